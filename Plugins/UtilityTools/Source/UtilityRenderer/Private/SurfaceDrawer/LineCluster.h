@@ -35,12 +35,14 @@ struct FSegmentCluster
 	FBox BoundingBox;			///< Χ
 	int32 SegmentStartIndex;	///< ߶ʼ
 	int32 PolygonIndex;			///< 
+	int32 PolylineClusterIndex;	///< еţ˳
 	int32 SegmentNumPerLOD[8];	///< ÿLOD߶	(4 * 8ֽ)
 
 	FSegmentCluster() = default;
 
 	FSegmentCluster(int32 InPolygonIndex)
 		: PolygonIndex(InPolygonIndex)
+		, PolylineClusterIndex(0)
 	{
 		BoundingBox = FBox(ForceInit);
 	}
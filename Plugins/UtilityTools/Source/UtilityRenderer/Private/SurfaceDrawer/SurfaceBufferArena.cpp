@@ -0,0 +1,443 @@
+﻿#include "SurfaceDrawer/SurfaceBufferArena.h"
+
+#include "Algo/BinarySearch.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "SurfaceDrawer/SurfaceBufferUpload.h"
+
+
+static TAutoConsoleVariable<int32> CVarSurfaceDrawerArenaDefragment(
+	TEXT("r.SurfaceDrawer.ArenaDefragment"),
+	1,
+	TEXT("没有几何数据上传时是否紧凑排列SurfaceLine/SurfacePolygon共享的几何缓冲区。\n")
+	TEXT(" 0: 不整理，缓冲区只增不减\n")
+	TEXT(" 1: 使用量低于容量的四分之一时在上传预算内分帧整理到更小的缓冲区（默认）"),
+	ECVF_RenderThreadSafe);
+
+std::atomic<int64> FSurfaceBufferArena::TotalCapacityBytes(0);
+std::atomic<int64> FSurfaceBufferArena::TotalUsedBytes(0);
+std::atomic<uint32> FSurfaceBufferArena::NumDefragments(0);
+
+namespace SurfaceBufferArena
+{
+	// 首次扩容时的最小容量（元素），避免少量数据时频繁扩容
+	static constexpr int32 MinCapacity = 256;
+
+	/// \brief 紧凑排列后的容量：保留与使用量相同的余量
+	///
+	/// 整理后使用量翻倍才会扩容，扩容后使用量还要降到容量的四分之一才再次整理，扩容和整理不会来回触发。
+	static int32 GetCompactCapacity(int32 InNumUsedElements)
+	{
+		return InNumUsedElements > 0 ? FMath::Max(InNumUsedElements * 2, MinCapacity) : 0;
+	}
+}
+
+int32 FSurfaceRangeAllocator::Allocate(int32 InNumElements)
+{
+	check(InNumElements > 0);
+
+	for (;;)
+	{
+		for (int32 Index = 0; Index < FreeRanges.Num(); ++Index)
+		{
+			FBlock& FreeRange = FreeRanges[Index];
+			if (FreeRange.Size < InNumElements)
+			{
+				continue;
+			}
+
+			const int32 Offset = FreeRange.Offset;
+			if (FreeRange.Size == InNumElements)
+			{
+				FreeRanges.RemoveAt(Index);
+			}
+			else
+			{
+				FreeRange.Offset += InNumElements;
+				FreeRange.Size -= InNumElements;
+			}
+
+			NumUsedElements += InNumElements;
+			return Allocations.Add({ Offset, InNumElements });
+		}
+
+		Grow(InNumElements);
+	}
+}
+
+void FSurfaceRangeAllocator::Free(int32 InHandle)
+{
+	if (InHandle == INDEX_NONE)
+	{
+		return;
+	}
+
+	check(Allocations.IsValidIndex(InHandle));
+	const FBlock Block = Allocations[InHandle];
+	Allocations.RemoveAt(InHandle);
+
+	NumUsedElements -= Block.Size;
+	AddFreeRange(Block.Offset, Block.Size);
+}
+
+bool FSurfaceRangeAllocator::ShouldCompact() const
+{
+	if (NumUsedElements == 0)
+	{
+		return Capacity > 0;
+	}
+
+	// 扩容只翻倍，使用量低于四分之一说明释放了大量分配；阈值与整理后的余量拉开距离，避免扩容和整理交替
+	return Capacity > SurfaceBufferArena::MinCapacity && NumUsedElements * 4 < Capacity
+		&& SurfaceBufferArena::GetCompactCapacity(NumUsedElements) < Capacity;
+}
+
+int32 FSurfaceRangeAllocator::PlanCompact(TArray<FMove>& OutMoves) const
+{
+	OutMoves.Reset();
+
+	TArray<int32> Handles;
+	GetHandlesByOffset(Handles);
+
+	int32 NextOffset = 0;
+	for (const int32 Handle : Handles)
+	{
+		const FBlock& Block = Allocations[Handle];
+
+		// 原来相邻的分配合并为一次拷贝
+		if (OutMoves.Num() > 0 && OutMoves.Last().SrcOffset + OutMoves.Last().Num == Block.Offset)
+		{
+			OutMoves.Last().Num += Block.Size;
+		}
+		else
+		{
+			OutMoves.Add({ Block.Offset, NextOffset, Block.Size });
+		}
+		NextOffset += Block.Size;
+	}
+
+	return SurfaceBufferArena::GetCompactCapacity(NumUsedElements);
+}
+
+void FSurfaceRangeAllocator::Compact(TArray<FMove>& OutMoves)
+{
+	Capacity = PlanCompact(OutMoves);
+
+	TArray<int32> Handles;
+	GetHandlesByOffset(Handles);
+
+	int32 NextOffset = 0;
+	for (const int32 Handle : Handles)
+	{
+		FBlock& Block = Allocations[Handle];
+		Block.Offset = NextOffset;
+		NextOffset += Block.Size;
+	}
+
+	FreeRanges.Reset();
+	if (Capacity > NumUsedElements)
+	{
+		FreeRanges.Add({ NumUsedElements, Capacity - NumUsedElements });
+	}
+}
+
+void FSurfaceRangeAllocator::Reset()
+{
+	Allocations.Empty();
+	FreeRanges.Empty();
+	Capacity = 0;
+	NumUsedElements = 0;
+}
+
+void FSurfaceRangeAllocator::GetHandlesByOffset(TArray<int32>& OutHandles) const
+{
+	OutHandles.Reset(Allocations.Num());
+	for (TSparseArray<FBlock>::TConstIterator It(Allocations); It; ++It)
+	{
+		OutHandles.Add(It.GetIndex());
+	}
+	OutHandles.Sort([this](int32 A, int32 B) { return Allocations[A].Offset < Allocations[B].Offset; });
+}
+
+void FSurfaceRangeAllocator::AddFreeRange(int32 InOffset, int32 InSize)
+{
+	const int32 Index = Algo::LowerBoundBy(FreeRanges, InOffset, [](const FBlock& Block) { return Block.Offset; });
+	const bool bMergePrev = Index > 0 && FreeRanges[Index - 1].Offset + FreeRanges[Index - 1].Size == InOffset;
+	const bool bMergeNext = Index < FreeRanges.Num() && InOffset + InSize == FreeRanges[Index].Offset;
+
+	if (bMergePrev && bMergeNext)
+	{
+		FreeRanges[Index - 1].Size += InSize + FreeRanges[Index].Size;
+		FreeRanges.RemoveAt(Index);
+	}
+	else if (bMergePrev)
+	{
+		FreeRanges[Index - 1].Size += InSize;
+	}
+	else if (bMergeNext)
+	{
+		FreeRanges[Index].Offset = InOffset;
+		FreeRanges[Index].Size += InSize;
+	}
+	else
+	{
+		FreeRanges.Insert({ InOffset, InSize }, Index);
+	}
+}
+
+void FSurfaceRangeAllocator::Grow(int32 InNumElements)
+{
+	// 末尾的空闲范围会与新增的空间合并，只需补足差额
+	const bool bTailFree = FreeRanges.Num() > 0 && FreeRanges.Last().Offset + FreeRanges.Last().Size == Capacity;
+	const int32 TailFreeElements = bTailFree ? FreeRanges.Last().Size : 0;
+	const int32 NewCapacity = FMath::Max3(Capacity * 2, Capacity - TailFreeElements + InNumElements, SurfaceBufferArena::MinCapacity);
+
+	AddFreeRange(Capacity, NewCapacity - Capacity);
+	Capacity = NewCapacity;
+}
+
+FSurfaceBufferArena::FSurfaceBufferArena(const TCHAR* InName, uint32 InBytesPerElement)
+	: Name(InName)
+	, BytesPerElement(InBytesPerElement)
+{
+}
+
+FSurfaceBufferArena::~FSurfaceBufferArena()
+{
+	Release();
+}
+
+int32 FSurfaceBufferArena::Allocate(int32 InNumElements)
+{
+	check(IsInRenderingThread());
+
+	CancelDefragment();
+	const int32 Allocation = Allocator.Allocate(FMath::Max(InNumElements, 1));
+	UpdateStats();
+	return Allocation;
+}
+
+void FSurfaceBufferArena::Free(int32& InOutAllocation)
+{
+	check(IsInRenderingThread());
+
+	if (InOutAllocation != INDEX_NONE)
+	{
+		CancelDefragment();
+		Allocator.Free(InOutAllocation);
+		InOutAllocation = INDEX_NONE;
+		UpdateStats();
+	}
+}
+
+FRDGBufferRef FSurfaceBufferArena::GetBuffer(FRDGBuilder& GraphBuilder)
+{
+	check(IsInRenderingThread());
+
+	const uint32 Capacity = static_cast<uint32>(FMath::Max(Allocator.GetCapacity(), 1));
+	if (PooledBuffer.IsValid() && PooledBuffer->Desc.NumElements >= Capacity)
+	{
+		return GraphBuilder.RegisterExternalBuffer(PooledBuffer);
+	}
+
+	FRDGBufferRef NewBuffer = GraphBuilder.CreateBuffer(
+		FRDGBufferDesc::CreateStructuredDesc(BytesPerElement, Capacity), Name, ERDGBufferFlags::MultiFrame);
+
+	// 扩容后原有的分配位置不变，只拷贝旧缓冲区中已分配的范围，相邻的分配合并为一次拷贝，空闲空间不拷贝。
+	// 拷贝不能推迟，但计入本帧的上传量，本帧之后的上传和整理相应减少
+	if (PooledBuffer.IsValid())
+	{
+		FRDGBufferRef OldBuffer = GraphBuilder.RegisterExternalBuffer(PooledBuffer);
+		const int32 NumOldElements = static_cast<int32>(PooledBuffer->Desc.NumElements);
+
+		TArray<FSurfaceRangeAllocator::FMove> Ranges;
+		Allocator.PlanCompact(Ranges);
+
+		uint64 NumCopiedBytes = 0;
+		for (const FSurfaceRangeAllocator::FMove& Range : Ranges)
+		{
+			// 扩容前分配、尚未写入的范围可能超出旧缓冲区
+			const int32 NumElements = FMath::Min(Range.SrcOffset + Range.Num, NumOldElements) - Range.SrcOffset;
+			if (NumElements > 0)
+			{
+				const uint64 ByteOffset = static_cast<uint64>(Range.SrcOffset) * BytesPerElement;
+				const uint64 NumBytes = static_cast<uint64>(NumElements) * BytesPerElement;
+				AddCopyBufferPass(GraphBuilder, NewBuffer, ByteOffset, OldBuffer, ByteOffset, NumBytes);
+				NumCopiedBytes += NumBytes;
+			}
+		}
+		FSurfaceBufferUpload::CommitFrameUpload(NumCopiedBytes);
+	}
+
+	PooledBuffer = GraphBuilder.ConvertToExternalBuffer(NewBuffer);
+	return NewBuffer;
+}
+
+FRDGBufferSRVRef FSurfaceBufferArena::GetSRV(FRDGBuilder& GraphBuilder)
+{
+	FRDGBufferRef Buffer = GetBuffer(GraphBuilder);
+	if (!SRV || SRVBuffer != Buffer)
+	{
+		SRV = GraphBuilder.CreateSRV(Buffer);
+		SRVBuffer = Buffer;
+	}
+	return SRV;
+}
+
+void FSurfaceBufferArena::ResetSRV()
+{
+	SRVBuffer = nullptr;
+	SRV = nullptr;
+}
+
+void FSurfaceBufferArena::Upload(FRDGBuilder& GraphBuilder, int32 InAllocation, int32 InElementOffset, const void* InData, int32 InNumElements)
+{
+	if (InNumElements <= 0)
+	{
+		return;
+	}
+
+	check(InElementOffset >= 0 && InElementOffset + InNumElements <= GetSize(InAllocation));
+
+	// 整理中已拷贝的范围不会再次拷贝，写入旧缓冲区后放弃整理
+	CancelDefragment();
+	const uint64 DestOffset = static_cast<uint64>(GetOffset(InAllocation) + InElementOffset) * BytesPerElement;
+	FSurfaceBufferUpload::AddRangeUpload(GraphBuilder, GetBuffer(GraphBuilder), DestOffset, InData, BytesPerElement, InNumElements);
+}
+
+void FSurfaceBufferArena::UploadDirtyRanges(FRDGBuilder& GraphBuilder, int32& InOutAllocation, const void* InData, int32 InNumElements, int32 InNumValidElements, const FSurfaceDirtyRanges& InDirtyRanges)
+{
+	check(IsInRenderingThread());
+	check(Allocator.IsValidHandle(InOutAllocation));
+
+	// 分配不足时按两倍重新分配，原有数据在GPU上拷贝，不重新上传
+	const int32 Size = GetSize(InOutAllocation);
+	if (InNumElements > Size)
+	{
+		int32 NewAllocation = Allocate(FMath::Max(InNumElements, Size * 2));
+
+		const int32 NumCopyElements = FMath::Min(InNumValidElements, Size);
+		if (NumCopyElements > 0)
+		{
+			// RDG不允许同一缓冲区同时作为拷贝的源和目标，经临时缓冲区中转
+			FRDGBufferRef Buffer = GetBuffer(GraphBuilder);
+			const uint64 NumBytes = static_cast<uint64>(NumCopyElements) * BytesPerElement;
+			FRDGBufferRef MoveBuffer = GraphBuilder.CreateBuffer(
+				FRDGBufferDesc::CreateStructuredDesc(BytesPerElement, NumCopyElements), TEXT("SurfaceArenaMove"));
+			AddCopyBufferPass(GraphBuilder, MoveBuffer, 0, Buffer, static_cast<uint64>(GetOffset(InOutAllocation)) * BytesPerElement, NumBytes);
+			AddCopyBufferPass(GraphBuilder, Buffer, static_cast<uint64>(GetOffset(NewAllocation)) * BytesPerElement, MoveBuffer, 0, NumBytes);
+			FSurfaceBufferUpload::CommitFrameUpload(NumBytes);
+		}
+
+		Free(InOutAllocation);
+		InOutAllocation = NewAllocation;
+	}
+
+	for (const FSurfaceDirtyRanges::FRange& Range : InDirtyRanges.GetRanges())
+	{
+		const int32 Start = FMath::Max(Range.Start, 0);
+		const int32 End = FMath::Min(Range.Start + Range.Num, InNumElements);
+		if (End > Start)
+		{
+			Upload(GraphBuilder, InOutAllocation, Start, static_cast<const uint8*>(InData) + static_cast<uint64>(Start) * BytesPerElement, End - Start);
+		}
+	}
+}
+
+bool FSurfaceBufferArena::Defragment(FRDGBuilder& GraphBuilder)
+{
+	check(IsInRenderingThread());
+
+	if (CVarSurfaceDrawerArenaDefragment.GetValueOnRenderThread() == 0)
+	{
+		CancelDefragment();
+		return false;
+	}
+
+	if (!DefragPooledBuffer.IsValid())
+	{
+		if (!Allocator.ShouldCompact())
+		{
+			return false;
+		}
+
+		if (Allocator.GetNumAllocations() == 0)
+		{
+			Release();
+			return false;
+		}
+
+		const int32 NewCapacity = Allocator.PlanCompact(DefragMoves);
+		DefragPooledBuffer = GraphBuilder.ConvertToExternalBuffer(GraphBuilder.CreateBuffer(
+			FRDGBufferDesc::CreateStructuredDesc(BytesPerElement, NewCapacity), Name, ERDGBufferFlags::MultiFrame));
+		DefragMoveIndex = 0;
+		DefragMovedElements = 0;
+	}
+
+	// 与几何数据上传共用每帧的预算，按整数个元素拷贝，预算用完时下一帧继续
+	FRDGBufferRef OldBuffer = GetBuffer(GraphBuilder);
+	FRDGBufferRef NewBuffer = GraphBuilder.RegisterExternalBuffer(DefragPooledBuffer);
+	while (DefragMoveIndex < DefragMoves.Num())
+	{
+		const FSurfaceRangeAllocator::FMove& Move = DefragMoves[DefragMoveIndex];
+		const uint64 AvailableBytes = FSurfaceBufferUpload::GetFrameBudget(BytesPerElement);
+		const int32 NumCopyElements = static_cast<int32>(FMath::Min<uint64>(AvailableBytes / BytesPerElement, Move.Num - DefragMovedElements));
+		if (NumCopyElements == 0)
+		{
+			return false;
+		}
+
+		const uint64 NumBytes = static_cast<uint64>(NumCopyElements) * BytesPerElement;
+		AddCopyBufferPass(GraphBuilder, NewBuffer, static_cast<uint64>(Move.DestOffset + DefragMovedElements) * BytesPerElement,
+			OldBuffer, static_cast<uint64>(Move.SrcOffset + DefragMovedElements) * BytesPerElement, NumBytes);
+		FSurfaceBufferUpload::CommitFrameUpload(NumBytes);
+
+		DefragMovedElements += NumCopyElements;
+		if (DefragMovedElements == Move.Num)
+		{
+			++DefragMoveIndex;
+			DefragMovedElements = 0;
+		}
+	}
+
+	// 全部拷贝完成，分配没有变化，紧凑排列得到与拷贝列表相同的偏移
+	TArray<FSurfaceRangeAllocator::FMove> Moves;
+	Allocator.Compact(Moves);
+	check(Moves.Num() == DefragMoves.Num());
+
+	PooledBuffer = MoveTemp(DefragPooledBuffer);
+	CancelDefragment();
+	NumDefragments.fetch_add(1, std::memory_order_relaxed);
+	UpdateStats();
+	return true;
+}
+
+void FSurfaceBufferArena::Release()
+{
+	CancelDefragment();
+	ResetSRV();
+	PooledBuffer.SafeRelease();
+	Allocator.Reset();
+	UpdateStats();
+}
+
+void FSurfaceBufferArena::CancelDefragment()
+{
+	DefragPooledBuffer.SafeRelease();
+	DefragMoves.Reset();
+	DefragMoveIndex = 0;
+	DefragMovedElements = 0;
+}
+
+void FSurfaceBufferArena::UpdateStats()
+{
+	const int64 CapacityBytes = static_cast<int64>(Allocator.GetCapacity()) * BytesPerElement;
+	const int64 UsedBytes = static_cast<int64>(Allocator.GetNumUsedElements()) * BytesPerElement;
+
+	TotalCapacityBytes.fetch_add(CapacityBytes - StatCapacityBytes, std::memory_order_relaxed);
+	TotalUsedBytes.fetch_add(UsedBytes - StatUsedBytes, std::memory_order_relaxed);
+	StatCapacityBytes = CapacityBytes;
+	StatUsedBytes = UsedBytes;
+}
@@ -0,0 +1,160 @@
+﻿#include "SurfaceDrawer/SurfaceBufferUpload.h"
+
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "Stats/Stats.h"
+#include "SurfaceDrawer/SurfaceBufferArena.h"
+
+
+DECLARE_STATS_GROUP(TEXT("SurfaceDrawer"), STATGROUP_SurfaceDrawer, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Upload Bytes (frame)"), STAT_SurfaceDrawerUploadBytes, STATGROUP_SurfaceDrawer);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Upload Chunks (frame)"), STAT_SurfaceDrawerUploadChunks, STATGROUP_SurfaceDrawer);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Upload Duration (ms)"), STAT_SurfaceDrawerLastUploadMs, STATGROUP_SurfaceDrawer);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Last Upload Frames"), STAT_SurfaceDrawerLastUploadFrames, STATGROUP_SurfaceDrawer);
+
+static TAutoConsoleVariable<int32> CVarSurfaceDrawerUploadBudgetKB(
+	TEXT("r.SurfaceDrawer.UploadBudgetKB"),
+	4096,
+	TEXT("SurfaceLine/SurfacePolygon几何数据每帧最多上传的数据量（KB），所有组件共用。\n")
+	TEXT(" 0: 不限制，几何数据变化后的下一帧上传全部缓冲区\n")
+	TEXT(" >0: 超出预算的缓冲区分多帧上传，上传完成前继续渲染旧数据（默认4096）"),
+	ECVF_RenderThreadSafe);
+
+std::atomic<uint64> FSurfaceBufferUpload::LastFrameUploadBytes(0);
+std::atomic<double> FSurfaceBufferUpload::LastUploadSeconds(0.0);
+std::atomic<uint32> FSurfaceBufferUpload::LastUploadFrames(0);
+
+namespace SurfaceBufferUpload
+{
+	// 本帧已上传的字节数，帧号变化时清零（仅渲染线程访问）
+	static uint32 BudgetFrameNumber = 0;
+	static uint64 FrameUploadBytes = 0;
+
+	/// \brief 帧号变化时保存上一个有上传的帧的上传量，并清零本帧的上传量
+	static void BeginFrame(std::atomic<uint64>& OutLastFrameUploadBytes)
+	{
+		if (BudgetFrameNumber != GFrameNumberRenderThread)
+		{
+			if (FrameUploadBytes > 0)
+			{
+				OutLastFrameUploadBytes.store(FrameUploadBytes, std::memory_order_relaxed);
+			}
+			BudgetFrameNumber = GFrameNumberRenderThread;
+			FrameUploadBytes = 0;
+		}
+	}
+}
+
+void FSurfaceBufferUpload::Begin(TConstArrayView<FSurfaceBufferUploadSource> InSources)
+{
+	check(IsInRenderingThread());
+
+	Sources.Reset();
+	Sources.Append(InSources.GetData(), InSources.Num());
+	SourceIndex = 0;
+	UploadedElements = 0;
+	StartTime = FPlatformTime::Seconds();
+	StartFrameNumber = GFrameNumberRenderThread;
+}
+
+bool FSurfaceBufferUpload::Advance(FRDGBuilder& GraphBuilder)
+{
+	check(IsInRenderingThread());
+
+	while (SourceIndex < Sources.Num())
+	{
+		const FSurfaceBufferUploadSource& Source = Sources[SourceIndex];
+		if (UploadedElements < Source.NumElements)
+		{
+			// 按整数个元素划分块，本帧预算用完时停止
+			const uint32 BytesPerElement = Source.Arena->GetBytesPerElement();
+			const uint64 AvailableBytes = GetFrameBudget(BytesPerElement);
+			const int32 NumChunkElements = static_cast<int32>(FMath::Min<uint64>(AvailableBytes / BytesPerElement, Source.NumElements - UploadedElements));
+			if (NumChunkElements == 0)
+			{
+				return false;
+			}
+
+			const uint64 ChunkOffset = static_cast<uint64>(UploadedElements) * BytesPerElement;
+			Source.Arena->Upload(GraphBuilder, Source.Allocation, UploadedElements, static_cast<const uint8*>(Source.Data) + ChunkOffset, NumChunkElements);
+
+			UploadedElements += NumChunkElements;
+			if (UploadedElements < Source.NumElements)
+			{
+				return false;
+			}
+		}
+		++SourceIndex;
+		UploadedElements = 0;
+	}
+
+	// 全部写入，记录本次上传的耗时
+	const double UploadSeconds = FPlatformTime::Seconds() - StartTime;
+	const uint32 UploadFrames = GFrameNumberRenderThread - StartFrameNumber + 1;
+	LastUploadSeconds.store(UploadSeconds, std::memory_order_relaxed);
+	LastUploadFrames.store(UploadFrames, std::memory_order_relaxed);
+	SET_FLOAT_STAT(STAT_SurfaceDrawerLastUploadMs, static_cast<float>(UploadSeconds * 1000.0));
+	SET_DWORD_STAT(STAT_SurfaceDrawerLastUploadFrames, UploadFrames);
+
+	Sources.Reset();
+	return true;
+}
+
+void FSurfaceBufferUpload::Reset()
+{
+	Sources.Reset();
+	SourceIndex = 0;
+	UploadedElements = 0;
+}
+
+void FSurfaceBufferUpload::AddRangeUpload(FRDGBuilder& GraphBuilder, FRDGBufferRef InDestBuffer, uint64 InDestOffset, const void* InData, uint32 InBytesPerElement, int32 InNumElements)
+{
+	if (InNumElements <= 0)
+	{
+		return;
+	}
+
+	const uint64 NumBytes = static_cast<uint64>(InNumElements) * InBytesPerElement;
+	FRDGBufferRef ChunkBuffer = GraphBuilder.CreateBuffer(
+		FRDGBufferDesc::CreateStructuredDesc(InBytesPerElement, InNumElements), TEXT("SurfaceUploadChunk"));
+	GraphBuilder.QueueBufferUpload(ChunkBuffer, InData, NumBytes);
+	AddCopyBufferPass(GraphBuilder, InDestBuffer, InDestOffset, ChunkBuffer, 0, NumBytes);
+
+	CommitFrameUpload(NumBytes);
+	INC_DWORD_STAT(STAT_SurfaceDrawerUploadChunks);
+}
+
+uint64 FSurfaceBufferUpload::GetBudgetBytes()
+{
+	const int32 BudgetKB = CVarSurfaceDrawerUploadBudgetKB.GetValueOnRenderThread();
+	return BudgetKB > 0 ? static_cast<uint64>(BudgetKB) * 1024 : MAX_uint64;
+}
+
+uint64 FSurfaceBufferUpload::GetFrameBudget(uint64 InMinBytes)
+{
+	check(IsInRenderingThread());
+	using namespace SurfaceBufferUpload;
+
+	BeginFrame(LastFrameUploadBytes);
+
+	const uint64 BudgetBytes = GetBudgetBytes();
+	if (BudgetBytes == MAX_uint64)
+	{
+		return MAX_uint64;
+	}
+
+	const uint64 RemainingBytes = BudgetBytes > FrameUploadBytes ? BudgetBytes - FrameUploadBytes : 0;
+	return FrameUploadBytes == 0 ? FMath::Max(RemainingBytes, InMinBytes) : RemainingBytes;
+}
+
+void FSurfaceBufferUpload::CommitFrameUpload(uint64 InNumBytes)
+{
+	check(IsInRenderingThread());
+	using namespace SurfaceBufferUpload;
+
+	BeginFrame(LastFrameUploadBytes);
+	FrameUploadBytes += InNumBytes;
+	INC_DWORD_STAT_BY(STAT_SurfaceDrawerUploadBytes, static_cast<uint32>(InNumBytes));
+}
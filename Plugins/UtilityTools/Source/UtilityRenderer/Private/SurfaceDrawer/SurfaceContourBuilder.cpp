@@ -0,0 +1,476 @@
+﻿#include "SurfaceDrawer/SurfaceContourBuilder.h"
+
+#include "Async/ParallelFor.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfaceContourBuilder, Log, All);
+
+namespace SurfaceContourBuilder
+{
+	static constexpr int32 DefaultTileSize = 128;		///< 默认分块边长（方格数），分块数据可以留在缓存中
+	static constexpr int32 MinTileSize = 8;				///< 最小分块边长
+
+	/// \brief 分块内拼接得到的折线段，端点以全局网格边为键
+	struct FTileChain
+	{
+		int32 Level;			///< 等值索引
+		int32 FirstVertex;		///< 首顶点在分块顶点数组中的偏移
+		int32 NumVertices;		///< 顶点数量
+		uint64 StartEdge;		///< 起点所在网格边
+		uint64 EndEdge;			///< 终点所在网格边
+		bool bClosed;			///< 是否已在分块内闭合
+	};
+
+	/// \brief 单个分块的输出
+	struct FTileOutput
+	{
+		TArray<FVector2f> Vertices;
+		TArray<FTileChain> Chains;
+		int32 NumSegments = 0;
+	};
+
+	/// \brief 全局网格边键：网格点索引左移一位，最低位表示竖直边
+	FORCEINLINE uint64 MakeEdgeKey(int32 X, int32 Y, int32 SizeX, bool bVertical)
+	{
+		return ((uint64(Y) * uint64(SizeX) + uint64(X)) << 1) | (bVertical ? 1 : 0);
+	}
+
+	/// \brief 计算等值与网格边的交点，只依赖边两端的数值，相邻分块结果一致
+	FORCEINLINE FVector2f GetEdgePoint(const FContourGridDesc& Grid, int32 X, int32 Y, bool bVertical, float Iso)
+	{
+		const int32 Index0 = Y * Grid.SizeX + X;
+		const int32 Index1 = bVertical ? Index0 + Grid.SizeX : Index0 + 1;
+		const float Value0 = Grid.Heights[Index0];
+		const float Value1 = Grid.Heights[Index1];
+		const double T = FMath::Clamp((double(Iso) - Value0) / (double(Value1) - Value0), 0.0, 1.0);
+
+		const double GridX = bVertical ? X : X + T;
+		const double GridY = bVertical ? Y + T : Y;
+		return FVector2f(FVector2D(Grid.Origin.X + GridX * Grid.CellSize.X, Grid.Origin.Y + GridY * Grid.CellSize.Y));
+	}
+
+	/// \brief 处理单个分块[X0, X1) x [Y0, Y1)内的全部方格
+	static void ProcessTile(const FContourGridDesc& Grid, TConstArrayView<float> IsoLevels, int32 X0, int32 Y0, int32 X1, int32 Y1, FTileOutput& Out)
+	{
+		const int32 Width = X1 - X0;
+		const int32 Height = Y1 - Y0;
+
+		// 分块覆盖的数值范围，范围外的等值直接跳过
+		float MinValue = TNumericLimits<float>::Max();
+		float MaxValue = TNumericLimits<float>::Lowest();
+		for (int32 Y = Y0; Y <= Y1; ++Y)
+		{
+			const float* Row = Grid.Heights.GetData() + Y * Grid.SizeX;
+			for (int32 X = X0; X <= X1; ++X)
+			{
+				MinValue = FMath::Min(MinValue, Row[X]);
+				MaxValue = FMath::Max(MaxValue, Row[X]);
+			}
+		}
+
+		// 分块内边的局部索引：水平边在前（Width * (Height + 1)），竖直边在后（(Width + 1) * Height）
+		const int32 NumHorizontalEdges = Width * (Height + 1);
+		const int32 NumLocalEdges = NumHorizontalEdges + (Width + 1) * Height;
+
+		auto DecodeLocalEdge = [&](int32 LocalEdge, int32& OutX, int32& OutY, bool& bOutVertical)
+		{
+			bOutVertical = LocalEdge >= NumHorizontalEdges;
+			if (bOutVertical)
+			{
+				const int32 Index = LocalEdge - NumHorizontalEdges;
+				OutX = X0 + Index % (Width + 1);
+				OutY = Y0 + Index / (Width + 1);
+			}
+			else
+			{
+				OutX = X0 + LocalEdge % Width;
+				OutY = Y0 + LocalEdge / Width;
+			}
+		};
+
+		// 每条边最多被两条线段共享（分块边界上的边只有一条）
+		TArray<int32> EdgeSegments;
+		EdgeSegments.Init(INDEX_NONE, NumLocalEdges * 2);
+		TArray<int32> TouchedEdges;
+		TArray<FIntPoint> Segments;
+		TArray<bool> SegmentVisited;
+
+		for (int32 Level = 0; Level < IsoLevels.Num(); ++Level)
+		{
+			const float Iso = IsoLevels[Level];
+			if (Iso < MinValue || Iso > MaxValue)
+			{
+				continue;
+			}
+
+			for (int32 TouchedEdge : TouchedEdges)
+			{
+				EdgeSegments[TouchedEdge * 2] = INDEX_NONE;
+				EdgeSegments[TouchedEdge * 2 + 1] = INDEX_NONE;
+			}
+			TouchedEdges.Reset();
+			Segments.Reset();
+
+			auto AddSegment = [&](int32 EdgeA, int32 EdgeB)
+			{
+				const int32 SegmentIndex = Segments.Add(FIntPoint(EdgeA, EdgeB));
+				for (int32 Edge : { EdgeA, EdgeB })
+				{
+					if (EdgeSegments[Edge * 2] == INDEX_NONE)
+					{
+						EdgeSegments[Edge * 2] = SegmentIndex;
+						TouchedEdges.Add(Edge);
+					}
+					else
+					{
+						EdgeSegments[Edge * 2 + 1] = SegmentIndex;
+					}
+				}
+			};
+
+			// 行进方格：角点0-3依次为(X,Y)、(X+1,Y)、(X+1,Y+1)、(X,Y+1)，边e连接角点e与e+1
+			for (int32 LocalY = 0; LocalY < Height; ++LocalY)
+			{
+				const float* Row0 = Grid.Heights.GetData() + (Y0 + LocalY) * Grid.SizeX + X0;
+				const float* Row1 = Row0 + Grid.SizeX;
+				for (int32 LocalX = 0; LocalX < Width; ++LocalX)
+				{
+					const int32 Case =
+						(Row0[LocalX] >= Iso ? 1 : 0) |
+						(Row0[LocalX + 1] >= Iso ? 2 : 0) |
+						(Row1[LocalX + 1] >= Iso ? 4 : 0) |
+						(Row1[LocalX] >= Iso ? 8 : 0);
+					if (Case == 0 || Case == 15)
+					{
+						continue;
+					}
+
+					const int32 LeftEdge = NumHorizontalEdges + LocalY * (Width + 1) + LocalX;
+					const int32 CellEdges[4] =
+					{
+						LocalY * Width + LocalX,		// 下
+						LeftEdge + 1,					// 右
+						(LocalY + 1) * Width + LocalX,	// 上
+						LeftEdge						// 左
+					};
+
+					if (Case == 5 || Case == 10)
+					{
+						// 鞍点：中心值高于等值时两个高角点相连，否则两个低角点相连
+						const float Center = (Row0[LocalX] + Row0[LocalX + 1] + Row1[LocalX + 1] + Row1[LocalX]) * 0.25f;
+						if ((Case == 5) == (Center >= Iso))
+						{
+							AddSegment(CellEdges[0], CellEdges[1]);
+							AddSegment(CellEdges[2], CellEdges[3]);
+						}
+						else
+						{
+							AddSegment(CellEdges[3], CellEdges[0]);
+							AddSegment(CellEdges[1], CellEdges[2]);
+						}
+						continue;
+					}
+
+					int32 CrossedEdges[2];
+					int32 NumCrossed = 0;
+					for (int32 Edge = 0; Edge < 4; ++Edge)
+					{
+						if (((Case >> Edge) ^ (Case >> ((Edge + 1) & 3))) & 1)
+						{
+							CrossedEdges[NumCrossed++] = CellEdges[Edge];
+						}
+					}
+					AddSegment(CrossedEdges[0], CrossedEdges[1]);
+				}
+			}
+
+			if (Segments.Num() == 0)
+			{
+				continue;
+			}
+			Out.NumSegments += Segments.Num();
+
+			// 沿共享边把线段串成折线段
+			SegmentVisited.Reset();
+			SegmentVisited.SetNumZeroed(Segments.Num());
+
+			auto WalkChain = [&](int32 StartSegment, int32 StartEdge)
+			{
+				FTileChain& Chain = Out.Chains.AddDefaulted_GetRef();
+				Chain.Level = Level;
+				Chain.FirstVertex = Out.Vertices.Num();
+
+				int32 EdgeX, EdgeY;
+				bool bEdgeVertical;
+				DecodeLocalEdge(StartEdge, EdgeX, EdgeY, bEdgeVertical);
+				Chain.StartEdge = MakeEdgeKey(EdgeX, EdgeY, Grid.SizeX, bEdgeVertical);
+				Out.Vertices.Add(GetEdgePoint(Grid, EdgeX, EdgeY, bEdgeVertical, Iso));
+
+				int32 Segment = StartSegment;
+				int32 Edge = StartEdge;
+				for (;;)
+				{
+					SegmentVisited[Segment] = true;
+					const int32 NextEdge = Segments[Segment].X == Edge ? Segments[Segment].Y : Segments[Segment].X;
+					DecodeLocalEdge(NextEdge, EdgeX, EdgeY, bEdgeVertical);
+					Out.Vertices.Add(GetEdgePoint(Grid, EdgeX, EdgeY, bEdgeVertical, Iso));
+
+					const int32 NextSegment = EdgeSegments[NextEdge * 2] == Segment ? EdgeSegments[NextEdge * 2 + 1] : EdgeSegments[NextEdge * 2];
+					if (NextSegment == INDEX_NONE || SegmentVisited[NextSegment])
+					{
+						Chain.EndEdge = MakeEdgeKey(EdgeX, EdgeY, Grid.SizeX, bEdgeVertical);
+						Chain.bClosed = NextEdge == StartEdge;
+						break;
+					}
+					Segment = NextSegment;
+					Edge = NextEdge;
+				}
+				Chain.NumVertices = Out.Vertices.Num() - Chain.FirstVertex;
+			};
+
+			// 先从只连接一条线段的边（分块或网格边界）出发得到开放折线段，剩余线段构成分块内的闭合环
+			for (int32 TouchedEdge : TouchedEdges)
+			{
+				const int32 Segment = EdgeSegments[TouchedEdge * 2];
+				if (EdgeSegments[TouchedEdge * 2 + 1] == INDEX_NONE && !SegmentVisited[Segment])
+				{
+					WalkChain(Segment, TouchedEdge);
+				}
+			}
+			for (int32 Segment = 0; Segment < Segments.Num(); ++Segment)
+			{
+				if (!SegmentVisited[Segment])
+				{
+					WalkChain(Segment, Segments[Segment].X);
+				}
+			}
+		}
+	}
+
+	/// \brief 开放折线段的引用
+	struct FChainRef
+	{
+		const FTileOutput* Tile;
+		const FTileChain* Chain;
+	};
+
+	/// \brief 拼接同一等值在不同分块中的折线段
+	static void StitchLevel(TConstArrayView<FTileOutput> TileOutputs, int32 Level, FContourPolylineSet& Out)
+	{
+		auto AppendChain = [&Out](const FChainRef& Ref, bool bForward, bool bSkipFirst)
+		{
+			const FVector2f* ChainVertices = Ref.Tile->Vertices.GetData() + Ref.Chain->FirstVertex;
+			const int32 NumVertices = Ref.Chain->NumVertices;
+			for (int32 Index = bSkipFirst ? 1 : 0; Index < NumVertices; ++Index)
+			{
+				Out.Vertices.Add(ChainVertices[bForward ? Index : NumVertices - 1 - Index]);
+			}
+		};
+
+		// 分块内闭合的折线直接输出，开放折线段以端点所在边建立连接关系
+		TArray<FChainRef> OpenChains;
+		for (const FTileOutput& TileOutput : TileOutputs)
+		{
+			for (const FTileChain& Chain : TileOutput.Chains)
+			{
+				if (Chain.Level != Level)
+				{
+					continue;
+				}
+
+				const FChainRef Ref{ &TileOutput, &Chain };
+				if (Chain.bClosed)
+				{
+					Out.PolylineOffsets.Add(Out.Vertices.Num());
+					Out.PolylineLevels.Add(Level);
+					AppendChain(Ref, true, false);
+				}
+				else
+				{
+					OpenChains.Add(Ref);
+				}
+			}
+		}
+
+		if (OpenChains.Num() == 0)
+		{
+			return;
+		}
+
+		// 端点编码为 ChainIndex * 2 + (0: 起点, 1: 终点)，每条边最多连接两个端点
+		TMap<uint64, FIntPoint> EdgeLinks;
+		EdgeLinks.Reserve(OpenChains.Num() * 2);
+		for (int32 ChainIndex = 0; ChainIndex < OpenChains.Num(); ++ChainIndex)
+		{
+			for (int32 End = 0; End < 2; ++End)
+			{
+				const uint64 EdgeKey = End == 0 ? OpenChains[ChainIndex].Chain->StartEdge : OpenChains[ChainIndex].Chain->EndEdge;
+				FIntPoint* Link = EdgeLinks.Find(EdgeKey);
+				if (Link)
+				{
+					Link->Y = ChainIndex * 2 + End;
+				}
+				else
+				{
+					EdgeLinks.Add(EdgeKey, FIntPoint(ChainIndex * 2 + End, INDEX_NONE));
+				}
+			}
+		}
+
+		auto GetPartner = [&](int32 ChainIndex, int32 End) -> int32
+		{
+			const uint64 EdgeKey = End == 0 ? OpenChains[ChainIndex].Chain->StartEdge : OpenChains[ChainIndex].Chain->EndEdge;
+			const FIntPoint& Link = EdgeLinks.FindChecked(EdgeKey);
+			return Link.X == ChainIndex * 2 + End ? Link.Y : Link.X;
+		};
+
+		TArray<bool> ChainVisited;
+		ChainVisited.SetNumZeroed(OpenChains.Num());
+
+		auto EmitPolyline = [&](int32 StartChain, bool bStartForward)
+		{
+			Out.PolylineOffsets.Add(Out.Vertices.Num());
+			Out.PolylineLevels.Add(Level);
+
+			int32 ChainIndex = StartChain;
+			bool bForward = bStartForward;
+			bool bFirst = true;
+			for (;;)
+			{
+				ChainVisited[ChainIndex] = true;
+				AppendChain(OpenChains[ChainIndex], bForward, !bFirst);
+				bFirst = false;
+
+				const int32 Partner = GetPartner(ChainIndex, bForward ? 1 : 0);
+				if (Partner == INDEX_NONE || ChainVisited[Partner / 2])
+				{
+					break;
+				}
+				ChainIndex = Partner / 2;
+				bForward = (Partner & 1) == 0;
+			}
+		};
+
+		// 先从没有相连端点的折线段出发，剩余折线段构成跨分块的闭合环
+		for (int32 ChainIndex = 0; ChainIndex < OpenChains.Num(); ++ChainIndex)
+		{
+			if (ChainVisited[ChainIndex])
+			{
+				continue;
+			}
+			if (GetPartner(ChainIndex, 0) == INDEX_NONE)
+			{
+				EmitPolyline(ChainIndex, true);
+			}
+			else if (GetPartner(ChainIndex, 1) == INDEX_NONE)
+			{
+				EmitPolyline(ChainIndex, false);
+			}
+		}
+		for (int32 ChainIndex = 0; ChainIndex < OpenChains.Num(); ++ChainIndex)
+		{
+			if (!ChainVisited[ChainIndex])
+			{
+				EmitPolyline(ChainIndex, true);
+			}
+		}
+	}
+}
+
+bool FSurfaceContourBuilder::Build(
+	const FContourGridDesc& InGrid,
+	TConstArrayView<float> InIsoLevels,
+	FContourPolylineSet& OutPolylines,
+	int32 InTileSize,
+	FContourBuildStats* OutStats)
+{
+	using namespace SurfaceContourBuilder;
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	OutPolylines.Reset();
+	if (OutStats)
+	{
+		*OutStats = FContourBuildStats();
+	}
+
+	if (InGrid.SizeX < 2 || InGrid.SizeY < 2 || InGrid.Heights.Num() != InGrid.SizeX * InGrid.SizeY)
+	{
+		UE_LOG(LogSurfaceContourBuilder, Warning, TEXT("网格尺寸无效: %d x %d, 数值数量=%d"), InGrid.SizeX, InGrid.SizeY, InGrid.Heights.Num());
+		return false;
+	}
+	if (InIsoLevels.Num() == 0)
+	{
+		return false;
+	}
+
+	const int32 NumCellsX = InGrid.SizeX - 1;
+	const int32 NumCellsY = InGrid.SizeY - 1;
+	const int32 TileSize = FMath::Max(InTileSize > 0 ? InTileSize : DefaultTileSize, MinTileSize);
+	const int32 NumTilesX = FMath::DivideAndRoundUp(NumCellsX, TileSize);
+	const int32 NumTilesY = FMath::DivideAndRoundUp(NumCellsY, TileSize);
+	const int32 NumTiles = NumTilesX * NumTilesY;
+
+	// 分块并行生成线段并在分块内拼接
+	TArray<FTileOutput> TileOutputs;
+	TileOutputs.SetNum(NumTiles);
+	ParallelFor(NumTiles, [&](int32 TileIndex)
+		{
+			const int32 X0 = (TileIndex % NumTilesX) * TileSize;
+			const int32 Y0 = (TileIndex / NumTilesX) * TileSize;
+			const int32 X1 = FMath::Min(X0 + TileSize, NumCellsX);
+			const int32 Y1 = FMath::Min(Y0 + TileSize, NumCellsY);
+			ProcessTile(InGrid, InIsoLevels, X0, Y0, X1, Y1, TileOutputs[TileIndex]);
+		},
+		NumTiles < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// 按等值并行拼接跨分块的折线段
+	const int32 NumLevels = InIsoLevels.Num();
+	TArray<FContourPolylineSet> LevelOutputs;
+	LevelOutputs.SetNum(NumLevels);
+	ParallelFor(NumLevels, [&](int32 Level)
+		{
+			StitchLevel(TileOutputs, Level, LevelOutputs[Level]);
+		},
+		NumLevels < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// 按等值顺序拼接，结果与线程调度无关
+	int32 NumVertices = 0;
+	int32 NumPolylines = 0;
+	for (const FContourPolylineSet& LevelOutput : LevelOutputs)
+	{
+		NumVertices += LevelOutput.Vertices.Num();
+		NumPolylines += LevelOutput.Num();
+	}
+	OutPolylines.Vertices.Reserve(NumVertices);
+	OutPolylines.PolylineOffsets.Reserve(NumPolylines + 1);
+	OutPolylines.PolylineLevels.Reserve(NumPolylines);
+	for (const FContourPolylineSet& LevelOutput : LevelOutputs)
+	{
+		const int32 VertexOffset = OutPolylines.Vertices.Num();
+		for (int32 Offset : LevelOutput.PolylineOffsets)
+		{
+			OutPolylines.PolylineOffsets.Add(VertexOffset + Offset);
+		}
+		OutPolylines.PolylineLevels.Append(LevelOutput.PolylineLevels);
+		OutPolylines.Vertices.Append(LevelOutput.Vertices);
+	}
+	OutPolylines.PolylineOffsets.Add(OutPolylines.Vertices.Num());
+
+	const double BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	if (OutStats)
+	{
+		OutStats->NumTiles = NumTiles;
+		OutStats->NumPolylines = NumPolylines;
+		OutStats->BuildTimeMs = BuildTimeMs;
+		for (const FTileOutput& TileOutput : TileOutputs)
+		{
+			OutStats->NumSegments += TileOutput.NumSegments;
+		}
+	}
+
+	UE_LOG(LogSurfaceContourBuilder, Log, TEXT("等值线生成完成: 网格=%d x %d, 等值数=%d, 分块数=%d, 折线数=%d, 顶点数=%d, 耗时: %.2f ms"),
+		InGrid.SizeX, InGrid.SizeY, NumLevels, NumTiles, NumPolylines, NumVertices, BuildTimeMs);
+
+	return NumPolylines > 0;
+}
@@ -0,0 +1,82 @@
+﻿#include "SurfaceDrawer/SurfaceCoverageCache.h"
+
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphBuilder.h"
+#include "SceneView.h"
+#include "SystemTextures.h"
+
+
+static TAutoConsoleVariable<int32> CVarSurfaceDrawerCoverageCache(
+	TEXT("r.SurfaceDrawer.CoverageCache"),
+	0,
+	TEXT("SurfaceLine/SurfacePolygon是否在主视图中缓存逐像素的覆盖结果。\n")
+	TEXT(" 0: 每帧逐像素遍历BVH（默认）\n")
+	TEXT(" 1: 相机、视口、数据和参数都不变时复用上一帧的覆盖结果，只重新合成颜色，深度变化的像素重新遍历BVH；\n")
+	TEXT("    每个组件额外占用一张与其屏幕范围同样大小的RGBA32整数纹理，组件各自使用全屏像素着色器Pass（不合并、不分块）"),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarSurfaceDrawerCoverageCacheDepthTolerance(
+	TEXT("r.SurfaceDrawer.CoverageCacheDepthTolerance"),
+	0.01f,
+	TEXT("覆盖缓存复用上一帧结果时设备深度允许的相对差，用于吸收TAA/TSR抖动引起的深度变化。\n")
+	TEXT(" 0: 只复用深度完全相同的像素，开启抖动时几乎不命中\n")
+	TEXT(" >0: 相对差不超过该值的像素复用上一帧的结果（默认0.01）"),
+	ECVF_RenderThreadSafe);
+
+std::atomic<uint64> FSurfaceCoverageCache::NumHits(0);
+std::atomic<uint64> FSurfaceCoverageCache::NumMisses(0);
+
+bool FSurfaceCoverageCache::IsEnabled()
+{
+	return CVarSurfaceDrawerCoverageCache.GetValueOnRenderThread() != 0;
+}
+
+FMatrix FSurfaceCoverageCache::GetUnjitteredViewProjection(const FSceneView& InView)
+{
+	return InView.ViewMatrices.GetViewMatrix() * InView.ViewMatrices.ComputeProjectionNoAAMatrix();
+}
+
+void FSurfaceCoverageCache::AddCoverageTexture(FRDGBuilder& GraphBuilder, const FSurfaceCoverageCacheKey& InKey, FSurfaceCoverageCacheParameters& OutParameters)
+{
+	check(IsInRenderingThread());
+
+	const bool bHit = HistoryTexture.IsValid() && Key == InKey;
+	if (bHit)
+	{
+		NumHits.fetch_add(1, std::memory_order_relaxed);
+		OutParameters.CoverageHistoryTexture = GraphBuilder.RegisterExternalTexture(HistoryTexture);
+	}
+	else
+	{
+		NumMisses.fetch_add(1, std::memory_order_relaxed);
+		OutParameters.CoverageHistoryTexture = GSystemTextures.GetZeroUIntDummy(GraphBuilder);
+	}
+	OutParameters.bCoverageHistoryValid = bHit;
+	OutParameters.CoverageOrigin = InKey.ScissorRect.Min;
+	OutParameters.CoverageDepthTolerance = FMath::Max(CVarSurfaceDrawerCoverageCacheDepthTolerance.GetValueOnRenderThread(), 0.0f);
+
+	// 全屏Pass只在ScissorRect内执行，覆盖纹理只需该范围大小；ScissorRect是缓存键的一部分，命中时两帧的原点相同
+	const FRDGTextureDesc CoverageDesc = FRDGTextureDesc::Create2D(
+		InKey.ScissorRect.Size().ComponentMax(FIntPoint(1, 1)),
+		CoverageTextureFormat,
+		FClearValueBinding::None,
+		TexCreate_UAV | TexCreate_ShaderResource);
+	FRDGTextureRef CoverageTexture = GraphBuilder.CreateTexture(CoverageDesc, TEXT("SurfaceCoverageTexture"));
+	OutParameters.CoverageOutputTexture = GraphBuilder.CreateUAV(CoverageTexture);
+	GraphBuilder.QueueTextureExtraction(CoverageTexture, &HistoryTexture);
+	Key = InKey;
+}
+
+void FSurfaceCoverageCache::Release_RenderThread()
+{
+	check(IsInRenderingThread());
+
+	HistoryTexture.SafeRelease();
+	Key = FSurfaceCoverageCacheKey();
+}
+
+void FSurfaceCoverageCache::ResetCounters()
+{
+	NumHits.store(0, std::memory_order_relaxed);
+	NumMisses.store(0, std::memory_order_relaxed);
+}
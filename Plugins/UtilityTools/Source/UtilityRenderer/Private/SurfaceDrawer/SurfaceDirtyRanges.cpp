@@ -0,0 +1,58 @@
+﻿#include "SurfaceDrawer/SurfaceDirtyRanges.h"
+
+
+void FSurfaceDirtyRanges::Add(int32 InStart, int32 InNum)
+{
+	if (InNum <= 0)
+	{
+		return;
+	}
+
+	// 连续追加的范围（例如逐个标记相邻元素）直接延长上一个范围
+	if (Ranges.Num() > 0)
+	{
+		FRange& Last = Ranges.Last();
+		if (InStart >= Last.Start && InStart <= Last.Start + Last.Num)
+		{
+			Last.Num = FMath::Max(Last.Num, InStart + InNum - Last.Start);
+			return;
+		}
+	}
+	Ranges.Add({ InStart, InNum });
+}
+
+void FSurfaceDirtyRanges::Normalize(int32 InMaxGap)
+{
+	if (Ranges.Num() < 2)
+	{
+		return;
+	}
+
+	Ranges.Sort([](const FRange& A, const FRange& B) { return A.Start < B.Start; });
+
+	int32 NumMerged = 0;
+	for (int32 Index = 1; Index < Ranges.Num(); ++Index)
+	{
+		FRange& Merged = Ranges[NumMerged];
+		const FRange& Range = Ranges[Index];
+		if (Range.Start <= Merged.Start + Merged.Num + InMaxGap)
+		{
+			Merged.Num = FMath::Max(Merged.Num, Range.Start + Range.Num - Merged.Start);
+		}
+		else
+		{
+			Ranges[++NumMerged] = Range;
+		}
+	}
+	Ranges.SetNum(NumMerged + 1);
+}
+
+int32 FSurfaceDirtyRanges::GetNumElements() const
+{
+	int32 NumElements = 0;
+	for (const FRange& Range : Ranges)
+	{
+		NumElements += Range.Num;
+	}
+	return NumElements;
+}
@@ -0,0 +1,175 @@
+﻿#include "SurfaceDrawer/SurfaceFrustumCulling.h"
+#include "SurfaceDrawer/SurfaceScreenBounds.h"
+
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphBuilder.h"
+
+
+static TAutoConsoleVariable<int32> CVarSurfaceDrawerSeedCullLevels(
+	TEXT("r.SurfaceDrawer.SeedCullLevels"),
+	4,
+	TEXT("SurfaceLine/SurfacePolygon每帧在CPU上按视图覆盖范围剔除BVH的层数，着色器从剩余子树的根节点开始遍历。\n")
+	TEXT(" 0: 不剔除，着色器从根节点开始遍历\n")
+	TEXT(" 1-4: 剔除前N层，最多2^N个起始子树（默认4）"),
+	ECVF_RenderThreadSafe);
+
+namespace SurfaceFrustumCulling
+{
+	/// \brief 遍历栈容量
+	static constexpr int32 MaxStackNum = 64;
+
+	/// \brief 待处理的节点及其层数
+	struct FStackEntry
+	{
+		int32 NodeIndex;
+		int32 Level;
+	};
+
+	/// \brief 节点的XY范围，按世界单位外扩
+	FORCEINLINE FBox2D MakeNodeRect(const FVector3f& InMinExtent, const FVector3f& InMaxExtent, float InWorldPadding)
+	{
+		const double Padding = FMath::Max(InWorldPadding, 0.0f);
+		return FBox2D(
+			FVector2D(InMinExtent.X - Padding, InMinExtent.Y - Padding),
+			FVector2D(InMaxExtent.X + Padding, InMaxExtent.Y + Padding));
+	}
+
+	/// \brief 读取剔除层数，关闭时返回0
+	static int32 GetSeedCullLevels()
+	{
+		return FMath::Clamp(CVarSurfaceDrawerSeedCullLevels.GetValueOnAnyThread(), 0, FSurfaceFrustumCulling::MaxSeedLevels);
+	}
+}
+
+void FSurfaceFrustumCulling::CullLineSubtrees(TConstArrayView<FGPULineBVHNode> InNodes, const FSurfaceViewFootprint& InFootprint, float InWorldPadding, int32 InNumLevels, TArray<uint32>& OutSeedNodes)
+{
+	using namespace SurfaceFrustumCulling;
+
+	OutSeedNodes.Reset();
+	if (InNodes.IsEmpty())
+	{
+		return;
+	}
+
+	// 层数不超过MaxSeedLevels，起始子树数量不超过着色器预留的栈容量
+	InNumLevels = FMath::Min(InNumLevels, MaxSeedLevels);
+
+	// 与着色器的QueryBVH一致：先压左子节点，右子节点先出栈
+	FStackEntry Stack[MaxStackNum];
+	int32 StackPtr = 0;
+	Stack[StackPtr++] = { 0, 0 };
+	while (StackPtr > 0)
+	{
+		const FStackEntry Entry = Stack[--StackPtr];
+		const FGPULineBVHNode& Node = InNodes[Entry.NodeIndex];
+
+		// 与着色器的IsValidNode一致
+		if (Node.LeftChild == -1 && Node.RightChild == -1 && Node.IsLeaf == 0)
+		{
+			continue;
+		}
+
+		if (!InFootprint.IntersectsBox(MakeNodeRect(Node.MinExtent, Node.MaxExtent, InWorldPadding)))
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf == 1 || Entry.Level >= InNumLevels)
+		{
+			OutSeedNodes.Add(Entry.NodeIndex);
+			continue;
+		}
+
+		if (Node.LeftChild != -1)
+		{
+			Stack[StackPtr++] = { Node.LeftChild, Entry.Level + 1 };
+		}
+		if (Node.RightChild != -1)
+		{
+			Stack[StackPtr++] = { Node.RightChild, Entry.Level + 1 };
+		}
+	}
+}
+
+void FSurfaceFrustumCulling::CullPolygonSubtrees(TConstArrayView<FGPUPolygonBVHNode> InNodes, TConstArrayView<uint32> InNodeLayerMasks, uint32 InVisibleLayers, const FSurfaceViewFootprint& InFootprint,
+	int32 InNumLevels, TArray<uint32>& OutSeedNodes)
+{
+	using namespace SurfaceFrustumCulling;
+
+	OutSeedNodes.Reset();
+	if (InNodes.IsEmpty())
+	{
+		return;
+	}
+
+	InNumLevels = FMath::Min(InNumLevels, MaxSeedLevels);
+
+	// 与着色器的QueryBVH一致：先压右子节点，左子节点先出栈
+	FStackEntry Stack[MaxStackNum];
+	int32 StackPtr = 0;
+	Stack[StackPtr++] = { 0, 0 };
+	while (StackPtr > 0)
+	{
+		const FStackEntry Entry = Stack[--StackPtr];
+		const FGPUPolygonBVHNode& Node = InNodes[Entry.NodeIndex];
+
+		if (InNodeLayerMasks.IsValidIndex(Entry.NodeIndex) && (InNodeLayerMasks[Entry.NodeIndex] & InVisibleLayers) == 0)
+		{
+			continue;
+		}
+
+		if (!InFootprint.IntersectsBox(MakeNodeRect(Node.MinExtent, Node.MaxExtent, 0.0f)))
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf() || Entry.Level >= InNumLevels)
+		{
+			OutSeedNodes.Add(Entry.NodeIndex);
+			continue;
+		}
+
+		Stack[StackPtr++] = { Node.GetRightChild(Entry.NodeIndex), Entry.Level + 1 };
+		Stack[StackPtr++] = { FGPUPolygonBVHNode::GetLeftChild(Entry.NodeIndex), Entry.Level + 1 };
+	}
+}
+
+void FSurfaceFrustumCulling::CalculateLineSeedNodes(const FGPULineData& InData, const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, float InWorldPadding, float InPixelPadding, TArray<uint32>& OutSeedNodes)
+{
+	const int32 NumLevels = SurfaceFrustumCulling::GetSeedCullLevels();
+	if (NumLevels <= 0)
+	{
+		OutSeedNodes.Reset();
+		OutSeedNodes.Add(0);
+		return;
+	}
+
+	const FSurfaceViewFootprint Footprint = FSurfaceViewFootprint::FromViewProjection(InViewProjMatrix, InViewportRect.Size(), InPixelPadding);
+	CullLineSubtrees(InData.Nodes, Footprint, InWorldPadding, NumLevels, OutSeedNodes);
+}
+
+void FSurfaceFrustumCulling::CalculatePolygonSeedNodes(const FGPUPolygonData& InData, TConstArrayView<uint32> InNodeLayerMasks, uint32 InVisibleLayers, const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, TArray<uint32>& OutSeedNodes)
+{
+	const int32 NumLevels = SurfaceFrustumCulling::GetSeedCullLevels();
+	if (NumLevels <= 0)
+	{
+		OutSeedNodes.Reset();
+		OutSeedNodes.Add(0);
+		return;
+	}
+
+	const FSurfaceViewFootprint Footprint = FSurfaceViewFootprint::FromViewProjection(InViewProjMatrix, InViewportRect.Size(), 0.0f);
+	CullPolygonSubtrees(InData.Nodes, InNodeLayerMasks, InVisibleLayers, Footprint, NumLevels, OutSeedNodes);
+}
+
+FRDGBufferSRVRef FSurfaceFrustumCulling::CreateSeedNodesSRV(FRDGBuilder& GraphBuilder, const TCHAR* InName, TConstArrayView<uint32> InSeedNodes)
+{
+	check(InSeedNodes.Num() <= MaxSeedNodes);
+
+	static const uint32 PlaceholderSeedNode = 0;
+	const int32 NumElements = FMath::Max(InSeedNodes.Num(), 1);
+	FRDGBuffer* SeedNodesBuffer = GraphBuilder.CreateBuffer(
+		FRDGBufferDesc::CreateStructuredDesc(sizeof(uint32), NumElements), InName);
+	GraphBuilder.QueueBufferUpload(SeedNodesBuffer, InSeedNodes.Num() > 0 ? InSeedNodes.GetData() : &PlaceholderSeedNode, NumElements * sizeof(uint32));
+	return GraphBuilder.CreateSRV(SeedNodesBuffer);
+}
@@ -0,0 +1,953 @@
+﻿#include "SurfaceDrawer/SurfaceGeoJsonImporter.h"
+
+#include "Algo/Reverse.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfaceGeoJsonImporter, Log, All);
+
+namespace SurfaceGeoJsonImporter
+{
+	static constexpr int32 DefaultFeaturesPerBatch = 1024;	///< 默认每批要素数量
+	static constexpr int32 BatchesPerWorker = 2;			///< 每轮并行解析的批次数为工作线程数的倍数
+	static constexpr int32 MinLineVertices = 2;				///< 折线最少顶点数
+	static constexpr int32 MinRingVertices = 4;				///< 多边形环最少顶点数（三角形加上重复的首顶点）
+	static constexpr int32 MaxGeometryDepth = 8;			///< GeometryCollection最大嵌套层数
+	static constexpr double EarthRadius = 6378137.0;		///< WGS84长半轴（米）
+	static constexpr uint64 MaxMantissa = 100000000000000000ull;	///< 尾数超过该值后忽略后续小数位
+
+	/// \brief 要素在缓冲区中的字节范围
+	struct FFeatureSpan
+	{
+		int64 Begin;
+		int64 End;
+	};
+
+	/// \brief 预先计算比例的投影
+	struct FProjector
+	{
+		double OriginX;
+		double OriginY;
+		double ScaleX;
+		double ScaleY;
+
+		explicit FProjector(const FGeoJsonProjection& InProjection)
+			: OriginX(InProjection.Origin.X), OriginY(InProjection.Origin.Y)
+		{
+			// 北向取负，Y轴指向南
+			const double MetersPerUnitX = InProjection.bProjectedMeters ? 1.0 : EarthRadius * FMath::DegreesToRadians(1.0) * FMath::Cos(FMath::DegreesToRadians(InProjection.Origin.Y));
+			const double MetersPerUnitY = InProjection.bProjectedMeters ? 1.0 : EarthRadius * FMath::DegreesToRadians(1.0);
+			ScaleX = MetersPerUnitX * InProjection.UnitsPerMeter;
+			ScaleY = -MetersPerUnitY * InProjection.UnitsPerMeter;
+		}
+
+		FORCEINLINE FVector2f Project(double X, double Y) const
+		{
+			return FVector2f(static_cast<float>((X - OriginX) * ScaleX), static_cast<float>((Y - OriginY) * ScaleY));
+		}
+	};
+
+	FORCEINLINE bool IsWhitespace(ANSICHAR Char)
+	{
+		return Char == ' ' || Char == '\n' || Char == '\r' || Char == '\t';
+	}
+
+	FORCEINLINE bool IsDigit(ANSICHAR Char)
+	{
+		return Char >= '0' && Char <= '9';
+	}
+
+	/// \brief 区分大小写比较，键和几何类型都按原始字节比较
+	FORCEINLINE bool NameEquals(FAnsiStringView A, FAnsiStringView B)
+	{
+		return A.Len() == B.Len() && FMemory::Memcmp(A.GetData(), B.GetData(), A.Len()) == 0;
+	}
+
+	/// \brief 从字符串内容的第一个字符开始查找结束引号，未找到时返回nullptr
+	static const ANSICHAR* FindStringEnd(const ANSICHAR* Current, const ANSICHAR* End)
+	{
+		const ANSICHAR* SearchBegin = Current;
+		while (Current < End)
+		{
+			const ANSICHAR* Quote = static_cast<const ANSICHAR*>(memchr(Current, '"', End - Current));
+			if (!Quote)
+			{
+				return nullptr;
+			}
+
+			// 引号前连续的反斜杠为奇数个时引号被转义
+			int32 NumBackslashes = 0;
+			for (const ANSICHAR* Char = Quote - 1; Char >= SearchBegin && *Char == '\\'; --Char)
+			{
+				++NumBackslashes;
+			}
+			if ((NumBackslashes & 1) == 0)
+			{
+				return Quote;
+			}
+			Current = Quote + 1;
+		}
+		return nullptr;
+	}
+
+	/// \brief 10的整数次幂，0~22次幂可以精确表示
+	static double Pow10(int32 Exponent)
+	{
+		static constexpr double ExactPowers[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		return Exponent < static_cast<int32>(UE_ARRAY_COUNT(ExactPowers)) ? ExactPowers[Exponent] : FMath::Pow(10.0, static_cast<double>(Exponent));
+	}
+
+	/// \brief 不分配内存的JSON游标，直接在缓冲区上前进，出错后保持失败状态
+	struct FJsonCursor
+	{
+		const ANSICHAR* Current;
+		const ANSICHAR* End;
+		bool bError;
+
+		FJsonCursor(const ANSICHAR* InBegin, const ANSICHAR* InEnd)
+			: Current(InBegin), End(InEnd), bError(false)
+		{
+		}
+
+		FORCEINLINE bool Fail()
+		{
+			bError = true;
+			return false;
+		}
+
+		FORCEINLINE void SkipWhitespace()
+		{
+			while (Current < End && IsWhitespace(*Current))
+			{
+				++Current;
+			}
+		}
+
+		/// \brief 下一个非空白字符必须为Char
+		FORCEINLINE bool Expect(ANSICHAR Char)
+		{
+			SkipWhitespace();
+			if (Current < End && *Current == Char)
+			{
+				++Current;
+				return true;
+			}
+			return Fail();
+		}
+
+		/// \brief 下一个非空白字符为Char时跳过并返回true
+		FORCEINLINE bool TryConsume(ANSICHAR Char)
+		{
+			SkipWhitespace();
+			if (Current < End && *Current == Char)
+			{
+				++Current;
+				return true;
+			}
+			return false;
+		}
+
+		/// \brief 下一个非空白字符是否为Char（不前进）
+		FORCEINLINE bool Peek(ANSICHAR Char)
+		{
+			SkipWhitespace();
+			return Current < End && *Current == Char;
+		}
+
+		/// \brief 读取字符串，返回引号之间的原始字节（不处理转义）
+		bool ParseString(FAnsiStringView& OutString)
+		{
+			if (!Expect('"'))
+			{
+				return false;
+			}
+
+			const ANSICHAR* Quote = FindStringEnd(Current, End);
+			if (!Quote)
+			{
+				return Fail();
+			}
+
+			OutString = FAnsiStringView(Current, static_cast<int32>(Quote - Current));
+			Current = Quote + 1;
+			return true;
+		}
+
+		/// \brief 读取数字：整数部分和小数部分累加到64位尾数，再按十进制指数缩放
+		bool ParseNumber(double& OutValue)
+		{
+			SkipWhitespace();
+
+			const ANSICHAR* Char = Current;
+			const bool bNegative = Char < End && *Char == '-';
+			if (bNegative)
+			{
+				++Char;
+			}
+
+			uint64 Mantissa = 0;
+			int32 Exponent = 0;
+			const ANSICHAR* DigitsBegin = Char;
+			for (; Char < End && IsDigit(*Char); ++Char)
+			{
+				if (Mantissa < MaxMantissa)
+				{
+					Mantissa = Mantissa * 10 + (*Char - '0');
+				}
+				else
+				{
+					++Exponent;
+				}
+			}
+			bool bHasDigits = Char != DigitsBegin;
+
+			if (Char < End && *Char == '.')
+			{
+				++Char;
+				const ANSICHAR* FractionBegin = Char;
+				for (; Char < End && IsDigit(*Char); ++Char)
+				{
+					if (Mantissa < MaxMantissa)
+					{
+						Mantissa = Mantissa * 10 + (*Char - '0');
+						--Exponent;
+					}
+				}
+				bHasDigits |= Char != FractionBegin;
+			}
+
+			if (!bHasDigits)
+			{
+				return Fail();
+			}
+
+			if (Char < End && (*Char == 'e' || *Char == 'E'))
+			{
+				++Char;
+				const bool bNegativeExponent = Char < End && *Char == '-';
+				if (Char < End && (*Char == '-' || *Char == '+'))
+				{
+					++Char;
+				}
+
+				int32 ExponentValue = 0;
+				const ANSICHAR* ExponentBegin = Char;
+				for (; Char < End && IsDigit(*Char); ++Char)
+				{
+					ExponentValue = FMath::Min(ExponentValue * 10 + (*Char - '0'), 100000);
+				}
+				if (Char == ExponentBegin)
+				{
+					return Fail();
+				}
+				Exponent += bNegativeExponent ? -ExponentValue : ExponentValue;
+			}
+
+			// 尾数不超过2^53且指数在22以内时，一次乘除即得到正确舍入的结果
+			double Value = static_cast<double>(Mantissa);
+			if (Exponent > 0)
+			{
+				Value *= Pow10(Exponent);
+			}
+			else if (Exponent < 0)
+			{
+				Value /= Pow10(-Exponent);
+			}
+
+			OutValue = bNegative ? -Value : Value;
+			Current = Char;
+			return true;
+		}
+
+		/// \brief 跳过任意值，对象和数组只跟踪括号深度
+		bool SkipValue()
+		{
+			SkipWhitespace();
+			if (Current >= End)
+			{
+				return Fail();
+			}
+
+			if (*Current == '"')
+			{
+				FAnsiStringView Unused;
+				return ParseString(Unused);
+			}
+
+			if (*Current == '{' || *Current == '[')
+			{
+				int32 Depth = 0;
+				while (Current < End)
+				{
+					const ANSICHAR Char = *Current++;
+					if (Char == '"')
+					{
+						const ANSICHAR* Quote = FindStringEnd(Current, End);
+						if (!Quote)
+						{
+							return Fail();
+						}
+						Current = Quote + 1;
+					}
+					else if (Char == '{' || Char == '[')
+					{
+						++Depth;
+					}
+					else if ((Char == '}' || Char == ']') && --Depth == 0)
+					{
+						return true;
+					}
+				}
+				return Fail();
+			}
+
+			// 数字或true/false/null
+			const ANSICHAR* Begin = Current;
+			while (Current < End && *Current != ',' && *Current != '}' && *Current != ']' && !IsWhitespace(*Current))
+			{
+				++Current;
+			}
+			return Current != Begin || Fail();
+		}
+	};
+
+	/// \brief 遍历对象成员，Visitor(Key)被调用时游标位于值之前，Visitor必须读取或跳过该值
+	template <typename VisitorType>
+	static bool ForEachMember(FJsonCursor& Cursor, VisitorType&& Visitor)
+	{
+		if (!Cursor.Expect('{'))
+		{
+			return false;
+		}
+		if (Cursor.TryConsume('}'))
+		{
+			return true;
+		}
+
+		do
+		{
+			FAnsiStringView Key;
+			if (!Cursor.ParseString(Key) || !Cursor.Expect(':') || !Visitor(Key))
+			{
+				return false;
+			}
+		} while (Cursor.TryConsume(','));
+
+		return Cursor.Expect('}');
+	}
+
+	/// \brief 遍历数组元素，Visitor()必须读取或跳过当前元素
+	template <typename VisitorType>
+	static bool ForEachElement(FJsonCursor& Cursor, VisitorType&& Visitor)
+	{
+		if (!Cursor.Expect('['))
+		{
+			return false;
+		}
+		if (Cursor.TryConsume(']'))
+		{
+			return true;
+		}
+
+		do
+		{
+			if (!Visitor())
+			{
+				return false;
+			}
+		} while (Cursor.TryConsume(','));
+
+		return Cursor.Expect(']');
+	}
+
+	/// \brief 结束一条折线/环：顶点不足时撤销，否则写入偏移和要素索引
+	static void FinishPolyline(FSurfacePolygonSoup& Soup, TArray<int32>& FeatureIndices, int32 FirstVertex, int32 MinVertices, int32 FeatureIndex)
+	{
+		if (Soup.Vertices.Num() - FirstVertex < MinVertices)
+		{
+			Soup.Vertices.SetNum(FirstVertex, EAllowShrinking::No);
+			return;
+		}
+
+		if (Soup.PolygonOffsets.Num() == 0)
+		{
+			Soup.PolygonOffsets.Add(0);
+		}
+		Soup.PolygonOffsets.Add(Soup.Vertices.Num());
+		FeatureIndices.Add(FeatureIndex);
+	}
+
+	/// \brief 统一环的方向（按XY坐标的有向面积，正值为逆时针）
+	static void OrientRing(TArrayView<FVector2f> Ring, bool bCounterClockwise)
+	{
+		double DoubleArea = 0.0;
+		for (int32 Index = 0; Index < Ring.Num(); ++Index)
+		{
+			const FVector2f& From = Ring[Index];
+			const FVector2f& To = Ring[(Index + 1) % Ring.Num()];
+			DoubleArea += static_cast<double>(From.X) * To.Y - static_cast<double>(To.X) * From.Y;
+		}
+
+		if (DoubleArea != 0.0 && (DoubleArea > 0.0) != bCounterClockwise)
+		{
+			Algo::Reverse(Ring);
+		}
+	}
+
+	/// \brief 批次数组长度的快照，要素解析失败时回滚
+	struct FBatchMark
+	{
+		int32 NumPolylineVertices;
+		int32 NumPolylineOffsets;
+		int32 NumPolylineFeatures;
+		int32 NumRingVertices;
+		int32 NumRingOffsets;
+		int32 NumRingFeatures;
+
+		explicit FBatchMark(const FGeoJsonFeatureBatch& Batch)
+			: NumPolylineVertices(Batch.Polylines.Vertices.Num())
+			, NumPolylineOffsets(Batch.Polylines.PolygonOffsets.Num())
+			, NumPolylineFeatures(Batch.PolylineFeatureIndices.Num())
+			, NumRingVertices(Batch.Rings.Vertices.Num())
+			, NumRingOffsets(Batch.Rings.PolygonOffsets.Num())
+			, NumRingFeatures(Batch.RingFeatureIndices.Num())
+		{
+		}
+
+		bool HasOutput(const FGeoJsonFeatureBatch& Batch) const
+		{
+			return Batch.PolylineFeatureIndices.Num() != NumPolylineFeatures || Batch.RingFeatureIndices.Num() != NumRingFeatures;
+		}
+
+		void Restore(FGeoJsonFeatureBatch& Batch) const
+		{
+			Batch.Polylines.Vertices.SetNum(NumPolylineVertices, EAllowShrinking::No);
+			Batch.Polylines.PolygonOffsets.SetNum(NumPolylineOffsets, EAllowShrinking::No);
+			Batch.PolylineFeatureIndices.SetNum(NumPolylineFeatures, EAllowShrinking::No);
+			Batch.Rings.Vertices.SetNum(NumRingVertices, EAllowShrinking::No);
+			Batch.Rings.PolygonOffsets.SetNum(NumRingOffsets, EAllowShrinking::No);
+			Batch.RingFeatureIndices.SetNum(NumRingFeatures, EAllowShrinking::No);
+		}
+	};
+
+	/// \brief 单个要素的解析器，投影后的顶点直接写入批次
+	struct FFeatureParser
+	{
+		const FProjector& Projector;
+		const FGeoJsonImportOptions& Options;
+		FGeoJsonFeatureBatch& Batch;
+		int32 FeatureIndex;
+
+		/// \brief 读取坐标数组[[x, y, ...], ...]，高程等额外分量被忽略
+		bool ParsePositions(FJsonCursor& Cursor, TArray<FVector2f>& OutVertices)
+		{
+			return ForEachElement(Cursor, [this, &Cursor, &OutVertices]()
+				{
+					double X, Y;
+					if (!Cursor.Expect('[') || !Cursor.ParseNumber(X) || !Cursor.Expect(',') || !Cursor.ParseNumber(Y))
+					{
+						return false;
+					}
+					while (Cursor.TryConsume(','))
+					{
+						double Unused;
+						if (!Cursor.ParseNumber(Unused))
+						{
+							return false;
+						}
+					}
+					if (!Cursor.Expect(']'))
+					{
+						return false;
+					}
+
+					OutVertices.Add(Projector.Project(X, Y));
+					return true;
+				});
+		}
+
+		bool ParseLineString(FJsonCursor& Cursor)
+		{
+			if (!Options.bImportLines)
+			{
+				return Cursor.SkipValue();
+			}
+
+			const int32 FirstVertex = Batch.Polylines.Vertices.Num();
+			if (!ParsePositions(Cursor, Batch.Polylines.Vertices))
+			{
+				return false;
+			}
+			FinishPolyline(Batch.Polylines, Batch.PolylineFeatureIndices, FirstVertex, MinLineVertices, FeatureIndex);
+			return true;
+		}
+
+		/// \brief 读取多边形的环：第一个为外环，其余为内环（洞）
+		bool ParsePolygon(FJsonCursor& Cursor)
+		{
+			if (!Options.bImportPolygonRings && !Options.bImportPolygonOutlines)
+			{
+				return Cursor.SkipValue();
+			}
+
+			int32 RingIndex = 0;
+			return ForEachElement(Cursor, [this, &Cursor, &RingIndex]()
+				{
+					const bool bOuterRing = RingIndex++ == 0;
+
+					// 需要填充时先写入环数组并统一方向，轮廓从中复制
+					FSurfacePolygonSoup& Target = Options.bImportPolygonRings ? Batch.Rings : Batch.Polylines;
+					const int32 FirstVertex = Target.Vertices.Num();
+					if (!ParsePositions(Cursor, Target.Vertices))
+					{
+						return false;
+					}
+
+					const int32 NumVertices = Target.Vertices.Num() - FirstVertex;
+					if (NumVertices < MinRingVertices)
+					{
+						Target.Vertices.SetNum(FirstVertex, EAllowShrinking::No);
+						return true;
+					}
+
+					if (!Options.bImportPolygonRings)
+					{
+						FinishPolyline(Batch.Polylines, Batch.PolylineFeatureIndices, FirstVertex, MinRingVertices, FeatureIndex);
+						return true;
+					}
+
+					OrientRing(MakeArrayView(Batch.Rings.Vertices.GetData() + FirstVertex, NumVertices), bOuterRing);
+					FinishPolyline(Batch.Rings, Batch.RingFeatureIndices, FirstVertex, MinRingVertices, FeatureIndex);
+
+					if (Options.bImportPolygonOutlines)
+					{
+						const int32 FirstOutlineVertex = Batch.Polylines.Vertices.Num();
+						Batch.Polylines.Vertices.Append(Batch.Rings.Vertices.GetData() + FirstVertex, NumVertices);
+						FinishPolyline(Batch.Polylines, Batch.PolylineFeatureIndices, FirstOutlineVertex, MinRingVertices, FeatureIndex);
+					}
+					return true;
+				});
+		}
+
+		/// \brief 按几何类型读取coordinates，不支持的类型直接跳过
+		bool ParseCoordinates(FJsonCursor& Cursor, FAnsiStringView Type)
+		{
+			if (NameEquals(Type, "LineString"))
+			{
+				return ParseLineString(Cursor);
+			}
+			if (NameEquals(Type, "MultiLineString"))
+			{
+				return ForEachElement(Cursor, [this, &Cursor]() { return ParseLineString(Cursor); });
+			}
+			if (NameEquals(Type, "Polygon"))
+			{
+				return ParsePolygon(Cursor);
+			}
+			if (NameEquals(Type, "MultiPolygon"))
+			{
+				return ForEachElement(Cursor, [this, &Cursor]() { return ParsePolygon(Cursor); });
+			}
+			return Cursor.SkipValue();
+		}
+
+		bool ParseGeometries(FJsonCursor& Cursor, int32 Depth)
+		{
+			return ForEachElement(Cursor, [this, &Cursor, Depth]() { return ParseObject(Cursor, Depth + 1); });
+		}
+
+		/// \brief 读取Feature或Geometry对象，成员顺序任意
+		///
+		/// 常见的文件中type位于coordinates之前，此时坐标只读一遍；否则先记录位置，读完对象后再回头解析
+		bool ParseObject(FJsonCursor& Cursor, int32 Depth)
+		{
+			if (Depth > MaxGeometryDepth)
+			{
+				return Cursor.Fail();
+			}
+
+			if (!Cursor.Peek('{'))
+			{
+				// "geometry": null
+				return Cursor.SkipValue();
+			}
+
+			FAnsiStringView Type;
+			const ANSICHAR* PendingCoordinates = nullptr;
+			const ANSICHAR* PendingGeometries = nullptr;
+			const bool bParsed = ForEachMember(Cursor, [this, &Cursor, Depth, &Type, &PendingCoordinates, &PendingGeometries](FAnsiStringView Key)
+				{
+					if (NameEquals(Key, "type"))
+					{
+						return Cursor.ParseString(Type);
+					}
+					if (NameEquals(Key, "geometry"))
+					{
+						return ParseObject(Cursor, Depth + 1);
+					}
+					if (NameEquals(Key, "coordinates"))
+					{
+						if (Type.Len() > 0)
+						{
+							return ParseCoordinates(Cursor, Type);
+						}
+						Cursor.SkipWhitespace();
+						PendingCoordinates = Cursor.Current;
+						return Cursor.SkipValue();
+					}
+					if (NameEquals(Key, "geometries"))
+					{
+						if (Type.Len() > 0)
+						{
+							return ParseGeometries(Cursor, Depth);
+						}
+						Cursor.SkipWhitespace();
+						PendingGeometries = Cursor.Current;
+						return Cursor.SkipValue();
+					}
+					return Cursor.SkipValue();
+				});
+			if (!bParsed)
+			{
+				return false;
+			}
+
+			if (PendingCoordinates)
+			{
+				FJsonCursor CoordinatesCursor(PendingCoordinates, Cursor.End);
+				if (!ParseCoordinates(CoordinatesCursor, Type))
+				{
+					return Cursor.Fail();
+				}
+			}
+			if (PendingGeometries)
+			{
+				FJsonCursor GeometriesCursor(PendingGeometries, Cursor.End);
+				if (!ParseGeometries(GeometriesCursor, Depth))
+				{
+					return Cursor.Fail();
+				}
+			}
+			return true;
+		}
+	};
+
+	/// \brief 解析一批要素，解析失败的要素回滚其全部输出
+	static void ParseBatch(
+		const ANSICHAR* Data,
+		TConstArrayView<FFeatureSpan> Spans,
+		int32 FirstFeatureIndex,
+		const FProjector& Projector,
+		const FGeoJsonImportOptions& Options,
+		FGeoJsonFeatureBatch& OutBatch)
+	{
+		OutBatch.Reset();
+		OutBatch.FirstFeatureIndex = FirstFeatureIndex;
+		OutBatch.NumFeatures = Spans.Num();
+
+		for (int32 Index = 0; Index < Spans.Num(); ++Index)
+		{
+			const FBatchMark Mark(OutBatch);
+			FFeatureParser Parser{ Projector, Options, OutBatch, FirstFeatureIndex + Index };
+			FJsonCursor Cursor(Data + Spans[Index].Begin, Data + Spans[Index].End);
+			if (!Parser.ParseObject(Cursor, 0))
+			{
+				Mark.Restore(OutBatch);
+				++OutBatch.NumSkippedFeatures;
+			}
+			else if (!Mark.HasOutput(OutBatch))
+			{
+				++OutBatch.NumSkippedFeatures;
+			}
+		}
+	}
+
+	/// \brief 顺序扫描要素边界，只跟踪括号深度和字符串边界
+	///
+	/// 根对象的"features"数组中每个对象为一个要素；根为数组时每个元素为一个要素；
+	/// 其余根对象（单个Feature/Geometry，或GeoJSON序列中的每一行）整体作为一个要素
+	struct FFeatureScanner
+	{
+		const ANSICHAR* Data;
+		int64 Size;
+		int64 Position = 0;
+		int32 Depth = 0;
+		int32 FeaturesDepth = INDEX_NONE;	///< 要素对象起始括号所在的深度
+		int64 FeatureBegin = 0;
+		int64 RootBegin = 0;
+		bool bRootHasFeatures = false;
+		bool bAfterFeaturesKey = false;		///< 上一个根对象的键为"features"
+
+		FFeatureScanner(const ANSICHAR* InData, int64 InSize)
+			: Data(InData), Size(InSize)
+		{
+		}
+
+		bool IsFinished() const { return Position >= Size; }
+
+		/// \brief 继续扫描，直到找到InMaxSpans个要素或到达末尾，结构错误时返回false
+		bool ScanNext(TArray<FFeatureSpan>& OutSpans, int32 InMaxSpans)
+		{
+			while (Position < Size && OutSpans.Num() < InMaxSpans)
+			{
+				const ANSICHAR Char = Data[Position];
+				switch (Char)
+				{
+				case '"':
+				{
+					const ANSICHAR* Quote = FindStringEnd(Data + Position + 1, Data + Size);
+					if (!Quote)
+					{
+						return false;
+					}
+					const int64 StringEnd = Quote - Data;
+					if (Depth == 1)
+					{
+						bAfterFeaturesKey = NameEquals(FAnsiStringView(Data + Position + 1, static_cast<int32>(StringEnd - Position - 1)), "features");
+					}
+					Position = StringEnd + 1;
+					continue;
+				}
+				case '{':
+				case '[':
+					if (Depth == 0)
+					{
+						RootBegin = Position;
+						bRootHasFeatures = Char == '[';
+						FeaturesDepth = Char == '[' ? 1 : INDEX_NONE;
+					}
+					else if (Depth == 1 && Char == '[' && bAfterFeaturesKey)
+					{
+						bRootHasFeatures = true;
+						FeaturesDepth = 2;
+					}
+					else if (Depth == FeaturesDepth && Char == '{')
+					{
+						FeatureBegin = Position;
+					}
+					bAfterFeaturesKey = false;
+					++Depth;
+					break;
+				case '}':
+				case ']':
+					if (--Depth < 0)
+					{
+						return false;
+					}
+					if (Depth == FeaturesDepth && Char == '}')
+					{
+						OutSpans.Add({ FeatureBegin, Position + 1 });
+					}
+					else if (Depth == FeaturesDepth - 1 && Char == ']')
+					{
+						FeaturesDepth = INDEX_NONE;
+					}
+					else if (Depth == 0 && !bRootHasFeatures)
+					{
+						OutSpans.Add({ RootBegin, Position + 1 });
+					}
+					break;
+				default:
+					break;
+				}
+				++Position;
+			}
+			return true;
+		}
+	};
+
+	/// \brief 追加扁平折线数据，调整顶点偏移
+	static void AppendSoup(FSurfacePolygonSoup& Target, const FSurfacePolygonSoup& Source)
+	{
+		if (Source.Num() == 0)
+		{
+			return;
+		}
+
+		if (Target.PolygonOffsets.Num() == 0)
+		{
+			Target.PolygonOffsets.Add(0);
+		}
+
+		const int32 BaseVertex = Target.Vertices.Num();
+		Target.Vertices.Append(Source.Vertices);
+		Target.PolygonOffsets.Reserve(Target.PolygonOffsets.Num() + Source.Num());
+		for (int32 Index = 1; Index < Source.PolygonOffsets.Num(); ++Index)
+		{
+			Target.PolygonOffsets.Add(BaseVertex + Source.PolygonOffsets[Index]);
+		}
+	}
+}
+
+void FGeoJsonFeatureBatch::Append(const FGeoJsonFeatureBatch& InOther)
+{
+	if (NumFeatures == 0)
+	{
+		FirstFeatureIndex = InOther.FirstFeatureIndex;
+	}
+	NumFeatures += InOther.NumFeatures;
+	NumSkippedFeatures += InOther.NumSkippedFeatures;
+
+	SurfaceGeoJsonImporter::AppendSoup(Polylines, InOther.Polylines);
+	PolylineFeatureIndices.Append(InOther.PolylineFeatureIndices);
+	SurfaceGeoJsonImporter::AppendSoup(Rings, InOther.Rings);
+	RingFeatureIndices.Append(InOther.RingFeatureIndices);
+}
+
+bool FSurfaceGeoJsonImporter::ImportBuffer(
+	TConstArrayView64<uint8> InData,
+	const FGeoJsonImportOptions& InOptions,
+	TFunctionRef<void(FGeoJsonFeatureBatch& InBatch)> InOnBatch,
+	FGeoJsonImportStats* OutStats)
+{
+	using namespace SurfaceGeoJsonImporter;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const ANSICHAR* Data = reinterpret_cast<const ANSICHAR*>(InData.GetData());
+	const FProjector Projector(InOptions.Projection);
+	const int32 FeaturesPerBatch = InOptions.FeaturesPerBatch > 0 ? InOptions.FeaturesPerBatch : DefaultFeaturesPerBatch;
+	const int32 BatchesPerRound = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * BatchesPerWorker, 1);
+
+	FGeoJsonImportStats Stats;
+	Stats.NumBytes = InData.Num();
+
+	// 批次数组跨轮次复用，稳定后不再分配
+	FFeatureScanner Scanner(Data, InData.Num());
+	TArray<FFeatureSpan> Spans;
+	TArray<FGeoJsonFeatureBatch> Batches;
+	Batches.SetNum(BatchesPerRound);
+	uint64 ScanCycles = 0;
+	uint64 ParseCycles = 0;
+	bool bScanSucceeded = true;
+
+	while (bScanSucceeded && !Scanner.IsFinished())
+	{
+		uint64 PhaseCycles = FPlatformTime::Cycles64();
+		Spans.Reset();
+		bScanSucceeded = Scanner.ScanNext(Spans, FeaturesPerBatch * BatchesPerRound);
+		ScanCycles += FPlatformTime::Cycles64() - PhaseCycles;
+		if (Spans.Num() == 0)
+		{
+			continue;
+		}
+
+		const int32 NumBatches = FMath::DivideAndRoundUp(Spans.Num(), FeaturesPerBatch);
+		const int32 FirstFeatureIndex = Stats.NumFeatures;
+		PhaseCycles = FPlatformTime::Cycles64();
+		ParallelFor(NumBatches, [&](int32 BatchIndex)
+			{
+				const int32 FirstSpan = BatchIndex * FeaturesPerBatch;
+				const int32 NumSpans = FMath::Min(FeaturesPerBatch, Spans.Num() - FirstSpan);
+				ParseBatch(Data, MakeArrayView(Spans.GetData() + FirstSpan, NumSpans), FirstFeatureIndex + FirstSpan, Projector, InOptions, Batches[BatchIndex]);
+			},
+			NumBatches < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+		ParseCycles += FPlatformTime::Cycles64() - PhaseCycles;
+
+		// 按文件顺序交给回调，回调返回后才继续扫描
+		for (int32 BatchIndex = 0; BatchIndex < NumBatches; ++BatchIndex)
+		{
+			FGeoJsonFeatureBatch& Batch = Batches[BatchIndex];
+			Stats.NumSkippedFeatures += Batch.NumSkippedFeatures;
+			Stats.NumPolylines += Batch.Polylines.Num();
+			Stats.NumRings += Batch.Rings.Num();
+			Stats.NumVertices += Batch.Polylines.Vertices.Num() + Batch.Rings.Vertices.Num();
+			InOnBatch(Batch);
+		}
+		Stats.NumFeatures += Spans.Num();
+		Stats.NumBatches += NumBatches;
+	}
+
+	if (!bScanSucceeded)
+	{
+		UE_LOG(LogSurfaceGeoJsonImporter, Warning, TEXT("GeoJSON结构错误，在第 %lld 字节处停止，已导入 %d 个要素"), Scanner.Position, Stats.NumFeatures);
+	}
+	else if (Scanner.Depth != 0)
+	{
+		UE_LOG(LogSurfaceGeoJsonImporter, Warning, TEXT("GeoJSON文件不完整（括号未闭合），已导入 %d 个要素"), Stats.NumFeatures);
+	}
+
+	Stats.ScanTimeMs = FPlatformTime::ToMilliseconds64(ScanCycles);
+	Stats.ParseTimeMs = FPlatformTime::ToMilliseconds64(ParseCycles);
+	Stats.TotalTimeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+
+	return Stats.NumPolylines + Stats.NumRings > 0;
+}
+
+bool FSurfaceGeoJsonImporter::ImportFile(
+	const FString& InFilePath,
+	const FGeoJsonImportOptions& InOptions,
+	TFunctionRef<void(FGeoJsonFeatureBatch& InBatch)> InOnBatch,
+	FGeoJsonImportStats* OutStats)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	// 优先内存映射，由操作系统按需分页读取；区域需先于句柄释放
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	auto OpenResult = FPlatformFileManager::Get().GetPlatformFile().OpenMappedEx(*InFilePath);
+	if (OpenResult.HasValue())
+	{
+		MappedFile = OpenResult.StealValue();
+		if (MappedFile->GetFileSize() > 0)
+		{
+			MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		}
+	}
+
+	TArray64<uint8> FileData;
+	TConstArrayView64<uint8> Data;
+	if (MappedRegion.IsValid())
+	{
+		Data = TConstArrayView64<uint8>(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize());
+	}
+	else if (FFileHelper::LoadFileToArray(FileData, *InFilePath))
+	{
+		Data = FileData;
+	}
+	else
+	{
+		UE_LOG(LogSurfaceGeoJsonImporter, Warning, TEXT("无法读取GeoJSON文件: %s"), *InFilePath);
+		return false;
+	}
+
+	FGeoJsonImportStats Stats;
+	const bool bSucceeded = ImportBuffer(Data, InOptions, InOnBatch, &Stats);
+	Stats.bMemoryMapped = MappedRegion.IsValid();
+	Stats.TotalTimeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	UE_LOG(LogSurfaceGeoJsonImporter, Log, TEXT("GeoJSON导入: %s, %.1f MB (%s), 要素 %d (跳过 %d), 折线 %d, 环 %d, 顶点 %lld, 批次 %d, 扫描 %.2f ms, 解析 %.2f ms, 总计 %.2f ms (%.1f MB/s)"),
+		*InFilePath, Stats.NumBytes / (1024.0 * 1024.0), Stats.bMemoryMapped ? TEXT("内存映射") : TEXT("读入内存"),
+		Stats.NumFeatures, Stats.NumSkippedFeatures, Stats.NumPolylines, Stats.NumRings, Stats.NumVertices, Stats.NumBatches,
+		Stats.ScanTimeMs, Stats.ParseTimeMs, Stats.TotalTimeMs,
+		Stats.TotalTimeMs > 0.0 ? Stats.NumBytes / (1024.0 * 1024.0) / (Stats.TotalTimeMs / 1000.0) : 0.0);
+
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+
+	return bSucceeded;
+}
+
+bool FSurfaceGeoJsonImporter::ImportFile(
+	const FString& InFilePath,
+	const FGeoJsonImportOptions& InOptions,
+	FGeoJsonFeatureBatch& OutResult,
+	FGeoJsonImportStats* OutStats)
+{
+	OutResult.Reset();
+	return ImportFile(InFilePath, InOptions, [&OutResult](FGeoJsonFeatureBatch& InBatch) { OutResult.Append(InBatch); }, OutStats);
+}
@@ -4,6 +4,9 @@
 
 	
 DEFINE_LOG_CATEGORY_STATIC(LogSurfaceLineBuilder, Log, All);
+
+/// \brief 每个线段簇最多包含的线段数量
+static constexpr int32 MaxSegmentsPerCluster = 128;
 	
 FLineBVHNode::~FLineBVHNode()
 {
@@ -24,49 +27,90 @@ FLineBVHNode::~FLineBVHNode()
 	}
 }
 
-FLineBVHBuilder::FLineBVHBuilder(const TArray<FPolygon>& InPolygons, const FBVHBuildConfig& InBuildConfig)
-	: Root(nullptr), BuildConfig(InBuildConfig), TotalSegments(0)
+template <typename VertexAccessorType>
+void FLineBVHBuilder::AddPolylineClusters(int32 PolyIndex, int32 NumVertices, const VertexAccessorType& GetVertex)
 {
-	// 遍历所有多边形，为每个多边形创建线段簇
-	for (int32 PolyIndex = 0; PolyIndex < InPolygons.Num(); ++PolyIndex)
+	if (NumVertices < 2)
 	{
-		const FPolygon& Polygon = InPolygons[PolyIndex];
-		if (Polygon.Vertices.Num() < 2)
-		{
-			UE_LOG(LogSurfaceLineBuilder, Warning, TEXT("多边形 %d 顶点数不足2个，已跳过"), PolyIndex);
-			continue;
-		}
-		
-		// 为当前多边形创建线段簇
-		const int32 MaxSegmentsPerCluster = 128;
-		const int32 NumCluster = Polygon.Vertices.Num() / (MaxSegmentsPerCluster + 1) + 1;
+		UE_LOG(LogSurfaceLineBuilder, Warning, TEXT("多边形 %d 顶点数不足2个，已跳过"), PolyIndex);
+		return;
+	}
+
+	// 为当前多边形创建线段簇
+	const int32 NumCluster = FMath::DivideAndRoundUp(NumVertices - 1, MaxSegmentsPerCluster);
+
+	for (int32 i = 0; i < NumCluster; ++i)
+	{
+		FSegmentCluster* NewCluster = new FSegmentCluster(PolyIndex);
+		NewCluster->PolylineClusterIndex = i;
 
-		for(int32 i = 0; i < NumCluster; ++i)
+		const int32 StartIdx = i * MaxSegmentsPerCluster;
+		const int32 EndIdx = FMath::Min(StartIdx + MaxSegmentsPerCluster, NumVertices - 1);
+		NewCluster->Segments.Reserve(EndIdx - StartIdx);
+		for (int32 j = StartIdx; j < EndIdx; ++j)
 		{
-			FSegmentCluster* NewCluster = new FSegmentCluster(PolyIndex);
+			FSegment Segment(GetVertex(j), GetVertex(j + 1), PolyIndex);
+			NewCluster->AddSegment(Segment);
 
-			const int32 StartIdx = i * MaxSegmentsPerCluster;
-			const int32 EndIdx = FMath::Min(StartIdx + MaxSegmentsPerCluster, Polygon.Vertices.Num() - 1);
-			for (int32 j = StartIdx; j < EndIdx; ++j)
-			{
-				FSegment Segment(Polygon.Vertices[j], Polygon.Vertices[j + 1], PolyIndex);
-				NewCluster->AddSegment(Segment);
+			TotalSegments++;
+		}
+		NewCluster->SegmentNumPerLOD[0] = NewCluster->Segments.Num();
 
-				TotalSegments++;
-			}
-			NewCluster->SegmentNumPerLOD[0] = NewCluster->Segments.Num();
+		// TODO: 已完成，但经测试，在采用分页策略前，增加额外的LOD数据会使显存压力过大，导致严重性能问题。
+		// 无论是合并还是分页，粗略估计，最终的Segments总数建议不超过100万时考虑开启LOD
+		//NewCluster->GenerateLODLevel();
 
-			// TODO: 已完成，但经测试，在采用分页策略前，增加额外的LOD数据会使显存压力过大，导致严重性能问题。
-			// 无论是合并还是分页，粗略估计，最终的Segments总数建议不超过100万时考虑开启LOD
-			//NewCluster->GenerateLODLevel();
+		AllClusters.Add(NewCluster);
+	}
+}
 
-			AllClusters.Add(NewCluster);
-		}
+FLineBVHBuilder::FLineBVHBuilder(const TArray<FPolygon>& InPolygons, const FBVHBuildConfig& InBuildConfig)
+	: Root(nullptr), BuildConfig(InBuildConfig), TotalSegments(0), NumPolylines(InPolygons.Num())
+{
+	// 遍历所有多边形，为每个多边形创建线段簇
+	for (int32 PolyIndex = 0; PolyIndex < InPolygons.Num(); ++PolyIndex)
+	{
+		const TArray<FVector>& Vertices = InPolygons[PolyIndex].Vertices;
+		AddPolylineClusters(PolyIndex, Vertices.Num(), [&Vertices](int32 Index) { return Vertices[Index]; });
 	}
 	// 打印初始统计信息
 	UE_LOG(LogSurfaceLineBuilder, Log, TEXT("初始统计: 多边形数=%d, 簇数=%d, 总线段数=%d"), InPolygons.Num(), AllClusters.Num(), TotalSegments);
 }
-	
+
+FLineBVHBuilder::FLineBVHBuilder(TConstArrayView<FVector2f> InVertices, TConstArrayView<int32> InPolylineOffsets, const FBVHBuildConfig& InBuildConfig)
+	: FLineBVHBuilder(InBuildConfig)
+{
+	AppendPolylines(InVertices, InPolylineOffsets);
+	UE_LOG(LogSurfaceLineBuilder, Log, TEXT("初始统计: 折线数=%d, 簇数=%d, 总线段数=%d"), NumPolylines, AllClusters.Num(), TotalSegments);
+}
+
+FLineBVHBuilder::FLineBVHBuilder(const FBVHBuildConfig& InBuildConfig)
+	: Root(nullptr), BuildConfig(InBuildConfig), TotalSegments(0), NumPolylines(0)
+{
+}
+
+void FLineBVHBuilder::AppendPolylines(TConstArrayView<FVector2f> InVertices, TConstArrayView<int32> InPolylineOffsets)
+{
+	check(Root == nullptr);
+
+	const int32 NumBatchPolylines = FMath::Max(InPolylineOffsets.Num() - 1, 0);
+	for (int32 LocalIndex = 0; LocalIndex < NumBatchPolylines; ++LocalIndex)
+	{
+		const int32 PolyIndex = NumPolylines + LocalIndex;
+		const int32 FirstVertex = InPolylineOffsets[LocalIndex];
+		const int32 NumVertices = InPolylineOffsets[LocalIndex + 1] - FirstVertex;
+		if (FirstVertex < 0 || NumVertices < 0 || FirstVertex + NumVertices > InVertices.Num())
+		{
+			UE_LOG(LogSurfaceLineBuilder, Warning, TEXT("折线 %d 顶点范围无效，已跳过"), PolyIndex);
+			continue;
+		}
+
+		const FVector2f* Vertices = InVertices.GetData() + FirstVertex;
+		AddPolylineClusters(PolyIndex, NumVertices, [Vertices](int32 Index) { return FVector(Vertices[Index].X, Vertices[Index].Y, 0.0); });
+	}
+	NumPolylines += NumBatchPolylines;
+}
+
 FLineBVHBuilder::~FLineBVHBuilder()
 {
 	if (Root)
@@ -509,6 +553,8 @@ void FLineDataConverter::CollectClustersRecursive(const FLineBVHNode* Node, FGPU
 		NewGPUCluster.PolygonIndex = Node->Cluster->PolygonIndex;
 
 		NewGPUCluster.AllSegmentNum = Node->Cluster->GetNumSegments();
+		NewGPUCluster.PolylineClusterIndex = Node->Cluster->PolylineClusterIndex;
+		NewGPUCluster.Padding[0] = NewGPUCluster.Padding[1] = 0.0f;
 
 		for (int32 LOD = 0; LOD < 8; ++LOD)
 		{
@@ -600,4 +646,302 @@ void FLineDataConverter::AssignIndices(FGPULineData& GPUData)
 	{
 		SetLeafClusterIndicesRecursive(GPUData.RootNodeIndex, CurrentLeafIndex);
 	}
+}
+
+bool FLineRefitIndices::Build(const FGPULineData& InGPUData)
+{
+	Reset();
+	if (!InGPUData.IsValid())
+	{
+		return false;
+	}
+
+	const int32 NumNodes = InGPUData.Nodes.Num();
+	const int32 NumClusters = InGPUData.Clusters.Num();
+	NodeParents.Init(-1, NumNodes);
+	ClusterNodes.Init(INDEX_NONE, NumClusters);
+	for (int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex)
+	{
+		const FGPULineBVHNode& Node = InGPUData.Nodes[NodeIndex];
+		if (Node.IsLeaf == 1)
+		{
+			if (InGPUData.Clusters.IsValidIndex(Node.ClusterIndex))
+			{
+				ClusterNodes[Node.ClusterIndex] = NodeIndex;
+			}
+			continue;
+		}
+
+		for (const int32 ChildIndex : { Node.LeftChild, Node.RightChild })
+		{
+			if (InGPUData.Nodes.IsValidIndex(ChildIndex))
+			{
+				NodeParents[ChildIndex] = NodeIndex;
+			}
+		}
+	}
+
+	// 按多边形计数后，Cluster按其在折线中的序号放到多边形的范围内
+	int32 NumPolygons = 0;
+	for (const FGPUSegmentCluster& Cluster : InGPUData.Clusters)
+	{
+		if (Cluster.PolygonIndex < 0)
+		{
+			Reset();
+			return false;
+		}
+		NumPolygons = FMath::Max(NumPolygons, Cluster.PolygonIndex + 1);
+	}
+
+	PolygonClusterOffsets.SetNumZeroed(NumPolygons + 1);
+	for (const FGPUSegmentCluster& Cluster : InGPUData.Clusters)
+	{
+		++PolygonClusterOffsets[Cluster.PolygonIndex + 1];
+	}
+	for (int32 PolygonIndex = 0; PolygonIndex < NumPolygons; ++PolygonIndex)
+	{
+		PolygonClusterOffsets[PolygonIndex + 1] += PolygonClusterOffsets[PolygonIndex];
+	}
+
+	PolygonClusters.Init(INDEX_NONE, NumClusters);
+	for (int32 ClusterIndex = 0; ClusterIndex < NumClusters; ++ClusterIndex)
+	{
+		const FGPUSegmentCluster& Cluster = InGPUData.Clusters[ClusterIndex];
+		const int32 FirstCluster = PolygonClusterOffsets[Cluster.PolygonIndex];
+		const int32 NumPolygonClusters = PolygonClusterOffsets[Cluster.PolygonIndex + 1] - FirstCluster;
+		if (ClusterNodes[ClusterIndex] == INDEX_NONE || Cluster.PolylineClusterIndex < 0 || Cluster.PolylineClusterIndex >= NumPolygonClusters
+			|| PolygonClusters[FirstCluster + Cluster.PolylineClusterIndex] != INDEX_NONE)
+		{
+			Reset();
+			return false;
+		}
+		PolygonClusters[FirstCluster + Cluster.PolylineClusterIndex] = ClusterIndex;
+	}
+
+	return true;
+}
+
+bool FLineRefitIndices::CanRefitPolyline(int32 InPolygonIndex, int32 InNumVertices) const
+{
+	if (InPolygonIndex < 0 || InPolygonIndex + 1 >= PolygonClusterOffsets.Num() || InNumVertices < 2)
+	{
+		return false;
+	}
+
+	const int32 NumClusters = PolygonClusterOffsets[InPolygonIndex + 1] - PolygonClusterOffsets[InPolygonIndex];
+	return NumClusters > 0 && FMath::DivideAndRoundUp(InNumVertices - 1, MaxSegmentsPerCluster) == NumClusters;
+}
+
+bool FLineDataConverter::RefitPolyline(const FGPULineData& InGPUData, const FLineRefitIndices& InRefitIndices, int32 InPolygonIndex, TConstArrayView<FVector2f> InVertices, FGPULineDataPatch& InOutPatch)
+{
+	const FGPULineData& Data = InGPUData;
+	const FLineRefitIndices& Indices = InRefitIndices;
+	FGPULineDataPatch& Patch = InOutPatch;
+	if (!Data.IsValid() || !Indices.IsValidFor(Data)
+		|| InPolygonIndex < 0 || InPolygonIndex + 1 >= Indices.PolygonClusterOffsets.Num()
+		|| (Patch.BaseNumSegments != INDEX_NONE && Patch.BaseNumSegments != Data.Segments.Num()))
+	{
+		return false;
+	}
+
+	const int32 FirstCluster = Indices.PolygonClusterOffsets[InPolygonIndex];
+	const int32 NumClusters = Indices.PolygonClusterOffsets[InPolygonIndex + 1] - FirstCluster;
+	const int32 NumSegments = InVertices.Num() - 1;
+	if (NumClusters == 0 || NumSegments < 1 || FMath::DivideAndRoundUp(NumSegments, MaxSegmentsPerCluster) != NumClusters)
+	{
+		return false;
+	}
+
+	// 含LOD数据的Cluster在第0级之后还存放简化的线段，不能原地替换
+	for (int32 Index = 0; Index < NumClusters; ++Index)
+	{
+		const FGPUSegmentCluster& Cluster = Patch.GetCluster(Data, Indices.PolygonClusters[FirstCluster + Index]);
+		if (Cluster.SegmentNumPerLOD[0] != Cluster.AllSegmentNum)
+		{
+			return false;
+		}
+	}
+
+	if (Patch.BaseNumSegments == INDEX_NONE)
+	{
+		Patch.BaseNumSegments = Data.Segments.Num();
+		Patch.NumSegments = Data.Segments.Num();
+	}
+
+	for (int32 Index = 0; Index < NumClusters; ++Index)
+	{
+		const int32 ClusterIndex = Indices.PolygonClusters[FirstCluster + Index];
+		FGPUSegmentCluster Cluster = Patch.GetCluster(Data, ClusterIndex);
+
+		// 与AddPolylineClusters相同的划分，线段变多时追加到末尾
+		const int32 FirstVertex = Index * MaxSegmentsPerCluster;
+		const int32 NumClusterSegments = FMath::Min(MaxSegmentsPerCluster, NumSegments - FirstVertex);
+		if (NumClusterSegments > Cluster.AllSegmentNum)
+		{
+			Cluster.SegmentStartIndex = Patch.NumSegments;
+			Patch.NumSegments += NumClusterSegments;
+		}
+		Cluster.AllSegmentNum = NumClusterSegments;
+		Cluster.SegmentNumPerLOD[0] = NumClusterSegments;
+
+		FGPULineDataPatch::FSegmentRange& SegmentRange = Patch.SegmentRanges.AddDefaulted_GetRef();
+		SegmentRange.Start = Cluster.SegmentStartIndex;
+		SegmentRange.Segments.SetNum(NumClusterSegments);
+
+		FBox3f ClusterBox(ForceInit);
+		for (int32 SegmentIndex = 0; SegmentIndex < NumClusterSegments; ++SegmentIndex)
+		{
+			FGPUSegment& Segment = SegmentRange.Segments[SegmentIndex];
+			Segment.Start = FVector3f(InVertices[FirstVertex + SegmentIndex], 0.f);
+			Segment.End = FVector3f(InVertices[FirstVertex + SegmentIndex + 1], 0.f);
+			Segment.PolygonIndex = InPolygonIndex;
+			Segment.Padding = 0.f;
+
+			ClusterBox += Segment.Start;
+			ClusterBox += Segment.End;
+		}
+		Cluster.MinExtent = ClusterBox.Min;
+		Cluster.MaxExtent = ClusterBox.Max;
+		Patch.Clusters.Add(ClusterIndex, Cluster);
+		Patch.DirtyRanges.Segments.Add(Cluster.SegmentStartIndex, NumClusterSegments);
+		Patch.DirtyRanges.Clusters.Add(ClusterIndex, 1);
+
+		// 叶子节点的包围盒即Cluster的包围盒，再向上合并子节点，包围盒不变时停止
+		const int32 LeafIndex = Indices.ClusterNodes[ClusterIndex];
+		FGPULineBVHNode Leaf = Patch.GetNode(Data, LeafIndex);
+		if (Leaf.MinExtent == ClusterBox.Min && Leaf.MaxExtent == ClusterBox.Max)
+		{
+			continue;
+		}
+		Leaf.MinExtent = ClusterBox.Min;
+		Leaf.MaxExtent = ClusterBox.Max;
+		Patch.Nodes.Add(LeafIndex, Leaf);
+		Patch.DirtyRanges.Nodes.Add(LeafIndex, 1);
+
+		for (int32 NodeIndex = Indices.NodeParents[LeafIndex]; NodeIndex >= 0; NodeIndex = Indices.NodeParents[NodeIndex])
+		{
+			FGPULineBVHNode Node = Patch.GetNode(Data, NodeIndex);
+			FVector3f MinExtent(MAX_flt);
+			FVector3f MaxExtent(-MAX_flt);
+			for (const int32 ChildIndex : { Node.LeftChild, Node.RightChild })
+			{
+				if (Data.Nodes.IsValidIndex(ChildIndex))
+				{
+					const FGPULineBVHNode& Child = Patch.GetNode(Data, ChildIndex);
+					MinExtent = MinExtent.ComponentMin(Child.MinExtent);
+					MaxExtent = MaxExtent.ComponentMax(Child.MaxExtent);
+				}
+			}
+			if (MinExtent == Node.MinExtent && MaxExtent == Node.MaxExtent)
+			{
+				break;
+			}
+			Node.MinExtent = MinExtent;
+			Node.MaxExtent = MaxExtent;
+			Patch.Nodes.Add(NodeIndex, Node);
+			Patch.DirtyRanges.Nodes.Add(NodeIndex, 1);
+		}
+	}
+
+	return true;
+}
+
+bool FGPULineDataPatch::Append(const FGPULineDataPatch& InOther)
+{
+	if (InOther.IsEmpty())
+	{
+		return true;
+	}
+	if (IsEmpty())
+	{
+		*this = InOther;
+		return true;
+	}
+	if (InOther.BaseNumSegments != NumSegments)
+	{
+		return false;
+	}
+
+	Nodes.Append(InOther.Nodes);
+	Clusters.Append(InOther.Clusters);
+	SegmentRanges.Append(InOther.SegmentRanges);
+	NumSegments = InOther.NumSegments;
+	DirtyRanges.Append(InOther.DirtyRanges);
+	return true;
+}
+
+bool FGPULineDataPatch::Apply(FGPULineData& InOutData) const
+{
+	if (IsEmpty())
+	{
+		return true;
+	}
+
+	// 先检查全部索引，不对应时不修改任何数据
+	if (InOutData.Segments.Num() != BaseNumSegments || NumSegments < BaseNumSegments)
+	{
+		return false;
+	}
+	for (const TPair<int32, FGPULineBVHNode>& Pair : Nodes)
+	{
+		if (!InOutData.Nodes.IsValidIndex(Pair.Key))
+		{
+			return false;
+		}
+	}
+	for (const TPair<int32, FGPUSegmentCluster>& Pair : Clusters)
+	{
+		if (!InOutData.Clusters.IsValidIndex(Pair.Key))
+		{
+			return false;
+		}
+	}
+	for (const FSegmentRange& SegmentRange : SegmentRanges)
+	{
+		if (SegmentRange.Start < 0 || SegmentRange.Start + SegmentRange.Segments.Num() > NumSegments)
+		{
+			return false;
+		}
+	}
+
+	for (const TPair<int32, FGPULineBVHNode>& Pair : Nodes)
+	{
+		InOutData.Nodes[Pair.Key] = Pair.Value;
+	}
+	for (const TPair<int32, FGPUSegmentCluster>& Pair : Clusters)
+	{
+		InOutData.Clusters[Pair.Key] = Pair.Value;
+	}
+
+	// 线段按写入顺序覆盖，之后写入的范围生效
+	InOutData.Segments.AddDefaulted(NumSegments - BaseNumSegments);
+	for (const FSegmentRange& SegmentRange : SegmentRanges)
+	{
+		FMemory::Memcpy(InOutData.Segments.GetData() + SegmentRange.Start, SegmentRange.Segments.GetData(), SegmentRange.Segments.Num() * sizeof(FGPUSegment));
+	}
+	return true;
+}
+
+void FLineStyleTable::Build(TConstArrayView<FGPULineStyle> InStyles, TConstArrayView<int32> InPolygonStyleIndices)
+{
+	Reset();
+
+	if (InStyles.Num() == 0)
+	{
+		return;
+	}
+
+	Styles.Append(InStyles.GetData(), InStyles.Num());
+	for (const FGPULineStyle& Style : Styles)
+	{
+		MaxLineWidth = FMath::Max(MaxLineWidth, Style.Width);
+	}
+
+	// 至少保留一个元素，保证着色器端的结构化缓冲区非空
+	PolygonStyleIndices.SetNumZeroed(FMath::Max(InPolygonStyleIndices.Num(), 1));
+	for (int32 PolygonIndex = 0; PolygonIndex < InPolygonStyleIndices.Num(); ++PolygonIndex)
+	{
+		const int32 StyleIndex = InPolygonStyleIndices[PolygonIndex];
+		PolygonStyleIndices[PolygonIndex] = Styles.IsValidIndex(StyleIndex) ? static_cast<uint32>(StyleIndex) : 0u;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,324 @@
+﻿#include "SurfaceDrawer/SurfaceLineQuery.h"
+
+#include "Math/VectorRegister.h"
+
+
+namespace SurfaceLineQuery
+{
+	/// \brief 遍历栈的内联容量，与着色器保持一致，更深的树在堆上扩展
+	static constexpr int32 MaxStackNum = 64;
+
+	using FTraversalStack = TArray<int32, TInlineAllocator<MaxStackNum>>;
+
+	/// \brief 每批同时测试的线段数量，与SIMD宽度（4）一致
+	static constexpr int32 SegmentBatchSize = 4;
+
+	/// \brief 4条线段的SoA布局
+	struct alignas(16) FSegmentBatch
+	{
+		float AX[SegmentBatchSize];
+		float AY[SegmentBatchSize];
+		float BX[SegmentBatchSize];
+		float BY[SegmentBatchSize];
+		int32 FirstSegment;
+		int32 NumSegments;
+
+		/// \brief 从线段数组读取一批线段，不足4条的通道复制最后一条
+		void Load(const TArray<FGPUSegment>& InSegments, int32 InFirst, int32 InNum)
+		{
+			FirstSegment = InFirst;
+			NumSegments = InNum;
+			for (int32 Lane = 0; Lane < SegmentBatchSize; ++Lane)
+			{
+				const FGPUSegment& Segment = InSegments[InFirst + FMath::Min(Lane, InNum - 1)];
+				AX[Lane] = Segment.Start.X;
+				AY[Lane] = Segment.Start.Y;
+				BX[Lane] = Segment.End.X;
+				BY[Lane] = Segment.End.Y;
+			}
+		}
+
+		/// \brief 有效通道掩码
+		uint32 GetValidMask() const { return (1u << NumSegments) - 1u; }
+	};
+
+	/// \brief 计算点到4条线段的距离平方及最近点的参数t
+	FORCEINLINE void PointSegmentDistanceSquared(const FSegmentBatch& InBatch, const FVector2f& InPoint, float* OutDistanceSquared, float* OutT)
+	{
+		const VectorRegister4Float AX = VectorLoadAligned(InBatch.AX);
+		const VectorRegister4Float AY = VectorLoadAligned(InBatch.AY);
+		const VectorRegister4Float DX = VectorSubtract(VectorLoadAligned(InBatch.BX), AX);
+		const VectorRegister4Float DY = VectorSubtract(VectorLoadAligned(InBatch.BY), AY);
+
+		const VectorRegister4Float APX = VectorSubtract(VectorSetFloat1(InPoint.X), AX);
+		const VectorRegister4Float APY = VectorSubtract(VectorSetFloat1(InPoint.Y), AY);
+
+		// t = clamp(dot(AP, D) / dot(D, D), 0, 1)，退化线段的t为0
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(DX, DX, VectorMultiply(DY, DY));
+		const VectorRegister4Float Dot = VectorMultiplyAdd(APX, DX, VectorMultiply(APY, DY));
+		VectorRegister4Float T = VectorDivide(Dot, VectorMax(LengthSquared, VectorSetFloat1(UE_SMALL_NUMBER)));
+		T = VectorMin(VectorMax(T, GlobalVectorConstants::FloatZero), GlobalVectorConstants::FloatOne);
+
+		// 最近点到查询点的偏移 AP - t * D
+		const VectorRegister4Float OffsetX = VectorNegateMultiplyAdd(T, DX, APX);
+		const VectorRegister4Float OffsetY = VectorNegateMultiplyAdd(T, DY, APY);
+
+		VectorStoreAligned(VectorMultiplyAdd(OffsetX, OffsetX, VectorMultiply(OffsetY, OffsetY)), OutDistanceSquared);
+		VectorStoreAligned(T, OutT);
+	}
+
+	/// \brief 计算射线与4条线段的交点
+	/// \return 与射线相交且沿射线距离在[0, InMaxDistance]内的通道掩码
+	FORCEINLINE uint32 RaySegmentIntersect(const FSegmentBatch& InBatch, const FVector2f& InOrigin, const FVector2f& InDirection, float InMaxDistance, float* OutDistance, float* OutT)
+	{
+		const VectorRegister4Float AX = VectorLoadAligned(InBatch.AX);
+		const VectorRegister4Float AY = VectorLoadAligned(InBatch.AY);
+		const VectorRegister4Float DX = VectorSubtract(VectorLoadAligned(InBatch.BX), AX);
+		const VectorRegister4Float DY = VectorSubtract(VectorLoadAligned(InBatch.BY), AY);
+		const VectorRegister4Float RX = VectorSetFloat1(InDirection.X);
+		const VectorRegister4Float RY = VectorSetFloat1(InDirection.Y);
+
+		const VectorRegister4Float OAX = VectorSubtract(AX, VectorSetFloat1(InOrigin.X));
+		const VectorRegister4Float OAY = VectorSubtract(AY, VectorSetFloat1(InOrigin.Y));
+
+		// O + s * R = A + t * D  =>  s = (OA x D) / (R x D), t = (OA x R) / (R x D)
+		const VectorRegister4Float Denominator = VectorSubtract(VectorMultiply(RX, DY), VectorMultiply(RY, DX));
+		const VectorRegister4Float NonParallel = VectorCompareGT(VectorAbs(Denominator), VectorSetFloat1(UE_SMALL_NUMBER));
+		const VectorRegister4Float InvDenominator = VectorSelect(NonParallel, VectorReciprocalAccurate(Denominator), GlobalVectorConstants::FloatZero);
+
+		const VectorRegister4Float S = VectorMultiply(VectorSubtract(VectorMultiply(OAX, DY), VectorMultiply(OAY, DX)), InvDenominator);
+		const VectorRegister4Float T = VectorMultiply(VectorSubtract(VectorMultiply(OAX, RY), VectorMultiply(OAY, RX)), InvDenominator);
+
+		const VectorRegister4Float Zero = GlobalVectorConstants::FloatZero;
+		VectorRegister4Float Hit = VectorBitwiseAnd(NonParallel, VectorCompareGE(S, Zero));
+		Hit = VectorBitwiseAnd(Hit, VectorCompareLE(S, VectorSetFloat1(InMaxDistance)));
+		Hit = VectorBitwiseAnd(Hit, VectorCompareGE(T, Zero));
+		Hit = VectorBitwiseAnd(Hit, VectorCompareLE(T, GlobalVectorConstants::FloatOne));
+
+		VectorStoreAligned(S, OutDistance);
+		VectorStoreAligned(T, OutT);
+
+		return static_cast<uint32>(VectorMaskBits(Hit)) & InBatch.GetValidMask();
+	}
+
+	/// \brief 点到包围盒XY范围的距离平方
+	FORCEINLINE float PointBoxDistanceSquaredXY(const FVector3f& InMin, const FVector3f& InMax, const FVector2f& InPoint)
+	{
+		const float DX = FMath::Max3(InMin.X - InPoint.X, 0.0f, InPoint.X - InMax.X);
+		const float DY = FMath::Max3(InMin.Y - InPoint.Y, 0.0f, InPoint.Y - InMax.Y);
+		return DX * DX + DY * DY;
+	}
+
+	/// \brief 射线与包围盒XY范围求交（slab），返回是否在[0, InMaxDistance]内相交
+	FORCEINLINE bool RayIntersectsBoxXY(const FVector3f& InMin, const FVector3f& InMax, const FVector2f& InOrigin, const FVector2f& InInvDirection, float InMaxDistance)
+	{
+		const float TX1 = (InMin.X - InOrigin.X) * InInvDirection.X;
+		const float TX2 = (InMax.X - InOrigin.X) * InInvDirection.X;
+		const float TY1 = (InMin.Y - InOrigin.Y) * InInvDirection.Y;
+		const float TY2 = (InMax.Y - InOrigin.Y) * InInvDirection.Y;
+
+		const float TMin = FMath::Max3(FMath::Min(TX1, TX2), FMath::Min(TY1, TY2), 0.0f);
+		const float TMax = FMath::Min3(FMath::Max(TX1, TX2), FMath::Max(TY1, TY2), InMaxDistance);
+		return TMin <= TMax;
+	}
+
+	/// \brief 生成查询结果
+	FORCEINLINE FSurfaceLineHit MakeHit(const FGPUSegment& InSegment, int32 InSegmentIndex, float InDistance, float InT)
+	{
+		FSurfaceLineHit Hit;
+		Hit.PolygonIndex = InSegment.PolygonIndex;
+		Hit.SegmentIndex = InSegmentIndex;
+		Hit.Distance = InDistance;
+		Hit.T = InT;
+
+		const FVector3f Location = FMath::Lerp(InSegment.Start, InSegment.End, InT);
+		Hit.Location = FVector(Location.X, Location.Y, 0.0);
+		return Hit;
+	}
+
+	/// \brief 深度优先遍历BVH，对每个叶子簇的LOD0线段按批调用Visitor
+	/// \param NodeFilter 返回false时跳过该节点（及其子树）
+	/// \param BatchVisitor 处理一批线段
+	template<typename FNodeFilter, typename FBatchVisitor>
+	void TraverseBatches(const FGPULineData& InGPUData, FNodeFilter&& NodeFilter, FBatchVisitor&& BatchVisitor)
+	{
+		FTraversalStack Stack;
+		Stack.Push(InGPUData.RootNodeIndex);
+
+		FSegmentBatch Batch;
+		while (Stack.Num() > 0)
+		{
+			const FGPULineBVHNode& Node = InGPUData.Nodes[Stack.Pop(EAllowShrinking::No)];
+			if (!NodeFilter(Node.MinExtent, Node.MaxExtent))
+			{
+				continue;
+			}
+
+			if (Node.IsLeaf == 1)
+			{
+				const FGPUSegmentCluster& Cluster = InGPUData.Clusters[Node.ClusterIndex];
+				if (!NodeFilter(Cluster.MinExtent, Cluster.MaxExtent))
+				{
+					continue;
+				}
+
+				// 只查询LOD0线段
+				const int32 NumSegments = Cluster.SegmentNumPerLOD[0];
+				for (int32 First = 0; First < NumSegments; First += SegmentBatchSize)
+				{
+					Batch.Load(InGPUData.Segments, Cluster.SegmentStartIndex + First, FMath::Min(SegmentBatchSize, NumSegments - First));
+					BatchVisitor(Batch);
+				}
+			}
+			else
+			{
+				if (Node.RightChild >= 0)
+				{
+					Stack.Push(Node.RightChild);
+				}
+				if (Node.LeftChild >= 0)
+				{
+					Stack.Push(Node.LeftChild);
+				}
+			}
+		}
+	}
+}
+
+bool FLineBVHQuery::QueryNearestSegment(const FGPULineData& InGPUData, const FVector2f& InPoint, float InMaxDistance, FSurfaceLineHit& OutHit)
+{
+	using namespace SurfaceLineQuery;
+
+	OutHit = FSurfaceLineHit();
+
+	if (!InGPUData.IsValid() || InMaxDistance < 0.0f)
+	{
+		return false;
+	}
+
+	// 已找到的最近距离持续收紧搜索范围
+	float BestDistanceSquared = FMath::Square(InMaxDistance);
+	int32 BestSegment = INDEX_NONE;
+	float BestT = 0.0f;
+
+	alignas(16) float DistanceSquared[SegmentBatchSize];
+	alignas(16) float T[SegmentBatchSize];
+
+	TraverseBatches(InGPUData,
+		[&](const FVector3f& InMin, const FVector3f& InMax)
+		{
+			return PointBoxDistanceSquaredXY(InMin, InMax, InPoint) <= BestDistanceSquared;
+		},
+		[&](const FSegmentBatch& InBatch)
+		{
+			PointSegmentDistanceSquared(InBatch, InPoint, DistanceSquared, T);
+			for (int32 Lane = 0; Lane < InBatch.NumSegments; ++Lane)
+			{
+				if (DistanceSquared[Lane] <= BestDistanceSquared)
+				{
+					BestDistanceSquared = DistanceSquared[Lane];
+					BestSegment = InBatch.FirstSegment + Lane;
+					BestT = T[Lane];
+				}
+			}
+		});
+
+	if (BestSegment == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHit = MakeHit(InGPUData.Segments[BestSegment], BestSegment, FMath::Sqrt(BestDistanceSquared), BestT);
+	return true;
+}
+
+int32 FLineBVHQuery::QuerySegmentsInRadius(const FGPULineData& InGPUData, const FVector2f& InPoint, float InRadius, TArray<FSurfaceLineHit>& OutHits)
+{
+	using namespace SurfaceLineQuery;
+
+	OutHits.Reset();
+
+	if (!InGPUData.IsValid() || InRadius < 0.0f)
+	{
+		return 0;
+	}
+
+	const float RadiusSquared = FMath::Square(InRadius);
+
+	alignas(16) float DistanceSquared[SegmentBatchSize];
+	alignas(16) float T[SegmentBatchSize];
+
+	TraverseBatches(InGPUData,
+		[&](const FVector3f& InMin, const FVector3f& InMax)
+		{
+			return PointBoxDistanceSquaredXY(InMin, InMax, InPoint) <= RadiusSquared;
+		},
+		[&](const FSegmentBatch& InBatch)
+		{
+			PointSegmentDistanceSquared(InBatch, InPoint, DistanceSquared, T);
+			for (int32 Lane = 0; Lane < InBatch.NumSegments; ++Lane)
+			{
+				if (DistanceSquared[Lane] <= RadiusSquared)
+				{
+					const int32 SegmentIndex = InBatch.FirstSegment + Lane;
+					OutHits.Add(MakeHit(InGPUData.Segments[SegmentIndex], SegmentIndex, FMath::Sqrt(DistanceSquared[Lane]), T[Lane]));
+				}
+			}
+		});
+
+	return OutHits.Num();
+}
+
+bool FLineBVHQuery::RaycastSegment(const FGPULineData& InGPUData, const FVector2f& InOrigin, const FVector2f& InDirection, float InMaxDistance, FSurfaceLineHit& OutHit)
+{
+	using namespace SurfaceLineQuery;
+
+	OutHit = FSurfaceLineHit();
+
+	const FVector2f Direction = InDirection.GetSafeNormal();
+	if (!InGPUData.IsValid() || Direction.IsNearlyZero() || InMaxDistance < 0.0f)
+	{
+		return false;
+	}
+
+	// 方向分量为0时倒数为无穷大，slab测试仍然成立
+	const FVector2f InvDirection(1.0f / Direction.X, 1.0f / Direction.Y);
+
+	// 已找到的最近交点持续缩短射线
+	float BestDistance = InMaxDistance;
+	int32 BestSegment = INDEX_NONE;
+	float BestT = 0.0f;
+
+	alignas(16) float Distance[SegmentBatchSize];
+	alignas(16) float T[SegmentBatchSize];
+
+	TraverseBatches(InGPUData,
+		[&](const FVector3f& InMin, const FVector3f& InMax)
+		{
+			return RayIntersectsBoxXY(InMin, InMax, InOrigin, InvDirection, BestDistance);
+		},
+		[&](const FSegmentBatch& InBatch)
+		{
+			uint32 HitMask = RaySegmentIntersect(InBatch, InOrigin, Direction, BestDistance, Distance, T);
+			while (HitMask != 0)
+			{
+				const int32 Lane = static_cast<int32>(FMath::CountTrailingZeros(HitMask));
+				HitMask &= HitMask - 1;
+
+				if (Distance[Lane] <= BestDistance)
+				{
+					BestDistance = Distance[Lane];
+					BestSegment = InBatch.FirstSegment + Lane;
+					BestT = T[Lane];
+				}
+			}
+		});
+
+	if (BestSegment == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHit = MakeHit(InGPUData.Segments[BestSegment], BestSegment, BestDistance, BestT);
+	return true;
+}
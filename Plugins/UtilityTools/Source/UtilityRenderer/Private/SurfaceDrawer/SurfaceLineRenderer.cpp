@@ -1,4 +1,9 @@
 ﻿#include "SurfaceDrawer/SurfaceLineRenderer.h"
+#include "SurfaceDrawer/SurfaceCoverageCache.h"
+#include "SurfaceDrawer/SurfaceFrustumCulling.h"
+#include "SurfaceDrawer/SurfaceReducedResolution.h"
+#include "SurfaceDrawer/SurfaceScreenBounds.h"
+#include "SurfaceDrawer/SurfaceTileCulling.h"
 
 #include "GlobalShader.h"
 #include "ShaderParameterStruct.h"
@@ -13,6 +18,8 @@
 #include "RenderTargetPool.h"
 #include "PixelShaderUtils.h"
 #include "RenderGraphEvent.h"
+#include "RenderGraphUtils.h"
+#include "Algo/Sort.h"
 #include "SceneTexturesConfig.h"
 
 #include "../Private/SceneRendering.h"
@@ -26,6 +33,16 @@ public:
 	
 	// 告诉引擎此着色器使用结构作为其参数
 	SHADER_USE_PARAMETER_STRUCT(FSurfaceLineRenderPS, FGlobalShader);
+
+	// 是否输出多边形ID纹理（拾取）
+	class FWritePolygonIdDim : SHADER_PERMUTATION_BOOL("WRITE_POLYGON_ID");
+	// 是否在一个Pass中处理所有代理
+	class FMergedProxiesDim : SHADER_PERMUTATION_BOOL("MERGED_PROXIES");
+	// 是否输出覆盖纹理并复用上一帧的覆盖结果
+	class FCoverageCacheDim : SHADER_PERMUTATION_BOOL("COVERAGE_CACHE");
+	// 是否使用低分辨率分类结果，只逐像素查询边缘附近的像素
+	class FReducedResolutionDim : SHADER_PERMUTATION_BOOL("REDUCED_RESOLUTION");
+	using FPermutationDomain = TShaderPermutationDomain<FWritePolygonIdDim, FMergedProxiesDim, FCoverageCacheDim, FReducedResolutionDim>;
 	
 	// 着色器参数结构声明
 	// 参数与HLSL代码中的参数匹配
@@ -36,16 +53,30 @@ public:
 		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPULineBVHNode>, LineBVHNodeData)			// BVH节点数据
 		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUSegmentCluster>, SegmentClusterData)	// 线段簇数据
 		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUSegment>, SegmentData)					// 线段数据
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPULineStyle>, LineStyleData)				// 线样式表
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, PolygonStyleData)					// 每个多边形的样式索引
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, SeedNodeData)						// 遍历的起始子树
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPULineBVHNode>, ProxyBVHNodeData)		// 代理顶层BVH（合并模式）
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPULineProxyParams>, ProxyParamsData)	// 每个代理的参数（合并模式）
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, CustomTexture)									// 自定义纹理
 		SHADER_PARAMETER_SAMPLER(SamplerState, CustomTextureSampler)								// 自定义纹理采样器
 		SHADER_PARAMETER(FMatrix44f, ScreenToWorld)													// 屏幕到世界坐标变换矩阵
 		SHADER_PARAMETER(FMatrix44f, InvViewMatrix)													// 视图矩阵的逆矩阵
 		SHADER_PARAMETER(FIntRect, ViewportRect)													// 视口矩形
-		SHADER_PARAMETER(float, LineWidth)															// 线宽
-		SHADER_PARAMETER(float, LineOpacity)														// 线透明度
-		SHADER_PARAMETER(FVector4f, LineColor)														// 线颜色
+		SHADER_PARAMETER(float, TanHalfFOV)															// 垂直半视场角的正切
+		SHADER_PARAMETER(float, MaxLineWidth)														// 最大线宽
+		SHADER_PARAMETER(uint32, NumPolygonStyles)													// 多边形样式索引数量
+		SHADER_PARAMETER(uint32, NumAtlasSlots)														// 图集槽位数量
 		SHADER_PARAMETER(uint32, bUseCustomTexture)													// 是否使用自定义纹理
 		SHADER_PARAMETER(uint32, bUsePixelUnit)														// 是否使用像素单位
+		SHADER_PARAMETER(uint32, NumSeedNodes)														// 起始子树数量
+		SHADER_PARAMETER(uint32, ProxyNodeOffset)													// 代理节点在共享缓冲区中的偏移
+		SHADER_PARAMETER(uint32, ProxyClusterOffset)												// 代理簇在共享缓冲区中的偏移
+		SHADER_PARAMETER(uint32, ProxySegmentOffset)												// 代理线段在共享缓冲区中的偏移
+		SHADER_PARAMETER(float, MaxWorldLineWidth)													// 世界单位代理的最大线宽（合并模式）
+		SHADER_PARAMETER(float, MaxPixelLineWidth)													// 像素单位代理的最大线宽（合并模式）
+		SHADER_PARAMETER_STRUCT_INCLUDE(FSurfaceCoverageCacheParameters, CoverageCache)			// 覆盖缓存
+		SHADER_PARAMETER_STRUCT_INCLUDE(FSurfaceReducedResolutionParameters, ReducedResolution)	// 降分辨率分类结果
 		RENDER_TARGET_BINDING_SLOTS()																// 渲染目标绑定槽
 	END_SHADER_PARAMETER_STRUCT()
 	
@@ -53,14 +84,283 @@ public:
 	// 由引擎调用，以确定为此着色器编译哪些变体
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
-		return true;
+		// 合并模式不输出多边形ID，也不使用覆盖缓存和降分辨率；覆盖缓存优先于降分辨率
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		if (PermutationVector.Get<FMergedProxiesDim>()
+			&& (PermutationVector.Get<FWritePolygonIdDim>() || PermutationVector.Get<FCoverageCacheDim>() || PermutationVector.Get<FReducedResolutionDim>()))
+		{
+			return false;
+		}
+		return !(PermutationVector.Get<FCoverageCacheDim>() && PermutationVector.Get<FReducedResolutionDim>());
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("MAX_PROXY_CANDIDATES"), FLineProxyTopLevelBVH::MaxMergedProxies);
 	}
 };
 	
 // 实现全局着色器		着色器类				着色器文件位置							着色器入口函数名	着色器类型
 IMPLEMENT_GLOBAL_SHADER(FSurfaceLineRenderPS, "/UtilityTools/SurfaceLineRenderShader.usf", "MainPixelShader", SF_Pixel);
+
+// 降分辨率分类像素着色器
+using FSurfaceLineReducedPS = TSurfaceReducedPS<FSurfaceLineRenderPS>;
+IMPLEMENT_SHADER_TYPE(template<>, TSurfaceReducedPS<FSurfaceLineRenderPS>, TEXT("/UtilityTools/SurfaceLineRenderShader.usf"), TEXT("MainReducedPixelShader"), SF_Pixel);
+
+/**
+ * 分块计算着色器：每个16×16分块剔除一次BVH，像素只测试分块的候选叶子节点
+ */
+class FSurfaceLineTiledCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FSurfaceLineTiledCS);
+	SHADER_USE_PARAMETER_STRUCT(FSurfaceLineTiledCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, DepthTexture)									// 深度纹理
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<uint2>, CustomDepthTexture)						// 自定义深度纹理
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, RWColorTexture)						// 颜色纹理（读写）
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPULineBVHNode>, LineBVHNodeData)			// BVH节点数据
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUSegmentCluster>, SegmentClusterData)	// 线段簇数据
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUSegment>, SegmentData)					// 线段数据
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPULineStyle>, LineStyleData)				// 线样式表
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, PolygonStyleData)					// 每个多边形的样式索引
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, SeedNodeData)						// 遍历的起始子树
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, CustomTexture)									// 自定义纹理
+		SHADER_PARAMETER_SAMPLER(SamplerState, CustomTextureSampler)								// 自定义纹理采样器
+		SHADER_PARAMETER(FMatrix44f, ScreenToWorld)													// 屏幕到世界坐标变换矩阵
+		SHADER_PARAMETER(FMatrix44f, InvViewMatrix)													// 视图矩阵的逆矩阵
+		SHADER_PARAMETER(FIntRect, ViewportRect)													// 视口矩形
+		SHADER_PARAMETER(FIntRect, ScissorRect)														// 分派的屏幕范围（最小值与分块网格对齐）
+		SHADER_PARAMETER(float, TanHalfFOV)															// 垂直半视场角的正切
+		SHADER_PARAMETER(float, MaxLineWidth)														// 最大线宽
+		SHADER_PARAMETER(uint32, NumPolygonStyles)													// 多边形样式索引数量
+		SHADER_PARAMETER(uint32, NumAtlasSlots)														// 图集槽位数量
+		SHADER_PARAMETER(uint32, bUseCustomTexture)													// 是否使用自定义纹理
+		SHADER_PARAMETER(uint32, bUsePixelUnit)														// 是否使用像素单位
+		SHADER_PARAMETER(uint32, NumSeedNodes)														// 起始子树数量
+		SHADER_PARAMETER(uint32, ProxyNodeOffset)													// 代理节点在共享缓冲区中的偏移
+		SHADER_PARAMETER(uint32, ProxyClusterOffset)												// 代理簇在共享缓冲区中的偏移
+		SHADER_PARAMETER(uint32, ProxySegmentOffset)												// 代理线段在共享缓冲区中的偏移
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("TILE_SIZE"), FSurfaceTileCulling::TileSize);
+		OutEnvironment.SetDefine(TEXT("MAX_TILE_CANDIDATES"), FSurfaceTileCulling::MaxTileCandidates);
+		OutEnvironment.SetDefine(TEXT("MAX_TILE_LOOPS"), FSurfaceTileCulling::MaxTileLoops);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FSurfaceLineTiledCS, "/UtilityTools/SurfaceLineRenderShader.usf", "MainTiledComputeShader", SF_Compute);
+
+static TAutoConsoleVariable<int32> CVarSurfaceLineTiledCompute(
+	TEXT("r.SurfaceLine.TiledCompute"),
+	0,
+	TEXT("是否使用分块计算着色器渲染SurfaceLine组件。\n")
+	TEXT(" 0: 全屏像素着色器，每个像素遍历一次BVH（默认）\n")
+	TEXT(" 1: 每个16x16分块遍历一次BVH，像素只测试分块的候选簇；优先于合并模式，开启拾取的组件仍使用像素着色器\n")
+	TEXT("开启r.SurfaceDrawer.ReducedResolution时不生效"),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarSurfaceLineMergedOverlay(
+	TEXT("r.SurfaceLine.MergedOverlay"),
+	1,
+	TEXT("是否在一个全屏Pass中渲染所有SurfaceLine组件。\n")
+	TEXT(" 0: 每个组件一个全屏Pass\n")
+	TEXT(" 1: 通过代理顶层BVH合并渲染，几何数据直接使用共享缓冲区，只拼接样式表；使用自定义纹理或开启拾取的组件仍单独渲染，超过16个的组件也单独渲染（默认）\n")
+	TEXT("开启r.SurfaceDrawer.CoverageCache时主视图中的组件各自单独渲染，开启r.SurfaceDrawer.ReducedResolution时所有组件各自单独渲染"),
+	ECVF_RenderThreadSafe);
+
+namespace SurfaceLineRenderer
+{
+	/// \brief 局部修改上传时，间隔不超过该数量元素的修改范围合并为一次拷贝
+	static constexpr int32 DirtyRangeMaxGap = 16;
+
+	/// \brief 合并缓冲区的一段来源
+	struct FMergeSource
+	{
+		const TRefCountPtr<FRDGPooledBuffer>* PooledBuffer;
+		int32 ElementOffset;
+		int32 NumElements;
+	};
+
+	/// \brief 在GPU上把各代理的缓冲区依次拷贝到新的合并缓冲区
+	static TRefCountPtr<FRDGPooledBuffer> CreateMergedBuffer(FRDGBuilder& GraphBuilder, const TCHAR* Name, uint32 BytesPerElement, int32 NumElements, TConstArrayView<FMergeSource> Sources)
+	{
+		FRDGBuffer* MergedBuffer = GraphBuilder.CreateBuffer(
+			FRDGBufferDesc::CreateStructuredDesc(BytesPerElement, FMath::Max(NumElements, 1)), Name,
+			ERDGBufferFlags::MultiFrame);
+		for (const FMergeSource& Source : Sources)
+		{
+			if (Source.NumElements > 0 && Source.PooledBuffer->IsValid())
+			{
+				AddCopyBufferPass(GraphBuilder,
+					MergedBuffer, static_cast<uint64>(Source.ElementOffset) * BytesPerElement,
+					GraphBuilder.RegisterExternalBuffer(*Source.PooledBuffer), 0,
+					static_cast<uint64>(Source.NumElements) * BytesPerElement);
+			}
+		}
+		return GraphBuilder.ConvertToExternalBuffer(MergedBuffer);
+	}
+
+	/// \brief 全局黑色纹理，用作未使用的纹理参数
+	static FRDGTextureSRVRef CreateBlackTextureSRV(FRDGBuilder& GraphBuilder)
+	{
+		FRDGTextureRef BlackTextureRDG = GraphBuilder.RegisterExternalTexture(
+			CreateRenderTarget(GBlackTextureWithSRV->GetTextureRHI(), TEXT("GlobalBlackTexture")));
+		return GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(BlackTextureRDG));
+	}
+
+	/// \brief 设置与代理无关的参数：场景纹理、变换矩阵、视口和输出目标
+	static void SetViewParameters(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfaceLineRenderPS::FParameters* PassParameters)
+	{
+		PassParameters->DepthTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.DepthTexture));
+		PassParameters->ColorTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.ColorTexture));
+
+		// CustomDepthTexture
+		if (Parameters.SceneTexturesUniformParams)
+		{
+			PassParameters->CustomDepthTexture = Parameters.SceneTexturesUniformParams->GetContents()->CustomStencilTexture;
+		}
+		else
+		{
+			// 使用默认全局黑色纹理替代无效的自定义深度纹理
+			PassParameters->CustomDepthTexture = CreateBlackTextureSRV(GraphBuilder);
+		}
+
+		PassParameters->CustomTextureSampler = TStaticSamplerState<SF_Bilinear, AM_Border, AM_Border, AM_Border>::GetRHI();
+
+		// 计算屏幕位置到世界位置的变换矩阵
+		FMatrix InvViewProjMatrix = (Parameters.ViewMatrix * Parameters.ProjMatrix).Inverse();
+		PassParameters->ScreenToWorld = FMatrix44f(InvViewProjMatrix);
+
+		// 设置视图矩阵的逆
+		PassParameters->InvViewMatrix = FMatrix44f(Parameters.ViewMatrix).Inverse();
+
+		// 设置视口参数，像素世界大小使用视图的实际视场角，与FSurfaceTileCulling::MakeView一致
+		PassParameters->ViewportRect = Parameters.ViewportRect;
+		PassParameters->TanHalfFOV = 1.0f / FMath::Max(static_cast<float>(Parameters.ProjMatrix.M[1][1]), UE_SMALL_NUMBER);
+
+		// 绑定输出渲染目标
+		PassParameters->RenderTargets[0] = FRenderTargetBinding(
+			Parameters.ColorTexture,
+			Parameters.ColorTexture->HasBeenProduced() ? ERenderTargetLoadAction::ELoad : ERenderTargetLoadAction::ENoAction);
+	}
+
+	/// \brief 递归构建顶层BVH节点，返回节点索引
+	static int32 BuildTopLevelNode(TConstArrayView<FBox2f> ProxyBounds, TArrayView<int32> ProxyIndices, TArray<FGPULineBVHNode>& OutNodes)
+	{
+		FBox2f NodeBounds(ForceInit);
+		FBox2f CenterBounds(ForceInit);
+		for (int32 ProxyIndex : ProxyIndices)
+		{
+			NodeBounds += ProxyBounds[ProxyIndex];
+			CenterBounds += ProxyBounds[ProxyIndex].GetCenter();
+		}
+
+		const int32 NodeIndex = OutNodes.AddDefaulted();
+		{
+			FGPULineBVHNode& Node = OutNodes[NodeIndex];
+			Node.MinExtent = FVector3f(NodeBounds.Min.X, NodeBounds.Min.Y, 0.0f);
+			Node.MaxExtent = FVector3f(NodeBounds.Max.X, NodeBounds.Max.Y, 0.0f);
+			Node.Padding[0] = Node.Padding[1] = 0.0f;
+			if (ProxyIndices.Num() == 1)
+			{
+				Node.IsLeaf = 1;
+				Node.ClusterIndex = ProxyIndices[0];
+				return NodeIndex;
+			}
+			Node.IsLeaf = 0;
+		}
+
+		// 沿中心分布较长的轴按中位数划分
+		const FVector2f CenterExtent = CenterBounds.GetSize();
+		const int32 Axis = CenterExtent.X >= CenterExtent.Y ? 0 : 1;
+		Algo::Sort(ProxyIndices, [&ProxyBounds, Axis](int32 A, int32 B)
+			{
+				return ProxyBounds[A].GetCenter()[Axis] < ProxyBounds[B].GetCenter()[Axis];
+			});
+
+		const int32 NumLeft = ProxyIndices.Num() / 2;
+		const int32 LeftChild = BuildTopLevelNode(ProxyBounds, ProxyIndices.Slice(0, NumLeft), OutNodes);
+		const int32 RightChild = BuildTopLevelNode(ProxyBounds, ProxyIndices.Slice(NumLeft, ProxyIndices.Num() - NumLeft), OutNodes);
+		OutNodes[NodeIndex].LeftChild = LeftChild;
+		OutNodes[NodeIndex].RightChild = RightChild;
+		return NodeIndex;
+	}
+}
+
+void FLineProxyTopLevelBVH::Build(TConstArrayView<FBox2f> InProxyBounds, TArray<FGPULineBVHNode>& OutNodes)
+{
+	OutNodes.Reset();
+	if (InProxyBounds.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<int32> ProxyIndices;
+	ProxyIndices.SetNumUninitialized(InProxyBounds.Num());
+	for (int32 Index = 0; Index < ProxyIndices.Num(); ++Index)
+	{
+		ProxyIndices[Index] = Index;
+	}
+
+	OutNodes.Reserve(InProxyBounds.Num() * 2 - 1);
+	SurfaceLineRenderer::BuildTopLevelNode(InProxyBounds, ProxyIndices, OutNodes);
+}
 	
 // 着色器管理器实例初始化
+FSurfaceLineArenas::FSurfaceLineArenas()
+	: Nodes(TEXT("SurfaceLineBVHNodesArena"), sizeof(FGPULineBVHNode))
+	, Clusters(TEXT("SurfaceLineClustersArena"), sizeof(FGPUSegmentCluster))
+	, Segments(TEXT("SurfaceLineSegmentsArena"), sizeof(FGPUSegment))
+{
+}
+
+void FSurfaceLineArenas::Allocate(const FGPULineData& InData, FSurfaceLineAllocations& OutAllocations)
+{
+	OutAllocations.Nodes = Nodes.Allocate(InData.Nodes.Num());
+	OutAllocations.Clusters = Clusters.Allocate(InData.Clusters.Num());
+	OutAllocations.Segments = Segments.Allocate(InData.Segments.Num());
+}
+
+void FSurfaceLineArenas::Free(FSurfaceLineAllocations& InOutAllocations)
+{
+	Nodes.Free(InOutAllocations.Nodes);
+	Clusters.Free(InOutAllocations.Clusters);
+	Segments.Free(InOutAllocations.Segments);
+}
+
+void FSurfaceLineArenas::Defragment(FRDGBuilder& GraphBuilder)
+{
+	Nodes.Defragment(GraphBuilder);
+	Clusters.Defragment(GraphBuilder);
+	Segments.Defragment(GraphBuilder);
+}
+
+void FSurfaceLineArenas::ResetSRVs()
+{
+	Nodes.ResetSRV();
+	Clusters.ResetSRV();
+	Segments.ResetSRV();
+}
+
+void FSurfaceLineArenas::Release()
+{
+	Nodes.Release();
+	Clusters.Release();
+	Segments.Release();
+}
+
 FSurfaceLineRenderManager* FSurfaceLineRenderManager::Instance = nullptr;
 	
 FSurfaceLineRenderManager::~FSurfaceLineRenderManager()
@@ -68,36 +368,42 @@ FSurfaceLineRenderManager::~FSurfaceLineRenderManager()
 	// 确保渲染结束
 	EndRendering();
 
-	FScopeLock Lock(&RenderThreadLock);
-	for (auto& ProxyPair : SceneProxyMap)
-	{
-		if (ProxyPair.Value.IsValid())
+	// 代理列表和池化缓冲区归渲染线程所有，排在已提交的注册/注销命令之后释放，并等待释放完成
+	ENQUEUE_RENDER_COMMAND(ReleaseSurfaceLineRenderManager)(
+		[this](FRHICommandList& RHICmdList)
 		{
-			// 发送渲染命令释放GPU资源
-			ENQUEUE_RENDER_COMMAND(ReleaseSurfaceLineResources)(
-				[SceneProxyCopy = ProxyPair.Value](FRHICommandList& RHICmdList)
-				{
-					SceneProxyCopy->ReleasePooledBuffers();
-				});
-		}
-	}
-	SceneProxyMap.Empty();
+			for (const TSharedPtr<FSurfaceLineSceneProxy>& SceneProxy : SceneProxies)
+			{
+				SceneProxy->ReleasePooledBuffers(Arenas);
+			}
+			SceneProxies.Empty();
+			Arenas.Release();
+
+			MergedProxySlots.Empty();
+			MergedLineStylesPooledBuffer.SafeRelease();
+			MergedPolygonStylesPooledBuffer.SafeRelease();
+		});
+	FlushRenderingCommands();
 }
 	
 void FSurfaceLineRenderManager::RegisterSceneProxy(const TSharedPtr<FSurfaceLineSceneProxy>& InSceneProxy)
 {
 	if (InSceneProxy.IsValid())
 	{
-		FScopeLock Lock(&RenderThreadLock);
-
 		// 分配唯一ID
 		uint32 NewProxyId = NextProxyId++;
 		InSceneProxy->ProxyId = NewProxyId;
 
 		// 检查是否是第一个代理
-		bool bWasEmpty = SceneProxyMap.IsEmpty();
+		bool bWasEmpty = RegisteredProxyIds.IsEmpty();
+		RegisteredProxyIds.Add(NewProxyId);
 
-		SceneProxyMap.Add(NewProxyId, InSceneProxy);
+		// 代理列表归渲染线程所有，渲染命令按提交顺序执行
+		ENQUEUE_RENDER_COMMAND(AddSurfaceLineSceneProxy)(
+			[this, InSceneProxy](FRHICommandList& RHICmdList)
+			{
+				AddSceneProxy_RenderThread(InSceneProxy);
+			});
 
 		// 如果是第一个代理，开始渲染
 		if (bWasEmpty)
@@ -109,34 +415,20 @@ void FSurfaceLineRenderManager::RegisterSceneProxy(const TSharedPtr<FSurfaceLine
 	
 void FSurfaceLineRenderManager::UnregisterSceneProxy(uint32 ProxyId)
 {
-	TSharedPtr<FSurfaceLineSceneProxy> SceneProxyToRemove;
-	bool bMapIsEmpty = false;
-
+	if (RegisteredProxyIds.Remove(ProxyId) == 0)
 	{
-		FScopeLock Lock(&RenderThreadLock);
-
-		if (SceneProxyMap.RemoveAndCopyValue(ProxyId, SceneProxyToRemove))
-		{
-			bMapIsEmpty = SceneProxyMap.IsEmpty();
-		}
-		else
-		{
-			bMapIsEmpty = SceneProxyMap.IsEmpty();
-		}
+		return;
 	}
 
-	if (SceneProxyToRemove.IsValid())
-	{
-		// 在渲染线程释放资源
-		ENQUEUE_RENDER_COMMAND(ReleaseSurfaceLineResources_ProxyId)(
-			[SceneProxyToRemove](FRHICommandList& RHICmdList)
-			{
-				SceneProxyToRemove->ReleasePooledBuffers();
-			});
-	}
+	// 在渲染线程移除代理并释放资源
+	ENQUEUE_RENDER_COMMAND(RemoveSurfaceLineSceneProxy)(
+		[this, ProxyId](FRHICommandList& RHICmdList)
+		{
+			RemoveSceneProxy_RenderThread(ProxyId);
+		});
 
-	// 如果Map为空，停止渲染
-	if (bMapIsEmpty)
+	// 如果没有代理，停止渲染
+	if (RegisteredProxyIds.IsEmpty())
 	{
 		EndRendering();
 	}
@@ -144,9 +436,39 @@ void FSurfaceLineRenderManager::UnregisterSceneProxy(uint32 ProxyId)
 
 int32 FSurfaceLineRenderManager::GetNumSceneProxies()
 {
-	FScopeLock Lock(&RenderThreadLock);
-	
-	return SceneProxyMap.Num();
+	return RegisteredProxyIds.Num();
+}
+
+void FSurfaceLineRenderManager::AddSceneProxy_RenderThread(const TSharedPtr<FSurfaceLineSceneProxy>& InSceneProxy)
+{
+	check(IsInRenderingThread());
+
+	// ProxyId递增，追加即保持注册顺序
+	SceneProxies.Add(InSceneProxy);
+}
+
+void FSurfaceLineRenderManager::RemoveSceneProxy_RenderThread(uint32 ProxyId)
+{
+	check(IsInRenderingThread());
+
+	const int32 ProxyIndex = SceneProxies.IndexOfByPredicate([ProxyId](const TSharedPtr<FSurfaceLineSceneProxy>& SceneProxy)
+		{
+			return SceneProxy->GetProxyId() == ProxyId;
+		});
+	if (ProxyIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	SceneProxies[ProxyIndex]->ReleasePooledBuffers(Arenas);
+	SceneProxies.RemoveAt(ProxyIndex);
+
+	// 没有代理时释放共享缓冲区和合并样式缓冲区
+	if (SceneProxies.IsEmpty())
+	{
+		Arenas.Release();
+		ReleaseMergedBuffers_RenderThread();
+	}
 }
 	
 void FSurfaceLineRenderManager::BeginRendering()
@@ -201,208 +523,666 @@ void FSurfaceLineRenderManager::Execute_RenderThread(FPostOpaqueRenderParameters
 		}
 	}
 
-	// 复制SceneProxyMap为本地Proxies
-	FScopeLock Lock(&RenderThreadLock);
-	if (SceneProxyMap.IsEmpty())
+	// 代理列表仅渲染线程访问，直接遍历
+	if (SceneProxies.IsEmpty())
 	{
 		return;
 	}
-	TArray<TSharedPtr<FSurfaceLineSceneProxy>> ProxiesToRender;
-	for (auto& ProxyPair : SceneProxyMap)
-	{
-		if (ProxyPair.Value.IsValid())
-		{
-			ProxiesToRender.Add(ProxyPair.Value);
-		}
-	}
-	Lock.Unlock();
 
-	// 为每个场景代理创建渲染Pass
-	for (TSharedPtr<FSurfaceLineSceneProxy> LocalSceneProxy : ProxiesToRender)
+	FRDGBuilder& GraphBuilder = *Parameters.GraphBuilder;
+	Arenas.ResetSRVs();
+	const bool bTiledCompute = CVarSurfaceLineTiledCompute.GetValueOnRenderThread() != 0;
+	const bool bMergeProxies = CVarSurfaceLineMergedOverlay.GetValueOnRenderThread() != 0;
+	const FMatrix ViewProjMatrix = Parameters.ViewMatrix * Parameters.ProjMatrix;
+
+	// 覆盖缓存只用于主视图，每个代理单独渲染以便各自保存覆盖纹理
+	const bool bIsMainView = SceneView->Family->Views.Num() > 0 && SceneView->Family->Views[0] == SceneView;
+	const bool bCoverageCache = bIsMainView && FSurfaceCoverageCache::IsEnabled();
+
+	// 降分辨率分类纹理按代理的屏幕范围生成，同样每个代理单独渲染
+	const bool bReducedResolution = FSurfaceReducedResolution::GetReductionFactor() > 1;
+
+	// 初始化缓冲区，可合并的代理收集到一起，其余代理各自一个Pass；屏幕范围与代理列表一一对应
+	TArray<FSurfaceLineSceneProxy*> ProxiesToMerge;
+	TArray<FSurfaceLineSceneProxy*> ProxiesToRenderSeparately;
+	TArray<FSurfaceLineSceneProxy*> ProxiesToRenderTiled;
+	TArray<FIntRect> MergeScissorRects;
+	TArray<FIntRect> SeparateScissorRects;
+	TArray<FIntRect> TiledScissorRects;
+	bool bUploadPending = false;
+	for (const TSharedPtr<FSurfaceLineSceneProxy>& LocalSceneProxy : SceneProxies)
 	{
-		if (!LocalSceneProxy.IsValid() || !LocalSceneProxy->GPULineData.IsValid() || !LocalSceneProxy->GPULineData->IsValid())
+		if (!LocalSceneProxy.IsValid())
 		{
 			continue;
 		}
 
-		FRDGBuilder& GraphBuilder = *Parameters.GraphBuilder;
+		// 推进几何数据的分帧上传，完成前继续使用旧数据和旧的分配
+		LocalSceneProxy->InitializePooledBuffers(GraphBuilder, Arenas);
+		bUploadPending |= LocalSceneProxy->bUploadPending;
 
-		// 初始化池化缓冲区
-		LocalSceneProxy->InitializePooledBuffers(GraphBuilder);
+		if (!LocalSceneProxy->GPULineData.IsValid() || !LocalSceneProxy->GPULineData->IsValid())
+		{
+			continue;
+		}
 
-		// 设置着色器参数
-		FSurfaceLineRenderPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfaceLineRenderPS::FParameters>();
+		if (!LocalSceneProxy->StyleTable.IsValid() || !LocalSceneProxy->StyleTable->IsValid())
+		{
+			continue;
+		}
 
-		// DepthTexture 
-		FRDGTextureSRVRef DepthTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.DepthTexture));
-		PassParameters->DepthTexture = DepthTextureSRV;
+		// 初始化样式缓冲区
+		LocalSceneProxy->InitializeStyleBuffers(GraphBuilder);
+		if (!LocalSceneProxy->bBuffersInitialized)
+		{
+			continue;
+		}
 
-		// ColorTexture
-		FRDGTextureSRVRef ColorTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.ColorTexture));
-		PassParameters->ColorTexture = ColorTextureSRV;
+		// 完全在屏幕外的代理不添加Pass；开启拾取时回读清空的ID纹理，使光标下的多边形随之清除
+		FIntRect ScissorRect;
+		if (!LocalSceneProxy->CalculateScissorRect(ViewProjMatrix, Parameters.ViewportRect, ScissorRect))
+		{
+			if (LocalSceneProxy->PolygonIdPicker.IsValid() && bIsMainView)
+			{
+				FRDGTextureRef PolygonIdTexture = FSurfacePolygonIdPicker::CreateIdTexture(GraphBuilder, Parameters.ColorTexture->Desc.Extent);
+				AddClearRenderTargetPass(GraphBuilder, PolygonIdTexture);
+				LocalSceneProxy->PolygonIdPicker->AddReadbackPasses(GraphBuilder, PolygonIdTexture, Parameters.ViewportRect);
+			}
+			continue;
+		}
 
-		// CustomDepthTexture
-		if (Parameters.SceneTexturesUniformParams)
+		if (bCoverageCache || bReducedResolution)
 		{
-			PassParameters->CustomDepthTexture = Parameters.SceneTexturesUniformParams->GetContents()->CustomStencilTexture;
+			ProxiesToRenderSeparately.Add(LocalSceneProxy.Get());
+			SeparateScissorRects.Add(ScissorRect);
 		}
-		else
+		else if (bTiledCompute && !LocalSceneProxy->PolygonIdPicker.IsValid())
 		{
-			// 使用默认全局白色纹理替代无效的自定义纹理
-			FRDGTextureRef CustomTextureRDG = GraphBuilder.RegisterExternalTexture(
-				CreateRenderTarget(GBlackTextureWithSRV->GetTextureRHI(), TEXT("GlobalBlackTexture")));
-			FRDGTextureSRVRef CustomDataTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(CustomTextureRDG));
-			PassParameters->CustomDepthTexture = CustomDataTextureSRV;
+			ProxiesToRenderTiled.Add(LocalSceneProxy.Get());
+			TiledScissorRects.Add(ScissorRect);
 		}
-
-		// 使用持久化缓冲区
-		if (LocalSceneProxy->bBuffersInitialized)
+		else if (bMergeProxies && LocalSceneProxy->CanMerge())
 		{
-			// 注册持久化缓冲区到当前帧的RDG
-			FRDGBuffer* BVHNodesRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->BVHNodesPooledBuffer);
-			PassParameters->LineBVHNodeData = GraphBuilder.CreateSRV(BVHNodesRDGBuffer);
-
-			FRDGBuffer* ClustersRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->ClustersPooledBuffer);
-			PassParameters->SegmentClusterData = GraphBuilder.CreateSRV(ClustersRDGBuffer);
-
-			FRDGBuffer* SegmentsRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->SegmentsPooledBuffer);
-			PassParameters->SegmentData = GraphBuilder.CreateSRV(SegmentsRDGBuffer);
+			ProxiesToMerge.Add(LocalSceneProxy.Get());
+			MergeScissorRects.Add(ScissorRect);
 		}
 		else
 		{
-			continue;
+			ProxiesToRenderSeparately.Add(LocalSceneProxy.Get());
+			SeparateScissorRects.Add(ScissorRect);
 		}
+	}
+
+	// 没有上传进行中时在剩余的上传预算内整理共享缓冲区，整理完成的帧之后添加的Pass使用新的偏移；
+	// 上传和整理都在添加Pass之前，所有Pass共用每个缓冲区的同一个SRV
+	if (!bUploadPending)
+	{
+		Arenas.Defragment(GraphBuilder);
+	}
 
-		// CustomTexture
-		if (LocalSceneProxy->bUseCustomTexture)
+	// 只有一个可合并的代理时直接单独渲染，不需要合并样式缓冲区
+	if (ProxiesToMerge.Num() == 1)
+	{
+		ProxiesToRenderSeparately.Insert(ProxiesToMerge[0], 0);
+		SeparateScissorRects.Insert(MergeScissorRects[0], 0);
+		ProxiesToMerge.Reset();
+	}
+
+	// 着色器每个像素最多混合MaxMergedProxies个代理，超出的代理单独渲染，避免重叠处被静默丢弃
+	if (ProxiesToMerge.Num() > FLineProxyTopLevelBVH::MaxMergedProxies)
+	{
+		const int32 NumOverflow = ProxiesToMerge.Num() - FLineProxyTopLevelBVH::MaxMergedProxies;
+		ProxiesToRenderSeparately.Append(MakeArrayView(ProxiesToMerge).Right(NumOverflow));
+		SeparateScissorRects.Append(MakeArrayView(MergeScissorRects).Right(NumOverflow));
+		ProxiesToMerge.SetNum(FLineProxyTopLevelBVH::MaxMergedProxies);
+		MergeScissorRects.SetNum(FLineProxyTopLevelBVH::MaxMergedProxies);
+	}
+
+	if (ProxiesToMerge.Num() > 0)
+	{
+		// 代理列表已按代理ID（注册顺序）排列，重叠时按该顺序混合；合并Pass渲染各代理屏幕范围的并集
+		FIntRect MergedScissorRect = MergeScissorRects[0];
+		for (const FIntRect& ScissorRect : MergeScissorRects)
 		{
-			if (LocalSceneProxy->CustomTexture)
-			{
-				FTextureResource* CustomTextureResource = LocalSceneProxy->CustomTexture->GetResource();
-				if (CustomTextureResource)
-				{
-					FRDGTextureRef CustomTextureRDG = GraphBuilder.RegisterExternalTexture(
-						CreateRenderTarget(CustomTextureResource->GetTextureRHI(), TEXT("CustomTexture")));
-					FRDGTextureSRVRef CustomDataTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(CustomTextureRDG));
-					PassParameters->CustomTexture = CustomDataTextureSRV;
-				}
-			}
-			else
-			{
-				// 使用默认全局白色纹理替代无效的自定义纹理
-				FRDGTextureRef CustomTextureRDG = GraphBuilder.RegisterExternalTexture(
-					CreateRenderTarget(GBlackTextureWithSRV->GetTextureRHI(), TEXT("GlobalBlackTexture")));
-				FRDGTextureSRVRef CustomDataTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(CustomTextureRDG));
-				PassParameters->CustomTexture = CustomDataTextureSRV;
-			}
+			MergedScissorRect.Union(ScissorRect);
 		}
-		else
+		AddMergedPass_RenderThread(GraphBuilder, Parameters, ProxiesToMerge, MergedScissorRect);
+	}
+
+	for (int32 Index = 0; Index < ProxiesToRenderTiled.Num(); ++Index)
+	{
+		if (!AddTiledComputePass_RenderThread(GraphBuilder, Parameters, *ProxiesToRenderTiled[Index], TiledScissorRects[Index]))
 		{
-			// 使用默认全局白色纹理占位
-			FRDGTextureRef CustomTextureRDG = GraphBuilder.RegisterExternalTexture(
-				CreateRenderTarget(GBlackTextureWithSRV->GetTextureRHI(), TEXT("GlobalBlackTexture")));
-			FRDGTextureSRVRef CustomDataTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(CustomTextureRDG));
-			PassParameters->CustomTexture = CustomDataTextureSRV;
+			ProxiesToRenderSeparately.Add(ProxiesToRenderTiled[Index]);
+			SeparateScissorRects.Add(TiledScissorRects[Index]);
 		}
+	}
 
-		// 设置采样器参数
-		PassParameters->CustomTextureSampler = TStaticSamplerState<SF_Bilinear, AM_Border, AM_Border, AM_Border>::GetRHI();
+	for (int32 Index = 0; Index < ProxiesToRenderSeparately.Num(); ++Index)
+	{
+		AddProxyPass_RenderThread(GraphBuilder, Parameters, SceneView, *ProxiesToRenderSeparately[Index], SeparateScissorRects[Index]);
+	}
+}
 
-		// 计算屏幕位置到世界位置的变换矩阵
-		FMatrix InvViewProjMatrix = (Parameters.ViewMatrix * Parameters.ProjMatrix).Inverse();
+template <typename ParametersType>
+void FSurfaceLineRenderManager::SetGeometryParameters(FRDGBuilder& GraphBuilder, const FSurfaceLineSceneProxy& SceneProxy, ParametersType* PassParameters)
+{
+	// 所有代理共用同一组缓冲区，着色器按偏移访问本代理的数据
+	PassParameters->LineBVHNodeData = Arenas.Nodes.GetSRV(GraphBuilder);
+	PassParameters->SegmentClusterData = Arenas.Clusters.GetSRV(GraphBuilder);
+	PassParameters->SegmentData = Arenas.Segments.GetSRV(GraphBuilder);
+	PassParameters->ProxyNodeOffset = Arenas.Nodes.GetOffset(SceneProxy.Allocations.Nodes);
+	PassParameters->ProxyClusterOffset = Arenas.Clusters.GetOffset(SceneProxy.Allocations.Clusters);
+	PassParameters->ProxySegmentOffset = Arenas.Segments.GetOffset(SceneProxy.Allocations.Segments);
+}
 
-		PassParameters->ScreenToWorld = FMatrix44f(InvViewProjMatrix);
+void FSurfaceLineRenderManager::AddProxyPass_RenderThread(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, const FSceneView* SceneView, FSurfaceLineSceneProxy& SceneProxy, const FIntRect& ScissorRect)
+{
+	using namespace SurfaceLineRenderer;
 
-		// 设置视图矩阵的逆
-		PassParameters->InvViewMatrix = FMatrix44f(Parameters.ViewMatrix).Inverse();
+	// 设置着色器参数
+	FSurfaceLineRenderPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfaceLineRenderPS::FParameters>();
+	SetViewParameters(GraphBuilder, Parameters, PassParameters);
 
-		// 设置视口参数
-		PassParameters->ViewportRect = Parameters.ViewportRect;
+	// 共享几何缓冲区及本代理的偏移
+	SetGeometryParameters(GraphBuilder, SceneProxy, PassParameters);
 
-		// 设置线参数
-		PassParameters->LineWidth = LocalSceneProxy->LineWidth;
-		PassParameters->LineOpacity = LocalSceneProxy->LineOpacity;
-		PassParameters->LineColor = LocalSceneProxy->LineColor;
-		PassParameters->bUseCustomTexture = LocalSceneProxy->bUseCustomTexture;
-		PassParameters->bUsePixelUnit = LocalSceneProxy->bUsePixelUnit;
+	// 样式表
+	FRDGBuffer* LineStylesRDGBuffer = GraphBuilder.RegisterExternalBuffer(SceneProxy.LineStylesPooledBuffer);
+	PassParameters->LineStyleData = GraphBuilder.CreateSRV(LineStylesRDGBuffer);
 
-		// 绑定输出渲染目标
-		PassParameters->RenderTargets[0] = FRenderTargetBinding(
-			Parameters.ColorTexture,
-			Parameters.ColorTexture->HasBeenProduced() ? ERenderTargetLoadAction::ELoad : ERenderTargetLoadAction::ENoAction);
+	FRDGBuffer* PolygonStylesRDGBuffer = GraphBuilder.RegisterExternalBuffer(SceneProxy.PolygonStylesPooledBuffer);
+	PassParameters->PolygonStyleData = GraphBuilder.CreateSRV(PolygonStylesRDGBuffer);
+
+	// CustomTexture，未指定或无效时使用默认全局黑色纹理占位
+	PassParameters->CustomTexture = nullptr;
+	if (SceneProxy.bUseCustomTexture && SceneProxy.CustomTexture)
+	{
+		FTextureResource* CustomTextureResource = SceneProxy.CustomTexture->GetResource();
+		if (CustomTextureResource)
+		{
+			FRDGTextureRef CustomTextureRDG = GraphBuilder.RegisterExternalTexture(
+				CreateRenderTarget(CustomTextureResource->GetTextureRHI(), TEXT("CustomTexture")));
+			PassParameters->CustomTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(CustomTextureRDG));
+		}
+	}
+	if (!PassParameters->CustomTexture)
+	{
+		PassParameters->CustomTexture = CreateBlackTextureSRV(GraphBuilder);
+	}
+
+	// 按视图覆盖范围剔除后剩余的子树，全部剔除时着色器不遍历
+	TArray<uint32> SeedNodes;
+	SceneProxy.CalculateSeedNodes(Parameters.ViewMatrix * Parameters.ProjMatrix, Parameters.ViewportRect, SeedNodes);
+	PassParameters->SeedNodeData = FSurfaceFrustumCulling::CreateSeedNodesSRV(GraphBuilder, TEXT("SurfaceLineSeedNodes"), SeedNodes);
+	PassParameters->NumSeedNodes = SeedNodes.Num();
+
+	// 设置线参数，BVH按最大线宽剪枝，命中后按样式线宽判断
+	PassParameters->MaxLineWidth = SceneProxy.StyleTable->MaxLineWidth;
+	PassParameters->NumPolygonStyles = SceneProxy.StyleTable->PolygonStyleIndices.Num();
+	PassParameters->NumAtlasSlots = SceneProxy.NumAtlasSlots;
+	PassParameters->bUseCustomTexture = SceneProxy.bUseCustomTexture;
+	PassParameters->bUsePixelUnit = SceneProxy.bUsePixelUnit;
+
+	// 多边形ID纹理和覆盖缓存，仅主视图输出
+	const bool bIsMainView = SceneView->Family->Views.Num() > 0 && SceneView->Family->Views[0] == SceneView;
+	FRDGTextureRef PolygonIdTexture = nullptr;
+	if (SceneProxy.PolygonIdPicker.IsValid() && bIsMainView)
+	{
+		PolygonIdTexture = FSurfacePolygonIdPicker::CreateIdTexture(GraphBuilder, Parameters.ColorTexture->Desc.Extent);
+		PassParameters->RenderTargets[1] = FRenderTargetBinding(PolygonIdTexture, ERenderTargetLoadAction::EClear);
+	}
 
-		// 获取着色器
-		TShaderMapRef<FSurfaceLineRenderPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	// 覆盖结果只取决于视图、屏幕范围、几何和样式缓冲区以及线宽单位；自定义纹理和颜色每帧重新合成
+	const bool bUseCoverageCache = bIsMainView && FSurfaceCoverageCache::IsEnabled();
+	if (bUseCoverageCache)
+	{
+		FSurfaceCoverageCacheKey CacheKey;
+		CacheKey.ViewProjMatrix = FSurfaceCoverageCache::GetUnjitteredViewProjection(*SceneView);
+		CacheKey.ViewportRect = Parameters.ViewportRect;
+		CacheKey.ScissorRect = ScissorRect;
+		CacheKey.TextureExtent = Parameters.ColorTexture->Desc.Extent;
+		CacheKey.GeometryGeneration = SceneProxy.BufferGeneration;
+		CacheKey.AttributeGeneration = SceneProxy.StyleBufferGeneration;
+		CacheKey.Parameters = SceneProxy.bUsePixelUnit;
+		SceneProxy.CoverageCache.AddCoverageTexture(GraphBuilder, CacheKey, PassParameters->CoverageCache);
+	}
+
+	// 降分辨率：先在屏幕范围对应的低分辨率矩形内分类，全分辨率Pass再读取分类结果
+	const int32 ReductionFactor = FSurfaceReducedResolution::GetReductionFactor();
+	const bool bUseReducedResolution = !bUseCoverageCache && ReductionFactor > 1;
+	if (bUseReducedResolution)
+	{
+		const FIntRect ReducedRect = FSurfaceReducedResolution::GetReducedRect(ScissorRect, Parameters.ViewportRect, ReductionFactor);
+		FRDGTextureRef ReducedCoverageTexture = FSurfaceReducedResolution::CreateCoverageTexture(
+			GraphBuilder, Parameters.ColorTexture->Desc.Extent, ReducedRect, ReductionFactor, PassParameters->ReducedResolution);
+
+		// 分类Pass与全分辨率Pass共用参数，只替换渲染目标
+		FSurfaceLineRenderPS::FParameters* ReducedPassParameters = GraphBuilder.AllocParameters<FSurfaceLineRenderPS::FParameters>();
+		*ReducedPassParameters = *PassParameters;
+		ReducedPassParameters->ReducedResolution.ReducedCoverageTexture = nullptr;
+		ReducedPassParameters->RenderTargets = FRenderTargetBindingSlots();
+		ReducedPassParameters->RenderTargets[0] = FRenderTargetBinding(ReducedCoverageTexture, ERenderTargetLoadAction::ENoAction);
 
-		// 添加全屏pass
+		TShaderMapRef<FSurfaceLineReducedPS> ReducedPixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
 		FPixelShaderUtils::AddFullscreenPass(
 			GraphBuilder,
 			GetGlobalShaderMap(GMaxRHIFeatureLevel),
-			RDG_EVENT_NAME("SurfaceLineRender_%d", LocalSceneProxy->GetProxyId()),
-			PixelShader,
-			PassParameters,
-			FIntRect(),
-			TStaticBlendState<>::GetRHI(),
-			TStaticRasterizerState<>::GetRHI(),
-			TStaticDepthStencilState<>::GetRHI()
-			);
+			RDG_EVENT_NAME("SurfaceLineReduced_%d(1/%d)", SceneProxy.GetProxyId(), ReductionFactor),
+			ReducedPixelShader,
+			ReducedPassParameters,
+			ReducedRect);
+	}
+
+	// 获取着色器
+	FSurfaceLineRenderPS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FSurfaceLineRenderPS::FWritePolygonIdDim>(PolygonIdTexture != nullptr);
+	PermutationVector.Set<FSurfaceLineRenderPS::FMergedProxiesDim>(false);
+	PermutationVector.Set<FSurfaceLineRenderPS::FCoverageCacheDim>(bUseCoverageCache);
+	PermutationVector.Set<FSurfaceLineRenderPS::FReducedResolutionDim>(bUseReducedResolution);
+	TShaderMapRef<FSurfaceLineRenderPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+	// 添加全屏pass
+	FPixelShaderUtils::AddFullscreenPass(
+		GraphBuilder,
+		GetGlobalShaderMap(GMaxRHIFeatureLevel),
+		RDG_EVENT_NAME("SurfaceLineRender_%d", SceneProxy.GetProxyId()),
+		PixelShader,
+		PassParameters,
+		ScissorRect,
+		TStaticBlendState<>::GetRHI(),
+		TStaticRasterizerState<>::GetRHI(),
+		TStaticDepthStencilState<>::GetRHI()
+		);
+
+	if (PolygonIdTexture)
+	{
+		SceneProxy.PolygonIdPicker->AddReadbackPasses(GraphBuilder, PolygonIdTexture, Parameters.ViewportRect);
 	}
 }
 
-void FSurfaceLineSceneProxy::InitializePooledBuffers(FRDGBuilder& GraphBuilder)
+bool FSurfaceLineRenderManager::AddTiledComputePass_RenderThread(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfaceLineSceneProxy& SceneProxy, const FIntRect& ScissorRect)
 {
-	if (bBuffersInitialized)
+	using namespace SurfaceLineRenderer;
+
+	// 场景颜色需要支持UAV及其类型化读取，否则退回像素着色器
+	const FRDGTextureDesc& ColorDesc = Parameters.ColorTexture->Desc;
+	if (!EnumHasAnyFlags(ColorDesc.Flags, TexCreate_UAV) || !RHIIsTypedUAVLoadSupported(ColorDesc.Format))
+	{
+		return false;
+	}
+
+	FSurfaceLineTiledCS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfaceLineTiledCS::FParameters>();
+	PassParameters->DepthTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.DepthTexture));
+	PassParameters->CustomDepthTexture = Parameters.SceneTexturesUniformParams
+		? Parameters.SceneTexturesUniformParams->GetContents()->CustomStencilTexture
+		: CreateBlackTextureSRV(GraphBuilder);
+	PassParameters->RWColorTexture = GraphBuilder.CreateUAV(Parameters.ColorTexture);
+
+	SetGeometryParameters(GraphBuilder, SceneProxy, PassParameters);
+	PassParameters->LineStyleData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.LineStylesPooledBuffer));
+	PassParameters->PolygonStyleData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.PolygonStylesPooledBuffer));
+
+	// 分块自行剔除BVH，溢出的分块逐像素从根节点遍历
+	const uint32 RootSeedNode = 0;
+	PassParameters->SeedNodeData = FSurfaceFrustumCulling::CreateSeedNodesSRV(GraphBuilder, TEXT("SurfaceLineSeedNodes"), MakeArrayView(&RootSeedNode, 1));
+	PassParameters->NumSeedNodes = 1;
+
+	// CustomTexture，未指定或无效时使用默认全局黑色纹理占位
+	PassParameters->CustomTexture = nullptr;
+	if (SceneProxy.bUseCustomTexture && SceneProxy.CustomTexture)
+	{
+		if (FTextureResource* CustomTextureResource = SceneProxy.CustomTexture->GetResource())
+		{
+			FRDGTextureRef CustomTextureRDG = GraphBuilder.RegisterExternalTexture(
+				CreateRenderTarget(CustomTextureResource->GetTextureRHI(), TEXT("CustomTexture")));
+			PassParameters->CustomTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(CustomTextureRDG));
+		}
+	}
+	if (!PassParameters->CustomTexture)
+	{
+		PassParameters->CustomTexture = CreateBlackTextureSRV(GraphBuilder);
+	}
+	PassParameters->CustomTextureSampler = TStaticSamplerState<SF_Bilinear, AM_Border, AM_Border, AM_Border>::GetRHI();
+
+	PassParameters->ScreenToWorld = FMatrix44f((Parameters.ViewMatrix * Parameters.ProjMatrix).Inverse());
+	PassParameters->InvViewMatrix = FMatrix44f(Parameters.ViewMatrix).Inverse();
+	PassParameters->ViewportRect = Parameters.ViewportRect;
+	PassParameters->ScissorRect = FSurfaceTileCulling::AlignScissorRect(Parameters.ViewportRect, ScissorRect);
+	PassParameters->TanHalfFOV = 1.0f / FMath::Max(static_cast<float>(Parameters.ProjMatrix.M[1][1]), UE_SMALL_NUMBER);
+
+	PassParameters->MaxLineWidth = SceneProxy.StyleTable->MaxLineWidth;
+	PassParameters->NumPolygonStyles = SceneProxy.StyleTable->PolygonStyleIndices.Num();
+	PassParameters->NumAtlasSlots = SceneProxy.NumAtlasSlots;
+	PassParameters->bUseCustomTexture = SceneProxy.bUseCustomTexture;
+	PassParameters->bUsePixelUnit = SceneProxy.bUsePixelUnit;
+
+	TShaderMapRef<FSurfaceLineTiledCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	FComputeShaderUtils::AddPass(
+		GraphBuilder,
+		RDG_EVENT_NAME("SurfaceLineRenderTiled_%d", SceneProxy.GetProxyId()),
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(PassParameters->ScissorRect.Size(), FSurfaceTileCulling::TileSize));
+
+	return true;
+}
+
+void FSurfaceLineRenderManager::AddMergedPass_RenderThread(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, TConstArrayView<FSurfaceLineSceneProxy*> SceneProxies, const FIntRect& ScissorRect)
+{
+	using namespace SurfaceLineRenderer;
+
+	UpdateMergedBuffers_RenderThread(GraphBuilder, SceneProxies);
+
+	// 每帧重建顶层BVH并填写代理参数，线宽单位等参数变化不需要重新拷贝合并样式缓冲区
+	TArray<FBox2f> ProxyBounds;
+	TArray<FGPULineProxyParams> ProxyParams;
+	ProxyBounds.Reserve(SceneProxies.Num());
+	ProxyParams.Reserve(SceneProxies.Num());
+	float MaxWorldLineWidth = 0.0f;
+	float MaxPixelLineWidth = 0.0f;
+	for (int32 ProxyIndex = 0; ProxyIndex < SceneProxies.Num(); ++ProxyIndex)
+	{
+		const FSurfaceLineSceneProxy& SceneProxy = *SceneProxies[ProxyIndex];
+		const FGPULineBVHNode& RootNode = SceneProxy.GPULineData->Nodes[SceneProxy.GPULineData->RootNodeIndex];
+		ProxyBounds.Add(FBox2f(FVector2f(RootNode.MinExtent.X, RootNode.MinExtent.Y), FVector2f(RootNode.MaxExtent.X, RootNode.MaxExtent.Y)));
+
+		// 几何数据的偏移取自共享缓冲区中的分配，整理后自动更新
+		FGPULineProxyParams& Params = ProxyParams.AddDefaulted_GetRef();
+		Params.NodeOffset = Arenas.Nodes.GetOffset(SceneProxy.Allocations.Nodes);
+		Params.ClusterOffset = Arenas.Clusters.GetOffset(SceneProxy.Allocations.Clusters);
+		Params.SegmentOffset = Arenas.Segments.GetOffset(SceneProxy.Allocations.Segments);
+		Params.StyleOffset = MergedProxySlots[ProxyIndex].StyleOffset;
+		Params.PolygonStyleOffset = MergedProxySlots[ProxyIndex].PolygonStyleOffset;
+		Params.NumPolygonStyles = SceneProxy.StyleTable->PolygonStyleIndices.Num();
+		Params.MaxLineWidth = SceneProxy.StyleTable->MaxLineWidth;
+		Params.bUsePixelUnit = SceneProxy.bUsePixelUnit;
+
+		float& MaxLineWidth = SceneProxy.bUsePixelUnit ? MaxPixelLineWidth : MaxWorldLineWidth;
+		MaxLineWidth = FMath::Max(MaxLineWidth, Params.MaxLineWidth);
+	}
+
+	TArray<FGPULineBVHNode> ProxyNodes;
+	FLineProxyTopLevelBVH::Build(ProxyBounds, ProxyNodes);
+
+	FRDGBuffer* ProxyNodesBuffer = GraphBuilder.CreateBuffer(
+		FRDGBufferDesc::CreateStructuredDesc(sizeof(FGPULineBVHNode), ProxyNodes.Num()), TEXT("SurfaceLineProxyBVHNodes"));
+	GraphBuilder.QueueBufferUpload(ProxyNodesBuffer, ProxyNodes.GetData(), ProxyNodes.Num() * sizeof(FGPULineBVHNode));
+
+	FRDGBuffer* ProxyParamsBuffer = GraphBuilder.CreateBuffer(
+		FRDGBufferDesc::CreateStructuredDesc(sizeof(FGPULineProxyParams), ProxyParams.Num()), TEXT("SurfaceLineProxyParams"));
+	GraphBuilder.QueueBufferUpload(ProxyParamsBuffer, ProxyParams.GetData(), ProxyParams.Num() * sizeof(FGPULineProxyParams));
+
+	// 设置着色器参数
+	FSurfaceLineRenderPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfaceLineRenderPS::FParameters>();
+	SetViewParameters(GraphBuilder, Parameters, PassParameters);
+
+	PassParameters->LineBVHNodeData = Arenas.Nodes.GetSRV(GraphBuilder);
+	PassParameters->SegmentClusterData = Arenas.Clusters.GetSRV(GraphBuilder);
+	PassParameters->SegmentData = Arenas.Segments.GetSRV(GraphBuilder);
+	PassParameters->LineStyleData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(MergedLineStylesPooledBuffer));
+	PassParameters->PolygonStyleData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(MergedPolygonStylesPooledBuffer));
+	PassParameters->ProxyBVHNodeData = GraphBuilder.CreateSRV(ProxyNodesBuffer);
+	PassParameters->ProxyParamsData = GraphBuilder.CreateSRV(ProxyParamsBuffer);
+	PassParameters->CustomTexture = CreateBlackTextureSRV(GraphBuilder);
+
+	// 顶层BVH已按像素剔除代理，每个代理从根节点开始遍历
+	const uint32 RootSeedNode = 0;
+	PassParameters->SeedNodeData = FSurfaceFrustumCulling::CreateSeedNodesSRV(GraphBuilder, TEXT("SurfaceLineSeedNodes"), MakeArrayView(&RootSeedNode, 1));
+	PassParameters->NumSeedNodes = 1;
+
+	PassParameters->NumAtlasSlots = 1;
+	PassParameters->bUseCustomTexture = 0;
+	PassParameters->MaxWorldLineWidth = MaxWorldLineWidth;
+	PassParameters->MaxPixelLineWidth = MaxPixelLineWidth;
+
+	FSurfaceLineRenderPS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FSurfaceLineRenderPS::FWritePolygonIdDim>(false);
+	PermutationVector.Set<FSurfaceLineRenderPS::FMergedProxiesDim>(true);
+	PermutationVector.Set<FSurfaceLineRenderPS::FCoverageCacheDim>(false);
+	PermutationVector.Set<FSurfaceLineRenderPS::FReducedResolutionDim>(false);
+	TShaderMapRef<FSurfaceLineRenderPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
+
+	FPixelShaderUtils::AddFullscreenPass(
+		GraphBuilder,
+		GetGlobalShaderMap(GMaxRHIFeatureLevel),
+		RDG_EVENT_NAME("SurfaceLineRender_Merged(%d)", SceneProxies.Num()),
+		PixelShader,
+		PassParameters,
+		ScissorRect,
+		TStaticBlendState<>::GetRHI(),
+		TStaticRasterizerState<>::GetRHI(),
+		TStaticDepthStencilState<>::GetRHI()
+		);
+}
+
+void FSurfaceLineRenderManager::UpdateMergedBuffers_RenderThread(FRDGBuilder& GraphBuilder, TConstArrayView<FSurfaceLineSceneProxy*> SceneProxies)
+{
+	using namespace SurfaceLineRenderer;
+
+	// 依次分配每个代理的样式偏移，几何数据已在共享缓冲区中，不需要拼接
+	TArray<FMergedProxySlot> NewSlots;
+	NewSlots.Reserve(SceneProxies.Num());
+	int32 StyleOffset = 0;
+	int32 PolygonStyleOffset = 0;
+	for (const FSurfaceLineSceneProxy* SceneProxy : SceneProxies)
+	{
+		NewSlots.Add({ SceneProxy->ProxyId, SceneProxy->StyleBufferGeneration, StyleOffset, PolygonStyleOffset });
+
+		StyleOffset += SceneProxy->StyleTable->Styles.Num();
+		PolygonStyleOffset += SceneProxy->StyleTable->PolygonStyleIndices.Num();
+	}
+
+	if (NewSlots == MergedProxySlots && MergedLineStylesPooledBuffer.IsValid())
 	{
 		return;
 	}
-	// 节点数据缓冲区
-	FRDGBufferDesc BVHNodesDesc = FRDGBufferDesc::CreateStructuredDesc(
-		sizeof(FGPULineBVHNode), GPULineData->Nodes.Num());
-	FRDGBuffer* BVHNodesBuffer = GraphBuilder.CreateBuffer(
-		BVHNodesDesc, TEXT("BVHNodesPooledBuffer"), 
-		ERDGBufferFlags::MultiFrame);
-	GraphBuilder.QueueBufferUpload(
-		BVHNodesBuffer, GPULineData->Nodes.GetData(),
-		GPULineData->Nodes.Num() * sizeof(FGPULineBVHNode));
-	BVHNodesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(BVHNodesBuffer);
-
-	// 创建簇数据缓冲区
-	FRDGBufferDesc ClustersDesc = FRDGBufferDesc::CreateStructuredDesc(
-		sizeof(FGPUSegmentCluster), GPULineData->Clusters.Num());
-	FRDGBuffer* ClustersBuffer = GraphBuilder.CreateBuffer(
-		ClustersDesc, TEXT("ClustersPooledBuffer"),
-		ERDGBufferFlags::MultiFrame);
+	MergedProxySlots = MoveTemp(NewSlots);
+
+	TArray<FMergeSource> LineStyleSources, PolygonStyleSources;
+	for (int32 ProxyIndex = 0; ProxyIndex < SceneProxies.Num(); ++ProxyIndex)
+	{
+		const FSurfaceLineSceneProxy& SceneProxy = *SceneProxies[ProxyIndex];
+		const FMergedProxySlot& Slot = MergedProxySlots[ProxyIndex];
+		LineStyleSources.Add({ &SceneProxy.LineStylesPooledBuffer, Slot.StyleOffset, SceneProxy.StyleTable->Styles.Num() });
+		PolygonStyleSources.Add({ &SceneProxy.PolygonStylesPooledBuffer, Slot.PolygonStyleOffset, SceneProxy.StyleTable->PolygonStyleIndices.Num() });
+	}
+
+	MergedLineStylesPooledBuffer = CreateMergedBuffer(GraphBuilder, TEXT("MergedLineStylesPooledBuffer"), sizeof(FGPULineStyle), StyleOffset, LineStyleSources);
+	MergedPolygonStylesPooledBuffer = CreateMergedBuffer(GraphBuilder, TEXT("MergedPolygonStylesPooledBuffer"), sizeof(uint32), PolygonStyleOffset, PolygonStyleSources);
+}
+
+void FSurfaceLineRenderManager::ReleaseMergedBuffers_RenderThread()
+{
+	check(IsInRenderingThread());
+
+	MergedProxySlots.Empty();
+	MergedLineStylesPooledBuffer.SafeRelease();
+	MergedPolygonStylesPooledBuffer.SafeRelease();
+}
+
+bool FSurfaceLineSceneProxy::CalculateScissorRect(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, FIntRect& OutScissorRect) const
+{
+	// 世界单位线宽外扩包围盒，像素单位线宽外扩投影后的矩形
+	const FGPULineBVHNode& RootNode = GPULineData->Nodes[GPULineData->RootNodeIndex];
+	const float HalfLineWidth = 0.5f * StyleTable->MaxLineWidth;
+	return FSurfaceScreenBounds::CalculateScissorRect(InViewProjMatrix, InViewportRect, RootNode.MinExtent, RootNode.MaxExtent,
+		bUsePixelUnit ? 0.0f : HalfLineWidth, bUsePixelUnit ? HalfLineWidth : 0.0f, OutScissorRect);
+}
+
+void FSurfaceLineSceneProxy::CalculateSeedNodes(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, TArray<uint32>& OutSeedNodes) const
+{
+	const float HalfLineWidth = 0.5f * StyleTable->MaxLineWidth;
+	FSurfaceFrustumCulling::CalculateLineSeedNodes(*GPULineData, InViewProjMatrix, InViewportRect,
+		bUsePixelUnit ? 0.0f : HalfLineWidth, bUsePixelUnit ? HalfLineWidth : 0.0f, OutSeedNodes);
+}
+
+void FSurfaceLineSceneProxy::InitializePooledBuffers(FRDGBuilder& GraphBuilder, FSurfaceLineArenas& Arenas)
+{
+	UploadDirtyRanges(GraphBuilder, Arenas);
+
+	if (!bUploadPending)
+	{
+		return;
+	}
+
+	// 新数据为空时直接替换，不再渲染
+	if (!PendingGPULineData.IsValid() || !PendingGPULineData->IsValid())
+	{
+		GPULineData = MoveTemp(PendingGPULineData);
+		Arenas.Free(Allocations);
+		Arenas.Free(PendingAllocations);
+		PendingUpload.Reset();
+		bUploadPending = false;
+		bBuffersInitialized = false;
+		return;
+	}
+
+	if (!PendingUpload.IsActive())
+	{
+		// 新数据写入新的分配，完成前旧的分配继续用于渲染；被中断的上一次上传的分配在这里回收
+		Arenas.Free(PendingAllocations);
+		Arenas.Allocate(*PendingGPULineData, PendingAllocations);
+
+		const FSurfaceBufferUploadSource Sources[] =
+		{
+			{ &Arenas.Nodes, PendingAllocations.Nodes, PendingGPULineData->Nodes.GetData(), PendingGPULineData->Nodes.Num() },
+			{ &Arenas.Clusters, PendingAllocations.Clusters, PendingGPULineData->Clusters.GetData(), PendingGPULineData->Clusters.Num() },
+			{ &Arenas.Segments, PendingAllocations.Segments, PendingGPULineData->Segments.GetData(), PendingGPULineData->Segments.Num() },
+		};
+		PendingUpload.Begin(Sources);
+	}
+
+	if (!PendingUpload.Advance(GraphBuilder))
+	{
+		return;
+	}
+
+	// 全部上传后一起替换，着色器不会读到新旧混合的数据
+	GPULineData = MoveTemp(PendingGPULineData);
+	Arenas.Free(Allocations);
+	Allocations = PendingAllocations;
+	PendingAllocations = FSurfaceLineAllocations();
+	PendingUpload.Reset();
+	bUploadPending = false;
+	bBuffersInitialized = true;
+	++BufferGeneration;
+}
+
+void FSurfaceLineSceneProxy::UploadDirtyRanges(FRDGBuilder& GraphBuilder, FSurfaceLineArenas& Arenas)
+{
+	if (PendingPatch.IsEmpty())
+	{
+		return;
+	}
+
+	// 修改总是基于之前传入的完整数据
+	if (!GPULineData.IsValid())
+	{
+		PendingPatch.Reset();
+		return;
+	}
+
+	// 间隔很小的范围合并为一次拷贝，多写入的元素与CPU数据相同
+	FGPULineDirtyRanges& PendingDirtyRanges = PendingPatch.DirtyRanges;
+	PendingDirtyRanges.Nodes.Normalize(SurfaceLineRenderer::DirtyRangeMaxGap);
+	PendingDirtyRanges.Clusters.Normalize(SurfaceLineRenderer::DirtyRangeMaxGap);
+	PendingDirtyRanges.Segments.Normalize(SurfaceLineRenderer::DirtyRangeMaxGap);
+
+	// 修改的范围在同一帧内全部写入现有分配，着色器不会读到只写入一部分的修改：
+	// 超过每帧的上传预算时改为分帧的完整上传，本帧剩余的预算不足时推迟到之后的帧
+	const uint64 DirtyBytes = static_cast<uint64>(PendingDirtyRanges.Nodes.GetNumElements()) * sizeof(FGPULineBVHNode)
+		+ static_cast<uint64>(PendingDirtyRanges.Clusters.GetNumElements()) * sizeof(FGPUSegmentCluster)
+		+ static_cast<uint64>(PendingDirtyRanges.Segments.GetNumElements()) * sizeof(FGPUSegment);
+	// 上传完成前当前数据和分配继续用于渲染，完整上传改为在副本上修补
+	if (!bBuffersInitialized || DirtyBytes > FSurfaceBufferUpload::GetBudgetBytes())
+	{
+		TSharedPtr<FGPULineData> PatchedGPULineData = MakeShared<FGPULineData>(*GPULineData);
+		ensure(PendingPatch.Apply(*PatchedGPULineData));
+		PendingGPULineData = MoveTemp(PatchedGPULineData);
+		PendingPatch.Reset();
+		PendingUpload.Reset();
+		bUploadPending = true;
+		return;
+	}
+
+	if (DirtyBytes > FSurfaceBufferUpload::GetFrameBudget(DirtyBytes))
+	{
+		return;
+	}
+
+	// 原地修补后与写入缓冲区在同一帧完成，CPU上的剔除数据与缓冲区保持一致
+	const int32 OldNumNodes = GPULineData->Nodes.Num();
+	const int32 OldNumClusters = GPULineData->Clusters.Num();
+	const int32 OldNumSegments = GPULineData->Segments.Num();
+	if (!ensure(PendingPatch.Apply(*GPULineData)))
+	{
+		PendingPatch.Reset();
+		return;
+	}
+
+	const FGPULineData& Data = *GPULineData;
+	Arenas.Nodes.UploadDirtyRanges(GraphBuilder, Allocations.Nodes,
+		Data.Nodes.GetData(), Data.Nodes.Num(), OldNumNodes, PendingDirtyRanges.Nodes);
+	Arenas.Clusters.UploadDirtyRanges(GraphBuilder, Allocations.Clusters,
+		Data.Clusters.GetData(), Data.Clusters.Num(), OldNumClusters, PendingDirtyRanges.Clusters);
+	Arenas.Segments.UploadDirtyRanges(GraphBuilder, Allocations.Segments,
+		Data.Segments.GetData(), Data.Segments.Num(), OldNumSegments, PendingDirtyRanges.Segments);
+
+	PendingPatch.Reset();
+	++BufferGeneration;
+}
+
+void FSurfaceLineSceneProxy::InitializeStyleBuffers(FRDGBuilder& GraphBuilder)
+{
+	if (bStyleBuffersInitialized)
+	{
+		return;
+	}
+
+	// 线样式表
+	FRDGBufferDesc LineStylesDesc = FRDGBufferDesc::CreateStructuredDesc(
+		sizeof(FGPULineStyle), StyleTable->Styles.Num());
+	FRDGBuffer* LineStylesBuffer = GraphBuilder.CreateBuffer(
+		LineStylesDesc, TEXT("LineStylesPooledBuffer"));
 	GraphBuilder.QueueBufferUpload(
-		ClustersBuffer, GPULineData->Clusters.GetData(),
-		GPULineData->Clusters.Num() * sizeof(FGPUSegmentCluster));
-	ClustersPooledBuffer = GraphBuilder.ConvertToExternalBuffer(ClustersBuffer);
-
-	// 创建线段数据缓冲区
-	FRDGBufferDesc SegmentsDesc = FRDGBufferDesc::CreateStructuredDesc(
-		sizeof(FGPUSegment), GPULineData->Segments.Num());
-	FRDGBuffer* SegmentsBuffer = GraphBuilder.CreateBuffer(
-		SegmentsDesc, TEXT("SegmentsPooledBuffer"));
+		LineStylesBuffer, StyleTable->Styles.GetData(),
+		StyleTable->Styles.Num() * sizeof(FGPULineStyle));
+	LineStylesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(LineStylesBuffer);
+
+	// 多边形样式索引
+	FRDGBufferDesc PolygonStylesDesc = FRDGBufferDesc::CreateStructuredDesc(
+		sizeof(uint32), StyleTable->PolygonStyleIndices.Num());
+	FRDGBuffer* PolygonStylesBuffer = GraphBuilder.CreateBuffer(
+		PolygonStylesDesc, TEXT("PolygonStylesPooledBuffer"));
 	GraphBuilder.QueueBufferUpload(
-		SegmentsBuffer, GPULineData->Segments.GetData(),
-		GPULineData->Segments.Num() * sizeof(FGPUSegment));
-	SegmentsPooledBuffer = GraphBuilder.ConvertToExternalBuffer(SegmentsBuffer);
+		PolygonStylesBuffer, StyleTable->PolygonStyleIndices.GetData(),
+		StyleTable->PolygonStyleIndices.Num() * sizeof(uint32));
+	PolygonStylesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(PolygonStylesBuffer);
 
-	bBuffersInitialized = true;
+	bStyleBuffersInitialized = true;
+	++StyleBufferGeneration;
 }
 
-void FSurfaceLineSceneProxy::ReleasePooledBuffers()
+void FSurfaceLineSceneProxy::ReleasePooledBuffers(FSurfaceLineArenas& Arenas)
 {
-	if (BVHNodesPooledBuffer)
+	Arenas.Free(Allocations);
+	Arenas.Free(PendingAllocations);
+	if (LineStylesPooledBuffer)
 	{
-		BVHNodesPooledBuffer.SafeRelease();
+		LineStylesPooledBuffer.SafeRelease();
 	}
-	if (ClustersPooledBuffer)
+	if (PolygonStylesPooledBuffer)
 	{
-		ClustersPooledBuffer.SafeRelease();
+		PolygonStylesPooledBuffer.SafeRelease();
 	}
-	if (SegmentsPooledBuffer)
+	if (PolygonIdPicker.IsValid())
 	{
-		SegmentsPooledBuffer.SafeRelease();
+		PolygonIdPicker->Release_RenderThread();
 	}
+	CoverageCache.Release_RenderThread();
+	PendingUpload.Reset();
+	PendingPatch.Reset();
 	bBuffersInitialized = false;
+	bStyleBuffersInitialized = false;
 }
\ No newline at end of file
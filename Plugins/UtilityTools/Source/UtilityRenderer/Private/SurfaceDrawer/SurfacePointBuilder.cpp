@@ -0,0 +1,189 @@
+﻿#include "SurfaceDrawer/SurfacePointBuilder.h"
+
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfacePointBuilder, Log, All);
+
+namespace SurfacePointBuilder
+{
+	static constexpr int32 PointsPerChunk = 16384;		///< 并行处理时每块的点数
+	static constexpr float TargetPointsPerCell = 4.0f;	///< 自动选择单元边长时每个单元的平均点数
+	static constexpr int32 MaxNumCells = 1 << 22;		///< 单元数量上限，超出时增大单元边长
+	static constexpr float MinAutoCellSize = 1.0f;		///< 自动选择的最小单元边长
+
+	/// \brief 按块并行执行，点数较少时单线程
+	template <typename FunctionType>
+	void ParallelForChunks(int32 InNum, const FunctionType& InFunction)
+	{
+		const int32 NumChunks = FMath::DivideAndRoundUp(InNum, PointsPerChunk);
+		ParallelFor(NumChunks, [&](int32 ChunkIndex)
+			{
+				const int32 Begin = ChunkIndex * PointsPerChunk;
+				const int32 End = FMath::Min(Begin + PointsPerChunk, InNum);
+				InFunction(ChunkIndex, Begin, End);
+			},
+			NumChunks < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+	}
+}
+
+bool FSurfacePointGridBuilder::Build(
+	TConstArrayView<FSurfacePoint> InPoints,
+	FGPUPointData& OutData,
+	bool bInRadiusInWorldUnits,
+	float InCellSize,
+	FPointGridStats* OutStats)
+{
+	using namespace SurfacePointBuilder;
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	OutData.Reset();
+	if (OutStats)
+	{
+		*OutStats = FPointGridStats();
+	}
+
+	const int32 NumPoints = InPoints.Num();
+	if (NumPoints == 0)
+	{
+		return false;
+	}
+
+	// 并行计算包围盒和最大半径
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumPoints, PointsPerChunk);
+	TArray<FBox2f> ChunkBounds;
+	ChunkBounds.Init(FBox2f(ForceInit), NumChunks);
+	TArray<float> ChunkMaxRadius;
+	ChunkMaxRadius.SetNumZeroed(NumChunks);
+	ParallelForChunks(NumPoints, [&](int32 ChunkIndex, int32 Begin, int32 End)
+		{
+			for (int32 Index = Begin; Index < End; ++Index)
+			{
+				ChunkBounds[ChunkIndex] += FVector2f(InPoints[Index].Location.X, InPoints[Index].Location.Y);
+				ChunkMaxRadius[ChunkIndex] = FMath::Max(ChunkMaxRadius[ChunkIndex], InPoints[Index].Radius);
+			}
+		});
+
+	FBox2f Bounds(ForceInit);
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ++ChunkIndex)
+	{
+		Bounds += ChunkBounds[ChunkIndex];
+		OutData.MaxRadius = FMath::Max(OutData.MaxRadius, ChunkMaxRadius[ChunkIndex]);
+	}
+
+	// 单元边长：按密度选择，世界单位半径时不小于最大半径（指定边长时同样限制），并限制单元总数
+	const FVector2f Extent = Bounds.GetSize();
+	float CellSize = InCellSize;
+	if (CellSize <= 0.0f)
+	{
+		const float Area = FMath::Max(Extent.X, MinAutoCellSize) * FMath::Max(Extent.Y, MinAutoCellSize);
+		CellSize = FMath::Max(FMath::Sqrt(Area * TargetPointsPerCell / NumPoints), MinAutoCellSize);
+	}
+	if (bInRadiusInWorldUnits && CellSize < OutData.MaxRadius)
+	{
+		// 着色器每个方向最多查找有限个相邻单元，单元小于最大半径时会漏掉大半径的点
+		UE_CLOG(InCellSize > 0.0f, LogSurfacePointBuilder, Log, TEXT("指定的单元边长 %.1f 小于最大半径 %.1f，使用最大半径"), InCellSize, OutData.MaxRadius);
+		CellSize = OutData.MaxRadius;
+	}
+	while ((int64(Extent.X / CellSize) + 1) * (int64(Extent.Y / CellSize) + 1) > MaxNumCells)
+	{
+		CellSize *= 2.0f;
+	}
+
+	OutData.GridOrigin = Bounds.Min;
+	OutData.CellSize = CellSize;
+	OutData.GridSize = FIntPoint(int32(Extent.X / CellSize) + 1, int32(Extent.Y / CellSize) + 1);
+	const int32 NumCells = OutData.GridSize.X * OutData.GridSize.Y;
+
+	// 并行计算单元索引并计数
+	TArray<int32> PointCells;
+	PointCells.SetNumUninitialized(NumPoints);
+	TArray<int32> CellCounts;
+	CellCounts.SetNumZeroed(NumCells);
+	ParallelForChunks(NumPoints, [&](int32 ChunkIndex, int32 Begin, int32 End)
+		{
+			for (int32 Index = Begin; Index < End; ++Index)
+			{
+				const FIntPoint Cell = OutData.GetCellCoord(FVector2f(InPoints[Index].Location.X, InPoints[Index].Location.Y));
+				const int32 CellX = FMath::Clamp(Cell.X, 0, OutData.GridSize.X - 1);
+				const int32 CellY = FMath::Clamp(Cell.Y, 0, OutData.GridSize.Y - 1);
+				PointCells[Index] = CellY * OutData.GridSize.X + CellX;
+				FPlatformAtomics::InterlockedIncrement(&CellCounts[PointCells[Index]]);
+			}
+		});
+
+	// 前缀和得到单元偏移
+	OutData.CellOffsets.SetNumUninitialized(NumCells + 1);
+	uint32 Offset = 0;
+	for (int32 CellIndex = 0; CellIndex < NumCells; ++CellIndex)
+	{
+		OutData.CellOffsets[CellIndex] = Offset;
+		Offset += CellCounts[CellIndex];
+	}
+	OutData.CellOffsets[NumCells] = Offset;
+
+	// 并行散射，单元内顺序由原子操作决定，之后按输入索引排序
+	TArray<int32> CellCursors;
+	CellCursors.SetNumUninitialized(NumCells);
+	FMemory::Memcpy(CellCursors.GetData(), OutData.CellOffsets.GetData(), NumCells * sizeof(int32));
+	OutData.SourceIndices.SetNumUninitialized(NumPoints);
+	ParallelForChunks(NumPoints, [&](int32 ChunkIndex, int32 Begin, int32 End)
+		{
+			for (int32 Index = Begin; Index < End; ++Index)
+			{
+				const int32 Slot = FPlatformAtomics::InterlockedIncrement(&CellCursors[PointCells[Index]]) - 1;
+				OutData.SourceIndices[Slot] = Index;
+			}
+		});
+
+	ParallelFor(NumCells, [&](int32 CellIndex)
+		{
+			const int32 Begin = OutData.CellOffsets[CellIndex];
+			const int32 Num = OutData.CellOffsets[CellIndex + 1] - Begin;
+			if (Num > 1)
+			{
+				Algo::Sort(MakeArrayView(OutData.SourceIndices.GetData() + Begin, Num));
+			}
+		},
+		NumCells < PointsPerChunk ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// 按排序结果填充GPU点数据
+	OutData.Points.SetNumUninitialized(NumPoints);
+	ParallelForChunks(NumPoints, [&](int32 ChunkIndex, int32 Begin, int32 End)
+		{
+			for (int32 Slot = Begin; Slot < End; ++Slot)
+			{
+				const FSurfacePoint& Point = InPoints[OutData.SourceIndices[Slot]];
+				FGPUSurfacePoint& GPUPoint = OutData.Points[Slot];
+				GPUPoint.Position = FVector2f(Point.Location.X, Point.Location.Y);
+				GPUPoint.Radius = Point.Radius;
+				GPUPoint.IconSlot = Point.IconSlot;
+				GPUPoint.Color = FVector4f(Point.Color.R, Point.Color.G, Point.Color.B, Point.Color.A);
+			}
+		});
+
+	const double BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	int32 NumOccupiedCells = 0;
+	int32 MaxPointsPerCell = 0;
+	for (int32 Count : CellCounts)
+	{
+		NumOccupiedCells += Count > 0 ? 1 : 0;
+		MaxPointsPerCell = FMath::Max(MaxPointsPerCell, Count);
+	}
+	if (OutStats)
+	{
+		OutStats->NumPoints = NumPoints;
+		OutStats->NumCells = NumCells;
+		OutStats->NumOccupiedCells = NumOccupiedCells;
+		OutStats->MaxPointsPerCell = MaxPointsPerCell;
+		OutStats->BuildTimeMs = BuildTimeMs;
+	}
+
+	UE_LOG(LogSurfacePointBuilder, Log, TEXT("点网格构建完成: 点数=%d, 网格=%d x %d, 单元边长=%.1f, 非空单元=%d, 单元最大点数=%d, 耗时: %.2f ms"),
+		NumPoints, OutData.GridSize.X, OutData.GridSize.Y, CellSize, NumOccupiedCells, MaxPointsPerCell, BuildTimeMs);
+
+	return true;
+}
@@ -0,0 +1,135 @@
+﻿#include "SurfaceDrawer/SurfacePointQuery.h"
+
+
+namespace SurfacePointQuery
+{
+	/// \brief 构造查询结果
+	FORCEINLINE FSurfacePointHit MakeHit(const FGPUPointData& InData, int32 InSlot, float InDistance)
+	{
+		FSurfacePointHit Hit;
+		Hit.PointIndex = InData.SourceIndices[InSlot];
+		Hit.Distance = InDistance;
+		Hit.Location = FVector(InData.Points[InSlot].Position.X, InData.Points[InSlot].Position.Y, 0.0);
+		return Hit;
+	}
+}
+
+int32 FSurfacePointQuery::QueryPointsInRadius(const FGPUPointData& InData, const FVector2f& InLocation, float InRadius, TArray<FSurfacePointHit>& OutHits, bool bInIncludePointRadius)
+{
+	OutHits.Reset();
+	if (!InData.IsValid() || InRadius < 0.0f)
+	{
+		return 0;
+	}
+
+	// 计入点半径时按最大点半径扩大搜索范围
+	const float SearchRadius = bInIncludePointRadius ? InRadius + InData.MaxRadius : InRadius;
+	const FIntPoint MinCell = InData.GetCellCoord(InLocation - FVector2f(SearchRadius));
+	const FIntPoint MaxCell = InData.GetCellCoord(InLocation + FVector2f(SearchRadius));
+	const int32 MinX = FMath::Max(MinCell.X, 0);
+	const int32 MinY = FMath::Max(MinCell.Y, 0);
+	const int32 MaxX = FMath::Min(MaxCell.X, InData.GridSize.X - 1);
+	const int32 MaxY = FMath::Min(MaxCell.Y, InData.GridSize.Y - 1);
+
+	for (int32 CellY = MinY; CellY <= MaxY; ++CellY)
+	{
+		for (int32 CellX = MinX; CellX <= MaxX; ++CellX)
+		{
+			const int32 CellIndex = CellY * InData.GridSize.X + CellX;
+			const int32 End = InData.CellOffsets[CellIndex + 1];
+			for (int32 Slot = InData.CellOffsets[CellIndex]; Slot < End; ++Slot)
+			{
+				const FGPUSurfacePoint& Point = InData.Points[Slot];
+				const float HitRadius = bInIncludePointRadius ? InRadius + Point.Radius : InRadius;
+				const float DistanceSquared = FVector2f::DistSquared(Point.Position, InLocation);
+				if (DistanceSquared <= HitRadius * HitRadius)
+				{
+					OutHits.Add(SurfacePointQuery::MakeHit(InData, Slot, FMath::Sqrt(DistanceSquared)));
+				}
+			}
+		}
+	}
+
+	OutHits.Sort([](const FSurfacePointHit& A, const FSurfacePointHit& B)
+		{
+			return A.Distance < B.Distance || (A.Distance == B.Distance && A.PointIndex < B.PointIndex);
+		});
+
+	return OutHits.Num();
+}
+
+bool FSurfacePointQuery::QueryNearestPoint(const FGPUPointData& InData, const FVector2f& InLocation, float InMaxDistance, FSurfacePointHit& OutHit)
+{
+	OutHit = FSurfacePointHit();
+	if (!InData.IsValid() || InMaxDistance < 0.0f)
+	{
+		return false;
+	}
+
+	// 以查询点所在单元为中心逐圈向外搜索，第Ring圈单元到查询点的距离不小于(Ring - 1) * CellSize
+	const FIntPoint CenterCell = InData.GetCellCoord(InLocation);
+	const int32 MaxRing = FMath::Max3(
+		FMath::Max(CenterCell.X, InData.GridSize.X - 1 - CenterCell.X),
+		FMath::Max(CenterCell.Y, InData.GridSize.Y - 1 - CenterCell.Y),
+		0);
+
+	float BestDistanceSquared = InMaxDistance * InMaxDistance;
+	int32 BestSlot = INDEX_NONE;
+
+	auto VisitCell = [&](int32 CellX, int32 CellY)
+	{
+		if (CellX < 0 || CellY < 0 || CellX >= InData.GridSize.X || CellY >= InData.GridSize.Y)
+		{
+			return;
+		}
+
+		const int32 CellIndex = CellY * InData.GridSize.X + CellX;
+		const int32 End = InData.CellOffsets[CellIndex + 1];
+		for (int32 Slot = InData.CellOffsets[CellIndex]; Slot < End; ++Slot)
+		{
+			const float DistanceSquared = FVector2f::DistSquared(InData.Points[Slot].Position, InLocation);
+			// 距离相同时取输入索引较小的点，结果与单元内顺序无关
+			const bool bCloser = DistanceSquared < BestDistanceSquared;
+			const bool bTie = DistanceSquared == BestDistanceSquared && (BestSlot == INDEX_NONE || InData.SourceIndices[Slot] < InData.SourceIndices[BestSlot]);
+			if (bCloser || bTie)
+			{
+				BestDistanceSquared = DistanceSquared;
+				BestSlot = Slot;
+			}
+		}
+	};
+
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		const float RingDistance = FMath::Max(Ring - 1, 0) * InData.CellSize;
+		if (RingDistance * RingDistance > BestDistanceSquared)
+		{
+			break;
+		}
+
+		if (Ring == 0)
+		{
+			VisitCell(CenterCell.X, CenterCell.Y);
+			continue;
+		}
+
+		for (int32 Offset = -Ring; Offset <= Ring; ++Offset)
+		{
+			VisitCell(CenterCell.X + Offset, CenterCell.Y - Ring);
+			VisitCell(CenterCell.X + Offset, CenterCell.Y + Ring);
+		}
+		for (int32 Offset = -Ring + 1; Offset <= Ring - 1; ++Offset)
+		{
+			VisitCell(CenterCell.X - Ring, CenterCell.Y + Offset);
+			VisitCell(CenterCell.X + Ring, CenterCell.Y + Offset);
+		}
+	}
+
+	if (BestSlot == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHit = SurfacePointQuery::MakeHit(InData, BestSlot, FMath::Sqrt(BestDistanceSquared));
+	return true;
+}
@@ -0,0 +1,325 @@
+﻿#include "SurfaceDrawer/SurfacePointRenderer.h"
+
+#include "GlobalShader.h"
+#include "ShaderParameterStruct.h"
+#include "ShaderParameterMacros.h"
+#include "RHICommandList.h"
+#include "RenderingThread.h"
+#include "Modules/ModuleManager.h"
+#include "RendererInterface.h"
+#include "SceneView.h"
+#include "SceneInterface.h"
+#include "RenderGraphResources.h"
+#include "RenderTargetPool.h"
+#include "PixelShaderUtils.h"
+#include "RenderGraphEvent.h"
+
+#include "../Private/SceneRendering.h"
+
+
+class FSurfacePointRenderPS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FSurfacePointRenderPS);
+	SHADER_USE_PARAMETER_STRUCT(FSurfacePointRenderPS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, DepthTexture)									// 深度纹理
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, ColorTexture)									// 颜色纹理
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUSurfacePoint>, PointData)				// 按单元排序的点数据
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, CellOffsetData)						// 单元偏移
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, IconTexture)									// 图标纹理
+		SHADER_PARAMETER_SAMPLER(SamplerState, IconTextureSampler)									// 图标纹理采样器
+		SHADER_PARAMETER(FMatrix44f, ScreenToWorld)													// 屏幕到世界坐标变换矩阵
+		SHADER_PARAMETER(FMatrix44f, InvViewMatrix)													// 视图矩阵的逆矩阵
+		SHADER_PARAMETER(FVector2f, PixelWorldSizeScale)											// 像素世界大小随视图深度的缩放
+		SHADER_PARAMETER(FIntRect, ViewportRect)													// 视口矩形
+		SHADER_PARAMETER(FVector2f, GridOrigin)														// 网格原点
+		SHADER_PARAMETER(FIntPoint, GridSize)														// 网格单元数量
+		SHADER_PARAMETER(float, CellSize)															// 单元边长
+		SHADER_PARAMETER(float, MaxRadius)															// 最大点半径
+		SHADER_PARAMETER(float, Opacity)															// 不透明度
+		SHADER_PARAMETER(uint32, NumIconSlots)														// 图标图集槽位数量
+		SHADER_PARAMETER(uint32, bUseIconTexture)													// 是否有图标纹理
+		SHADER_PARAMETER(uint32, bUsePixelUnit)														// 是否使用像素单位
+		RENDER_TARGET_BINDING_SLOTS()																// 渲染目标绑定槽
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FSurfacePointRenderPS, "/UtilityTools/SurfacePointRenderShader.usf", "MainPixelShader", SF_Pixel);
+
+// 着色器管理器实例初始化
+FSurfacePointRenderManager* FSurfacePointRenderManager::Instance = nullptr;
+
+FSurfacePointRenderManager::~FSurfacePointRenderManager()
+{
+	// 确保渲染结束
+	EndRendering();
+
+	// 代理列表和池化缓冲区归渲染线程所有，排在已提交的注册/注销命令之后释放，并等待释放完成
+	ENQUEUE_RENDER_COMMAND(ReleaseSurfacePointRenderManager)(
+		[this](FRHICommandList& RHICmdList)
+		{
+			for (const TSharedPtr<FSurfacePointSceneProxy>& SceneProxy : SceneProxies)
+			{
+				SceneProxy->ReleasePooledBuffers();
+			}
+			SceneProxies.Empty();
+		});
+	FlushRenderingCommands();
+}
+
+void FSurfacePointRenderManager::RegisterSceneProxy(const TSharedPtr<FSurfacePointSceneProxy>& InSceneProxy)
+{
+	if (InSceneProxy.IsValid())
+	{
+		// 分配唯一ID
+		uint32 NewProxyId = NextProxyId++;
+		InSceneProxy->ProxyId = NewProxyId;
+
+		// 检查是否是第一个代理
+		bool bWasEmpty = RegisteredProxyIds.IsEmpty();
+		RegisteredProxyIds.Add(NewProxyId);
+
+		// 代理列表归渲染线程所有，渲染命令按提交顺序执行
+		ENQUEUE_RENDER_COMMAND(AddSurfacePointSceneProxy)(
+			[this, InSceneProxy](FRHICommandList& RHICmdList)
+			{
+				AddSceneProxy_RenderThread(InSceneProxy);
+			});
+
+		// 如果是第一个代理，开始渲染
+		if (bWasEmpty)
+		{
+			BeginRendering();
+		}
+	}
+}
+
+void FSurfacePointRenderManager::UnregisterSceneProxy(uint32 ProxyId)
+{
+	if (RegisteredProxyIds.Remove(ProxyId) == 0)
+	{
+		return;
+	}
+
+	// 在渲染线程移除代理并释放资源
+	ENQUEUE_RENDER_COMMAND(RemoveSurfacePointSceneProxy)(
+		[this, ProxyId](FRHICommandList& RHICmdList)
+		{
+			RemoveSceneProxy_RenderThread(ProxyId);
+		});
+
+	// 如果没有代理，停止渲染
+	if (RegisteredProxyIds.IsEmpty())
+	{
+		EndRendering();
+	}
+}
+
+int32 FSurfacePointRenderManager::GetNumSceneProxies()
+{
+	return RegisteredProxyIds.Num();
+}
+
+void FSurfacePointRenderManager::AddSceneProxy_RenderThread(const TSharedPtr<FSurfacePointSceneProxy>& InSceneProxy)
+{
+	check(IsInRenderingThread());
+
+	// ProxyId递增，追加即保持注册顺序
+	SceneProxies.Add(InSceneProxy);
+}
+
+void FSurfacePointRenderManager::RemoveSceneProxy_RenderThread(uint32 ProxyId)
+{
+	check(IsInRenderingThread());
+
+	const int32 ProxyIndex = SceneProxies.IndexOfByPredicate([ProxyId](const TSharedPtr<FSurfacePointSceneProxy>& SceneProxy)
+		{
+			return SceneProxy->GetProxyId() == ProxyId;
+		});
+	if (ProxyIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	SceneProxies[ProxyIndex]->ReleasePooledBuffers();
+	SceneProxies.RemoveAt(ProxyIndex);
+}
+
+void FSurfacePointRenderManager::BeginRendering()
+{
+	if (OnPostOpaqueRenderHandle.IsValid())
+	{
+		return;
+	}
+
+	const FName RendererModuleName("Renderer");
+	IRendererModule* RendererModule = FModuleManager::GetModulePtr<IRendererModule>(RendererModuleName);
+	if (RendererModule)
+	{
+		OnPostOpaqueRenderHandle = RendererModule->RegisterPostOpaqueRenderDelegate(
+			FPostOpaqueRenderDelegate::CreateRaw(this, &FSurfacePointRenderManager::Execute_RenderThread)
+		);
+	}
+}
+
+void FSurfacePointRenderManager::EndRendering()
+{
+	if (!OnPostOpaqueRenderHandle.IsValid())
+	{
+		return;
+	}
+
+	const FName RendererModuleName("Renderer");
+	IRendererModule* RendererModule = FModuleManager::GetModulePtr<IRendererModule>(RendererModuleName);
+	if (RendererModule)
+	{
+		RendererModule->RemovePostOpaqueRenderDelegate(OnPostOpaqueRenderHandle);
+	}
+
+	OnPostOpaqueRenderHandle.Reset();
+}
+
+void FSurfacePointRenderManager::Execute_RenderThread(FPostOpaqueRenderParameters& Parameters)
+{
+	check(IsInRenderingThread());
+
+	// 仅在Game和PIE中渲染
+	const FSceneView* SceneView = static_cast<const FSceneView*>(Parameters.View);
+	const FSceneInterface* Scene = SceneView->Family->Scene;
+	if (UWorld* World = Scene->GetWorld())
+	{
+		if (!(World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE))
+		{
+			return;
+		}
+	}
+
+	// 代理列表仅渲染线程访问，直接遍历
+	if (SceneProxies.IsEmpty())
+	{
+		return;
+	}
+
+	FRDGBuilder& GraphBuilder = *Parameters.GraphBuilder;
+
+	for (const TSharedPtr<FSurfacePointSceneProxy>& LocalSceneProxy : SceneProxies)
+	{
+		if (!LocalSceneProxy.IsValid() || !LocalSceneProxy->GPUPointData.IsValid() || !LocalSceneProxy->GPUPointData->IsValid())
+		{
+			continue;
+		}
+
+		// 初始化池化缓冲区
+		LocalSceneProxy->InitializePooledBuffers(GraphBuilder);
+
+		const FGPUPointData& PointData = *LocalSceneProxy->GPUPointData;
+		FSurfacePointRenderPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfacePointRenderPS::FParameters>();
+
+		PassParameters->DepthTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.DepthTexture));
+		PassParameters->ColorTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.ColorTexture));
+
+		FRDGBuffer* PointsRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->PointsPooledBuffer);
+		PassParameters->PointData = GraphBuilder.CreateSRV(PointsRDGBuffer);
+
+		FRDGBuffer* CellOffsetsRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->CellOffsetsPooledBuffer);
+		PassParameters->CellOffsetData = GraphBuilder.CreateSRV(CellOffsetsRDGBuffer);
+
+		// 图标纹理，未设置时使用全局黑色纹理占位
+		FTextureResource* IconTextureResource = LocalSceneProxy->IconTexture ? LocalSceneProxy->IconTexture->GetResource() : nullptr;
+		FRHITexture* IconTextureRHI = IconTextureResource ? IconTextureResource->GetTextureRHI() : nullptr;
+		FRDGTextureRef IconTextureRDG = GraphBuilder.RegisterExternalTexture(
+			IconTextureRHI ? CreateRenderTarget(IconTextureRHI, TEXT("SurfacePointIconTexture")) : CreateRenderTarget(GBlackTextureWithSRV->GetTextureRHI(), TEXT("GlobalBlackTexture")));
+		PassParameters->IconTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(IconTextureRDG));
+		PassParameters->IconTextureSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp, AM_Clamp>::GetRHI();
+
+		// 视图参数
+		FMatrix InvViewProjMatrix = (Parameters.ViewMatrix * Parameters.ProjMatrix).Inverse();
+		PassParameters->ScreenToWorld = FMatrix44f(InvViewProjMatrix);
+		PassParameters->InvViewMatrix = FMatrix44f(Parameters.ViewMatrix).Inverse();
+		PassParameters->ViewportRect = Parameters.ViewportRect;
+
+		// 像素在视图深度处的世界大小：透视投影与深度成正比，正交投影为常数
+		const float PixelSizeAtUnitDepth = 2.0f / FMath::Max(Parameters.ProjMatrix.M[1][1] * Parameters.ViewportRect.Height(), UE_SMALL_NUMBER);
+		const bool bPerspective = Parameters.ProjMatrix.M[3][3] < 1.0f;
+		PassParameters->PixelWorldSizeScale = bPerspective ? FVector2f(PixelSizeAtUnitDepth, 0.0f) : FVector2f(0.0f, PixelSizeAtUnitDepth);
+
+		// 网格参数，着色器只查找最大半径覆盖的单元
+		PassParameters->GridOrigin = PointData.GridOrigin;
+		PassParameters->GridSize = PointData.GridSize;
+		PassParameters->CellSize = PointData.CellSize;
+		PassParameters->MaxRadius = PointData.MaxRadius;
+		PassParameters->Opacity = LocalSceneProxy->Opacity;
+		PassParameters->NumIconSlots = LocalSceneProxy->NumIconSlots;
+		PassParameters->bUseIconTexture = IconTextureRHI != nullptr;
+		PassParameters->bUsePixelUnit = LocalSceneProxy->bUsePixelUnit;
+
+		PassParameters->RenderTargets[0] = FRenderTargetBinding(
+			Parameters.ColorTexture,
+			Parameters.ColorTexture->HasBeenProduced() ? ERenderTargetLoadAction::ELoad : ERenderTargetLoadAction::ENoAction);
+
+		TShaderMapRef<FSurfacePointRenderPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+
+		FPixelShaderUtils::AddFullscreenPass(
+			GraphBuilder,
+			GetGlobalShaderMap(GMaxRHIFeatureLevel),
+			RDG_EVENT_NAME("SurfacePointRender_%d", LocalSceneProxy->GetProxyId()),
+			PixelShader,
+			PassParameters,
+			FIntRect(),
+			TStaticBlendState<>::GetRHI(),
+			TStaticRasterizerState<>::GetRHI(),
+			TStaticDepthStencilState<>::GetRHI()
+			);
+	}
+}
+
+void FSurfacePointSceneProxy::InitializePooledBuffers(FRDGBuilder& GraphBuilder)
+{
+	if (bBuffersInitialized)
+	{
+		return;
+	}
+
+	// 点数据缓冲区
+	FRDGBufferDesc PointsDesc = FRDGBufferDesc::CreateStructuredDesc(
+		sizeof(FGPUSurfacePoint), GPUPointData->Points.Num());
+	FRDGBuffer* PointsBuffer = GraphBuilder.CreateBuffer(
+		PointsDesc, TEXT("SurfacePointsPooledBuffer"));
+	GraphBuilder.QueueBufferUpload(
+		PointsBuffer, GPUPointData->Points.GetData(),
+		GPUPointData->Points.Num() * sizeof(FGPUSurfacePoint));
+	PointsPooledBuffer = GraphBuilder.ConvertToExternalBuffer(PointsBuffer);
+
+	// 单元偏移缓冲区
+	FRDGBufferDesc CellOffsetsDesc = FRDGBufferDesc::CreateStructuredDesc(
+		sizeof(uint32), GPUPointData->CellOffsets.Num());
+	FRDGBuffer* CellOffsetsBuffer = GraphBuilder.CreateBuffer(
+		CellOffsetsDesc, TEXT("SurfacePointCellOffsetsPooledBuffer"));
+	GraphBuilder.QueueBufferUpload(
+		CellOffsetsBuffer, GPUPointData->CellOffsets.GetData(),
+		GPUPointData->CellOffsets.Num() * sizeof(uint32));
+	CellOffsetsPooledBuffer = GraphBuilder.ConvertToExternalBuffer(CellOffsetsBuffer);
+
+	bBuffersInitialized = true;
+}
+
+void FSurfacePointSceneProxy::ReleasePooledBuffers()
+{
+	if (PointsPooledBuffer)
+	{
+		PointsPooledBuffer.SafeRelease();
+	}
+	if (CellOffsetsPooledBuffer)
+	{
+		CellOffsetsPooledBuffer.SafeRelease();
+	}
+	bBuffersInitialized = false;
+}
@@ -1,5 +1,11 @@
 ﻿#include "SurfaceDrawer/SurfacePolygonBuilder.h"
 
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+
+#include <algorithm>
+
 
 DEFINE_LOG_CATEGORY_STATIC(LogSurfacePolygonBuilder, Log, All);
 
@@ -21,11 +27,89 @@ private:
 
 #define BUILD_TIME_LOG_SCOPE(Name) FTimeLogScope TimeLogScope_##Name(TEXT(#Name))
 
-FPolygonBVHBuilder::FPolygonBVHBuilder(const TArray<FTriangle>& InTriangles, const FBVHBuildConfig& InBuildConfig) : Root(nullptr)
-	, AllTriangles(InTriangles)
+bool FPolygonMeshData::IsValid() const
+{
+	return Indices.Num() > 0 && Indices.Num() % 3 == 0 && PolygonIds.Num() == NumTriangles();
+}
+
+void FPolygonMeshData::AppendTriangles(const TArray<FTriangle>& InTriangles)
+{
+	const int32 BaseVertex = Vertices.Num();
+	Vertices.Reserve(BaseVertex + InTriangles.Num() * 3);
+	Indices.Reserve(Indices.Num() + InTriangles.Num() * 3);
+	PolygonIds.Reserve(PolygonIds.Num() + InTriangles.Num());
+
+	for (int32 i = 0; i < InTriangles.Num(); ++i)
+	{
+		const FTriangle& Triangle = InTriangles[i];
+		Vertices.Add(FVector3f(Triangle.Vertex1));
+		Vertices.Add(FVector3f(Triangle.Vertex2));
+		Vertices.Add(FVector3f(Triangle.Vertex3));
+
+		const uint32 FirstIndex = BaseVertex + i * 3;
+		Indices.Add(FirstIndex);
+		Indices.Add(FirstIndex + 1);
+		Indices.Add(FirstIndex + 2);
+
+		PolygonIds.Add(Triangle.PolygonIndex);
+	}
+}
+
+void FPolygonMeshData::AppendMesh(const FPolygonMeshData& InMeshData)
+{
+	const uint32 BaseVertex = Vertices.Num();
+	Vertices.Append(InMeshData.Vertices);
+	PolygonIds.Append(InMeshData.PolygonIds);
+
+	Indices.Reserve(Indices.Num() + InMeshData.Indices.Num());
+	for (const uint32 Index : InMeshData.Indices)
+	{
+		Indices.Add(BaseVertex + Index);
+	}
+}
+
+FPolygonBVHBuilder::FPolygonBVHBuilder(const TSharedRef<const FPolygonMeshData>& InMeshData, const FBVHBuildConfig& InBuildConfig)
+	: FPolygonBVHBuilder(InMeshData->Vertices, InMeshData->Indices, InMeshData->PolygonIds, InBuildConfig)
+{
+	MeshData = InMeshData;
+}
+
+FPolygonBVHBuilder::FPolygonBVHBuilder(
+	TConstArrayView<FVector3f> InVertices,
+	TConstArrayView<uint32> InIndices,
+	TConstArrayView<int32> InPolygonIds,
+	const FBVHBuildConfig& InBuildConfig)
+	: Root(nullptr)
+	, Vertices(InVertices)
+	, Indices(InIndices)
+	, PolygonIds(InPolygonIds)
 	, BuildConfig(InBuildConfig)
 	, BuildTimeMs(0.0)
 {
+	bool bIsValid = Indices.Num() % 3 == 0 && PolygonIds.Num() == Indices.Num() / 3;
+	for (int32 i = 0; bIsValid && i < Indices.Num(); ++i)
+	{
+		bIsValid = Indices[i] < static_cast<uint32>(Vertices.Num());
+	}
+
+	if (!bIsValid)
+	{
+		UE_LOG(LogSurfacePolygonBuilder, Warning, TEXT("索引网格无效: 顶点数=%d, 索引数=%d, 多边形ID数=%d"), Vertices.Num(), Indices.Num(), PolygonIds.Num());
+		Indices = TConstArrayView<uint32>();
+		PolygonIds = TConstArrayView<int32>();
+	}
+}
+
+FPolygonBVHBuilder::FPolygonBVHBuilder(const TArray<FTriangle>& InTriangles, const FBVHBuildConfig& InBuildConfig)
+	: FPolygonBVHBuilder(MakeTriangleMeshData(InTriangles), InBuildConfig)
+{
+}
+
+TSharedRef<const FPolygonMeshData> FPolygonBVHBuilder::MakeTriangleMeshData(const TArray<FTriangle>& InTriangles)
+{
+	TSharedRef<FPolygonMeshData> NewMeshData = MakeShared<FPolygonMeshData>();
+	NewMeshData->AppendTriangles(InTriangles);
+	return NewMeshData;
 }
 
 FPolygonBVHBuilder::~FPolygonBVHBuilder()
@@ -41,7 +125,8 @@ void FPolygonBVHBuilder::Build()
 {
 	BUILD_TIME_LOG_SCOPE(PolygonBVHBuild);
 
-	if (AllTriangles.Num() == 0)
+	const int32 NumTriangles = GetNumTriangles();
+	if (NumTriangles == 0)
 	{
 		UE_LOG(LogSurfacePolygonBuilder, Warning, TEXT("没有三角形可构建BVH"));
 		return;
@@ -49,19 +134,49 @@ void FPolygonBVHBuilder::Build()
 
 	double StartTime = FPlatformTime::Seconds();
 
-	// 仅支持Middle构建
-	if (BuildConfig.Strategy == EBVHBuildStrategy::Middle)
+	// 预先计算每个三角形的包围盒和中心，构建过程只对三角形索引进行原地划分
+	TriangleOrder.SetNumUninitialized(NumTriangles);
+	TriangleBounds.SetNumUninitialized(NumTriangles);
+	TriangleCenters.SetNumUninitialized(NumTriangles);
+	ParallelFor(NumTriangles, [this](int32 TriangleIndex)
+		{
+			FVector3f V1, V2, V3;
+			GetTriangleVertices(TriangleIndex, V1, V2, V3);
+
+			FBox3f Box(ForceInit);
+			Box += V1;
+			Box += V2;
+			Box += V3;
+
+			TriangleOrder[TriangleIndex] = TriangleIndex;
+			TriangleBounds[TriangleIndex] = Box;
+			TriangleCenters[TriangleIndex] = Box.GetCenter();
+		});
+
+	if (BuildConfig.Strategy == EBVHBuildStrategy::SAH)
 	{
-		Root = BuildRecursive_Middle(AllTriangles, 0);
+		Root = BuildRecursive_SAH(0, NumTriangles, 0);
 	}
 	else
 	{
-		Root = BuildRecursive_Middle(AllTriangles, 0);
+		Root = BuildRecursive_Middle(0, NumTriangles, 0);
 	}
 
+	// 构建完成后只需保留叶子中的三角形索引
+	TriangleBounds.Empty();
+	TriangleCenters.Empty();
+
 	BuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
 }
 
+void FPolygonBVHBuilder::GetTriangleVertices(int32 TriangleIndex, FVector3f& OutV1, FVector3f& OutV2, FVector3f& OutV3) const
+{
+	const int32 FirstIndex = TriangleIndex * 3;
+	OutV1 = Vertices[Indices[FirstIndex]];
+	OutV2 = Vertices[Indices[FirstIndex + 1]];
+	OutV3 = Vertices[Indices[FirstIndex + 2]];
+}
+
 void FPolygonBVHBuilder::GetStats(FBVHStats& OutStats) const
 {
 	OutStats.NumNodes = 0;
@@ -98,7 +213,7 @@ void FPolygonBVHBuilder::GetStats(FBVHStats& OutStats) const
 			if (Node->bIsLeaf)
 			{
 				OutStats.NumLeaves++;
-				TotalBytes += sizeof(FGPUTriangle);
+				TotalBytes += sizeof(FGPUTrianglePacket);
 			}
 			else
 			{
@@ -111,39 +226,26 @@ void FPolygonBVHBuilder::GetStats(FBVHStats& OutStats) const
  	OutStats.MemoryUsageMB = TotalBytes / (1024.0f * 1024.0f);
 }
 
-FPolygonBVHNode* FPolygonBVHBuilder::BuildRecursive_Middle(const TArray<FTriangle>& InTriangles, int32 Depth)
+FBox FPolygonBVHBuilder::ComputeRangeBounds(int32 Begin, int32 End) const
 {
-	// 添加深度限制防止栈溢出
-	if (Depth > 64)
+	FBox3f UnionBox(ForceInit);
+	for (int32 i = Begin; i < End; ++i)
 	{
-		UE_LOG(LogSurfacePolygonBuilder, Warning, TEXT("达到最大构建深度 64，创建叶子节点"));
-		return new FPolygonBVHNode();
+		UnionBox += TriangleBounds[TriangleOrder[i]];
 	}
+	return FBox(UnionBox);
+}
 
-	FPolygonBVHNode* Node = new FPolygonBVHNode();
-
+FPolygonBVHNode* FPolygonBVHBuilder::BuildRecursive_Middle(int32 Begin, int32 End, int32 Depth)
+{
 	// 计算联合包围盒
-	FBox UnionBox(ForceInit);
-	for (const FTriangle& Triangle : InTriangles)
-	{
-		UnionBox += Triangle.GetBoundingBox();
-	}
-	Node->BoundingBox = UnionBox;
+	const FBox UnionBox = ComputeRangeBounds(Begin, End);
+	const int32 Count = End - Begin;
 
-	// 检查是否达到叶子节点条件（一个叶子节点只保存一个三角形）
-	if (InTriangles.Num() == 1)
-	{
-		Node->bIsLeaf = true;
-		Node->Triangle = InTriangles[0];
-		
-		return Node;
-	}
-	else if (InTriangles.IsEmpty())
+	// 检查是否达到叶子节点条件（一个叶子节点保存一个三角形包）
+	if (Count <= TRIANGLE_PACKET_SIZE)
 	{
-		Node->bIsLeaf = true;
-		Node->Triangle = FTriangle();
-
-		return Node;
+		return CreateLeaf(Begin, End, UnionBox);
 	}
 
 	// 选择最长的轴作为分割轴
@@ -152,52 +254,187 @@ FPolygonBVHNode* FPolygonBVHBuilder::BuildRecursive_Middle(const TArray<FTriangl
 	if (BoxSize.Y > BoxSize.X) SplitAxis = 1;
 	if (BoxSize.Z > BoxSize[SplitAxis]) SplitAxis = 2;
 
-	// 计算所有多边形中心点在分割轴上的中位数
-	TArray<float> Centers;
-	for (const FTriangle& Triangle : InTriangles)
+	// 只需把中位数放到位并按它划分两侧，不需要完整排序
+	// 每层数量减半，深度最多再增加log2(Count)，不需要深度限制
+	const int32 Mid = Begin + Count / 2;
+	int32* RangeData = TriangleOrder.GetData();
+	std::nth_element(RangeData + Begin, RangeData + Mid, RangeData + End, [this, SplitAxis](int32 A, int32 B)
+		{
+			return TriangleCenters[A][SplitAxis] < TriangleCenters[B][SplitAxis];
+		});
+
+	// 递归构建子树
+	FPolygonBVHNode* Node = new FPolygonBVHNode();
+	Node->BoundingBox = UnionBox;
+	Node->bIsLeaf = false;
+	Node->LeftChild = BuildRecursive_Middle(Begin, Mid, Depth + 1);
+	Node->RightChild = BuildRecursive_Middle(Mid, End, Depth + 1);
+	Node->NumSubtreeNodes = 1 + Node->LeftChild->NumSubtreeNodes + Node->RightChild->NumSubtreeNodes;
+	Node->NumSubtreeLeaves = Node->LeftChild->NumSubtreeLeaves + Node->RightChild->NumSubtreeLeaves;
+
+	return Node;
+}
+
+FPolygonBVHNode* FPolygonBVHBuilder::BuildRecursive_SAH(int32 Begin, int32 End, int32 Depth)
+{
+	if (Depth > 64)
 	{
-		Centers.Add(Triangle.GetBoundingBox().GetCenter()[SplitAxis]);
+		UE_LOG(LogSurfacePolygonBuilder, Warning, TEXT("达到最大构建深度 64，改用中位数分割"));
+		return BuildRecursive_Middle(Begin, End, Depth);
 	}
 
-	// 排序并找到中位数
-	Centers.Sort();
-	float Median = Centers[Centers.Num() / 2];
+	const int32 Count = End - Begin;
 
-	// 根据中位数分割多边形
-	TArray<FTriangle> LeftTriangles, RightTriangles;
+	// 计算联合包围盒与中心点包围盒
+	FBox3f UnionBox3f(ForceInit);
+	FBox3f CenterBox(ForceInit);
+	for (int32 i = Begin; i < End; ++i)
+	{
+		const int32 TriangleIndex = TriangleOrder[i];
+		UnionBox3f += TriangleBounds[TriangleIndex];
+		CenterBox += TriangleCenters[TriangleIndex];
+	}
+	const FBox UnionBox(UnionBox3f);
 
-	for (const FTriangle& Triangle : InTriangles)
+	// 一个包放得下时直接作为叶子：叶子代价为一次包测试，任何分割的代价都是一次遍历加上子节点的包测试，不会更低
+	if (Count <= TRIANGLE_PACKET_SIZE)
 	{
-		float Center = Triangle.GetBoundingBox().GetCenter()[SplitAxis];
+		return CreateLeaf(Begin, End, UnionBox);
+	}
+
+	// 查询只在XY平面上进行，点落入包围盒的概率与其XY面积成正比
+	auto GetAreaXY = [](const FBox3f& Box) -> double
+		{
+			const FVector3f Size = Box.GetSize();
+			return FMath::Max(static_cast<double>(Size.X) * Size.Y, UE_DOUBLE_SMALL_NUMBER);
+		};
 
-		if (Center < Median)
+	// SAH参数：一次节点遍历与一次三角形包测试（4个三角形SIMD并行）的代价
+	const double TraversalCost = 1.0;
+	const double PacketCost = 1.0;
+	auto GetNumPackets = [](int32 InCount) -> int32
 		{
-			LeftTriangles.Add(Triangle);
+			return FMath::DivideAndRoundUp(InCount, TRIANGLE_PACKET_SIZE);
+		};
+
+	const int32 NumBins = 16;
+	double BestCost = UE_DOUBLE_BIG_NUMBER;
+	int32 BestAxis = -1;
+	float BestSplit = 0.0f;
+
+	const FVector3f CenterSize = CenterBox.GetSize();
+	const double UnionArea = GetAreaXY(UnionBox3f);
+
+	// 只在XY两个轴上寻找分割
+	for (int32 Axis = 0; Axis < 2; ++Axis)
+	{
+		if (CenterSize[Axis] < KINDA_SMALL_NUMBER)
+		{
+			continue;
 		}
-		else
+
+		struct FBin
+		{
+			FBox3f Bounds;
+			int32 Count;
+			FBin() : Bounds(ForceInit), Count(0) {}
+		};
+		FBin Bins[NumBins];
+
+		const float BinWidth = CenterSize[Axis] / NumBins;
+		const float AxisStart = CenterBox.Min[Axis];
+
+		for (int32 i = Begin; i < End; ++i)
 		{
-			RightTriangles.Add(Triangle);
+			const int32 TriangleIndex = TriangleOrder[i];
+			const int32 BinIndex = FMath::Clamp(FMath::FloorToInt((TriangleCenters[TriangleIndex][Axis] - AxisStart) / BinWidth), 0, NumBins - 1);
+			Bins[BinIndex].Bounds += TriangleBounds[TriangleIndex];
+			Bins[BinIndex].Count++;
+		}
+
+		// 后缀（从右到左）
+		FBox3f SuffixBounds[NumBins];
+		int32 SuffixCounts[NumBins];
+		FBox3f CurrentSuffixBounds(ForceInit);
+		int32 CurrentSuffixCount = 0;
+		for (int32 i = NumBins - 1; i >= 0; --i)
+		{
+			CurrentSuffixBounds += Bins[i].Bounds;
+			CurrentSuffixCount += Bins[i].Count;
+			SuffixBounds[i] = CurrentSuffixBounds;
+			SuffixCounts[i] = CurrentSuffixCount;
+		}
+
+		// 前缀（从左到右）同时计算代价
+		FBox3f PrefixBounds(ForceInit);
+		int32 PrefixCount = 0;
+		for (int32 SplitBin = 0; SplitBin < NumBins - 1; ++SplitBin)
+		{
+			PrefixBounds += Bins[SplitBin].Bounds;
+			PrefixCount += Bins[SplitBin].Count;
+
+			const int32 RightCount = SuffixCounts[SplitBin + 1];
+			if (PrefixCount == 0 || RightCount == 0)
+			{
+				continue;
+			}
+
+			const double Cost = TraversalCost + PacketCost *
+				(GetAreaXY(PrefixBounds) * GetNumPackets(PrefixCount) + GetAreaXY(SuffixBounds[SplitBin + 1]) * GetNumPackets(RightCount)) / UnionArea;
+
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestSplit = AxisStart + (SplitBin + 1) * BinWidth;
+			}
 		}
 	}
 
-	// 检查分割结果，避免无限递归
-	if (LeftTriangles.Num() == InTriangles.Num() && RightTriangles.Num() == 0)
+	// 没有找到合适的分割（例如所有中心点重合），使用中位数分割作为备选
+	if (BestAxis == -1)
 	{
-		// 所有三角形都在左边，弹出一个给右边
-		//UE_LOG(LogSurfacePolygonBuilder, Warning, TEXT("标准分割失败，所有三角形都在左边"));
-		RightTriangles.Add(LeftTriangles.Pop());
+		return BuildRecursive_Middle(Begin, End, Depth);
 	}
-	if (RightTriangles.Num() == InTriangles.Num() && LeftTriangles.Num() == 0)
+
+	// 原地划分三角形索引
+	int32 Mid = Begin;
+	for (int32 i = Begin; i < End; ++i)
 	{
-		// 所有三角形都在右边，弹出一个给左边
-		//UE_LOG(LogSurfacePolygonBuilder, Warning, TEXT("标准分割失败，所有三角形都在右边"));
-		LeftTriangles.Add(RightTriangles.Pop());
+		if (TriangleCenters[TriangleOrder[i]][BestAxis] < BestSplit)
+		{
+			Swap(TriangleOrder[i], TriangleOrder[Mid]);
+			++Mid;
+		}
 	}
 
-	// 递归构建子树
+	// 检查分割结果，避免无限递归
+	if (Mid == Begin || Mid == End)
+	{
+		return BuildRecursive_Middle(Begin, End, Depth);
+	}
+
+	FPolygonBVHNode* Node = new FPolygonBVHNode();
+	Node->BoundingBox = UnionBox;
 	Node->bIsLeaf = false;
-	Node->LeftChild = BuildRecursive_Middle(LeftTriangles, Depth + 1);
-	Node->RightChild = BuildRecursive_Middle(RightTriangles, Depth + 1);
+	Node->LeftChild = BuildRecursive_SAH(Begin, Mid, Depth + 1);
+	Node->RightChild = BuildRecursive_SAH(Mid, End, Depth + 1);
+	Node->NumSubtreeNodes = 1 + Node->LeftChild->NumSubtreeNodes + Node->RightChild->NumSubtreeNodes;
+	Node->NumSubtreeLeaves = Node->LeftChild->NumSubtreeLeaves + Node->RightChild->NumSubtreeLeaves;
+
+	return Node;
+}
+
+FPolygonBVHNode* FPolygonBVHBuilder::CreateLeaf(int32 Begin, int32 End, const FBox& InBoundingBox) const
+{
+	check(End - Begin <= TRIANGLE_PACKET_SIZE);
+
+	FPolygonBVHNode* Node = new FPolygonBVHNode();
+	Node->bIsLeaf = true;
+	Node->BoundingBox = InBoundingBox;
+	Node->TriangleIndices.Append(TriangleOrder.GetData() + Begin, End - Begin);
+	Node->NumSubtreeNodes = 1;
+	Node->NumSubtreeLeaves = 1;
 
 	return Node;
 }
@@ -221,9 +458,9 @@ void FPolygonBVHBuilder::GetStatsRecursive(const FPolygonBVHNode* Node, int32 Cu
 
 	if (Node->bIsLeaf)
 	{
-		// 叶子节点统计、线段内存
+		// 叶子节点统计、三角形包内存
 		OutStats.NumLeaves++;
-		OutStats.MemoryUsageMB += sizeof(FGPUTriangle);
+		OutStats.MemoryUsageMB += sizeof(FGPUTrianglePacket);
 	}
 	else
 	{
@@ -233,6 +470,143 @@ void FPolygonBVHBuilder::GetStatsRecursive(const FPolygonBVHNode* Node, int32 Cu
 	}
 }
 
+void FPolygonLayerMasks::Build(const FGPUPolygonData& InGPUData, TConstArrayView<uint32> InPolygonLayerMasks)
+{
+	Reset();
+
+	if (!InGPUData.IsValid())
+	{
+		return;
+	}
+
+	// 覆盖GPU数据中出现的全部多边形索引，着色器可直接按索引读取
+	int32 MaxPolygonIndex = 0;
+	for (const FGPUTrianglePacket& Packet : InGPUData.Packets)
+	{
+		for (int32 Lane = 0; Lane < Packet.NumTriangles; ++Lane)
+		{
+			MaxPolygonIndex = FMath::Max(MaxPolygonIndex, Packet.PolygonIndex[Lane]);
+		}
+	}
+
+	PolygonLayerMasks.Init(DEFAULT_POLYGON_LAYER_MASK, FMath::Max(MaxPolygonIndex + 1, InPolygonLayerMasks.Num()));
+	FMemory::Memcpy(PolygonLayerMasks.GetData(), InPolygonLayerMasks.GetData(), InPolygonLayerMasks.Num() * sizeof(uint32));
+
+	NodeLayerMasks.SetNumZeroed(InGPUData.Nodes.Num());
+	MergeNodeLayerMasks(InGPUData, nullptr);
+}
+
+bool FPolygonLayerMasks::Update(const FGPUPolygonData& InGPUData, TConstArrayView<uint32> InPolygonLayerMasks, TConstArrayView<int32> InChangedPolygons, FPolygonLayerMaskDirtyRanges& OutDirtyRanges)
+{
+	if (NodeLayerMasks.Num() != InGPUData.Nodes.Num())
+	{
+		return false;
+	}
+
+	for (const int32 PolygonIndex : InChangedPolygons)
+	{
+		if (!PolygonLayerMasks.IsValidIndex(PolygonIndex))
+		{
+			return false;
+		}
+	}
+
+	bool bChanged = false;
+	for (const int32 PolygonIndex : InChangedPolygons)
+	{
+		const uint32 LayerMask = InPolygonLayerMasks.IsValidIndex(PolygonIndex) ? InPolygonLayerMasks[PolygonIndex] : DEFAULT_POLYGON_LAYER_MASK;
+		if (PolygonLayerMasks[PolygonIndex] != LayerMask)
+		{
+			PolygonLayerMasks[PolygonIndex] = LayerMask;
+			OutDirtyRanges.Polygons.Add(PolygonIndex, 1);
+			bChanged = true;
+		}
+	}
+
+	// 节点掩码只是位或，整体重新合并的开销远小于上传；只有包含修改多边形的叶子到根的路径会变化
+	if (bChanged)
+	{
+		MergeNodeLayerMasks(InGPUData, &OutDirtyRanges.Nodes);
+	}
+	return true;
+}
+
+void FPolygonLayerMaskPatch::Stage(const FPolygonLayerMasks& InLayerMasks, const FPolygonLayerMaskDirtyRanges& InDirtyRanges)
+{
+	for (const FSurfaceDirtyRanges::FRange& Range : InDirtyRanges.Polygons.GetRanges())
+	{
+		PolygonValues.Append(InLayerMasks.PolygonLayerMasks.GetData() + Range.Start, Range.Num);
+	}
+	for (const FSurfaceDirtyRanges::FRange& Range : InDirtyRanges.Nodes.GetRanges())
+	{
+		NodeValues.Append(InLayerMasks.NodeLayerMasks.GetData() + Range.Start, Range.Num);
+	}
+	DirtyRanges.Append(InDirtyRanges);
+}
+
+bool FPolygonLayerMaskPatch::Apply(FPolygonLayerMasks& InOutLayerMasks) const
+{
+	auto IsInside = [](const FSurfaceDirtyRanges& InRanges, int32 InNum)
+		{
+			for (const FSurfaceDirtyRanges::FRange& Range : InRanges.GetRanges())
+			{
+				if (Range.Start < 0 || Range.Start + Range.Num > InNum)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+	if (!IsInside(DirtyRanges.Polygons, InOutLayerMasks.PolygonLayerMasks.Num()) || !IsInside(DirtyRanges.Nodes, InOutLayerMasks.NodeLayerMasks.Num()))
+	{
+		return false;
+	}
+
+	// 范围按暂存顺序排列，依次写入即可保证后暂存的值生效
+	auto Write = [](const FSurfaceDirtyRanges& InRanges, const TArray<uint32>& InValues, TArray<uint32>& OutMasks)
+		{
+			int32 ValueIndex = 0;
+			for (const FSurfaceDirtyRanges::FRange& Range : InRanges.GetRanges())
+			{
+				FMemory::Memcpy(OutMasks.GetData() + Range.Start, InValues.GetData() + ValueIndex, Range.Num * sizeof(uint32));
+				ValueIndex += Range.Num;
+			}
+		};
+
+	Write(DirtyRanges.Polygons, PolygonValues, InOutLayerMasks.PolygonLayerMasks);
+	Write(DirtyRanges.Nodes, NodeValues, InOutLayerMasks.NodeLayerMasks);
+	return true;
+}
+
+void FPolygonLayerMasks::MergeNodeLayerMasks(const FGPUPolygonData& InGPUData, FSurfaceDirtyRanges* OutDirtyNodes)
+{
+	// 深度优先布局中子节点总在父节点之后，逆序遍历即可自底向上合并
+	for (int32 NodeIndex = InGPUData.Nodes.Num() - 1; NodeIndex >= 0; --NodeIndex)
+	{
+		const FGPUPolygonBVHNode& Node = InGPUData.Nodes[NodeIndex];
+		uint32 LayerMask = 0;
+		if (Node.IsLeaf())
+		{
+			const FGPUTrianglePacket& Packet = InGPUData.Packets[Node.GetPacketIndex()];
+			for (int32 Lane = 0; Lane < Packet.NumTriangles; ++Lane)
+			{
+				LayerMask |= GetPolygonLayerMask(Packet.PolygonIndex[Lane]);
+			}
+		}
+		else
+		{
+			LayerMask = NodeLayerMasks[FGPUPolygonBVHNode::GetLeftChild(NodeIndex)] | NodeLayerMasks[Node.GetRightChild(NodeIndex)];
+		}
+
+		if (OutDirtyNodes && NodeLayerMasks[NodeIndex] != LayerMask)
+		{
+			OutDirtyNodes->Add(NodeIndex, 1);
+		}
+		NodeLayerMasks[NodeIndex] = LayerMask;
+	}
+}
+
 bool FPolygonGPUConverter::ConvertToGPUData(const FPolygonBVHBuilder& Builder, FGPUPolygonData& OutGPUData)
 {
 	BUILD_TIME_LOG_SCOPE(ConvertToGPUData);
@@ -245,85 +619,168 @@ bool FPolygonGPUConverter::ConvertToGPUData(const FPolygonBVHBuilder& Builder, F
 
 	OutGPUData.Reset();
 
-	// 第一步：收集BVH节点数据
-	OutGPUData.RootNodeIndex = CollectNodesRecursive(Builder.Root, OutGPUData);
+	TArray<uint8> BoundaryEdgeMasks;
+	ComputeBoundaryEdgeMasks(Builder, BoundaryEdgeMasks);
 
-	// 第二步：收集多边形面数据和顶点数据
-	CollectTrianglesRecursive(Builder.Root,OutGPUData);
+	// 子树的节点数和叶子数在构建时已知，可直接分配最终大小
+	const FPolygonBVHNode* Root = Builder.Root;
+	OutGPUData.Nodes.SetNumUninitialized(Root->NumSubtreeNodes);
+	OutGPUData.Packets.SetNumUninitialized(Root->NumSubtreeLeaves);
+	OutGPUData.RootNodeIndex = 0;
 
-	// 第三步：为叶子节点分配正确的三角形索引
-	AssignTriangleIndices(OutGPUData);
+	// 串行输出上层节点，直到得到足够多的独立子树；
+	// 每棵子树的输出位置由左侧子树大小的前缀和确定，因此可以并行输出
+	const int32 MinParallelTasks = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * 4, 1);
+	const int32 MinParallelSubtreeNodes = 1024;
 
-	//UE_LOG(LogSurfacePolygonBuilder, Log, TEXT("BVHData到GPUData转换完成: %d 个节点, %d 个三角形"), OutGPUData.Nodes.Num(), OutGPUData.Triangles.Num());
+	TArray<FSubtreeTask> Frontier;
+	Frontier.Add({ Root, 0, 0 });
+
+	TArray<FSubtreeTask> ParallelTasks;
+	while (Frontier.Num() > 0 && Frontier.Num() + ParallelTasks.Num() < MinParallelTasks)
+	{
+		TArray<FSubtreeTask> NextFrontier;
+		for (const FSubtreeTask& Task : Frontier)
+		{
+			if (Task.Node->bIsLeaf || Task.Node->NumSubtreeNodes <= MinParallelSubtreeNodes)
+			{
+				ParallelTasks.Add(Task);
+				continue;
+			}
+
+			EmitNode(Builder, BoundaryEdgeMasks, Task, OutGPUData);
+
+			const FPolygonBVHNode* Left = Task.Node->LeftChild;
+			const FPolygonBVHNode* Right = Task.Node->RightChild;
+			NextFrontier.Add({ Left, Task.NodeOffset + 1, Task.PacketOffset });
+			NextFrontier.Add({ Right, Task.NodeOffset + 1 + Left->NumSubtreeNodes, Task.PacketOffset + Left->NumSubtreeLeaves });
+		}
+		Frontier = MoveTemp(NextFrontier);
+	}
+	ParallelTasks.Append(Frontier);
+
+	ParallelFor(ParallelTasks.Num(), [&Builder, &BoundaryEdgeMasks, &ParallelTasks, &OutGPUData](int32 TaskIndex)
+		{
+			EmitSubtreeRecursive(Builder, BoundaryEdgeMasks, ParallelTasks[TaskIndex], OutGPUData);
+		});
+
+	//UE_LOG(LogSurfacePolygonBuilder, Log, TEXT("BVHData到GPUData转换完成: %d 个节点, %d 个三角形包"), OutGPUData.Nodes.Num(), OutGPUData.Packets.Num());
 
 	return OutGPUData.IsValid();
 }
 
-int32 FPolygonGPUConverter::CollectNodesRecursive(const FPolygonBVHNode* BVHNodes, FGPUPolygonData& OutGPUData)
+void FPolygonGPUConverter::ComputeBoundaryEdgeMasks(const FPolygonBVHBuilder& Builder, TArray<uint8>& OutBoundaryEdgeMasks)
 {
-	if (!BVHNodes) return -1;
+	BUILD_TIME_LOG_SCOPE(ComputeBoundaryEdgeMasks);
 
-	FGPUPolygonBVHNode NewGPUNode;
-	NewGPUNode.MinExtent = FVector3f(BVHNodes->BoundingBox.Min);
-	NewGPUNode.MaxExtent = FVector3f(BVHNodes->BoundingBox.Max);
+	// 每条边按所属多边形和两个端点的XY坐标（按位比较，较小的端点在前）排序，
+	// 同一多边形内出现两次以上的边位于两个三角形之间，不是边界边
+	struct FEdgeEntry
+	{
+		int32 PolygonId;
+		uint64 A;
+		uint64 B;
+		int32 TriangleEdge;		///< 三角形索引 * 3 + 边序号
 
-	int32 CurrentIndex = OutGPUData.Nodes.Num();
-	OutGPUData.Nodes.Add(NewGPUNode);
+		bool SameEdge(const FEdgeEntry& Other) const
+		{
+			return PolygonId == Other.PolygonId && A == Other.A && B == Other.B;
+		}
+	};
 
-	if (BVHNodes->bIsLeaf)
-	{
-		// 叶子节点：
-		OutGPUData.Nodes[CurrentIndex].LeftChild = -1;
-		OutGPUData.Nodes[CurrentIndex].RightChild = -1;
-		OutGPUData.Nodes[CurrentIndex].IsLeaf = 1.0f;
+	auto PackXY = [](const FVector3f& InVertex)
+		{
+			return (static_cast<uint64>(FMath::AsUInt(InVertex.X)) << 32) | FMath::AsUInt(InVertex.Y);
+		};
 
-		// 暂时设置默认值，后续通过AssignPolygonIndices正确设置
-		OutGPUData.Nodes[CurrentIndex].TriangleIndex = -1; 
-	}
-	else
+	const int32 NumTriangles = Builder.GetNumTriangles();
+	OutBoundaryEdgeMasks.Init(0x7, NumTriangles);
+
+	TArray<FEdgeEntry> Edges;
+	Edges.SetNumUninitialized(NumTriangles * 3);
+	ParallelFor(NumTriangles, [&Builder, &Edges, &PackXY](int32 TriangleIndex)
+		{
+			FVector3f Vertices[3];
+			Builder.GetTriangleVertices(TriangleIndex, Vertices[0], Vertices[1], Vertices[2]);
+			for (int32 EdgeIndex = 0; EdgeIndex < 3; ++EdgeIndex)
+			{
+				const uint64 Start = PackXY(Vertices[EdgeIndex]);
+				const uint64 End = PackXY(Vertices[(EdgeIndex + 1) % 3]);
+				Edges[TriangleIndex * 3 + EdgeIndex] = { Builder.PolygonIds[TriangleIndex], FMath::Min(Start, End), FMath::Max(Start, End), TriangleIndex * 3 + EdgeIndex };
+			}
+		});
+
+	Algo::Sort(Edges, [](const FEdgeEntry& Left, const FEdgeEntry& Right)
+		{
+			if (Left.PolygonId != Right.PolygonId)
+			{
+				return Left.PolygonId < Right.PolygonId;
+			}
+			return Left.A != Right.A ? Left.A < Right.A : Left.B < Right.B;
+		});
+
+	for (int32 RunBegin = 0; RunBegin < Edges.Num();)
 	{
-		// 内部节点：递归处理子节点
-		OutGPUData.Nodes[CurrentIndex].LeftChild = CollectNodesRecursive(BVHNodes->LeftChild, OutGPUData);
-		OutGPUData.Nodes[CurrentIndex].RightChild = CollectNodesRecursive(BVHNodes->RightChild, OutGPUData);
-		OutGPUData.Nodes[CurrentIndex].IsLeaf = 0.0f;
-		OutGPUData.Nodes[CurrentIndex].TriangleIndex = -1;
-	}
+		int32 RunEnd = RunBegin + 1;
+		while (RunEnd < Edges.Num() && Edges[RunEnd].SameEdge(Edges[RunBegin]))
+		{
+			++RunEnd;
+		}
 
-	return CurrentIndex;
+		if (RunEnd - RunBegin > 1)
+		{
+			for (int32 Index = RunBegin; Index < RunEnd; ++Index)
+			{
+				const int32 TriangleEdge = Edges[Index].TriangleEdge;
+				OutBoundaryEdgeMasks[TriangleEdge / 3] &= ~(1 << (TriangleEdge % 3));
+			}
+		}
+		RunBegin = RunEnd;
+	}
 }
 
-void FPolygonGPUConverter::CollectTrianglesRecursive(const FPolygonBVHNode* BVHNode, FGPUPolygonData& OutGPUData)
+void FPolygonGPUConverter::EmitNode(const FPolygonBVHBuilder& Builder, TConstArrayView<uint8> InBoundaryEdgeMasks, const FSubtreeTask& Task, FGPUPolygonData& OutGPUData)
 {
-	if (!BVHNode) return;
+	const FPolygonBVHNode* BVHNode = Task.Node;
+
+	FGPUPolygonBVHNode& GPUNode = OutGPUData.Nodes[Task.NodeOffset];
+	GPUNode = FGPUPolygonBVHNode();
+	GPUNode.MinExtent = FVector3f(BVHNode->BoundingBox.Min);
+	GPUNode.MaxExtent = FVector3f(BVHNode->BoundingBox.Max);
 
 	if (BVHNode->bIsLeaf)
 	{
-		// 叶子节点：收集三角形 多边形面和顶点数据
-		FGPUTriangle NewGPUTriangle;
-		NewGPUTriangle.Vertex1 = FVector3f(BVHNode->Triangle.Vertex1);
-		NewGPUTriangle.Vertex2 = FVector3f(BVHNode->Triangle.Vertex2);
-		NewGPUTriangle.Vertex3 = FVector3f(BVHNode->Triangle.Vertex3);
-		NewGPUTriangle.PolygonIndex = BVHNode->Triangle.PolygonIndex;
+		// 叶子节点：将叶子内的三角形打包为SoA布局，按遍历顺序存放
+		FGPUTrianglePacket& Packet = OutGPUData.Packets[Task.PacketOffset];
+		Packet = FGPUTrianglePacket();
+		Packet.NumTriangles = BVHNode->TriangleIndices.Num();
+		for (int32 Lane = 0; Lane < BVHNode->TriangleIndices.Num(); ++Lane)
+		{
+			const int32 TriangleIndex = BVHNode->TriangleIndices[Lane];
+
+			FVector3f V1, V2, V3;
+			Builder.GetTriangleVertices(TriangleIndex, V1, V2, V3);
+			Packet.SetTriangle(Lane, V1, V2, V3, Builder.PolygonIds[TriangleIndex]);
+			Packet.BoundaryEdgeMask |= static_cast<uint32>(InBoundaryEdgeMasks[TriangleIndex]) << (Lane * 3);
+		}
 
-		OutGPUData.Triangles.Add(NewGPUTriangle);
+		GPUNode.RightOffsetOrPacket = -(Task.PacketOffset + 1);
 	}
 	else
 	{
-		CollectTrianglesRecursive(BVHNode->LeftChild, OutGPUData);
-		CollectTrianglesRecursive(BVHNode->RightChild, OutGPUData);
+		// 内部节点：左子节点紧随其后，右子节点位于左子树之后
+		GPUNode.RightOffsetOrPacket = 1 + BVHNode->LeftChild->NumSubtreeNodes;
 	}
 }
 
-void FPolygonGPUConverter::AssignTriangleIndices(FGPUPolygonData& OutGPUData)
+void FPolygonGPUConverter::EmitSubtreeRecursive(const FPolygonBVHBuilder& Builder, TConstArrayView<uint8> InBoundaryEdgeMasks, const FSubtreeTask& Task, FGPUPolygonData& OutGPUData)
 {
-	float CurrentTriangleIndex = 0.0f;
-	for (int32 i = 0; i < OutGPUData.Nodes.Num(); i++)
+	EmitNode(Builder, InBoundaryEdgeMasks, Task, OutGPUData);
+
+	if (!Task.Node->bIsLeaf)
 	{
-		FGPUPolygonBVHNode& Node = OutGPUData.Nodes[i];
-		if (Node.IsLeaf)
-		{
-			// 叶子节点，设置三角形索引
-			Node.TriangleIndex = CurrentTriangleIndex++;
-		}
+		const FPolygonBVHNode* Left = Task.Node->LeftChild;
+		EmitSubtreeRecursive(Builder, InBoundaryEdgeMasks, { Left, Task.NodeOffset + 1, Task.PacketOffset }, OutGPUData);
+		EmitSubtreeRecursive(Builder, InBoundaryEdgeMasks, { Task.Node->RightChild, Task.NodeOffset + 1 + Left->NumSubtreeNodes, Task.PacketOffset + Left->NumSubtreeLeaves }, OutGPUData);
 	}
 }
@@ -0,0 +1,212 @@
+﻿#include "SurfaceDrawer/SurfacePolygonIdPicker.h"
+
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "RHIGPUReadback.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfacePolygonIdPicker, Log, All);
+
+FSurfacePolygonIdPicker::FSurfacePolygonIdPicker()
+	: WriteIndex(0)
+	, NumPending(0)
+	, CursorPosition(-1.0f, -1.0f)
+	, PolygonUnderCursor(INDEX_NONE)
+	, NumSkippedReadbacks(0)
+{
+	ReadbackSlots.SetNum(NumReadbacks);
+	for (int32 SlotIndex = 0; SlotIndex < NumReadbacks; ++SlotIndex)
+	{
+		ReadbackSlots[SlotIndex].Readback = MakeUnique<FRHIGPUTextureReadback>(*FString::Printf(TEXT("SurfacePolygonIdReadback_%d"), SlotIndex));
+	}
+}
+
+FSurfacePolygonIdPicker::~FSurfacePolygonIdPicker()
+{
+	ReadbackSlots.Empty();
+}
+
+void FSurfacePolygonIdPicker::SetCursorPosition(const FVector2f& InNormalizedPosition)
+{
+	{
+		FScopeLock Lock(&CursorLock);
+		CursorPosition = InNormalizedPosition;
+	}
+
+	// 光标离开视口时立即清空结果，不等待回读
+	if (InNormalizedPosition.X < 0.0f || InNormalizedPosition.Y < 0.0f)
+	{
+		PolygonUnderCursor.store(INDEX_NONE, std::memory_order_relaxed);
+	}
+}
+
+int32 FSurfacePolygonIdPicker::PickPolygonUnderCursor(const UWorld* InWorld)
+{
+	check(IsInGameThread());
+
+	// 光标位置归一化到视口，与渲染分辨率无关
+	FVector2f NormalizedCursorPosition(-1.0f, -1.0f);
+	APlayerController* PlayerController = InWorld ? InWorld->GetFirstPlayerController() : nullptr;
+	if (PlayerController)
+	{
+		float MouseX = 0.0f;
+		float MouseY = 0.0f;
+		int32 ViewportSizeX = 0;
+		int32 ViewportSizeY = 0;
+		PlayerController->GetViewportSize(ViewportSizeX, ViewportSizeY);
+		if (PlayerController->GetMousePosition(MouseX, MouseY) && ViewportSizeX > 0 && ViewportSizeY > 0)
+		{
+			NormalizedCursorPosition = FVector2f(MouseX / ViewportSizeX, MouseY / ViewportSizeY);
+		}
+	}
+	SetCursorPosition(NormalizedCursorPosition);
+
+	return GetPolygonUnderCursor();
+}
+
+FRDGTextureRef FSurfacePolygonIdPicker::CreateIdTexture(FRDGBuilder& GraphBuilder, FIntPoint InExtent)
+{
+	FRDGTextureDesc IdTextureDesc = FRDGTextureDesc::Create2D(
+		InExtent,
+		IdTextureFormat,
+		FClearValueBinding::Black,
+		TexCreate_RenderTargetable | TexCreate_ShaderResource);
+
+	return GraphBuilder.CreateTexture(IdTextureDesc, TEXT("SurfacePolygonIdTexture"));
+}
+
+void FSurfacePolygonIdPicker::AddReadbackPasses(FRDGBuilder& GraphBuilder, FRDGTextureRef InIdTexture, const FIntRect& InViewRect)
+{
+	check(IsInRenderingThread());
+
+	ProcessReadbacks_RenderThread();
+
+	FVector2f LocalCursorPosition;
+	{
+		FScopeLock Lock(&CursorLock);
+		LocalCursorPosition = CursorPosition;
+	}
+
+	if (LocalCursorPosition.X < 0.0f || LocalCursorPosition.Y < 0.0f || LocalCursorPosition.X > 1.0f || LocalCursorPosition.Y > 1.0f)
+	{
+		return;
+	}
+
+	// 拾取区域必须完整落在视口和ID纹理内
+	const FIntPoint TextureExtent = InIdTexture->Desc.Extent;
+	const FIntRect ClampedViewRect(
+		InViewRect.Min.ComponentMax(FIntPoint::ZeroValue),
+		InViewRect.Max.ComponentMin(TextureExtent));
+	if (ClampedViewRect.Width() < RegionSize || ClampedViewRect.Height() < RegionSize)
+	{
+		return;
+	}
+
+	// GPU尚未完成之前的拷贝，跳过本帧，不阻塞渲染线程
+	if (NumPending >= NumReadbacks)
+	{
+		NumSkippedReadbacks.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	FIntPoint CursorPixel(
+		InViewRect.Min.X + FMath::FloorToInt32(LocalCursorPosition.X * InViewRect.Width()),
+		InViewRect.Min.Y + FMath::FloorToInt32(LocalCursorPosition.Y * InViewRect.Height()));
+	CursorPixel = CursorPixel.ComponentMax(ClampedViewRect.Min).ComponentMin(ClampedViewRect.Max - FIntPoint(1, 1));
+
+	const FIntPoint RegionMin = (CursorPixel - FIntPoint(PickRadius, PickRadius))
+		.ComponentMax(ClampedViewRect.Min)
+		.ComponentMin(ClampedViewRect.Max - FIntPoint(RegionSize, RegionSize));
+
+	// 只拷贝光标附近的区域，回读量与分辨率无关
+	FRDGTextureDesc RegionDesc = FRDGTextureDesc::Create2D(
+		FIntPoint(RegionSize, RegionSize),
+		IdTextureFormat,
+		FClearValueBinding::Black,
+		TexCreate_ShaderResource);
+	FRDGTextureRef RegionTexture = GraphBuilder.CreateTexture(RegionDesc, TEXT("SurfacePolygonIdRegion"));
+
+	FRHICopyTextureInfo CopyInfo;
+	CopyInfo.SourcePosition = FIntVector(RegionMin.X, RegionMin.Y, 0);
+	CopyInfo.Size = FIntVector(RegionSize, RegionSize, 1);
+	AddCopyTexturePass(GraphBuilder, InIdTexture, RegionTexture, CopyInfo);
+
+	FReadbackSlot& Slot = ReadbackSlots[WriteIndex];
+	AddEnqueueCopyPass(GraphBuilder, Slot.Readback.Get(), RegionTexture);
+	Slot.CursorInRegion = CursorPixel - RegionMin;
+
+	WriteIndex = (WriteIndex + 1) % NumReadbacks;
+	++NumPending;
+}
+
+void FSurfacePolygonIdPicker::Release_RenderThread()
+{
+	check(IsInRenderingThread());
+
+	for (FReadbackSlot& Slot : ReadbackSlots)
+	{
+		Slot.Readback = MakeUnique<FRHIGPUTextureReadback>(TEXT("SurfacePolygonIdReadback"));
+	}
+	WriteIndex = 0;
+	NumPending = 0;
+	PolygonUnderCursor.store(INDEX_NONE, std::memory_order_relaxed);
+}
+
+void FSurfacePolygonIdPicker::ProcessReadbacks_RenderThread()
+{
+	// 按提交顺序读取，遇到未就绪的槽位即停止，保证结果单调更新
+	while (NumPending > 0)
+	{
+		const int32 ReadIndex = (WriteIndex - NumPending + NumReadbacks) % NumReadbacks;
+		FReadbackSlot& Slot = ReadbackSlots[ReadIndex];
+		if (!Slot.Readback->IsReady())
+		{
+			break;
+		}
+
+		int32 RowPitchInPixels = 0;
+		const uint32* Data = static_cast<const uint32*>(Slot.Readback->Lock(RowPitchInPixels));
+		if (Data)
+		{
+			PolygonUnderCursor.store(FindNearestPolygon(Data, RowPitchInPixels, Slot.CursorInRegion), std::memory_order_relaxed);
+		}
+		else
+		{
+			UE_LOG(LogSurfacePolygonIdPicker, Warning, TEXT("多边形ID回读锁定失败"));
+		}
+		Slot.Readback->Unlock();
+
+		--NumPending;
+	}
+}
+
+int32 FSurfacePolygonIdPicker::FindNearestPolygon(const uint32* InData, int32 InRowPitchInPixels, const FIntPoint& InCursorInRegion)
+{
+	int32 NearestPolygon = INDEX_NONE;
+	int32 NearestDistanceSquared = MAX_int32;
+
+	for (int32 Y = 0; Y < RegionSize; ++Y)
+	{
+		const uint32* Row = InData + Y * InRowPitchInPixels;
+		for (int32 X = 0; X < RegionSize; ++X)
+		{
+			// ID纹理保存多边形索引 + 1，0表示未命中
+			const int32 PolygonId = static_cast<int32>(Row[X]);
+			if (PolygonId <= 0)
+			{
+				continue;
+			}
+
+			const int32 DistanceSquared = FMath::Square(X - InCursorInRegion.X) + FMath::Square(Y - InCursorInRegion.Y);
+			if (DistanceSquared < NearestDistanceSquared)
+			{
+				NearestDistanceSquared = DistanceSquared;
+				NearestPolygon = PolygonId - 1;
+			}
+		}
+	}
+
+	return NearestPolygon;
+}
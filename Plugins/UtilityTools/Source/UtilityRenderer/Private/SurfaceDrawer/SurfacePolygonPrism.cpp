@@ -0,0 +1,157 @@
+﻿#include "SurfaceDrawer/SurfacePolygonPrism.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfacePolygonPrism, Log, All);
+
+namespace SurfacePolygonPrism
+{
+	/// \brief 顶点焊接键：同一多边形内XY坐标完全相同的顶点共用一个棱柱顶点
+	struct FVertexKey
+	{
+		int32 PolygonIndex;
+		float X;
+		float Y;
+
+		bool operator==(const FVertexKey& Other) const
+		{
+			return PolygonIndex == Other.PolygonIndex && X == Other.X && Y == Other.Y;
+		}
+
+		friend uint32 GetTypeHash(const FVertexKey& Key)
+		{
+			return HashCombineFast(HashCombineFast(::GetTypeHash(Key.PolygonIndex), ::GetTypeHash(Key.X)), ::GetTypeHash(Key.Y));
+		}
+	};
+
+	/// \brief 有向边键
+	FORCEINLINE uint64 MakeEdgeKey(uint32 From, uint32 To)
+	{
+		return (static_cast<uint64>(From) << 32) | To;
+	}
+
+	/// \brief 底面/顶面顶点索引（每个焊接后的顶点对应一对棱柱顶点）
+	FORCEINLINE uint32 BottomVertex(uint32 Vertex) { return Vertex * 2; }
+	FORCEINLINE uint32 TopVertex(uint32 Vertex) { return Vertex * 2 + 1; }
+}
+
+bool FPolygonPrismBuilder::BuildPrismMesh(const FPolygonMeshData& InMeshData, float InMinZ, float InMaxZ, FPolygonPrismMesh& OutPrismMesh)
+{
+	using namespace SurfacePolygonPrism;
+
+	OutPrismMesh.Reset();
+
+	if (!InMeshData.IsValid())
+	{
+		UE_LOG(LogSurfacePolygonPrism, Warning, TEXT("网格数据无效, 不能生成棱柱"));
+		return false;
+	}
+
+	if (!(InMaxZ > InMinZ))
+	{
+		UE_LOG(LogSurfacePolygonPrism, Warning, TEXT("棱柱高度范围无效: [%f, %f]"), InMinZ, InMaxZ);
+		return false;
+	}
+
+	const int32 NumTriangles = InMeshData.NumTriangles();
+
+	TMap<FVertexKey, uint32> VertexMap;
+	VertexMap.Reserve(NumTriangles);
+
+	// 边界边：有向边 -> 重复次数；遇到反向边时相互抵消
+	TMap<uint64, int32> BoundaryEdges;
+	BoundaryEdges.Reserve(NumTriangles * 3);
+
+	OutPrismMesh.Vertices.Reserve(NumTriangles * 2);
+	OutPrismMesh.Indices.Reserve(NumTriangles * 6);
+
+	auto FindOrAddVertex = [&VertexMap, &OutPrismMesh, InMinZ, InMaxZ](const FVector3f& InPosition, int32 InPolygonIndex)
+		{
+			const FVertexKey Key{ InPolygonIndex, InPosition.X, InPosition.Y };
+			if (const uint32* Found = VertexMap.Find(Key))
+			{
+				return *Found;
+			}
+
+			const uint32 NewVertex = static_cast<uint32>(VertexMap.Num());
+			VertexMap.Add(Key, NewVertex);
+			OutPrismMesh.Vertices.Emplace(FVector3f(InPosition.X, InPosition.Y, InMinZ), InPolygonIndex);
+			OutPrismMesh.Vertices.Emplace(FVector3f(InPosition.X, InPosition.Y, InMaxZ), InPolygonIndex);
+			return NewVertex;
+		};
+
+	int32 NumSkipped = 0;
+	for (int32 TriangleIndex = 0; TriangleIndex < NumTriangles; ++TriangleIndex)
+	{
+		const FVector3f& V1 = InMeshData.Vertices[InMeshData.Indices[TriangleIndex * 3 + 0]];
+		FVector3f V2 = InMeshData.Vertices[InMeshData.Indices[TriangleIndex * 3 + 1]];
+		FVector3f V3 = InMeshData.Vertices[InMeshData.Indices[TriangleIndex * 3 + 2]];
+
+		// XY平面退化的三角形不覆盖任何像素
+		const float SignedArea = (V2.X - V1.X) * (V3.Y - V1.Y) - (V2.Y - V1.Y) * (V3.X - V1.X);
+		if (FMath::Abs(SignedArea) <= UE_SMALL_NUMBER)
+		{
+			++NumSkipped;
+			continue;
+		}
+
+		// 统一为逆时针（从+Z方向看），保证公共边方向相反
+		if (SignedArea < 0.0f)
+		{
+			Swap(V2, V3);
+		}
+
+		const int32 PolygonIndex = InMeshData.PolygonIds[TriangleIndex];
+		const uint32 Corners[3] = {
+			FindOrAddVertex(V1, PolygonIndex),
+			FindOrAddVertex(V2, PolygonIndex),
+			FindOrAddVertex(V3, PolygonIndex)
+		};
+
+		// 顶面朝上，底面朝下
+		OutPrismMesh.Indices.Append({ TopVertex(Corners[0]), TopVertex(Corners[1]), TopVertex(Corners[2]) });
+		OutPrismMesh.Indices.Append({ BottomVertex(Corners[0]), BottomVertex(Corners[2]), BottomVertex(Corners[1]) });
+
+		for (int32 Edge = 0; Edge < 3; ++Edge)
+		{
+			const uint32 From = Corners[Edge];
+			const uint32 To = Corners[(Edge + 1) % 3];
+
+			int32* ReverseCount = BoundaryEdges.Find(MakeEdgeKey(To, From));
+			if (ReverseCount && *ReverseCount > 0)
+			{
+				if (--(*ReverseCount) == 0)
+				{
+					BoundaryEdges.Remove(MakeEdgeKey(To, From));
+				}
+			}
+			else
+			{
+				++BoundaryEdges.FindOrAdd(MakeEdgeKey(From, To));
+			}
+		}
+	}
+
+	// 边界边拉伸为侧面，多边形内部在边的左侧，侧面法线朝右（朝外）
+	for (const TPair<uint64, int32>& EdgePair : BoundaryEdges)
+	{
+		const uint32 From = static_cast<uint32>(EdgePair.Key >> 32);
+		const uint32 To = static_cast<uint32>(EdgePair.Key & 0xFFFFFFFFull);
+		for (int32 Count = 0; Count < EdgePair.Value; ++Count)
+		{
+			OutPrismMesh.Indices.Append({ BottomVertex(From), BottomVertex(To), TopVertex(To) });
+			OutPrismMesh.Indices.Append({ BottomVertex(From), TopVertex(To), TopVertex(From) });
+		}
+	}
+
+	for (const FPolygonPrismVertex& Vertex : OutPrismMesh.Vertices)
+	{
+		OutPrismMesh.Bounds += Vertex.Position;
+	}
+
+	if (NumSkipped > 0)
+	{
+		UE_LOG(LogSurfacePolygonPrism, Verbose, TEXT("跳过 %d 个退化三角形"), NumSkipped);
+	}
+
+	return OutPrismMesh.IsValid();
+}
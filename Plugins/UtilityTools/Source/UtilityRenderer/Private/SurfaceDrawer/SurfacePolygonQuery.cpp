@@ -0,0 +1,314 @@
+﻿#include "SurfaceDrawer/SurfacePolygonQuery.h"
+
+#include "Math/VectorRegister.h"
+#include "Async/ParallelFor.h"
+
+
+namespace SurfacePolygonQuery
+{
+	/// \brief 遍历栈的内联容量，与着色器保持一致，更深的树在堆上扩展
+	static constexpr int32 MaxStackNum = 64;
+
+	using FTraversalStack = TArray<int32, TInlineAllocator<MaxStackNum>>;
+
+	/// \brief 批量查询时每个并行任务处理的点数
+	static constexpr int32 PointsPerBatch = 256;
+
+	/// \brief 少于该数量时单线程查询，避免任务调度开销
+	static constexpr int32 MinParallelPoints = 1024;
+
+	/// \brief 判断点是否在节点包围盒的XY范围内
+	FORCEINLINE bool IsPointInNodeXY(const FGPUPolygonBVHNode& InNode, const FVector2f& InPoint)
+	{
+		return InPoint.X >= InNode.MinExtent.X && InPoint.X <= InNode.MaxExtent.X
+			&& InPoint.Y >= InNode.MinExtent.Y && InPoint.Y <= InNode.MaxExtent.Y;
+	}
+
+	/// \brief 计算4个三角形的边函数 (B - A) x (P - A)
+	FORCEINLINE VectorRegister4Float EdgeFunction(
+		const VectorRegister4Float& AX, const VectorRegister4Float& AY,
+		const VectorRegister4Float& BX, const VectorRegister4Float& BY,
+		const VectorRegister4Float& PX, const VectorRegister4Float& PY)
+	{
+		return VectorSubtract(
+			VectorMultiply(VectorSubtract(BX, AX), VectorSubtract(PY, AY)),
+			VectorMultiply(VectorSubtract(BY, AY), VectorSubtract(PX, AX)));
+	}
+
+	/// \brief 计算点到4条线段AB的距离平方
+	FORCEINLINE VectorRegister4Float PointSegmentDistanceSquared(
+		const VectorRegister4Float& AX, const VectorRegister4Float& AY,
+		const VectorRegister4Float& BX, const VectorRegister4Float& BY,
+		const VectorRegister4Float& PX, const VectorRegister4Float& PY)
+	{
+		const VectorRegister4Float DX = VectorSubtract(BX, AX);
+		const VectorRegister4Float DY = VectorSubtract(BY, AY);
+		const VectorRegister4Float APX = VectorSubtract(PX, AX);
+		const VectorRegister4Float APY = VectorSubtract(PY, AY);
+
+		// t = clamp(dot(AP, D) / dot(D, D), 0, 1)
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(DX, DX, VectorMultiply(DY, DY));
+		const VectorRegister4Float Dot = VectorMultiplyAdd(APX, DX, VectorMultiply(APY, DY));
+		VectorRegister4Float T = VectorDivide(Dot, VectorMax(LengthSquared, VectorSetFloat1(UE_SMALL_NUMBER)));
+		T = VectorMin(VectorMax(T, GlobalVectorConstants::FloatZero), GlobalVectorConstants::FloatOne);
+
+		const VectorRegister4Float OffsetX = VectorNegateMultiplyAdd(T, DX, APX);
+		const VectorRegister4Float OffsetY = VectorNegateMultiplyAdd(T, DY, APY);
+		return VectorMultiplyAdd(OffsetX, OffsetX, VectorMultiply(OffsetY, OffsetY));
+	}
+
+	/// \brief 点到节点包围盒XY范围的距离平方
+	FORCEINLINE float PointNodeDistanceSquaredXY(const FGPUPolygonBVHNode& InNode, const FVector2f& InPoint)
+	{
+		const float DX = FMath::Max3(InNode.MinExtent.X - InPoint.X, 0.0f, InPoint.X - InNode.MaxExtent.X);
+		const float DY = FMath::Max3(InNode.MinExtent.Y - InPoint.Y, 0.0f, InPoint.Y - InNode.MaxExtent.Y);
+		return DX * DX + DY * DY;
+	}
+}
+
+bool FPolygonBVHQuery::QueryPoint(const FGPUPolygonData& InGPUData, const FVector2f& InPoint, int32& OutPolygonIndex)
+{
+	return QueryPointInternal(InGPUData, nullptr, ~0u, InPoint, OutPolygonIndex);
+}
+
+bool FPolygonBVHQuery::QueryPoint(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks& InLayerMasks, uint32 InVisibleLayers, const FVector2f& InPoint, int32& OutPolygonIndex)
+{
+	return QueryPointInternal(InGPUData, &InLayerMasks, InVisibleLayers, InPoint, OutPolygonIndex);
+}
+
+void FPolygonBVHQuery::QueryPoints(const FGPUPolygonData& InGPUData, TConstArrayView<FVector2f> InPoints, TArray<int32>& OutPolygonIndices)
+{
+	QueryPointsInternal(InGPUData, nullptr, ~0u, InPoints, OutPolygonIndices);
+}
+
+void FPolygonBVHQuery::QueryPoints(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks& InLayerMasks, uint32 InVisibleLayers, TConstArrayView<FVector2f> InPoints, TArray<int32>& OutPolygonIndices)
+{
+	QueryPointsInternal(InGPUData, &InLayerMasks, InVisibleLayers, InPoints, OutPolygonIndices);
+}
+
+float FPolygonBVHQuery::QueryDistanceToEdges(const FGPUPolygonData& InGPUData, const FVector2f& InPoint, float InMaxDistance)
+{
+	using namespace SurfacePolygonQuery;
+
+	if (!InGPUData.IsValid() || InMaxDistance <= 0.0f)
+	{
+		return FMath::Max(InMaxDistance, 0.0f);
+	}
+
+	float BestDistanceSquared = FMath::Square(InMaxDistance);
+
+	const VectorRegister4Float PX = VectorSetFloat1(InPoint.X);
+	const VectorRegister4Float PY = VectorSetFloat1(InPoint.Y);
+	const VectorRegister4Float LaneIndices = MakeVectorRegisterFloat(0.5f, 1.5f, 2.5f, 3.5f);
+
+	FTraversalStack Stack;
+	Stack.Push(InGPUData.RootNodeIndex);
+
+	while (Stack.Num() > 0)
+	{
+		const int32 NodeIndex = Stack.Pop(EAllowShrinking::No);
+		const FGPUPolygonBVHNode& Node = InGPUData.Nodes[NodeIndex];
+
+		// 包围盒外的点到盒内任意边的距离不小于到包围盒的距离
+		if (PointNodeDistanceSquaredXY(Node, InPoint) >= BestDistanceSquared)
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf())
+		{
+			const FGPUTrianglePacket& Packet = InGPUData.Packets[Node.GetPacketIndex()];
+
+			const VectorRegister4Float V1X = VectorLoadAligned(Packet.V1X);
+			const VectorRegister4Float V1Y = VectorLoadAligned(Packet.V1Y);
+			const VectorRegister4Float V2X = VectorLoadAligned(Packet.V2X);
+			const VectorRegister4Float V2Y = VectorLoadAligned(Packet.V2Y);
+			const VectorRegister4Float V3X = VectorLoadAligned(Packet.V3X);
+			const VectorRegister4Float V3Y = VectorLoadAligned(Packet.V3Y);
+
+			// 4个三角形的3条边同时计算
+			VectorRegister4Float DistanceSquared = PointSegmentDistanceSquared(V1X, V1Y, V2X, V2Y, PX, PY);
+			DistanceSquared = VectorMin(DistanceSquared, PointSegmentDistanceSquared(V2X, V2Y, V3X, V3Y, PX, PY));
+			DistanceSquared = VectorMin(DistanceSquared, PointSegmentDistanceSquared(V3X, V3Y, V1X, V1Y, PX, PY));
+
+			// 未使用的通道不参与
+			const VectorRegister4Float ValidLane = VectorCompareLT(LaneIndices, VectorSetFloat1(static_cast<float>(Packet.NumTriangles)));
+			DistanceSquared = VectorSelect(ValidLane, DistanceSquared, VectorSetFloat1(BestDistanceSquared));
+
+			alignas(16) float LaneDistanceSquared[TRIANGLE_PACKET_SIZE];
+			VectorStoreAligned(DistanceSquared, LaneDistanceSquared);
+			for (int32 Lane = 0; Lane < TRIANGLE_PACKET_SIZE; ++Lane)
+			{
+				BestDistanceSquared = FMath::Min(BestDistanceSquared, LaneDistanceSquared[Lane]);
+			}
+		}
+		else
+		{
+			Stack.Push(Node.GetRightChild(NodeIndex));
+			Stack.Push(FGPUPolygonBVHNode::GetLeftChild(NodeIndex));
+		}
+	}
+
+	return FMath::Sqrt(BestDistanceSquared);
+}
+
+void FPolygonBVHQuery::QueryPointBruteForce(const FGPUPolygonData& InGPUData, const FVector2f& InPoint, TArray<int32>& OutPolygonIndices)
+{
+	OutPolygonIndices.Reset();
+
+	for (const FGPUTrianglePacket& Packet : InGPUData.Packets)
+	{
+		// 逐个通道测试，收集包内所有包含点的三角形
+		for (int32 Lane = 0; Lane < Packet.NumTriangles; ++Lane)
+		{
+			if (PointInsidePacket(Packet, InPoint, 1u << Lane) != INDEX_NONE)
+			{
+				OutPolygonIndices.Add(Packet.PolygonIndex[Lane]);
+			}
+		}
+	}
+}
+
+void FPolygonBVHQuery::QueryPointsInternal(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks* InLayerMasks, uint32 InVisibleLayers, TConstArrayView<FVector2f> InPoints, TArray<int32>& OutPolygonIndices)
+{
+	using namespace SurfacePolygonQuery;
+
+	const int32 NumPoints = InPoints.Num();
+	OutPolygonIndices.Init(INDEX_NONE, NumPoints);
+
+	if (NumPoints == 0 || !InGPUData.IsValid())
+	{
+		return;
+	}
+
+	// 在点集包围盒内量化为16位，按Morton码排序，使相邻查询访问相近的BVH节点
+	FBox2f PointBounds(ForceInit);
+	for (const FVector2f& Point : InPoints)
+	{
+		PointBounds += Point;
+	}
+	const FVector2f Extent = PointBounds.GetSize();
+	const FVector2f Scale(
+		Extent.X > UE_SMALL_NUMBER ? 65535.0f / Extent.X : 0.0f,
+		Extent.Y > UE_SMALL_NUMBER ? 65535.0f / Extent.Y : 0.0f);
+
+	// 高32位为Morton码，低32位为原始序号
+	TArray<uint64> SortKeys;
+	SortKeys.SetNumUninitialized(NumPoints);
+	for (int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex)
+	{
+		const FVector2f Local = (InPoints[PointIndex] - PointBounds.Min) * Scale;
+		const uint32 X = static_cast<uint32>(FMath::Clamp(Local.X, 0.0f, 65535.0f));
+		const uint32 Y = static_cast<uint32>(FMath::Clamp(Local.Y, 0.0f, 65535.0f));
+		const uint32 Morton = FMath::MortonCode2(X) | (FMath::MortonCode2(Y) << 1);
+		SortKeys[PointIndex] = (static_cast<uint64>(Morton) << 32) | static_cast<uint32>(PointIndex);
+	}
+	SortKeys.Sort();
+
+	const int32 NumBatches = FMath::DivideAndRoundUp(NumPoints, PointsPerBatch);
+	ParallelFor(NumBatches,
+		[&InGPUData, InLayerMasks, InVisibleLayers, &InPoints, &SortKeys, &OutPolygonIndices, NumPoints](int32 BatchIndex)
+		{
+			const int32 Begin = BatchIndex * PointsPerBatch;
+			const int32 End = FMath::Min(Begin + PointsPerBatch, NumPoints);
+			for (int32 SortedIndex = Begin; SortedIndex < End; ++SortedIndex)
+			{
+				const int32 PointIndex = static_cast<int32>(SortKeys[SortedIndex] & 0xFFFFFFFFull);
+				QueryPointInternal(InGPUData, InLayerMasks, InVisibleLayers, InPoints[PointIndex], OutPolygonIndices[PointIndex]);
+			}
+		},
+		NumPoints < MinParallelPoints ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+bool FPolygonBVHQuery::QueryPointInternal(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks* InLayerMasks, uint32 InVisibleLayers, const FVector2f& InPoint, int32& OutPolygonIndex)
+{
+	using namespace SurfacePolygonQuery;
+
+	OutPolygonIndex = INDEX_NONE;
+
+	if (!InGPUData.IsValid())
+	{
+		return false;
+	}
+
+	// 使用栈代替递归
+	FTraversalStack Stack;
+	Stack.Push(InGPUData.RootNodeIndex);
+
+	while (Stack.Num() > 0)
+	{
+		const int32 NodeIndex = Stack.Pop(EAllowShrinking::No);
+		const FGPUPolygonBVHNode& Node = InGPUData.Nodes[NodeIndex];
+
+		if (!IsPointInNodeXY(Node, InPoint))
+		{
+			continue;
+		}
+
+		// 子树内没有可见图层的多边形，整体剔除
+		if (InLayerMasks && (InLayerMasks->GetNodeLayerMask(NodeIndex) & InVisibleLayers) == 0)
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf())
+		{
+			const FGPUTrianglePacket& Packet = InGPUData.Packets[Node.GetPacketIndex()];
+
+			uint32 LaneMask = 0xF;
+			if (InLayerMasks)
+			{
+				LaneMask = 0;
+				for (int32 Lane = 0; Lane < Packet.NumTriangles; ++Lane)
+				{
+					LaneMask |= (InLayerMasks->GetPolygonLayerMask(Packet.PolygonIndex[Lane]) & InVisibleLayers) != 0 ? (1u << Lane) : 0u;
+				}
+			}
+
+			const int32 Lane = PointInsidePacket(Packet, InPoint, LaneMask);
+			if (Lane != INDEX_NONE)
+			{
+				OutPolygonIndex = Packet.PolygonIndex[Lane];
+				return true;
+			}
+		}
+		else
+		{
+			// 先压右子节点，左子节点（i + 1）优先出栈，保持线性内存访问
+			Stack.Push(Node.GetRightChild(NodeIndex));
+			Stack.Push(FGPUPolygonBVHNode::GetLeftChild(NodeIndex));
+		}
+	}
+
+	return false;
+}
+
+int32 FPolygonBVHQuery::PointInsidePacket(const FGPUTrianglePacket& InPacket, const FVector2f& InPoint, uint32 InLaneMask)
+{
+	using namespace SurfacePolygonQuery;
+
+	const VectorRegister4Float PX = VectorSetFloat1(InPoint.X);
+	const VectorRegister4Float PY = VectorSetFloat1(InPoint.Y);
+
+	const VectorRegister4Float V1X = VectorLoadAligned(InPacket.V1X);
+	const VectorRegister4Float V1Y = VectorLoadAligned(InPacket.V1Y);
+	const VectorRegister4Float V2X = VectorLoadAligned(InPacket.V2X);
+	const VectorRegister4Float V2Y = VectorLoadAligned(InPacket.V2Y);
+	const VectorRegister4Float V3X = VectorLoadAligned(InPacket.V3X);
+	const VectorRegister4Float V3Y = VectorLoadAligned(InPacket.V3Y);
+
+	// 三条边的边函数同号则点在三角形内（与绕序无关）
+	const VectorRegister4Float E0 = EdgeFunction(V1X, V1Y, V2X, V2Y, PX, PY);
+	const VectorRegister4Float E1 = EdgeFunction(V2X, V2Y, V3X, V3Y, PX, PY);
+	const VectorRegister4Float E2 = EdgeFunction(V3X, V3Y, V1X, V1Y, PX, PY);
+
+	const VectorRegister4Float Zero = GlobalVectorConstants::FloatZero;
+	const VectorRegister4Float AllPositive = VectorBitwiseAnd(VectorBitwiseAnd(VectorCompareGE(E0, Zero), VectorCompareGE(E1, Zero)), VectorCompareGE(E2, Zero));
+	const VectorRegister4Float AllNegative = VectorBitwiseAnd(VectorBitwiseAnd(VectorCompareLE(E0, Zero), VectorCompareLE(E1, Zero)), VectorCompareLE(E2, Zero));
+
+	// 屏蔽包内未使用的通道
+	const uint32 ValidMask = ((1u << FMath::Clamp(InPacket.NumTriangles, 0, TRIANGLE_PACKET_SIZE)) - 1u) & InLaneMask;
+	const uint32 InsideMask = static_cast<uint32>(VectorMaskBits(VectorBitwiseOr(AllPositive, AllNegative))) & ValidMask;
+
+	return InsideMask != 0 ? static_cast<int32>(FMath::CountTrailingZeros(InsideMask)) : INDEX_NONE;
+}
@@ -1,4 +1,9 @@
 ﻿#include "SurfaceDrawer/SurfacePolygonRenderer.h"
+#include "SurfaceDrawer/SurfaceCoverageCache.h"
+#include "SurfaceDrawer/SurfaceFrustumCulling.h"
+#include "SurfaceDrawer/SurfaceReducedResolution.h"
+#include "SurfaceDrawer/SurfaceScreenBounds.h"
+#include "SurfaceDrawer/SurfaceTileCulling.h"
 
 #include "GlobalShader.h"
 #include "ShaderParameterStruct.h"
@@ -12,6 +17,7 @@
 #include "RenderGraphUtils.h"
 #include "PixelShaderUtils.h"
 #include "RenderGraphEvent.h"
+#include "CommonRenderResources.h"
 
 #include "../Private/SceneRendering.h"
 
@@ -25,18 +31,35 @@ public:
 	// 告诉引擎此着色器使用结构作为其参数
 	SHADER_USE_PARAMETER_STRUCT(FSurfacePolygonRenderPS, FGlobalShader);
 
+	// 是否输出多边形ID纹理（拾取）
+	class FWritePolygonIdDim : SHADER_PERMUTATION_BOOL("WRITE_POLYGON_ID");
+	// 是否输出覆盖纹理并复用上一帧的覆盖结果
+	class FCoverageCacheDim : SHADER_PERMUTATION_BOOL("COVERAGE_CACHE");
+	// 是否使用低分辨率分类结果，只逐像素查询边缘附近的像素
+	class FReducedResolutionDim : SHADER_PERMUTATION_BOOL("REDUCED_RESOLUTION");
+	using FPermutationDomain = TShaderPermutationDomain<FWritePolygonIdDim, FCoverageCacheDim, FReducedResolutionDim>;
+
 	// 着色器参数结构声明
 	// 参数与HLSL代码中的参数匹配
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, DepthTexture)
 		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, ColorTexture)
 		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUPolygonBVHNode>, PolygonBVHNodeData)
-		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUTriangle>, TriangleData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUTrianglePacket>, TrianglePacketData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, PolygonLayerMaskData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, NodeLayerMaskData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, SeedNodeData)
+		SHADER_PARAMETER(uint32, VisibleLayers)
+		SHADER_PARAMETER(uint32, NumSeedNodes)
+		SHADER_PARAMETER(uint32, ProxyNodeOffset)
+		SHADER_PARAMETER(uint32, ProxyPacketOffset)
 		SHADER_PARAMETER(FMatrix44f, ScreenToWorld)
 		SHADER_PARAMETER(FMatrix44f, InvViewMatrix)
 		SHADER_PARAMETER(FIntRect, ViewportRect)
 		SHADER_PARAMETER(float, Opacity)
 		SHADER_PARAMETER(FVector4f, Color)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FSurfaceCoverageCacheParameters, CoverageCache)
+		SHADER_PARAMETER_STRUCT_INCLUDE(FSurfaceReducedResolutionParameters, ReducedResolution)
 		RENDER_TARGET_BINDING_SLOTS()
 	END_SHADER_PARAMETER_STRUCT()
 
@@ -44,13 +67,203 @@ public:
 	// 由引擎调用，以确定为此着色器编译哪些变体
 	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
 	{
-		return true;
+		// 覆盖缓存优先于降分辨率
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		return !(PermutationVector.Get<FCoverageCacheDim>() && PermutationVector.Get<FReducedResolutionDim>());
 	}
 };
 
 // 创建着色器			着色器类				着色器文件位置									着色器入口函数名  着色器类型
 IMPLEMENT_GLOBAL_SHADER(FSurfacePolygonRenderPS, "/UtilityTools/SurfacePolygonRenderShader.usf", "MainPixelShader", SF_Pixel);
 
+// 降分辨率分类像素着色器
+using FSurfacePolygonReducedPS = TSurfaceReducedPS<FSurfacePolygonRenderPS>;
+IMPLEMENT_SHADER_TYPE(template<>, TSurfaceReducedPS<FSurfacePolygonRenderPS>, TEXT("/UtilityTools/SurfacePolygonRenderShader.usf"), TEXT("MainReducedPixelShader"), SF_Pixel);
+
+/**
+ * 分块计算着色器：每个16×16分块剔除一次BVH，像素只测试分块的候选三角形包
+ */
+class FSurfacePolygonTiledCS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FSurfacePolygonTiledCS);
+	SHADER_USE_PARAMETER_STRUCT(FSurfacePolygonTiledCS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, DepthTexture)
+		SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<float4>, RWColorTexture)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUPolygonBVHNode>, PolygonBVHNodeData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FGPUTrianglePacket>, TrianglePacketData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, PolygonLayerMaskData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, NodeLayerMaskData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, SeedNodeData)
+		SHADER_PARAMETER(uint32, VisibleLayers)
+		SHADER_PARAMETER(uint32, NumSeedNodes)
+		SHADER_PARAMETER(uint32, ProxyNodeOffset)
+		SHADER_PARAMETER(uint32, ProxyPacketOffset)
+		SHADER_PARAMETER(FMatrix44f, ScreenToWorld)
+		SHADER_PARAMETER(FIntRect, ViewportRect)
+		SHADER_PARAMETER(FIntRect, ScissorRect)
+		SHADER_PARAMETER(float, Opacity)
+		SHADER_PARAMETER(FVector4f, Color)
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("TILE_SIZE"), FSurfaceTileCulling::TileSize);
+		OutEnvironment.SetDefine(TEXT("MAX_TILE_CANDIDATES"), FSurfaceTileCulling::MaxTileCandidates);
+		OutEnvironment.SetDefine(TEXT("MAX_TILE_LOOPS"), FSurfaceTileCulling::MaxTileLoops);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FSurfacePolygonTiledCS, "/UtilityTools/SurfacePolygonRenderShader.usf", "MainTiledComputeShader", SF_Compute);
+
+/**
+ * 棱柱顶点着色器：按SV_VertexID从结构化缓冲区读取顶点
+ */
+class FSurfacePolygonPrismVS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FSurfacePolygonPrismVS);
+	SHADER_USE_PARAMETER_STRUCT(FSurfacePolygonPrismVS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<FPolygonPrismVertex>, PrismVertexData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, PrismIndexData)
+		SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, PolygonLayerMaskData)
+		SHADER_PARAMETER(FMatrix44f, WorldToClip)
+		SHADER_PARAMETER(uint32, VisibleLayers)
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+};
+
+/**
+ * 将场景深度复制到棱柱通道专用的深度模板缓冲区
+ */
+class FSurfacePolygonCopyDepthPS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FSurfacePolygonCopyDepthPS);
+	SHADER_USE_PARAMETER_STRUCT(FSurfacePolygonCopyDepthPS, FGlobalShader);
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D, DepthTexture)
+		RENDER_TARGET_BINDING_SLOTS()
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+};
+
+/**
+ * 着色模板标记的像素
+ */
+class FSurfacePolygonPrismShadePS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(FSurfacePolygonPrismShadePS);
+	SHADER_USE_PARAMETER_STRUCT(FSurfacePolygonPrismShadePS, FGlobalShader);
+
+	class FWritePolygonIdDim : SHADER_PERMUTATION_BOOL("WRITE_POLYGON_ID");
+	using FPermutationDomain = TShaderPermutationDomain<FWritePolygonIdDim>;
+
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER(float, Opacity)
+		SHADER_PARAMETER(FVector4f, Color)
+	END_SHADER_PARAMETER_STRUCT()
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FSurfacePolygonPrismVS, "/UtilityTools/SurfacePolygonPrismShader.usf", "MainVertexShader", SF_Vertex);
+IMPLEMENT_GLOBAL_SHADER(FSurfacePolygonCopyDepthPS, "/UtilityTools/SurfacePolygonPrismShader.usf", "CopyDepthPixelShader", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FSurfacePolygonPrismShadePS, "/UtilityTools/SurfacePolygonPrismShader.usf", "ShadePixelShader", SF_Pixel);
+
+BEGIN_SHADER_PARAMETER_STRUCT(FSurfacePolygonPrismPassParameters, )
+	SHADER_PARAMETER_STRUCT_INCLUDE(FSurfacePolygonPrismVS::FParameters, VS)
+	SHADER_PARAMETER_STRUCT_INCLUDE(FSurfacePolygonPrismShadePS::FParameters, PS)
+	RENDER_TARGET_BINDING_SLOTS()
+END_SHADER_PARAMETER_STRUCT()
+
+namespace SurfacePolygonRenderer
+{
+	/// \brief 局部修改上传时，间隔不超过该数量元素的修改范围合并为一次拷贝
+	static constexpr int32 DirtyRangeMaxGap = 16;
+
+	/// \brief 把数组中修改的范围写入缓冲区
+	static void UploadDirtyRanges(FRDGBuilder& GraphBuilder, const TRefCountPtr<FRDGPooledBuffer>& InPooledBuffer, TConstArrayView<uint32> InData, FSurfaceDirtyRanges& InOutDirtyRanges)
+	{
+		if (InOutDirtyRanges.IsEmpty())
+		{
+			return;
+		}
+
+		InOutDirtyRanges.Normalize(DirtyRangeMaxGap);
+		FRDGBufferRef Buffer = GraphBuilder.RegisterExternalBuffer(InPooledBuffer);
+		for (const FSurfaceDirtyRanges::FRange& Range : InOutDirtyRanges.GetRanges())
+		{
+			FSurfaceBufferUpload::AddRangeUpload(GraphBuilder, Buffer, static_cast<uint64>(Range.Start) * sizeof(uint32),
+				InData.GetData() + Range.Start, sizeof(uint32), Range.Num);
+		}
+		InOutDirtyRanges.Reset();
+	}
+}
+
+FSurfacePolygonArenas::FSurfacePolygonArenas()
+	: Nodes(TEXT("SurfacePolygonBVHNodesArena"), sizeof(FGPUPolygonBVHNode))
+	, Packets(TEXT("SurfacePolygonPacketsArena"), sizeof(FGPUTrianglePacket))
+{
+}
+
+void FSurfacePolygonArenas::Allocate(const FGPUPolygonData& InData, FSurfacePolygonAllocations& OutAllocations)
+{
+	OutAllocations.Nodes = Nodes.Allocate(InData.Nodes.Num());
+	OutAllocations.Packets = Packets.Allocate(InData.Packets.Num());
+}
+
+void FSurfacePolygonArenas::Free(FSurfacePolygonAllocations& InOutAllocations)
+{
+	Nodes.Free(InOutAllocations.Nodes);
+	Packets.Free(InOutAllocations.Packets);
+}
+
+void FSurfacePolygonArenas::Defragment(FRDGBuilder& GraphBuilder)
+{
+	Nodes.Defragment(GraphBuilder);
+	Packets.Defragment(GraphBuilder);
+}
+
+void FSurfacePolygonArenas::ResetSRVs()
+{
+	Nodes.ResetSRV();
+	Packets.ResetSRV();
+}
+
+void FSurfacePolygonArenas::Release()
+{
+	Nodes.Release();
+	Packets.Release();
+}
+
 // 着色器管理器实例初始化
 FSurfacePolygonRenderManager* FSurfacePolygonRenderManager::Instance = nullptr;
 
@@ -58,22 +271,39 @@ FSurfacePolygonRenderManager::~FSurfacePolygonRenderManager()
 {
 	// 确保渲染结束
 	EndRendering();
+
+	// 代理列表和池化缓冲区归渲染线程所有，排在已提交的注册/注销命令之后释放，并等待释放完成
+	ENQUEUE_RENDER_COMMAND(ReleaseSurfacePolygonRenderManager)(
+		[this](FRHICommandList& RHICmdList)
+		{
+			for (const TSharedPtr<FSurfacePolygonSceneProxy>& SceneProxy : SceneProxies)
+			{
+				SceneProxy->ReleasePooledBuffers(Arenas);
+			}
+			SceneProxies.Empty();
+			Arenas.Release();
+		});
+	FlushRenderingCommands();
 }
 
 void FSurfacePolygonRenderManager::RegisterSceneProxy(const TSharedPtr<FSurfacePolygonSceneProxy>& InSceneProxy)
 {
 	if (InSceneProxy.IsValid())
 	{
-		FScopeLock Lock(&RenderThreadLock);
-
 		// 分配唯一ID
 		uint32 NewProxyId = NextProxyId++;
 		InSceneProxy->ProxyId = NewProxyId;
 
 		// 检查是否是第一个代理
-		bool bWasEmpty = SceneProxyMap.IsEmpty();
+		bool bWasEmpty = RegisteredProxyIds.IsEmpty();
+		RegisteredProxyIds.Add(NewProxyId);
 
-		SceneProxyMap.Add(NewProxyId, InSceneProxy);
+		// 代理列表归渲染线程所有，渲染命令按提交顺序执行
+		ENQUEUE_RENDER_COMMAND(AddSurfacePolygonSceneProxy)(
+			[this, InSceneProxy](FRHICommandList& RHICmdList)
+			{
+				AddSceneProxy_RenderThread(InSceneProxy);
+			});
 
 		// 如果是第一个代理，开始渲染
 		if (bWasEmpty)
@@ -85,34 +315,20 @@ void FSurfacePolygonRenderManager::RegisterSceneProxy(const TSharedPtr<FSurfaceP
 
 void FSurfacePolygonRenderManager::UnregisterSceneProxy(uint32 ProxyId)
 {
-	TSharedPtr<FSurfacePolygonSceneProxy> SceneProxyToRemove;
-	bool bMapIsEmpty = false;
-
+	if (RegisteredProxyIds.Remove(ProxyId) == 0)
 	{
-		FScopeLock Lock(&RenderThreadLock);
-
-		if (SceneProxyMap.RemoveAndCopyValue(ProxyId, SceneProxyToRemove))
-		{
-			bMapIsEmpty = SceneProxyMap.IsEmpty();
-		}
-		else
-		{
-			bMapIsEmpty = SceneProxyMap.IsEmpty();
-		}
+		return;
 	}
 
-	if (SceneProxyToRemove.IsValid())
-	{
-		// 在渲染线程释放资源
-		ENQUEUE_RENDER_COMMAND(ReleaseSurfacePolygonResources)(
-			[SceneProxyToRemove](FRHICommandList& RHICmdList)
-			{
-				SceneProxyToRemove->ReleasePooledBuffers();
-			});
-	}
+	// 在渲染线程移除代理并释放资源
+	ENQUEUE_RENDER_COMMAND(RemoveSurfacePolygonSceneProxy)(
+		[this, ProxyId](FRHICommandList& RHICmdList)
+		{
+			RemoveSceneProxy_RenderThread(ProxyId);
+		});
 
-	// 如果Map为空，停止渲染
-	if (bMapIsEmpty)
+	// 如果没有代理，停止渲染
+	if (RegisteredProxyIds.IsEmpty())
 	{
 		EndRendering();
 	}
@@ -120,9 +336,38 @@ void FSurfacePolygonRenderManager::UnregisterSceneProxy(uint32 ProxyId)
 
 int32 FSurfacePolygonRenderManager::GetNumSceneProxies()
 {
-	FScopeLock Lock(&RenderThreadLock);
+	return RegisteredProxyIds.Num();
+}
+
+void FSurfacePolygonRenderManager::AddSceneProxy_RenderThread(const TSharedPtr<FSurfacePolygonSceneProxy>& InSceneProxy)
+{
+	check(IsInRenderingThread());
 
-	return SceneProxyMap.Num();
+	// ProxyId递增，追加即保持注册顺序
+	SceneProxies.Add(InSceneProxy);
+}
+
+void FSurfacePolygonRenderManager::RemoveSceneProxy_RenderThread(uint32 ProxyId)
+{
+	check(IsInRenderingThread());
+
+	const int32 ProxyIndex = SceneProxies.IndexOfByPredicate([ProxyId](const TSharedPtr<FSurfacePolygonSceneProxy>& SceneProxy)
+		{
+			return SceneProxy->GetProxyId() == ProxyId;
+		});
+	if (ProxyIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	SceneProxies[ProxyIndex]->ReleasePooledBuffers(Arenas);
+	SceneProxies.RemoveAt(ProxyIndex);
+
+	// 没有代理时释放共享缓冲区
+	if (SceneProxies.IsEmpty())
+	{
+		Arenas.Release();
+	}
 }
 
 void FSurfacePolygonRenderManager::BeginRendering()
@@ -161,6 +406,16 @@ void FSurfacePolygonRenderManager::EndRendering()
 	OnOverlayRenderHandle.Reset();
 }
 
+template <typename ParametersType>
+void FSurfacePolygonRenderManager::SetGeometryParameters(FRDGBuilder& GraphBuilder, const FSurfacePolygonSceneProxy& SceneProxy, ParametersType* PassParameters)
+{
+	// 所有代理共用同一组缓冲区，节点和三角形包索引仍相对代理，着色器读取时加上偏移
+	PassParameters->PolygonBVHNodeData = Arenas.Nodes.GetSRV(GraphBuilder);
+	PassParameters->TrianglePacketData = Arenas.Packets.GetSRV(GraphBuilder);
+	PassParameters->ProxyNodeOffset = Arenas.Nodes.GetOffset(SceneProxy.Allocations.Nodes);
+	PassParameters->ProxyPacketOffset = Arenas.Packets.GetOffset(SceneProxy.Allocations.Packets);
+}
+
 void FSurfacePolygonRenderManager::Execute_RenderThread(FPostOpaqueRenderParameters& Parameters)
 {
 	// 检查是否在渲染线程
@@ -177,34 +432,96 @@ void FSurfacePolygonRenderManager::Execute_RenderThread(FPostOpaqueRenderParamet
 		}
 	}
 
-	// 复制SceneProxyMap为本地Proxies
-	FScopeLock Lock(&RenderThreadLock);
-	if (SceneProxyMap.IsEmpty())
+	// 代理列表仅渲染线程访问，直接遍历
+	if (SceneProxies.IsEmpty())
 	{
 		return;
 	}
-	TArray<TSharedPtr<FSurfacePolygonSceneProxy>> ProxiesToRender;
-	for (auto& ProxyPair : SceneProxyMap)
-	{
-		if (ProxyPair.Value.IsValid())
+
+	// 模板阴影体模式共用的深度模板缓冲区
+	FRDGTextureRef PrismDepthTexture = nullptr;
+
+	// 覆盖缓存只用于主视图
+	const bool bIsMainView = SceneView->Family->Views.Num() > 0 && SceneView->Family->Views[0] == SceneView;
+	const bool bCoverageCache = bIsMainView && FSurfaceCoverageCache::IsEnabled();
+
+	// 降分辨率，覆盖缓存开启时不生效
+	const int32 ReductionFactor = bCoverageCache ? 1 : FSurfaceReducedResolution::GetReductionFactor();
+	const bool bReducedResolution = ReductionFactor > 1;
+
+	// 为每个场景代理创建渲染Pass，共享缓冲区的SRV在本次渲染中复用
+	FRDGBuilder& GraphBuilder = *Parameters.GraphBuilder;
+	Arenas.ResetSRVs();
+	bool bUploadPending = false;
+	for (const TSharedPtr<FSurfacePolygonSceneProxy>& LocalSceneProxy : SceneProxies)
+	{ 
+		if (!LocalSceneProxy.IsValid())
 		{
-			ProxiesToRender.Add(ProxyPair.Value);
+			continue;
 		}
-	}
-	Lock.Unlock();
 
-	// 为每个场景代理创建渲染Pass
-	for (TSharedPtr<FSurfacePolygonSceneProxy> LocalSceneProxy : ProxiesToRender)
-	{ 
-		if (!LocalSceneProxy.IsValid() || !LocalSceneProxy->GPUPolygonData.IsValid() || !LocalSceneProxy->GPUPolygonData->IsValid())
+		// 推进几何数据的分帧上传，完成前继续使用旧数据和旧的分配
+		LocalSceneProxy->InitializePooledBuffers(GraphBuilder, Arenas);
+		bUploadPending |= LocalSceneProxy->bUploadPending;
+
+		if (!LocalSceneProxy->GPUPolygonData.IsValid() || !LocalSceneProxy->GPUPolygonData->IsValid())
+		{
+			continue;
+		}
+
+		if (!LocalSceneProxy->LayerMasks.IsValid() || !LocalSceneProxy->LayerMasks->IsValid())
+		{
+			continue;
+		}
+
+		// 所有图层均不可见
+		if (LocalSceneProxy->VisibleLayers == 0)
+		{
+			continue;
+		}
+
+		// 初始化图层掩码缓冲区；首次上传完成前不渲染
+		LocalSceneProxy->InitializeLayerBuffers(GraphBuilder);
+		if (!LocalSceneProxy->bBuffersInitialized)
 		{
 			continue;
 		}
 
-		FRDGBuilder& GraphBuilder = *Parameters.GraphBuilder;
+		// 多边形ID纹理，仅主视图输出
+		FRDGTextureRef PolygonIdTexture = nullptr;
+		if (LocalSceneProxy->PolygonIdPicker.IsValid() && bIsMainView)
+		{
+			PolygonIdTexture = FSurfacePolygonIdPicker::CreateIdTexture(GraphBuilder, Parameters.ColorTexture->Desc.Extent);
+		}
+
+		// 完全在屏幕外的代理不添加Pass；开启拾取时回读清空的ID纹理，使光标下的多边形随之清除
+		FIntRect ScissorRect;
+		if (!LocalSceneProxy->CalculateScissorRect(Parameters.ViewMatrix * Parameters.ProjMatrix, Parameters.ViewportRect, ScissorRect))
+		{
+			if (PolygonIdTexture)
+			{
+				AddClearRenderTargetPass(GraphBuilder, PolygonIdTexture);
+				LocalSceneProxy->PolygonIdPicker->AddReadbackPasses(GraphBuilder, PolygonIdTexture, Parameters.ViewportRect);
+			}
+			continue;
+		}
+
+		// 模板阴影体模式：开销与覆盖面积成正比，不逐像素遍历BVH
+		if (LocalSceneProxy->UseStencilVolume())
+		{
+			AddStencilVolumePasses(GraphBuilder, Parameters, *LocalSceneProxy, PrismDepthTexture, PolygonIdTexture);
+			if (PolygonIdTexture && PolygonIdTexture->HasBeenProduced())
+			{
+				LocalSceneProxy->PolygonIdPicker->AddReadbackPasses(GraphBuilder, PolygonIdTexture, Parameters.ViewportRect);
+			}
+			continue;
+		}
 
-		// 初始化持久化缓冲区
-		LocalSceneProxy->InitializePooledBuffers(GraphBuilder);
+		// 分块计算模式：拾取、覆盖缓存和降分辨率仍由像素着色器输出
+		if (LocalSceneProxy->UseTiledCompute() && !PolygonIdTexture && !bCoverageCache && !bReducedResolution && AddTiledComputePass(GraphBuilder, Parameters, *LocalSceneProxy, ScissorRect))
+		{
+			continue;
+		}
 
 		// 设置着色器参数
 		FSurfacePolygonRenderPS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfacePolygonRenderPS::FParameters>();
@@ -217,16 +534,26 @@ void FSurfacePolygonRenderManager::Execute_RenderThread(FPostOpaqueRenderParamet
 		FRDGTextureSRVRef ColorTextureSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.ColorTexture));
 		PassParameters->ColorTexture = ColorTextureSRV;
 
-		// 使用持久化缓冲区
+		// 共享几何缓冲区及本代理的偏移
 		if (LocalSceneProxy->bBuffersInitialized)
 		{
-			// 注册持久化缓冲区到当前帧的RDG
-			FRDGBuffer* BVHNodesRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->BVHNodesPooledBuffer);
-			PassParameters->PolygonBVHNodeData = GraphBuilder.CreateSRV(BVHNodesRDGBuffer);
+			SetGeometryParameters(GraphBuilder, *LocalSceneProxy, PassParameters);
+		}
+		if (LocalSceneProxy->bLayerBuffersInitialized)
+		{
+			FRDGBuffer* PolygonLayerMasksRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->PolygonLayerMasksPooledBuffer);
+			PassParameters->PolygonLayerMaskData = GraphBuilder.CreateSRV(PolygonLayerMasksRDGBuffer);
 
-			FRDGBuffer* TrianglesRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->TrianglesPooledBuffer);
-			PassParameters->TriangleData = GraphBuilder.CreateSRV(TrianglesRDGBuffer);
+			FRDGBuffer* NodeLayerMasksRDGBuffer = GraphBuilder.RegisterExternalBuffer(LocalSceneProxy->NodeLayerMasksPooledBuffer);
+			PassParameters->NodeLayerMaskData = GraphBuilder.CreateSRV(NodeLayerMasksRDGBuffer);
 		}
+		PassParameters->VisibleLayers = LocalSceneProxy->VisibleLayers;
+
+		// 按视图覆盖范围剔除后剩余的子树，全部剔除时着色器不遍历
+		TArray<uint32> SeedNodes;
+		LocalSceneProxy->CalculateSeedNodes(Parameters.ViewMatrix * Parameters.ProjMatrix, Parameters.ViewportRect, SeedNodes);
+		PassParameters->SeedNodeData = FSurfaceFrustumCulling::CreateSeedNodesSRV(GraphBuilder, TEXT("SurfacePolygonSeedNodes"), SeedNodes);
+		PassParameters->NumSeedNodes = SeedNodes.Num();
 
 		// 计算屏幕位置到世界位置的变换矩阵
 		FMatrix InvViewProjMatrix = (Parameters.ViewMatrix * Parameters.ProjMatrix).Inverse();
@@ -245,9 +572,55 @@ void FSurfacePolygonRenderManager::Execute_RenderThread(FPostOpaqueRenderParamet
 
 		// 绑定输出渲染目标
 		PassParameters->RenderTargets[0] = FRenderTargetBinding(Parameters.ColorTexture, Parameters.ColorTexture->HasBeenProduced() ? ERenderTargetLoadAction::ELoad : ERenderTargetLoadAction::ENoAction);
+		if (PolygonIdTexture)
+		{
+			PassParameters->RenderTargets[1] = FRenderTargetBinding(PolygonIdTexture, ERenderTargetLoadAction::EClear);
+		}
+
+		// 覆盖结果只取决于视图、屏幕范围、几何和图层缓冲区以及可见图层；颜色和不透明度每帧重新合成
+		if (bCoverageCache)
+		{
+			FSurfaceCoverageCacheKey CacheKey;
+			CacheKey.ViewProjMatrix = FSurfaceCoverageCache::GetUnjitteredViewProjection(*SceneView);
+			CacheKey.ViewportRect = Parameters.ViewportRect;
+			CacheKey.ScissorRect = ScissorRect;
+			CacheKey.TextureExtent = Parameters.ColorTexture->Desc.Extent;
+			CacheKey.GeometryGeneration = LocalSceneProxy->BufferGeneration;
+			CacheKey.AttributeGeneration = LocalSceneProxy->LayerBufferGeneration;
+			CacheKey.Parameters = LocalSceneProxy->VisibleLayers;
+			LocalSceneProxy->CoverageCache.AddCoverageTexture(GraphBuilder, CacheKey, PassParameters->CoverageCache);
+		}
+
+		// 降分辨率：先在屏幕范围对应的低分辨率矩形内分类，全分辨率Pass再读取分类结果
+		if (bReducedResolution)
+		{
+			const FIntRect ReducedRect = FSurfaceReducedResolution::GetReducedRect(ScissorRect, Parameters.ViewportRect, ReductionFactor);
+			FRDGTextureRef ReducedCoverageTexture = FSurfaceReducedResolution::CreateCoverageTexture(
+				GraphBuilder, Parameters.ColorTexture->Desc.Extent, ReducedRect, ReductionFactor, PassParameters->ReducedResolution);
+
+			// 分类Pass与全分辨率Pass共用参数，只替换渲染目标
+			FSurfacePolygonRenderPS::FParameters* ReducedPassParameters = GraphBuilder.AllocParameters<FSurfacePolygonRenderPS::FParameters>();
+			*ReducedPassParameters = *PassParameters;
+			ReducedPassParameters->ReducedResolution.ReducedCoverageTexture = nullptr;
+			ReducedPassParameters->RenderTargets = FRenderTargetBindingSlots();
+			ReducedPassParameters->RenderTargets[0] = FRenderTargetBinding(ReducedCoverageTexture, ERenderTargetLoadAction::ENoAction);
+
+			TShaderMapRef<FSurfacePolygonReducedPS> ReducedPixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+			FPixelShaderUtils::AddFullscreenPass(
+				GraphBuilder,
+				GetGlobalShaderMap(GMaxRHIFeatureLevel),
+				RDG_EVENT_NAME("SurfacePolygonReduced_%d(1/%d)", LocalSceneProxy->GetProxyId(), ReductionFactor),
+				ReducedPixelShader,
+				ReducedPassParameters,
+				ReducedRect);
+		}
 
 		// 获取着色器
-		TShaderMapRef<FSurfacePolygonRenderPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+		FSurfacePolygonRenderPS::FPermutationDomain PermutationVector;
+		PermutationVector.Set<FSurfacePolygonRenderPS::FWritePolygonIdDim>(PolygonIdTexture != nullptr);
+		PermutationVector.Set<FSurfacePolygonRenderPS::FCoverageCacheDim>(bCoverageCache);
+		PermutationVector.Set<FSurfacePolygonRenderPS::FReducedResolutionDim>(bReducedResolution);
+		TShaderMapRef<FSurfacePolygonRenderPS> PixelShader(GetGlobalShaderMap(GMaxRHIFeatureLevel), PermutationVector);
 
 		// 添加全屏pass
 		FPixelShaderUtils::AddFullscreenPass(
@@ -256,57 +629,361 @@ void FSurfacePolygonRenderManager::Execute_RenderThread(FPostOpaqueRenderParamet
 			RDG_EVENT_NAME("SurfacePolygonRender_%d", LocalSceneProxy->GetProxyId()),
 			PixelShader,
 			PassParameters,
-			FIntRect(),
+			ScissorRect,
 			TStaticBlendState<>::GetRHI(),
 			TStaticRasterizerState<>::GetRHI(),
 			TStaticDepthStencilState<>::GetRHI()
 			);
+
+		if (PolygonIdTexture)
+		{
+			LocalSceneProxy->PolygonIdPicker->AddReadbackPasses(GraphBuilder, PolygonIdTexture, Parameters.ViewportRect);
+		}
+	}
+
+	// 没有上传进行中时整理共享缓冲区；整理到新的缓冲区，本帧已添加的Pass仍读取旧缓冲区和旧偏移
+	if (!bUploadPending)
+	{
+		Arenas.Defragment(GraphBuilder);
 	}
 }
 
-void FSurfacePolygonSceneProxy::InitializePooledBuffers(FRDGBuilder& GraphBuilder)
+void FSurfacePolygonRenderManager::AddStencilVolumePasses(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfacePolygonSceneProxy& SceneProxy, FRDGTextureRef& InOutPrismDepthTexture, FRDGTextureRef InPolygonIdTexture)
 {
-	if (bBuffersInitialized)
+	SceneProxy.InitializePrismBuffers(GraphBuilder);
+	if (!SceneProxy.bPrismBuffersInitialized || !SceneProxy.bLayerBuffersInitialized)
 	{
 		return;
 	}
 
-	// BVH节点数据
-	FRDGBufferDesc BVHNodesDesc = FRDGBufferDesc::CreateStructuredDesc(sizeof(FGPUPolygonBVHNode), GPUPolygonData->Nodes.Num());
-	auto test1 = GPUPolygonData->Nodes.Num() * sizeof(FGPUPolygonBVHNode);
+	FGlobalShaderMap* GlobalShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
 
-	FRDGBuffer* BVHNodesBuffer = GraphBuilder.CreateBuffer(BVHNodesDesc, TEXT("BVHNodesBuffer"));
+	// 场景深度复制到独立的深度模板缓冲区并清空模板，避免改写引擎的场景模板
+	if (!InOutPrismDepthTexture)
+	{
+		FRDGTextureDesc PrismDepthDesc = FRDGTextureDesc::Create2D(
+			Parameters.DepthTexture->Desc.Extent,
+			PF_DepthStencil,
+			FClearValueBinding::DepthFar,
+			TexCreate_DepthStencilTargetable);
+		InOutPrismDepthTexture = GraphBuilder.CreateTexture(PrismDepthDesc, TEXT("SurfacePolygonPrismDepth"));
+
+		FSurfacePolygonCopyDepthPS::FParameters* CopyDepthParameters = GraphBuilder.AllocParameters<FSurfacePolygonCopyDepthPS::FParameters>();
+		CopyDepthParameters->DepthTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.DepthTexture));
+		CopyDepthParameters->RenderTargets.DepthStencil = FDepthStencilBinding(
+			InOutPrismDepthTexture,
+			ERenderTargetLoadAction::ENoAction,
+			ERenderTargetLoadAction::EClear,
+			FExclusiveDepthStencil::DepthWrite_StencilWrite);
+
+		TShaderMapRef<FSurfacePolygonCopyDepthPS> CopyDepthShader(GlobalShaderMap);
+		FPixelShaderUtils::AddFullscreenPass(
+			GraphBuilder,
+			GlobalShaderMap,
+			RDG_EVENT_NAME("SurfacePolygonPrismCopyDepth"),
+			CopyDepthShader,
+			CopyDepthParameters,
+			FIntRect(FIntPoint::ZeroValue, Parameters.DepthTexture->Desc.Extent),
+			TStaticBlendState<>::GetRHI(),
+			TStaticRasterizerState<>::GetRHI(),
+			TStaticDepthStencilState<true, CF_Always>::GetRHI());
+	}
+
+	FSurfacePolygonPrismPassParameters* PassParameters = GraphBuilder.AllocParameters<FSurfacePolygonPrismPassParameters>();
+	PassParameters->VS.PrismVertexData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.PrismVerticesPooledBuffer));
+	PassParameters->VS.PrismIndexData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.PrismIndicesPooledBuffer));
+	PassParameters->VS.PolygonLayerMaskData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.PolygonLayerMasksPooledBuffer));
+	PassParameters->VS.WorldToClip = FMatrix44f(Parameters.ViewMatrix * Parameters.ProjMatrix);
+	PassParameters->VS.VisibleLayers = SceneProxy.VisibleLayers;
+	PassParameters->PS.Color = SceneProxy.Color;
+	PassParameters->PS.Opacity = SceneProxy.Opacity;
+	PassParameters->RenderTargets[0] = FRenderTargetBinding(Parameters.ColorTexture, ERenderTargetLoadAction::ELoad);
+	if (InPolygonIdTexture)
+	{
+		PassParameters->RenderTargets[1] = FRenderTargetBinding(InPolygonIdTexture, ERenderTargetLoadAction::EClear);
+	}
+	PassParameters->RenderTargets.DepthStencil = FDepthStencilBinding(
+		InOutPrismDepthTexture,
+		ERenderTargetLoadAction::ELoad,
+		ERenderTargetLoadAction::ELoad,
+		FExclusiveDepthStencil::DepthRead_StencilWrite);
+
+	TShaderMapRef<FSurfacePolygonPrismVS> VertexShader(GlobalShaderMap);
+	FSurfacePolygonPrismShadePS::FPermutationDomain PermutationVector;
+	PermutationVector.Set<FSurfacePolygonPrismShadePS::FWritePolygonIdDim>(InPolygonIdTexture != nullptr);
+	TShaderMapRef<FSurfacePolygonPrismShadePS> PixelShader(GlobalShaderMap, PermutationVector);
+	const FIntRect ViewportRect = Parameters.ViewportRect;
+	const uint32 NumPrimitives = SceneProxy.PrismMesh->NumTriangles();
+
+	// 第一遍：深度失败（Carmack's reverse）标记模板，正面减、背面加，被棱柱包围的场景像素模板值非零。
+	// 只比较是否为零，因此与棱柱的绕序约定无关，摄像机位于棱柱内部时同样正确
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("SurfacePolygonPrismStencil_%d", SceneProxy.GetProxyId()),
+		PassParameters,
+		ERDGPassFlags::Raster,
+		[PassParameters, VertexShader, ViewportRect, NumPrimitives](FRHICommandList& RHICmdList)
+		{
+			RHICmdList.SetViewport(ViewportRect.Min.X, ViewportRect.Min.Y, 0.0f, ViewportRect.Max.X, ViewportRect.Max.Y, 1.0f);
+
+			FGraphicsPipelineStateInitializer GraphicsPSOInit;
+			RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+			GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+			GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+			GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+			GraphicsPSOInit.BlendState = TStaticBlendState<
+				CW_NONE, BO_Add, BF_One, BF_Zero, BO_Add, BF_One, BF_Zero,
+				CW_NONE>::GetRHI();
+			GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+			GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<
+				false, CF_DepthNearOrEqual,
+				true, CF_Always, SO_Keep, SO_Decrement, SO_Keep,
+				true, CF_Always, SO_Keep, SO_Increment, SO_Keep>::GetRHI();
+			SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+
+			SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), PassParameters->VS);
+
+			RHICmdList.DrawPrimitive(0, NumPrimitives, 1);
+		});
+
+	// 第二遍：只着色模板非零的像素，着色后清零，每个像素只混合一次，模板恢复为零供下一个代理使用
+	GraphBuilder.AddPass(
+		RDG_EVENT_NAME("SurfacePolygonPrismShade_%d", SceneProxy.GetProxyId()),
+		PassParameters,
+		ERDGPassFlags::Raster,
+		[PassParameters, VertexShader, PixelShader, ViewportRect, NumPrimitives](FRHICommandList& RHICmdList)
+		{
+			RHICmdList.SetViewport(ViewportRect.Min.X, ViewportRect.Min.Y, 0.0f, ViewportRect.Max.X, ViewportRect.Max.Y, 1.0f);
+
+			FGraphicsPipelineStateInitializer GraphicsPSOInit;
+			RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+			GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+			GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+			GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+			GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+			// ID纹理（若有）直接写入，不混合
+			GraphicsPSOInit.BlendState = TStaticBlendState<
+				CW_RGB, BO_Add, BF_SourceAlpha, BF_InverseSourceAlpha, BO_Add, BF_One, BF_Zero,
+				CW_RED, BO_Add, BF_One, BF_Zero, BO_Add, BF_One, BF_Zero>::GetRHI();
+			GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+			GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<
+				false, CF_Always,
+				true, CF_NotEqual, SO_Keep, SO_Keep, SO_Zero,
+				true, CF_NotEqual, SO_Keep, SO_Keep, SO_Zero>::GetRHI();
+			SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+
+			SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), PassParameters->VS);
+			SetShaderParameters(RHICmdList, PixelShader, PixelShader.GetPixelShader(), PassParameters->PS);
+
+			RHICmdList.DrawPrimitive(0, NumPrimitives, 1);
+		});
+}
+
+bool FSurfacePolygonRenderManager::AddTiledComputePass(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfacePolygonSceneProxy& SceneProxy, const FIntRect& ScissorRect)
+{
+	if (!SceneProxy.bBuffersInitialized || !SceneProxy.bLayerBuffersInitialized)
+	{
+		return false;
+	}
+
+	// 场景颜色需要支持UAV及其类型化读取，否则退回像素着色器
+	const FRDGTextureDesc& ColorDesc = Parameters.ColorTexture->Desc;
+	if (!EnumHasAnyFlags(ColorDesc.Flags, TexCreate_UAV) || !RHIIsTypedUAVLoadSupported(ColorDesc.Format))
+	{
+		return false;
+	}
+
+	FSurfacePolygonTiledCS::FParameters* PassParameters = GraphBuilder.AllocParameters<FSurfacePolygonTiledCS::FParameters>();
+	PassParameters->DepthTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::Create(Parameters.DepthTexture));
+	PassParameters->RWColorTexture = GraphBuilder.CreateUAV(Parameters.ColorTexture);
+	SetGeometryParameters(GraphBuilder, SceneProxy, PassParameters);
+	PassParameters->PolygonLayerMaskData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.PolygonLayerMasksPooledBuffer));
+	PassParameters->NodeLayerMaskData = GraphBuilder.CreateSRV(GraphBuilder.RegisterExternalBuffer(SceneProxy.NodeLayerMasksPooledBuffer));
+	PassParameters->VisibleLayers = SceneProxy.VisibleLayers;
+
+	// 分块自行剔除BVH，溢出的分块逐像素从根节点遍历
+	const uint32 RootSeedNode = 0;
+	PassParameters->SeedNodeData = FSurfaceFrustumCulling::CreateSeedNodesSRV(GraphBuilder, TEXT("SurfacePolygonSeedNodes"), MakeArrayView(&RootSeedNode, 1));
+	PassParameters->NumSeedNodes = 1;
+	PassParameters->ScreenToWorld = FMatrix44f((Parameters.ViewMatrix * Parameters.ProjMatrix).Inverse());
+	PassParameters->ViewportRect = Parameters.ViewportRect;
+	PassParameters->ScissorRect = FSurfaceTileCulling::AlignScissorRect(Parameters.ViewportRect, ScissorRect);
+	PassParameters->Opacity = SceneProxy.Opacity;
+	PassParameters->Color = SceneProxy.Color;
+
+	TShaderMapRef<FSurfacePolygonTiledCS> ComputeShader(GetGlobalShaderMap(GMaxRHIFeatureLevel));
+	FComputeShaderUtils::AddPass(
+		GraphBuilder,
+		RDG_EVENT_NAME("SurfacePolygonRenderTiled_%d", SceneProxy.GetProxyId()),
+		ComputeShader,
+		PassParameters,
+		FComputeShaderUtils::GetGroupCount(PassParameters->ScissorRect.Size(), FSurfaceTileCulling::TileSize));
+
+	return true;
+}
+
+void FSurfacePolygonSceneProxy::CalculateSeedNodes(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, TArray<uint32>& OutSeedNodes) const
+{
+	FSurfaceFrustumCulling::CalculatePolygonSeedNodes(*GPUPolygonData, LayerMasks->NodeLayerMasks, VisibleLayers, InViewProjMatrix, InViewportRect, OutSeedNodes);
+}
+
+bool FSurfacePolygonSceneProxy::CalculateScissorRect(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, FIntRect& OutScissorRect) const
+{
+	const FGPUPolygonBVHNode& RootNode = GPUPolygonData->Nodes[GPUPolygonData->RootNodeIndex];
+	return FSurfaceScreenBounds::CalculateScissorRect(InViewProjMatrix, InViewportRect, RootNode.MinExtent, RootNode.MaxExtent, 0.0f, 0.0f, OutScissorRect);
+}
+
+void FSurfacePolygonSceneProxy::InitializePooledBuffers(FRDGBuilder& GraphBuilder, FSurfacePolygonArenas& Arenas)
+{
+	if (!bUploadPending)
+	{
+		return;
+	}
+
+	// 新数据为空时直接替换，不再渲染
+	if (!PendingGPUPolygonData.IsValid() || !PendingGPUPolygonData->IsValid())
+	{
+		GPUPolygonData = MoveTemp(PendingGPUPolygonData);
+		LayerMasks = MoveTemp(PendingLayerMasks);
+		Arenas.Free(Allocations);
+		Arenas.Free(PendingAllocations);
+		PendingUpload.Reset();
+		bUploadPending = false;
+		bBuffersInitialized = false;
+		bLayerBuffersInitialized = false;
+		return;
+	}
+
+	if (!PendingUpload.IsActive())
+	{
+		// 新数据写入新的分配，完成前旧的分配继续用于渲染；被中断的上一次上传的分配在这里回收
+		Arenas.Free(PendingAllocations);
+		Arenas.Allocate(*PendingGPUPolygonData, PendingAllocations);
+
+		const FSurfaceBufferUploadSource Sources[] =
+		{
+			{ &Arenas.Nodes, PendingAllocations.Nodes, PendingGPUPolygonData->Nodes.GetData(), PendingGPUPolygonData->Nodes.Num() },
+			{ &Arenas.Packets, PendingAllocations.Packets, PendingGPUPolygonData->Packets.GetData(), PendingGPUPolygonData->Packets.Num() },
+		};
+		PendingUpload.Begin(Sources);
+	}
+
+	if (!PendingUpload.Advance(GraphBuilder))
+	{
+		return;
+	}
+
+	// 全部上传后一起替换，图层掩码随新数据在本帧重新上传
+	GPUPolygonData = MoveTemp(PendingGPUPolygonData);
+	LayerMasks = MoveTemp(PendingLayerMasks);
+	Arenas.Free(Allocations);
+	Allocations = PendingAllocations;
+	PendingAllocations = FSurfacePolygonAllocations();
+	PendingUpload.Reset();
+	bUploadPending = false;
+	bBuffersInitialized = true;
+	bLayerBuffersInitialized = false;
+	++BufferGeneration;
+}
+
+void FSurfacePolygonSceneProxy::InitializeLayerBuffers(FRDGBuilder& GraphBuilder)
+{
+	// 缓冲区大小不变，只写入修改的多边形和节点
+	if (bLayerBuffersInitialized)
+	{
+		if (!PendingLayerDirtyRanges.IsEmpty())
+		{
+			SurfacePolygonRenderer::UploadDirtyRanges(GraphBuilder, PolygonLayerMasksPooledBuffer, LayerMasks->PolygonLayerMasks, PendingLayerDirtyRanges.Polygons);
+			SurfacePolygonRenderer::UploadDirtyRanges(GraphBuilder, NodeLayerMasksPooledBuffer, LayerMasks->NodeLayerMasks, PendingLayerDirtyRanges.Nodes);
+			++LayerBufferGeneration;
+		}
+		return;
+	}
+
+	PendingLayerDirtyRanges.Reset();
+
+	// 多边形图层掩码
+	FRDGBufferDesc PolygonLayerMasksDesc = FRDGBufferDesc::CreateStructuredDesc(sizeof(uint32), LayerMasks->PolygonLayerMasks.Num());
+	FRDGBuffer* PolygonLayerMasksBuffer = GraphBuilder.CreateBuffer(PolygonLayerMasksDesc, TEXT("PolygonLayerMasksBuffer"));
 	GraphBuilder.QueueBufferUpload(
-		BVHNodesBuffer,
-		GPUPolygonData->Nodes.GetData(),
-		GPUPolygonData->Nodes.Num() * sizeof(FGPUPolygonBVHNode)
+		PolygonLayerMasksBuffer,
+		LayerMasks->PolygonLayerMasks.GetData(),
+		LayerMasks->PolygonLayerMasks.Num() * sizeof(uint32)
 	);
-	// 转换为持久化缓冲区
-	BVHNodesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(BVHNodesBuffer);
+	PolygonLayerMasksPooledBuffer = GraphBuilder.ConvertToExternalBuffer(PolygonLayerMasksBuffer);
 
-	// 三角形数据
-	FRDGBufferDesc TrianglesDesc = FRDGBufferDesc::CreateStructuredDesc(sizeof(FGPUTriangle), GPUPolygonData->Triangles.Num());
-	FRDGBuffer* TrianglesBuffer = GraphBuilder.CreateBuffer(TrianglesDesc, TEXT("TrianglesBuffer"));
+	// 节点子树图层掩码
+	FRDGBufferDesc NodeLayerMasksDesc = FRDGBufferDesc::CreateStructuredDesc(sizeof(uint32), LayerMasks->NodeLayerMasks.Num());
+	FRDGBuffer* NodeLayerMasksBuffer = GraphBuilder.CreateBuffer(NodeLayerMasksDesc, TEXT("NodeLayerMasksBuffer"));
 	GraphBuilder.QueueBufferUpload(
-		TrianglesBuffer,
-		GPUPolygonData->Triangles.GetData(),
-		GPUPolygonData->Triangles.Num() * sizeof(FGPUTriangle)
+		NodeLayerMasksBuffer,
+		LayerMasks->NodeLayerMasks.GetData(),
+		LayerMasks->NodeLayerMasks.Num() * sizeof(uint32)
 	);
-	TrianglesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(TrianglesBuffer);
+	NodeLayerMasksPooledBuffer = GraphBuilder.ConvertToExternalBuffer(NodeLayerMasksBuffer);
 
-	bBuffersInitialized = true;
+	bLayerBuffersInitialized = true;
+	++LayerBufferGeneration;
 }
 
-void FSurfacePolygonSceneProxy::ReleasePooledBuffers()
+void FSurfacePolygonSceneProxy::InitializePrismBuffers(FRDGBuilder& GraphBuilder)
 {
-	if (BVHNodesPooledBuffer)
+	if (bPrismBuffersInitialized || !PrismMesh.IsValid() || !PrismMesh->IsValid())
+	{
+		return;
+	}
+
+	// 棱柱顶点
+	FRDGBufferDesc PrismVerticesDesc = FRDGBufferDesc::CreateStructuredDesc(sizeof(FPolygonPrismVertex), PrismMesh->Vertices.Num());
+	FRDGBuffer* PrismVerticesBuffer = GraphBuilder.CreateBuffer(PrismVerticesDesc, TEXT("PrismVerticesBuffer"));
+	GraphBuilder.QueueBufferUpload(
+		PrismVerticesBuffer,
+		PrismMesh->Vertices.GetData(),
+		PrismMesh->Vertices.Num() * sizeof(FPolygonPrismVertex)
+	);
+	PrismVerticesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(PrismVerticesBuffer);
+
+	// 棱柱索引
+	FRDGBufferDesc PrismIndicesDesc = FRDGBufferDesc::CreateStructuredDesc(sizeof(uint32), PrismMesh->Indices.Num());
+	FRDGBuffer* PrismIndicesBuffer = GraphBuilder.CreateBuffer(PrismIndicesDesc, TEXT("PrismIndicesBuffer"));
+	GraphBuilder.QueueBufferUpload(
+		PrismIndicesBuffer,
+		PrismMesh->Indices.GetData(),
+		PrismMesh->Indices.Num() * sizeof(uint32)
+	);
+	PrismIndicesPooledBuffer = GraphBuilder.ConvertToExternalBuffer(PrismIndicesBuffer);
+
+	bPrismBuffersInitialized = true;
+}
+
+void FSurfacePolygonSceneProxy::ReleasePooledBuffers(FSurfacePolygonArenas& Arenas)
+{
+	Arenas.Free(Allocations);
+	Arenas.Free(PendingAllocations);
+	if (PolygonLayerMasksPooledBuffer)
+	{
+		PolygonLayerMasksPooledBuffer.SafeRelease();
+	}
+	if (NodeLayerMasksPooledBuffer)
+	{
+		NodeLayerMasksPooledBuffer.SafeRelease();
+	}
+	if (PrismVerticesPooledBuffer)
+	{
+		PrismVerticesPooledBuffer.SafeRelease();
+	}
+	if (PrismIndicesPooledBuffer)
 	{
-		BVHNodesPooledBuffer.SafeRelease();
+		PrismIndicesPooledBuffer.SafeRelease();
 	}
-	if (TrianglesPooledBuffer)
+	if (PolygonIdPicker.IsValid())
 	{
-		TrianglesPooledBuffer.SafeRelease();
+		PolygonIdPicker->Release_RenderThread();
 	}
+	CoverageCache.Release_RenderThread();
+	PendingUpload.Reset();
+	PendingLayerDirtyRanges.Reset();
 
 	bBuffersInitialized = false;
+	bLayerBuffersInitialized = false;
+	bPrismBuffersInitialized = false;
 }
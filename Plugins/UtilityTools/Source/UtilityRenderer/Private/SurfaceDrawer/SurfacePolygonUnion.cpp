@@ -0,0 +1,519 @@
+﻿#include "SurfaceDrawer/SurfacePolygonUnion.h"
+
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfacePolygonUnion, Log, All);
+
+namespace SurfacePolygonUnion
+{
+	static constexpr int32 TrianglesPerTile = 2048;		///< 自动分块时每块的目标三角形数量
+	static constexpr int32 RingEdgesPerTile = 4096;		///< 三角化多边形环时每块的目标边数量
+	static constexpr double MinTriangleArea = 1e-8;		///< 面积低于该值的三角形视为退化
+	static constexpr double MinEdgeWidth = 1e-9;		///< X跨度低于该值的边视为竖直边，不参与区间计算
+	static constexpr double MinSlabWidth = 1e-7;		///< 条带最小宽度，避免交点误差产生过窄的条带
+	static constexpr double RelativeTieTolerance = 1e-6;	///< 条带起点处Y差值小于该相对容差时视为相交于起点，按终点Y排序
+
+	/// \brief 扫描边（X0 < X1），环绕值为从下向上穿过该边时覆盖次数的变化
+	struct FSweepEdge
+	{
+		double X0, Y0, Z0;
+		double X1, Y1, Z1;
+		int32 Winding;
+
+		FORCEINLINE double YAt(double X) const
+		{
+			return Y0 + (Y1 - Y0) * ((X - X0) / (X1 - X0));
+		}
+
+		FORCEINLINE double ZAt(double X) const
+		{
+			return Z0 + (Z1 - Z0) * ((X - X0) / (X1 - X0));
+		}
+	};
+
+	/// \brief 单个分块的输出
+	struct FTileOutput
+	{
+		TArray<FVector3f> Vertices;
+		TArray<uint32> Indices;
+		TArray<int32> PolygonIds;
+	};
+
+	/// \brief 输出梯形：由下边界边和上边界边在[XStart, XEnd]之间围成
+	static void EmitTrapezoid(const FSweepEdge& Bottom, const FSweepEdge& Top, double XStart, double XEnd, int32 PolygonId, FTileOutput& Out)
+	{
+		if (XEnd - XStart < MinSlabWidth)
+		{
+			return;
+		}
+
+		const FVector3f P0(FVector3d(XStart, Bottom.YAt(XStart), Bottom.ZAt(XStart)));
+		const FVector3f P1(FVector3d(XEnd, Bottom.YAt(XEnd), Bottom.ZAt(XEnd)));
+		const FVector3f P2(FVector3d(XEnd, Top.YAt(XEnd), Top.ZAt(XEnd)));
+		const FVector3f P3(FVector3d(XStart, Top.YAt(XStart), Top.ZAt(XStart)));
+
+		const bool bHasRightSide = P2.Y - P1.Y > MinEdgeWidth;
+		const bool bHasLeftSide = P3.Y - P0.Y > MinEdgeWidth;
+		if (!bHasRightSide && !bHasLeftSide)
+		{
+			return;
+		}
+
+		const uint32 BaseIndex = Out.Vertices.Num();
+		Out.Vertices.Add(P0);
+		Out.Vertices.Add(P1);
+		Out.Vertices.Add(P2);
+		Out.Vertices.Add(P3);
+
+		// 逆时针：左下 -> 右下 -> 右上 -> 左上
+		if (bHasRightSide)
+		{
+			Out.Indices.Append({ BaseIndex, BaseIndex + 1, BaseIndex + 2 });
+			Out.PolygonIds.Add(PolygonId);
+		}
+		if (bHasLeftSide)
+		{
+			Out.Indices.Append({ BaseIndex, BaseIndex + 2, BaseIndex + 3 });
+			Out.PolygonIds.Add(PolygonId);
+		}
+	}
+
+	/// \brief 对一个分组在[TileMinX, TileMaxX]内执行扫描
+	static void SweepTile(TArray<FSweepEdge>& Edges, double TileMinX, double TileMaxX, int32 PolygonId, FTileOutput& Out)
+	{
+		if (Edges.Num() == 0)
+		{
+			return;
+		}
+
+		// 事件：分块边界以及分块内的所有端点
+		TArray<double> EventXs;
+		EventXs.Reserve(Edges.Num() * 2 + 2);
+		EventXs.Add(TileMinX);
+		EventXs.Add(TileMaxX);
+		for (const FSweepEdge& Edge : Edges)
+		{
+			if (Edge.X0 > TileMinX && Edge.X0 < TileMaxX)
+			{
+				EventXs.Add(Edge.X0);
+			}
+			if (Edge.X1 > TileMinX && Edge.X1 < TileMaxX)
+			{
+				EventXs.Add(Edge.X1);
+			}
+		}
+		EventXs.Sort();
+		int32 NumUniqueEvents = 0;
+		for (int32 EventIndex = 0; EventIndex < EventXs.Num(); ++EventIndex)
+		{
+			if (NumUniqueEvents == 0 || EventXs[EventIndex] - EventXs[NumUniqueEvents - 1] >= MinSlabWidth)
+			{
+				EventXs[NumUniqueEvents++] = EventXs[EventIndex];
+			}
+		}
+		EventXs.SetNum(NumUniqueEvents, EAllowShrinking::No);
+
+		Edges.Sort([](const FSweepEdge& A, const FSweepEdge& B) { return A.X0 < B.X0; });
+
+		TArray<int32> ActiveEdges;
+		TArray<double> SortKeys;
+		SortKeys.SetNumUninitialized(Edges.Num());
+		int32 NextEdge = 0;
+
+		// 上一条带中仍然打开的梯形（下边界边 << 32 | 上边界边 -> 起始X）
+		TMap<uint64, double> OpenTrapezoids;
+		TMap<uint64, double> NextOpenTrapezoids;
+
+		auto CloseAll = [&Edges, PolygonId, &Out](TMap<uint64, double>& Trapezoids, double XEnd)
+			{
+				for (const TPair<uint64, double>& Pair : Trapezoids)
+				{
+					EmitTrapezoid(Edges[static_cast<int32>(Pair.Key >> 32)], Edges[static_cast<int32>(Pair.Key & 0xFFFFFFFF)], Pair.Value, XEnd, PolygonId, Out);
+				}
+				Trapezoids.Reset();
+			};
+
+		for (int32 EventIndex = 0; EventIndex + 1 < EventXs.Num(); ++EventIndex)
+		{
+			const double EventStart = EventXs[EventIndex];
+			const double EventEnd = EventXs[EventIndex + 1];
+
+			// 更新活动边：端点都是事件，活动边一定完整跨越[EventStart, EventEnd]
+			while (NextEdge < Edges.Num() && Edges[NextEdge].X0 < EventEnd - MinSlabWidth * 0.5)
+			{
+				ActiveEdges.Add(NextEdge++);
+			}
+			ActiveEdges.RemoveAllSwap([&Edges, EventStart](int32 EdgeIndex) { return Edges[EdgeIndex].X1 <= EventStart + MinSlabWidth * 0.5; }, EAllowShrinking::No);
+
+			double SlabStart = EventStart;
+			while (SlabStart < EventEnd)
+			{
+				// 按条带起点的Y排序，相邻边的首个交点即为条带内的第一个交点。
+				// 上一个交点处的两条边在起点的Y只有舍入误差，按终点Y排序，否则会漏掉紧随其后的交点
+				ActiveEdges.Sort([&Edges, SlabStart, EventEnd](int32 A, int32 B)
+					{
+						const double YA = Edges[A].YAt(SlabStart);
+						const double YB = Edges[B].YAt(SlabStart);
+						const double Tolerance = RelativeTieTolerance * FMath::Max3(1.0, FMath::Abs(YA), FMath::Abs(YB));
+						if (FMath::Abs(YA - YB) > Tolerance)
+						{
+							return YA < YB;
+						}
+						return Edges[A].YAt(EventEnd) < Edges[B].YAt(EventEnd);
+					});
+
+				double SlabEnd = EventEnd;
+				for (int32 Index = 0; Index + 1 < ActiveEdges.Num(); ++Index)
+				{
+					const FSweepEdge& Lower = Edges[ActiveEdges[Index]];
+					const FSweepEdge& Upper = Edges[ActiveEdges[Index + 1]];
+					const double DeltaStart = Upper.YAt(SlabStart) - Lower.YAt(SlabStart);
+					const double DeltaEnd = Upper.YAt(SlabEnd) - Lower.YAt(SlabEnd);
+					if (DeltaEnd >= 0.0 || DeltaStart < 0.0)
+					{
+						continue;
+					}
+
+					const double CrossX = SlabStart + (SlabEnd - SlabStart) * (DeltaStart / (DeltaStart - DeltaEnd));
+					if (CrossX > SlabStart + MinSlabWidth)
+					{
+						SlabEnd = FMath::Min(SlabEnd, CrossX);
+					}
+				}
+
+				// 条带内边互不相交，按中点Y排序；Y相同时进入边优先，避免共享边把区间切开
+				const double MidX = 0.5 * (SlabStart + SlabEnd);
+				for (int32 EdgeIndex : ActiveEdges)
+				{
+					SortKeys[EdgeIndex] = Edges[EdgeIndex].YAt(MidX);
+				}
+				ActiveEdges.Sort([&Edges, &SortKeys](int32 A, int32 B)
+					{
+						return SortKeys[A] != SortKeys[B] ? SortKeys[A] < SortKeys[B] : Edges[A].Winding > Edges[B].Winding;
+					});
+
+				// 非零环绕：覆盖次数由0变为非0时开始区间，回到0时结束区间
+				int32 Coverage = 0;
+				int32 BottomEdge = INDEX_NONE;
+				for (int32 EdgeIndex : ActiveEdges)
+				{
+					const int32 PreviousCoverage = Coverage;
+					Coverage += Edges[EdgeIndex].Winding;
+					if (PreviousCoverage == 0 && Coverage != 0)
+					{
+						BottomEdge = EdgeIndex;
+					}
+					else if (PreviousCoverage != 0 && Coverage == 0 && BottomEdge != INDEX_NONE)
+					{
+						// 与上一条带边界边相同的梯形继续延伸
+						const uint64 Key = (static_cast<uint64>(BottomEdge) << 32) | static_cast<uint32>(EdgeIndex);
+						double XStart = SlabStart;
+						OpenTrapezoids.RemoveAndCopyValue(Key, XStart);
+						NextOpenTrapezoids.Add(Key, XStart);
+						BottomEdge = INDEX_NONE;
+					}
+				}
+
+				CloseAll(OpenTrapezoids, SlabStart);
+				Swap(OpenTrapezoids, NextOpenTrapezoids);
+
+				SlabStart = SlabEnd;
+			}
+		}
+
+		CloseAll(OpenTrapezoids, EventXs.Last());
+	}
+
+	/// \brief 添加一条有向边：逆时针轮廓中向+X的边为下边界，从下向上穿过时进入
+	static void AddSweepEdge(TArray<FSweepEdge>& Edges, const FVector3d& From, const FVector3d& To)
+	{
+		if (FMath::Abs(To.X - From.X) < MinEdgeWidth)
+		{
+			return;
+		}
+
+		FSweepEdge& Edge = Edges.AddDefaulted_GetRef();
+		const bool bForward = To.X > From.X;
+		const FVector3d& Left = bForward ? From : To;
+		const FVector3d& Right = bForward ? To : From;
+		Edge.X0 = Left.X; Edge.Y0 = Left.Y; Edge.Z0 = Left.Z;
+		Edge.X1 = Right.X; Edge.Y1 = Right.Y; Edge.Z1 = Right.Z;
+		Edge.Winding = bForward ? 1 : -1;
+	}
+
+	/// \brief 按顺序拼接各分块的输出，返回三角形数量
+	static int32 AppendTileOutputs(TConstArrayView<FTileOutput> TileOutputs, FPolygonMeshData& OutMeshData)
+	{
+		int32 NumOutputVertices = 0;
+		int32 NumOutputTriangles = 0;
+		for (const FTileOutput& TileOutput : TileOutputs)
+		{
+			NumOutputVertices += TileOutput.Vertices.Num();
+			NumOutputTriangles += TileOutput.PolygonIds.Num();
+		}
+		OutMeshData.Vertices.Reserve(NumOutputVertices);
+		OutMeshData.Indices.Reserve(NumOutputTriangles * 3);
+		OutMeshData.PolygonIds.Reserve(NumOutputTriangles);
+		for (const FTileOutput& TileOutput : TileOutputs)
+		{
+			const uint32 BaseIndex = OutMeshData.Vertices.Num();
+			OutMeshData.Vertices.Append(TileOutput.Vertices);
+			for (uint32 Index : TileOutput.Indices)
+			{
+				OutMeshData.Indices.Add(BaseIndex + Index);
+			}
+			OutMeshData.PolygonIds.Append(TileOutput.PolygonIds);
+		}
+		return NumOutputTriangles;
+	}
+}
+
+bool FPolygonUnionBuilder::BuildUnion(
+	const FPolygonMeshData& InMeshData,
+	TConstArrayView<uint32> InPolygonGroupKeys,
+	uint32 InDefaultGroupKey,
+	FPolygonMeshData& OutMeshData,
+	int32 InNumTiles,
+	FPolygonUnionStats* OutStats)
+{
+	using namespace SurfacePolygonUnion;
+
+	const uint32 StartTime = FPlatformTime::Cycles();
+
+	OutMeshData = FPolygonMeshData();
+	if (!InMeshData.IsValid())
+	{
+		return false;
+	}
+
+	const int32 NumTriangles = InMeshData.NumTriangles();
+
+	// 按分组键收集三角形，分组的多边形索引取组内最小值
+	TMap<uint32, int32> GroupKeyToIndex;
+	TArray<TArray<int32>> GroupTriangles;
+	TArray<int32> GroupPolygonIds;
+	FBox2D Bounds(ForceInit);
+	for (int32 TriangleIndex = 0; TriangleIndex < NumTriangles; ++TriangleIndex)
+	{
+		const int32 PolygonId = InMeshData.PolygonIds[TriangleIndex];
+		const uint32 GroupKey = InPolygonGroupKeys.IsValidIndex(PolygonId) ? InPolygonGroupKeys[PolygonId] : InDefaultGroupKey;
+
+		int32 GroupIndex = INDEX_NONE;
+		if (const int32* FoundGroupIndex = GroupKeyToIndex.Find(GroupKey))
+		{
+			GroupIndex = *FoundGroupIndex;
+			GroupPolygonIds[GroupIndex] = FMath::Min(GroupPolygonIds[GroupIndex], PolygonId);
+		}
+		else
+		{
+			GroupIndex = GroupTriangles.Num();
+			GroupKeyToIndex.Add(GroupKey, GroupIndex);
+			GroupTriangles.AddDefaulted();
+			GroupPolygonIds.Add(PolygonId);
+		}
+		GroupTriangles[GroupIndex].Add(TriangleIndex);
+
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			const FVector3f& Vertex = InMeshData.Vertices[InMeshData.Indices[TriangleIndex * 3 + Corner]];
+			Bounds += FVector2D(Vertex.X, Vertex.Y);
+		}
+	}
+
+	// 沿X方向等宽分块
+	int32 NumTiles = InNumTiles > 0 ? InNumTiles : FMath::DivideAndRoundUp(NumTriangles, TrianglesPerTile);
+	NumTiles = FMath::Clamp(NumTiles, 1, FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * 4, 1));
+	const double TileWidth = (Bounds.Max.X - Bounds.Min.X) / NumTiles;
+
+	const int32 NumGroups = GroupTriangles.Num();
+	const int32 NumWorkItems = NumGroups * NumTiles;
+	TArray<FTileOutput> TileOutputs;
+	TileOutputs.SetNum(NumWorkItems);
+
+	ParallelFor(NumWorkItems, [&](int32 WorkIndex)
+		{
+			const int32 GroupIndex = WorkIndex / NumTiles;
+			const int32 TileIndex = WorkIndex % NumTiles;
+			const double TileMinX = Bounds.Min.X + TileWidth * TileIndex;
+			const double TileMaxX = TileIndex == NumTiles - 1 ? Bounds.Max.X : Bounds.Min.X + TileWidth * (TileIndex + 1);
+
+			// 收集与分块相交的三角形的边，三角形统一为逆时针
+			TArray<FSweepEdge> Edges;
+			for (int32 TriangleIndex : GroupTriangles[GroupIndex])
+			{
+				FVector3d Corners[3];
+				for (int32 Corner = 0; Corner < 3; ++Corner)
+				{
+					Corners[Corner] = FVector3d(InMeshData.Vertices[InMeshData.Indices[TriangleIndex * 3 + Corner]]);
+				}
+
+				const double MinX = FMath::Min3(Corners[0].X, Corners[1].X, Corners[2].X);
+				const double MaxX = FMath::Max3(Corners[0].X, Corners[1].X, Corners[2].X);
+				if (MaxX <= TileMinX || MinX >= TileMaxX)
+				{
+					continue;
+				}
+
+				const double DoubleArea = (Corners[1].X - Corners[0].X) * (Corners[2].Y - Corners[0].Y) - (Corners[2].X - Corners[0].X) * (Corners[1].Y - Corners[0].Y);
+				if (FMath::Abs(DoubleArea) < MinTriangleArea)
+				{
+					continue;
+				}
+				if (DoubleArea < 0.0)
+				{
+					Swap(Corners[1], Corners[2]);
+				}
+
+				for (int32 Corner = 0; Corner < 3; ++Corner)
+				{
+					AddSweepEdge(Edges, Corners[Corner], Corners[(Corner + 1) % 3]);
+				}
+			}
+
+			SweepTile(Edges, TileMinX, TileMaxX, GroupPolygonIds[GroupIndex], TileOutputs[WorkIndex]);
+		},
+		NumWorkItems < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// 按分组、分块顺序拼接，结果与线程调度无关
+	const int32 NumOutputTriangles = AppendTileOutputs(TileOutputs, OutMeshData);
+
+	const double BuildTimeMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartTime);
+	UE_LOG(LogSurfacePolygonUnion, Log, TEXT("多边形并集：%d 组，%d 块，三角形 %d -> %d，耗时 %.2fms"),
+		NumGroups, NumTiles, NumTriangles, NumOutputTriangles, BuildTimeMs);
+
+	if (OutStats)
+	{
+		OutStats->NumInputTriangles = NumTriangles;
+		OutStats->NumOutputTriangles = NumOutputTriangles;
+		OutStats->NumGroups = NumGroups;
+		OutStats->NumTiles = NumTiles;
+		OutStats->BuildTimeMs = BuildTimeMs;
+	}
+
+	return NumOutputTriangles > 0;
+}
+
+bool FPolygonUnionBuilder::TriangulateRings(
+	TConstArrayView<FVector2f> InVertices,
+	TConstArrayView<int32> InRingOffsets,
+	TConstArrayView<int32> InRingPolygonIds,
+	float InZ,
+	FPolygonMeshData& OutMeshData,
+	FPolygonUnionStats* OutStats)
+{
+	using namespace SurfacePolygonUnion;
+
+	const uint32 StartTime = FPlatformTime::Cycles();
+
+	OutMeshData = FPolygonMeshData();
+	const int32 NumRings = FMath::Min(FMath::Max(InRingOffsets.Num() - 1, 0), InRingPolygonIds.Num());
+
+	// 按多边形索引收集环，分组顺序为多边形首次出现的顺序
+	TMap<int32, int32> PolygonIdToGroup;
+	TArray<TArray<int32>> GroupRings;
+	TArray<int32> GroupPolygonIds;
+	TArray<FBox2D> GroupBounds;
+	TArray<int32> GroupNumEdges;
+	for (int32 RingIndex = 0; RingIndex < NumRings; ++RingIndex)
+	{
+		const int32 FirstVertex = InRingOffsets[RingIndex];
+		const int32 NumVertices = InRingOffsets[RingIndex + 1] - FirstVertex;
+		if (FirstVertex < 0 || NumVertices < 3 || FirstVertex + NumVertices > InVertices.Num())
+		{
+			continue;
+		}
+
+		const int32 PolygonId = InRingPolygonIds[RingIndex];
+		int32 GroupIndex = INDEX_NONE;
+		if (const int32* FoundGroupIndex = PolygonIdToGroup.Find(PolygonId))
+		{
+			GroupIndex = *FoundGroupIndex;
+		}
+		else
+		{
+			GroupIndex = GroupRings.Num();
+			PolygonIdToGroup.Add(PolygonId, GroupIndex);
+			GroupRings.AddDefaulted();
+			GroupPolygonIds.Add(PolygonId);
+			GroupBounds.Add(FBox2D(ForceInit));
+			GroupNumEdges.Add(0);
+		}
+		GroupRings[GroupIndex].Add(RingIndex);
+		GroupNumEdges[GroupIndex] += NumVertices;
+		for (int32 VertexIndex = FirstVertex; VertexIndex < FirstVertex + NumVertices; ++VertexIndex)
+		{
+			GroupBounds[GroupIndex] += FVector2D(InVertices[VertexIndex]);
+		}
+	}
+
+	// 每个多边形单独扫描，边数较多的多边形再沿X方向分块
+	const int32 NumGroups = GroupRings.Num();
+	const int32 MaxTilesPerGroup = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * 4, 1);
+	TArray<FIntPoint> WorkItems;
+	TArray<int32> GroupNumTiles;
+	GroupNumTiles.SetNum(NumGroups);
+	for (int32 GroupIndex = 0; GroupIndex < NumGroups; ++GroupIndex)
+	{
+		GroupNumTiles[GroupIndex] = FMath::Clamp(FMath::DivideAndRoundUp(GroupNumEdges[GroupIndex], RingEdgesPerTile), 1, MaxTilesPerGroup);
+		for (int32 TileIndex = 0; TileIndex < GroupNumTiles[GroupIndex]; ++TileIndex)
+		{
+			WorkItems.Add(FIntPoint(GroupIndex, TileIndex));
+		}
+	}
+
+	const int32 NumWorkItems = WorkItems.Num();
+	TArray<FTileOutput> TileOutputs;
+	TileOutputs.SetNum(NumWorkItems);
+
+	ParallelFor(NumWorkItems, [&](int32 WorkIndex)
+		{
+			const int32 GroupIndex = WorkItems[WorkIndex].X;
+			const int32 TileIndex = WorkItems[WorkIndex].Y;
+			const int32 NumTiles = GroupNumTiles[GroupIndex];
+			const FBox2D& Bounds = GroupBounds[GroupIndex];
+			const double TileWidth = (Bounds.Max.X - Bounds.Min.X) / NumTiles;
+			const double TileMinX = Bounds.Min.X + TileWidth * TileIndex;
+			const double TileMaxX = TileIndex == NumTiles - 1 ? Bounds.Max.X : Bounds.Min.X + TileWidth * (TileIndex + 1);
+
+			// 环的方向决定环绕值：外环逆时针、内环顺时针；未闭合的环补上首尾相连的边
+			TArray<FSweepEdge> Edges;
+			for (int32 RingIndex : GroupRings[GroupIndex])
+			{
+				const int32 FirstVertex = InRingOffsets[RingIndex];
+				const int32 NumVertices = InRingOffsets[RingIndex + 1] - FirstVertex;
+				for (int32 Index = 0; Index < NumVertices; ++Index)
+				{
+					const FVector2f& From = InVertices[FirstVertex + Index];
+					const FVector2f& To = InVertices[FirstVertex + (Index + 1) % NumVertices];
+					if (FMath::Max(From.X, To.X) <= TileMinX || FMath::Min(From.X, To.X) >= TileMaxX)
+					{
+						continue;
+					}
+
+					AddSweepEdge(Edges, FVector3d(From.X, From.Y, InZ), FVector3d(To.X, To.Y, InZ));
+				}
+			}
+
+			SweepTile(Edges, TileMinX, TileMaxX, GroupPolygonIds[GroupIndex], TileOutputs[WorkIndex]);
+		},
+		NumWorkItems < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	const int32 NumOutputTriangles = AppendTileOutputs(TileOutputs, OutMeshData);
+
+	const double BuildTimeMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartTime);
+	UE_LOG(LogSurfacePolygonUnion, Log, TEXT("多边形环三角化：%d 个环，%d 个多边形，%d 块，输出三角形 %d，耗时 %.2fms"),
+		NumRings, NumGroups, NumWorkItems, NumOutputTriangles, BuildTimeMs);
+
+	if (OutStats)
+	{
+		OutStats->NumInputTriangles = 0;
+		OutStats->NumOutputTriangles = NumOutputTriangles;
+		OutStats->NumGroups = NumGroups;
+		OutStats->NumTiles = NumWorkItems;
+		OutStats->BuildTimeMs = BuildTimeMs;
+	}
+
+	return NumOutputTriangles > 0;
+}
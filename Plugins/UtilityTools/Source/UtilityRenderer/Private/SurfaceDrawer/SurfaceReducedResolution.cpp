@@ -0,0 +1,48 @@
+﻿#include "SurfaceDrawer/SurfaceReducedResolution.h"
+
+#include "HAL/IConsoleManager.h"
+#include "RenderGraphBuilder.h"
+
+
+static TAutoConsoleVariable<int32> CVarSurfaceDrawerReducedResolution(
+	TEXT("r.SurfaceDrawer.ReducedResolution"),
+	1,
+	TEXT("SurfaceLine/SurfacePolygon逐像素BVH查询的降采样倍数。\n")
+	TEXT(" 1: 全分辨率（默认）\n")
+	TEXT(" 2/4: 先以1/2或1/4分辨率分类，全分辨率只查询线/面边缘和深度不连续处的像素；\n")
+	TEXT("    组件各自使用全屏像素着色器Pass（不合并、不分块），开启r.SurfaceDrawer.CoverageCache时不生效"),
+	ECVF_RenderThreadSafe);
+
+int32 FSurfaceReducedResolution::GetReductionFactor()
+{
+	const int32 ReductionFactor = CVarSurfaceDrawerReducedResolution.GetValueOnRenderThread();
+	return ReductionFactor >= 4 ? 4 : (ReductionFactor >= 2 ? 2 : 1);
+}
+
+FIntRect FSurfaceReducedResolution::GetReducedRect(const FIntRect& InScissorRect, const FIntRect& InViewportRect, int32 InReductionFactor)
+{
+	// 像素P的2×2采样点为 floor((P - N/2) / N) 及其右下相邻的采样点
+	const FIntPoint HalfFactor(InReductionFactor / 2, InReductionFactor / 2);
+	const FIntPoint ReducedViewportMax = FIntPoint::DivideAndRoundUp(InViewportRect.Max, InReductionFactor);
+	FIntRect ReducedRect(
+		FIntPoint::DivideAndRoundDown(InScissorRect.Min - HalfFactor, InReductionFactor),
+		FIntPoint::DivideAndRoundDown(InScissorRect.Max - FIntPoint(1, 1) - HalfFactor, InReductionFactor) + FIntPoint(2, 2));
+	ReducedRect.Min = ReducedRect.Min.ComponentMax(FIntPoint::DivideAndRoundDown(InViewportRect.Min, InReductionFactor));
+	ReducedRect.Max = ReducedRect.Max.ComponentMin(ReducedViewportMax);
+	return ReducedRect;
+}
+
+FRDGTextureRef FSurfaceReducedResolution::CreateCoverageTexture(FRDGBuilder& GraphBuilder, FIntPoint InExtent, const FIntRect& InReducedRect, int32 InReductionFactor, FSurfaceReducedResolutionParameters& OutParameters)
+{
+	const FRDGTextureDesc CoverageDesc = FRDGTextureDesc::Create2D(
+		FIntPoint::DivideAndRoundUp(InExtent, InReductionFactor),
+		CoverageTextureFormat,
+		FClearValueBinding::None,
+		TexCreate_RenderTargetable | TexCreate_ShaderResource);
+	FRDGTextureRef CoverageTexture = GraphBuilder.CreateTexture(CoverageDesc, TEXT("SurfaceReducedCoverageTexture"));
+
+	OutParameters.ReducedCoverageTexture = CoverageTexture;
+	OutParameters.ReducedRect = InReducedRect;
+	OutParameters.ReductionFactor = InReductionFactor;
+	return CoverageTexture;
+}
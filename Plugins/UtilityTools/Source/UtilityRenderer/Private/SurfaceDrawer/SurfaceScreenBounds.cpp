@@ -0,0 +1,283 @@
+﻿#include "SurfaceDrawer/SurfaceScreenBounds.h"
+
+#include "Algo/Sort.h"
+#include "HAL/IConsoleManager.h"
+
+
+static TAutoConsoleVariable<int32> CVarSurfaceDrawerScissor(
+	TEXT("r.SurfaceDrawer.Scissor"),
+	1,
+	TEXT("SurfaceLine/SurfacePolygon是否只渲染代理在屏幕上的范围。\n")
+	TEXT(" 0: 每个组件的全屏Pass覆盖整个视口\n")
+	TEXT(" 1: 根节点XY范围沿Z延伸到整个视锥高度后投影到屏幕，与地表高度无关；XY范围不在视图覆盖范围内的组件跳过（默认）"),
+	ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarSurfaceDrawerMaxViewDistance(
+	TEXT("r.SurfaceDrawer.MaxViewDistance"),
+	10000000.0f,
+	TEXT("SurfaceLine/SurfacePolygon计算屏幕范围时视锥角射线的截断长度（世界单位），更远处的地表不绘制叠加（默认10000000，即100千米）"),
+	ECVF_RenderThreadSafe);
+
+namespace SurfaceScreenBounds
+{
+	/// \brief 近平面裁剪阈值（裁剪空间W），W小于该值的点位于相机后方或过于靠近相机
+	static constexpr double MinClipW = 1e-3;
+
+	/// \brief 包围盒的6个面，顶点索引的第0/1/2位分别选择X/Y/Z的最大值，每个面的顶点按环绕顺序排列
+	static constexpr int32 BoxFaces[6][4] =
+	{
+		{ 0, 2, 6, 4 }, { 1, 3, 7, 5 },
+		{ 0, 1, 5, 4 }, { 2, 3, 7, 6 },
+		{ 0, 1, 3, 2 }, { 4, 5, 7, 6 },
+	};
+
+	/// \brief 裁剪空间多边形，四边形被5个平面裁剪后不超过9个顶点
+	using FClipPolygon = TArray<FVector4, TInlineAllocator<16>>;
+
+	/// \brief 裁剪空间半空间：Dot4(Plane, P) >= Offset
+	struct FClipPlane
+	{
+		FVector4 Plane;
+		double Offset;
+	};
+
+	/// \brief 用半空间裁剪凸多边形（Sutherland-Hodgman）
+	static void ClipPolygon(const FClipPlane& InPlane, const FClipPolygon& InPolygon, FClipPolygon& OutPolygon)
+	{
+		OutPolygon.Reset();
+		for (int32 Index = 0; Index < InPolygon.Num(); ++Index)
+		{
+			const FVector4& A = InPolygon[Index];
+			const FVector4& B = InPolygon[(Index + 1) % InPolygon.Num()];
+			const double DistanceA = Dot4(InPlane.Plane, A) - InPlane.Offset;
+			const double DistanceB = Dot4(InPlane.Plane, B) - InPlane.Offset;
+			if (DistanceA >= 0.0)
+			{
+				OutPolygon.Add(A);
+			}
+			if ((DistanceA >= 0.0) != (DistanceB >= 0.0))
+			{
+				OutPolygon.Add(A + (B - A) * (DistanceA / (DistanceA - DistanceB)));
+			}
+		}
+	}
+
+	/// \brief 二维叉积，OA到OB逆时针旋转时为正
+	FORCEINLINE double Cross(const FVector2D& O, const FVector2D& A, const FVector2D& B)
+	{
+		return (A.X - O.X) * (B.Y - O.Y) - (A.Y - O.Y) * (B.X - O.X);
+	}
+
+	/// \brief 读取视锥截断长度
+	static double GetMaxViewDistance()
+	{
+		return FMath::Max(CVarSurfaceDrawerMaxViewDistance.GetValueOnAnyThread(), 1.0f);
+	}
+}
+
+FSurfaceViewFootprint FSurfaceViewFootprint::FromViewProjection(const FMatrix& InViewProjMatrix, const FIntPoint& InViewportSize, float InPixelPadding)
+{
+	using namespace SurfaceScreenBounds;
+
+	const FMatrix InvViewProjMatrix = InViewProjMatrix.Inverse();
+	auto Unproject = [&InvViewProjMatrix](double NDCX, double NDCY, double DeviceDepth)
+		{
+			const FVector4 WorldPosition = InvViewProjMatrix.TransformFVector4(FVector4(NDCX, NDCY, DeviceDepth, 1.0));
+			return FVector(WorldPosition) / WorldPosition.W;
+		};
+
+	// 反向Z：设备深度1为近平面，0.5处的点确定角射线方向（正交投影时各射线平行）
+	const double ScaleX = 1.0 + 2.0 * FMath::Max(InPixelPadding, 0.0f) / FMath::Max(InViewportSize.X, 1);
+	const double ScaleY = 1.0 + 2.0 * FMath::Max(InPixelPadding, 0.0f) / FMath::Max(InViewportSize.Y, 1);
+	const double MaxViewDistance = GetMaxViewDistance();
+
+	FSurfaceViewFootprint Footprint;
+	FVector2D Points[8];
+	Footprint.MinZ = MAX_dbl;
+	Footprint.MaxZ = -MAX_dbl;
+	for (int32 Corner = 0; Corner < 4; ++Corner)
+	{
+		const double NDCX = (Corner & 1) ? ScaleX : -ScaleX;
+		const double NDCY = (Corner & 2) ? ScaleY : -ScaleY;
+		const FVector NearPosition = Unproject(NDCX, NDCY, 1.0);
+		const FVector RayDirection = (Unproject(NDCX, NDCY, 0.5) - NearPosition).GetSafeNormal();
+		const FVector FarPosition = NearPosition + RayDirection * MaxViewDistance;
+
+		Points[Corner * 2] = FVector2D(NearPosition);
+		Points[Corner * 2 + 1] = FVector2D(FarPosition);
+		Footprint.MinZ = FMath::Min3(Footprint.MinZ, NearPosition.Z, FarPosition.Z);
+		Footprint.MaxZ = FMath::Max3(Footprint.MaxZ, NearPosition.Z, FarPosition.Z);
+		Footprint.Bounds += Points[Corner * 2];
+		Footprint.Bounds += Points[Corner * 2 + 1];
+	}
+
+	// 单调链求凸包，按X再按Y排序后分别构造下半和上半部分（逆时针）
+	Algo::Sort(Points, [](const FVector2D& A, const FVector2D& B)
+		{
+			return A.X < B.X || (A.X == B.X && A.Y < B.Y);
+		});
+
+	TArray<FVector2D, TInlineAllocator<16>> Hull;
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		const int32 FirstIndex = Hull.Num();
+		for (int32 Step = 0; Step < 8; ++Step)
+		{
+			const FVector2D& Point = Points[Pass == 0 ? Step : 7 - Step];
+			while (Hull.Num() >= FirstIndex + 2 && Cross(Hull[Hull.Num() - 2], Hull.Last(), Point) <= 0.0)
+			{
+				Hull.Pop(EAllowShrinking::No);
+			}
+			Hull.Add(Point);
+		}
+		// 每半部分的最后一个点是另一半的起点
+		Hull.Pop(EAllowShrinking::No);
+	}
+	Footprint.Hull.Append(Hull);
+	return Footprint;
+}
+
+bool FSurfaceViewFootprint::IntersectsBox(const FBox2D& InBox) const
+{
+	if (!Bounds.Intersect(InBox))
+	{
+		return false;
+	}
+
+	// 凸包退化为线段或点时只比较包围盒（保守）
+	if (Hull.Num() < 3)
+	{
+		return true;
+	}
+
+	// 任一凸包边的外法线方向上，矩形4个顶点都在边的外侧时两者分离
+	for (int32 Index = 0; Index < Hull.Num(); ++Index)
+	{
+		const FVector2D& EdgeStart = Hull[Index];
+		const FVector2D Edge = Hull[(Index + 1) % Hull.Num()] - EdgeStart;
+		const FVector2D OutwardNormal(Edge.Y, -Edge.X);
+		const FVector2D NearestCorner(
+			OutwardNormal.X >= 0.0 ? InBox.Min.X : InBox.Max.X,
+			OutwardNormal.Y >= 0.0 ? InBox.Min.Y : InBox.Max.Y);
+		if (FVector2D::DotProduct(OutwardNormal, NearestCorner - EdgeStart) > 0.0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FSurfaceScreenBounds::ProjectBox(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, const FBox& InWorldBox, float InPixelPadding, FIntRect& OutScreenRect)
+{
+	using namespace SurfaceScreenBounds;
+
+	OutScreenRect = FIntRect();
+	if (!InWorldBox.IsValid || InViewportRect.Area() <= 0)
+	{
+		return false;
+	}
+
+	FVector4 ClipCorners[8];
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		const FVector WorldCorner(
+			(Corner & 1) ? InWorldBox.Max.X : InWorldBox.Min.X,
+			(Corner & 2) ? InWorldBox.Max.Y : InWorldBox.Min.Y,
+			(Corner & 4) ? InWorldBox.Max.Z : InWorldBox.Min.Z);
+		ClipCorners[Corner] = InViewProjMatrix.TransformFVector4(FVector4(WorldCorner, 1.0));
+	}
+
+	// 近平面和四个侧面（按像素外扩量放宽：|X| <= W * ScaleX）
+	const FVector2D ViewportMin(InViewportRect.Min);
+	const FVector2D ViewportSize(InViewportRect.Size());
+	const double Padding = FMath::Max(InPixelPadding, 0.0f) + 1.0;
+	const double ScaleX = 1.0 + 2.0 * Padding / ViewportSize.X;
+	const double ScaleY = 1.0 + 2.0 * Padding / ViewportSize.Y;
+	const FClipPlane ClipPlanes[5] =
+	{
+		{ FVector4(0.0, 0.0, 0.0, 1.0), MinClipW },
+		{ FVector4(1.0, 0.0, 0.0, ScaleX), 0.0 },
+		{ FVector4(-1.0, 0.0, 0.0, ScaleX), 0.0 },
+		{ FVector4(0.0, 1.0, 0.0, ScaleY), 0.0 },
+		{ FVector4(0.0, -1.0, 0.0, ScaleY), 0.0 },
+	};
+
+	// 每个面裁剪后剩余顶点的NDC范围即为包围盒在视锥内部分的投影范围
+	FVector2D NDCMin(MAX_dbl, MAX_dbl);
+	FVector2D NDCMax(-MAX_dbl, -MAX_dbl);
+	FClipPolygon Polygon;
+	FClipPolygon ClippedPolygon;
+	for (const int32 (&Face)[4] : BoxFaces)
+	{
+		Polygon.Reset();
+		for (const int32 Corner : Face)
+		{
+			Polygon.Add(ClipCorners[Corner]);
+		}
+		for (const FClipPlane& ClipPlane : ClipPlanes)
+		{
+			ClipPolygon(ClipPlane, Polygon, ClippedPolygon);
+			Swap(Polygon, ClippedPolygon);
+			if (Polygon.IsEmpty())
+			{
+				break;
+			}
+		}
+
+		for (const FVector4& ClipPoint : Polygon)
+		{
+			const FVector2D NDCPoint(ClipPoint.X / ClipPoint.W, ClipPoint.Y / ClipPoint.W);
+			NDCMin = FVector2D::Min(NDCMin, NDCPoint);
+			NDCMax = FVector2D::Max(NDCMax, NDCPoint);
+		}
+	}
+
+	// 包围盒与视锥不相交；相机位于包围盒内部时，视锥角射线与包围盒的面相交，仍会得到顶点
+	if (NDCMin.X > NDCMax.X)
+	{
+		return false;
+	}
+
+	// NDC的Y轴向上，屏幕的Y轴向下
+	const FIntRect ScreenRect(
+		FMath::FloorToInt32(ViewportMin.X + (NDCMin.X * 0.5 + 0.5) * ViewportSize.X - Padding),
+		FMath::FloorToInt32(ViewportMin.Y + (0.5 - NDCMax.Y * 0.5) * ViewportSize.Y - Padding),
+		FMath::CeilToInt32(ViewportMin.X + (NDCMax.X * 0.5 + 0.5) * ViewportSize.X + Padding),
+		FMath::CeilToInt32(ViewportMin.Y + (0.5 - NDCMin.Y * 0.5) * ViewportSize.Y + Padding));
+
+	OutScreenRect = ScreenRect;
+	OutScreenRect.Clip(InViewportRect);
+	return OutScreenRect.Area() > 0;
+}
+
+FBox FSurfaceScreenBounds::MakeSurfaceBox(const FVector3f& InMinExtent, const FVector3f& InMaxExtent, float InWorldPadding, const FSurfaceViewFootprint& InFootprint)
+{
+	const double Padding = FMath::Max(InWorldPadding, 0.0f);
+	return FBox(
+		FVector(FMath::Max(InMinExtent.X - Padding, InFootprint.Bounds.Min.X), FMath::Max(InMinExtent.Y - Padding, InFootprint.Bounds.Min.Y), InFootprint.MinZ),
+		FVector(FMath::Min(InMaxExtent.X + Padding, InFootprint.Bounds.Max.X), FMath::Min(InMaxExtent.Y + Padding, InFootprint.Bounds.Max.Y), InFootprint.MaxZ));
+}
+
+bool FSurfaceScreenBounds::CalculateScissorRect(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, const FVector3f& InMinExtent, const FVector3f& InMaxExtent,
+	float InWorldPadding, float InPixelPadding, FIntRect& OutScissorRect)
+{
+	if (CVarSurfaceDrawerScissor.GetValueOnAnyThread() == 0)
+	{
+		OutScissorRect = InViewportRect;
+		return true;
+	}
+
+	// XY范围不在视图覆盖范围内时，任何高度的地表上都看不到该代理
+	const FSurfaceViewFootprint Footprint = FSurfaceViewFootprint::FromViewProjection(InViewProjMatrix, InViewportRect.Size(), InPixelPadding);
+	const double Padding = FMath::Max(InWorldPadding, 0.0f);
+	const FBox2D SurfaceRect(
+		FVector2D(InMinExtent.X - Padding, InMinExtent.Y - Padding),
+		FVector2D(InMaxExtent.X + Padding, InMaxExtent.Y + Padding));
+	if (!Footprint.IntersectsBox(SurfaceRect))
+	{
+		OutScissorRect = FIntRect();
+		return false;
+	}
+
+	return ProjectBox(InViewProjMatrix, InViewportRect, MakeSurfaceBox(InMinExtent, InMaxExtent, InWorldPadding, Footprint), InPixelPadding, OutScissorRect);
+}
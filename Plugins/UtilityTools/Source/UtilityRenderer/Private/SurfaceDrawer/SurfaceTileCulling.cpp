@@ -0,0 +1,425 @@
+﻿#include "SurfaceDrawer/SurfaceTileCulling.h"
+
+#include "Algo/Count.h"
+#include "Async/ParallelFor.h"
+
+
+namespace SurfaceTileCulling
+{
+	static constexpr int32 MaxStackNum = 64;				///< 遍历栈容量，与着色器一致
+	static constexpr float MaxDistance = 1e10f;				///< 与着色器的MAX_DISTANCE一致
+	static constexpr float FootprintEpsilon = 1e-3f;		///< 覆盖范围按尺寸的相对扩大量，吸收反投影的浮点误差
+
+	/// \brief 包围盒（按半线宽扩大）与覆盖范围是否相交
+	FORCEINLINE bool OverlapsFootprint(const FVector3f& InMinExtent, const FVector3f& InMaxExtent, const FBox2f& InFootprint, float InHalfWidth)
+	{
+		const float GapX = FMath::Max3(InFootprint.Min.X - InMaxExtent.X, InMinExtent.X - InFootprint.Max.X, 0.0f);
+		const float GapY = FMath::Max3(InFootprint.Min.Y - InMaxExtent.Y, InMinExtent.Y - InFootprint.Max.Y, 0.0f);
+		return GapX * GapX + GapY * GapY <= InHalfWidth * InHalfWidth;
+	}
+
+	/// \brief 分块剔除函数：输入覆盖范围和分块内最大的像素世界大小，输出候选叶子节点，溢出时返回false
+	using FCullTileFunction = TFunctionRef<bool(const FBox2f&, float, TArray<int32>&)>;
+
+	/// \brief 逐分块归约深度范围并剔除，按分块顺序拼接候选
+	static void CullTiles(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, bool bInNeedsPixelWorldSize, FCullTileFunction InCullTile, FSurfaceTileCandidates& OutCandidates)
+	{
+		const int32 ViewportWidth = InView.ViewportRect.Width();
+		const int32 ViewportHeight = InView.ViewportRect.Height();
+		check(InDeviceDepth.Num() == ViewportWidth * ViewportHeight);
+
+		const int32 TileSize = FSurfaceTileCulling::TileSize;
+		OutCandidates.NumTilesX = FMath::DivideAndRoundUp(ViewportWidth, TileSize);
+		OutCandidates.NumTilesY = FMath::DivideAndRoundUp(ViewportHeight, TileSize);
+		const int32 NumTiles = OutCandidates.NumTilesX * OutCandidates.NumTilesY;
+
+		TArray<TArray<int32>> TileLeafNodes;
+		TileLeafNodes.SetNum(NumTiles);
+		OutCandidates.TileOverflow.Init(false, NumTiles);
+
+		ParallelFor(NumTiles, [&](int32 TileIndex)
+			{
+				const FIntPoint TileMin((TileIndex % OutCandidates.NumTilesX) * TileSize, (TileIndex / OutCandidates.NumTilesX) * TileSize);
+				const FIntRect TileRect(TileMin, FIntPoint(FMath::Min(TileMin.X + TileSize, ViewportWidth), FMath::Min(TileMin.Y + TileSize, ViewportHeight)));
+
+				// 对应着色器第一阶段：每个像素参与深度范围和像素世界大小的归约，无穷远（深度为0）的像素不参与
+				float MinDepth = MAX_flt;
+				float MaxDepth = 0.0f;
+				float MaxPixelWorldSize = 0.0f;
+				for (int32 Y = TileRect.Min.Y; Y < TileRect.Max.Y; ++Y)
+				{
+					for (int32 X = TileRect.Min.X; X < TileRect.Max.X; ++X)
+					{
+						const float DeviceDepth = InDeviceDepth[Y * ViewportWidth + X];
+						if (DeviceDepth <= 0.0f)
+						{
+							continue;
+						}
+						MinDepth = FMath::Min(MinDepth, DeviceDepth);
+						MaxDepth = FMath::Max(MaxDepth, DeviceDepth);
+
+						if (bInNeedsPixelWorldSize)
+						{
+							const FVector2f ScreenPosition(InView.ViewportRect.Min.X + X + 0.5f, InView.ViewportRect.Min.Y + Y + 0.5f);
+							const FVector3f WorldPosition = FSurfaceTileCulling::ScreenToWorldPosition(InView, ScreenPosition, DeviceDepth);
+							MaxPixelWorldSize = FMath::Max(MaxPixelWorldSize, FSurfaceTileCulling::CalculatePixelWorldSize(InView, WorldPosition, ScreenPosition));
+						}
+					}
+				}
+				if (MaxDepth <= 0.0f)
+				{
+					return;
+				}
+
+				// 第二阶段：一个线程剔除BVH
+				const FBox2f Footprint = FSurfaceTileCulling::ComputeTileFootprint(InView, TileRect, MinDepth, MaxDepth);
+				if (!InCullTile(Footprint, MaxPixelWorldSize, TileLeafNodes[TileIndex]))
+				{
+					OutCandidates.TileOverflow[TileIndex] = true;
+					TileLeafNodes[TileIndex].Reset();
+				}
+			},
+			NumTiles < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+		// 按分块顺序拼接
+		OutCandidates.TileOffsets.SetNumUninitialized(NumTiles + 1);
+		OutCandidates.Candidates.Reset();
+		OutCandidates.NumEmptyTiles = 0;
+		for (int32 TileIndex = 0; TileIndex < NumTiles; ++TileIndex)
+		{
+			OutCandidates.TileOffsets[TileIndex] = OutCandidates.Candidates.Num();
+			OutCandidates.Candidates.Append(TileLeafNodes[TileIndex]);
+			if (TileLeafNodes[TileIndex].IsEmpty() && !OutCandidates.TileOverflow[TileIndex])
+			{
+				++OutCandidates.NumEmptyTiles;
+			}
+		}
+		OutCandidates.TileOffsets[NumTiles] = OutCandidates.Candidates.Num();
+	}
+}
+
+FIntRect FSurfaceTileCulling::AlignScissorRect(const FIntRect& InViewportRect, const FIntRect& InScissorRect)
+{
+	const FIntPoint AlignedMin = InViewportRect.Min + ((InScissorRect.Min - InViewportRect.Min) / TileSize) * TileSize;
+	return FIntRect(AlignedMin, InScissorRect.Max);
+}
+
+FSurfaceTileView FSurfaceTileCulling::MakeView(const FMatrix& InViewMatrix, const FMatrix& InProjMatrix, const FIntRect& InViewportRect)
+{
+	FSurfaceTileView View;
+	View.ScreenToWorld = FMatrix44f((InViewMatrix * InProjMatrix).Inverse());
+	View.InvViewMatrix = FMatrix44f(InViewMatrix).Inverse();
+	View.ViewportRect = InViewportRect;
+	View.TanHalfFOV = 1.0f / FMath::Max(static_cast<float>(InProjMatrix.M[1][1]), UE_SMALL_NUMBER);
+	return View;
+}
+
+FSurfaceTileView FSurfaceTileCulling::MakeObliqueView(const FVector& InTarget, double InDistance, float InPitch, int32 InViewportSize)
+{
+	const FRotator ViewRotation(InPitch, 0.0f, 0.0f);
+	const FVector ViewLocation = InTarget - ViewRotation.Vector() * InDistance;
+
+	// 与引擎的视图矩阵约定一致：平移、逆旋转，再交换坐标轴使相机看向+Z
+	const FMatrix ViewMatrix = FTranslationMatrix(-ViewLocation) * FInverseRotationMatrix(ViewRotation) * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+	const FMatrix ProjMatrix = FReversedZPerspectiveMatrix(UE_PI * 0.25f, InViewportSize, InViewportSize, 10.0f);
+
+	return MakeView(ViewMatrix, ProjMatrix, FIntRect(0, 0, InViewportSize, InViewportSize));
+}
+
+void FSurfaceTileCulling::BuildPlaneDepth(const FSurfaceTileView& InView, float InPlaneZ, TArray<float>& OutDeviceDepth)
+{
+	const int32 ViewportWidth = InView.ViewportRect.Width();
+	const int32 ViewportHeight = InView.ViewportRect.Height();
+	OutDeviceDepth.SetNumUninitialized(ViewportWidth * ViewportHeight);
+
+	const FMatrix44f WorldToScreen = InView.ScreenToWorld.Inverse();
+	const FVector3f CameraPosition = InView.InvViewMatrix.GetOrigin();
+
+	ParallelFor(ViewportHeight, [&](int32 Y)
+		{
+			for (int32 X = 0; X < ViewportWidth; ++X)
+			{
+				// 像素射线与平面求交，交点投影回裁剪空间得到设备深度
+				const FVector2f ScreenPosition(InView.ViewportRect.Min.X + X + 0.5f, InView.ViewportRect.Min.Y + Y + 0.5f);
+				const FVector3f Direction = ScreenToWorldPosition(InView, ScreenPosition, 0.5f) - CameraPosition;
+				const float T = FMath::IsNearlyZero(Direction.Z) ? -1.0f : (InPlaneZ - CameraPosition.Z) / Direction.Z;
+
+				float DeviceDepth = 0.0f;
+				if (T > 0.0f)
+				{
+					const FVector4f ClipPosition = WorldToScreen.TransformFVector4(FVector4f(CameraPosition + Direction * T, 1.0f));
+					DeviceDepth = FMath::Clamp(ClipPosition.Z / ClipPosition.W, 0.0f, 1.0f);
+				}
+				OutDeviceDepth[Y * ViewportWidth + X] = DeviceDepth;
+			}
+		},
+		ViewportHeight < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+FVector3f FSurfaceTileCulling::ScreenToWorldPosition(const FSurfaceTileView& InView, const FVector2f& InScreenPosition, float InDeviceDepth)
+{
+	// 与着色器一致：屏幕坐标除以ViewportRect的Max分量归一化
+	const FVector2f NormalizedScreenPosition(InScreenPosition.X / InView.ViewportRect.Max.X, InScreenPosition.Y / InView.ViewportRect.Max.Y);
+	const FVector4f NDCPosition(NormalizedScreenPosition.X * 2.0f - 1.0f, (1.0f - NormalizedScreenPosition.Y) * 2.0f - 1.0f, InDeviceDepth, 1.0f);
+
+	const FVector4f WorldPosition = InView.ScreenToWorld.TransformFVector4(NDCPosition);
+	return FVector3f(WorldPosition) / WorldPosition.W;
+}
+
+float FSurfaceTileCulling::CalculatePixelWorldSize(const FSurfaceTileView& InView, const FVector3f& InWorldPosition, const FVector2f& InScreenPosition)
+{
+	using namespace SurfaceTileCulling;
+
+	const int32 ViewportWidth = InView.ViewportRect.Max.X;
+	const int32 ViewportHeight = InView.ViewportRect.Max.Y;
+
+	const float DistanceToCamera = FVector3f::Distance(InWorldPosition, InView.InvViewMatrix.GetOrigin());
+	if (DistanceToCamera > MaxDistance)
+	{
+		return 0.0f;
+	}
+
+	const float VerticalPixelSize = (2.0f * DistanceToCamera * InView.TanHalfFOV) / ViewportHeight;
+	const float AspectRatio = static_cast<float>(ViewportWidth) / ViewportHeight;
+	const float HorizontalPixelSize = VerticalPixelSize * AspectRatio;
+
+	const FVector2f ScreenOffset = (FVector2f(InScreenPosition.X / ViewportWidth, InScreenPosition.Y / ViewportHeight) - 0.5f) * 2.0f;
+	const float CosTheta = FMath::Sqrt(ScreenOffset.X * ScreenOffset.X * AspectRatio * AspectRatio + ScreenOffset.Y * ScreenOffset.Y + AspectRatio);
+
+	return 0.5f * (HorizontalPixelSize + VerticalPixelSize) / CosTheta;
+}
+
+FBox2f FSurfaceTileCulling::ComputeTileFootprint(const FSurfaceTileView& InView, const FIntRect& InTileRect, float InMinDepth, float InMaxDepth)
+{
+	// 分块内的像素位于四角射线与两个深度面围成的凸体内，8个顶点的包围盒即为保守的覆盖范围
+	const FIntPoint TileMin = InView.ViewportRect.Min + InTileRect.Min;
+	const FIntPoint TileMax = InView.ViewportRect.Min + InTileRect.Max;
+	const FVector2f ScreenMin(TileMin.X, TileMin.Y);
+	const FVector2f ScreenMax(TileMax.X, TileMax.Y);
+
+	FBox2f Footprint(ForceInit);
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		const FVector2f ScreenPosition((Corner & 1) ? ScreenMax.X : ScreenMin.X, (Corner & 2) ? ScreenMax.Y : ScreenMin.Y);
+		const FVector3f WorldPosition = ScreenToWorldPosition(InView, ScreenPosition, (Corner & 4) ? InMaxDepth : InMinDepth);
+		Footprint += FVector2f(WorldPosition.X, WorldPosition.Y);
+	}
+
+	return Footprint.ExpandBy(Footprint.GetSize().GetMax() * SurfaceTileCulling::FootprintEpsilon);
+}
+
+bool FSurfaceTileCulling::CullLineBVH(TConstArrayView<FGPULineBVHNode> InNodes, const FBox2f& InFootprint, float InHalfWidth, TArray<int32>& OutLeafNodes)
+{
+	using namespace SurfaceTileCulling;
+
+	OutLeafNodes.Reset();
+	if (InNodes.IsEmpty())
+	{
+		return true;
+	}
+
+	// 入栈顺序与着色器的QueryBVH一致（先左后右），候选顺序即逐像素遍历访问叶子的顺序
+	int32 Stack[MaxStackNum];
+	int32 StackPtr = 0;
+	Stack[StackPtr++] = 0;
+
+	int32 LoopCounter = 0;
+	while (StackPtr > 0)
+	{
+		if (++LoopCounter > MaxTileLoops)
+		{
+			return false;
+		}
+
+		const FGPULineBVHNode& Node = InNodes[Stack[--StackPtr]];
+		const int32 NodeIndex = static_cast<int32>(&Node - InNodes.GetData());
+
+		// 与着色器的IsValidNode一致
+		if (Node.LeftChild == -1 && Node.RightChild == -1 && Node.IsLeaf == 0)
+		{
+			continue;
+		}
+
+		if (!OverlapsFootprint(Node.MinExtent, Node.MaxExtent, InFootprint, InHalfWidth))
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf == 1)
+		{
+			if (OutLeafNodes.Num() >= MaxTileCandidates)
+			{
+				return false;
+			}
+			OutLeafNodes.Add(NodeIndex);
+			continue;
+		}
+
+		if (StackPtr + 2 > MaxStackNum)
+		{
+			return false;
+		}
+		if (Node.LeftChild != -1)
+		{
+			Stack[StackPtr++] = Node.LeftChild;
+		}
+		if (Node.RightChild != -1)
+		{
+			Stack[StackPtr++] = Node.RightChild;
+		}
+	}
+
+	return true;
+}
+
+bool FSurfaceTileCulling::CullPolygonBVH(TConstArrayView<FGPUPolygonBVHNode> InNodes, TConstArrayView<uint32> InNodeLayerMasks, uint32 InVisibleLayers, const FBox2f& InFootprint, TArray<int32>& OutLeafNodes)
+{
+	using namespace SurfaceTileCulling;
+
+	OutLeafNodes.Reset();
+	if (InNodes.IsEmpty())
+	{
+		return true;
+	}
+
+	// 入栈顺序与着色器的QueryBVH一致（先右后左，左子节点先出栈）
+	int32 Stack[MaxStackNum];
+	int32 StackPtr = 0;
+	Stack[StackPtr++] = 0;
+
+	int32 LoopCounter = 0;
+	while (StackPtr > 0)
+	{
+		if (++LoopCounter > MaxTileLoops)
+		{
+			return false;
+		}
+
+		const int32 NodeIndex = Stack[--StackPtr];
+		const FGPUPolygonBVHNode& Node = InNodes[NodeIndex];
+		if (!OverlapsFootprint(Node.MinExtent, Node.MaxExtent, InFootprint, 0.0f))
+		{
+			continue;
+		}
+
+		// 子树内没有可见图层的多边形
+		if ((InNodeLayerMasks[NodeIndex] & InVisibleLayers) == 0)
+		{
+			continue;
+		}
+
+		if (Node.IsLeaf())
+		{
+			if (OutLeafNodes.Num() >= MaxTileCandidates)
+			{
+				return false;
+			}
+			OutLeafNodes.Add(NodeIndex);
+			continue;
+		}
+
+		if (StackPtr + 2 > MaxStackNum)
+		{
+			return false;
+		}
+		Stack[StackPtr++] = Node.GetRightChild(NodeIndex);
+		Stack[StackPtr++] = FGPUPolygonBVHNode::GetLeftChild(NodeIndex);
+	}
+
+	return true;
+}
+
+void FSurfaceTileCulling::CullLineTiles(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, const FGPULineData& InData, float InMaxLineWidth, bool bInUsePixelUnit, FSurfaceTileCandidates& OutCandidates)
+{
+	SurfaceTileCulling::CullTiles(InView, InDeviceDepth, bInUsePixelUnit,
+		[&InData, InMaxLineWidth, bInUsePixelUnit](const FBox2f& InFootprint, float InMaxPixelWorldSize, TArray<int32>& OutLeafNodes)
+		{
+			const float HalfWidth = 0.5f * InMaxLineWidth * (bInUsePixelUnit ? InMaxPixelWorldSize : 1.0f);
+			return CullLineBVH(InData.Nodes, InFootprint, HalfWidth, OutLeafNodes);
+		},
+		OutCandidates);
+}
+
+void FSurfaceTileCulling::CullPolygonTiles(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, const FGPUPolygonData& InData, const FPolygonLayerMasks& InLayerMasks, uint32 InVisibleLayers, FSurfaceTileCandidates& OutCandidates)
+{
+	SurfaceTileCulling::CullTiles(InView, InDeviceDepth, false,
+		[&InData, &InLayerMasks, InVisibleLayers](const FBox2f& InFootprint, float InMaxPixelWorldSize, TArray<int32>& OutLeafNodes)
+		{
+			return CullPolygonBVH(InData.Nodes, InLayerMasks.NodeLayerMasks, InVisibleLayers, InFootprint, OutLeafNodes);
+		},
+		OutCandidates);
+}
+
+FSurfaceTileCullingCheck FSurfaceTileCulling::CheckTileCandidates(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, const FSurfaceTileCandidates& InCandidates, FCullPixelFunction InCullPixel)
+{
+	const int32 ViewportWidth = InView.ViewportRect.Width();
+	const int32 ViewportHeight = InView.ViewportRect.Height();
+	check(InDeviceDepth.Num() == ViewportWidth * ViewportHeight);
+
+	// 以像素位置为退化覆盖范围剔除即为逐像素遍历，其访问的叶子节点序列必须是分块候选的子序列
+	TArray<int32> RowMismatches;
+	RowMismatches.SetNumZeroed(ViewportHeight);
+	TArray<int64> RowPixelLeafNodes;
+	RowPixelLeafNodes.SetNumZeroed(ViewportHeight);
+	ParallelFor(ViewportHeight, [&](int32 Y)
+		{
+			TArray<int32> PixelLeafNodes;
+			for (int32 X = 0; X < ViewportWidth; ++X)
+			{
+				const float PixelDepth = InDeviceDepth[Y * ViewportWidth + X];
+				const int32 TileX = X / TileSize;
+				const int32 TileY = Y / TileSize;
+				if (PixelDepth <= 0.0f || InCandidates.TileOverflow[TileY * InCandidates.NumTilesX + TileX])
+				{
+					continue;
+				}
+
+				const FVector2f ScreenPosition(InView.ViewportRect.Min.X + X + 0.5f, InView.ViewportRect.Min.Y + Y + 0.5f);
+				const FVector3f WorldPosition = ScreenToWorldPosition(InView, ScreenPosition, PixelDepth);
+				if (!InCullPixel(WorldPosition, ScreenPosition, PixelLeafNodes))
+				{
+					continue;
+				}
+				RowPixelLeafNodes[Y] += PixelLeafNodes.Num();
+
+				const TConstArrayView<int32> Candidates = InCandidates.GetTileCandidates(TileX, TileY);
+				int32 CandidateIndex = 0;
+				for (const int32 LeafNode : PixelLeafNodes)
+				{
+					while (CandidateIndex < Candidates.Num() && Candidates[CandidateIndex] != LeafNode)
+					{
+						++CandidateIndex;
+					}
+					if (CandidateIndex == Candidates.Num())
+					{
+						++RowMismatches[Y];
+						break;
+					}
+				}
+			}
+		},
+		ViewportHeight < 2 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	FSurfaceTileCullingCheck Result;
+	Result.NumPixels = ViewportWidth * ViewportHeight;
+	for (int32 Y = 0; Y < ViewportHeight; ++Y)
+	{
+		Result.NumMismatches += RowMismatches[Y];
+		Result.NumPixelLeafNodes += RowPixelLeafNodes[Y];
+	}
+	return Result;
+}
+
+FString FSurfaceTileCandidates::DescribeStats() const
+{
+	const int32 NumTiles = NumTilesX * NumTilesY;
+	const int32 NumOverflowTiles = Algo::Count(TileOverflow, true);
+	const int32 NumCandidateTiles = FMath::Max(NumTiles - NumEmptyTiles - NumOverflowTiles, 1);
+	return FString::Printf(TEXT("%d 个分块, 空分块 %.1f%%, 溢出分块 %d 个, 非空分块平均候选 %.1f 个"),
+		NumTiles, 100.0 * NumEmptyTiles / FMath::Max(NumTiles, 1), NumOverflowTiles,
+		static_cast<double>(Candidates.Num()) / NumCandidateTiles);
+}
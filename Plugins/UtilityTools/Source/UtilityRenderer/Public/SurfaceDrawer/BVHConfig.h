@@ -11,6 +11,14 @@ enum class EBVHBuildStrategy : uint8
 	Middle      UMETA(DisplayName = "Middle Split")
 };
 
+UENUM(BlueprintType)
+enum class ESurfacePolygonRenderMode : uint8
+{
+	FullscreenBVH   UMETA(DisplayName = "Fullscreen BVH Traversal"),
+	StencilVolume   UMETA(DisplayName = "Stencil Shadow Volume"),
+	TiledCompute    UMETA(DisplayName = "Tiled Compute")
+};
+
 USTRUCT(BlueprintType)
 struct UTILITYRENDERER_API FBVHBuildConfig
 {
@@ -118,4 +126,100 @@ struct UTILITYRENDERER_API FTriangle
 		Box += Vertex3;
 		return Box;
 	}
+};
+
+// 线段查询结果
+USTRUCT(BlueprintType)
+struct UTILITYRENDERER_API FSurfaceLineHit
+{
+	GENERATED_BODY()
+
+	/// \brief 线段所属多边形索引
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	int32 PolygonIndex = -1;
+
+	/// \brief 线段在线段数据中的索引
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	int32 SegmentIndex = -1;
+
+	/// \brief 距离：点查询为点到线段的距离，射线查询为沿射线的距离
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	float Distance = 0.0f;
+
+	/// \brief 线段上的参数位置 [0, 1]（0为起点，1为终点）
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	float T = 0.0f;
+
+	/// \brief 线段上的最近点或交点（XY平面）
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	FVector Location = FVector::ZeroVector;
+
+	bool IsValid() const { return SegmentIndex >= 0; }
+};
+
+// 线样式，多边形通过样式索引引用
+USTRUCT(BlueprintType)
+struct UTILITYRENDERER_API FSurfaceLineStyle
+{
+	GENERATED_BODY()
+
+	/// \brief 线宽（bUsePixelUnit时为像素）
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH", meta = (ClampMin = "0"))
+	float LineWidth = 2.0f;
+
+	/// \brief 线不透明度
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH", meta = (ClampMin = "0", ClampMax = "1"))
+	float LineOpacity = 0.5f;
+
+	/// \brief 线颜色
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH")
+	FLinearColor LineColor = FLinearColor::Green;
+
+	/// \brief 自定义纹理图集槽位，-1表示使用线颜色
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH", meta = (ClampMin = "-1"))
+	int32 AtlasSlot = -1;
+};
+
+// 地表点，贴地绘制为圆或图标
+USTRUCT(BlueprintType)
+struct UTILITYRENDERER_API FSurfacePoint
+{
+	GENERATED_BODY()
+
+	/// \brief 点位置（只使用XY）
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH")
+	FVector Location = FVector::ZeroVector;
+
+	/// \brief 半径（bUsePixelUnit时为像素）
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH", meta = (ClampMin = "0"))
+	float Radius = 50.0f;
+
+	/// \brief 颜色，使用图标时作为图标的染色
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH")
+	FLinearColor Color = FLinearColor::Red;
+
+	/// \brief 图标纹理图集槽位，-1表示绘制为纯色圆
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "BVH", meta = (ClampMin = "-1"))
+	int32 IconSlot = -1;
+};
+
+// 点查询结果
+USTRUCT(BlueprintType)
+struct UTILITYRENDERER_API FSurfacePointHit
+{
+	GENERATED_BODY()
+
+	/// \brief 点在输入点数组中的索引
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	int32 PointIndex = -1;
+
+	/// \brief 查询位置到点的距离（XY平面）
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	float Distance = 0.0f;
+
+	/// \brief 点位置（XY平面）
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "BVH")
+	FVector Location = FVector::ZeroVector;
+
+	bool IsValid() const { return PointIndex >= 0; }
 };
\ No newline at end of file
@@ -0,0 +1,200 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+#include "SurfaceDirtyRanges.h"
+
+#include <atomic>
+
+
+class FRDGBuilder;
+
+/**
+ * @brief 一维元素范围的分配器，只记录偏移，不持有数据
+ *
+ * 空闲范围按偏移排序并在释放时与相邻的空闲范围合并，分配时取第一个放得下的空闲范围（first fit），
+ * 没有放得下的空闲范围时按两倍扩大容量。分配通过句柄访问，Compact之后句柄不变，偏移可能变化。
+ */
+class UTILITYRENDERER_API FSurfaceRangeAllocator
+{
+public:
+	/// \brief 紧凑排列时需要拷贝的一段元素
+	struct FMove
+	{
+		int32 SrcOffset;	///< 原偏移
+		int32 DestOffset;	///< 新偏移
+		int32 Num;			///< 元素数量
+	};
+
+	/// \brief 分配InNumElements个连续的元素
+	/// \return 分配句柄
+	int32 Allocate(int32 InNumElements);
+
+	/// \brief 释放分配，INDEX_NONE忽略
+	void Free(int32 InHandle);
+
+	bool IsValidHandle(int32 InHandle) const { return Allocations.IsValidIndex(InHandle); }
+	int32 GetOffset(int32 InHandle) const { return Allocations[InHandle].Offset; }
+	int32 GetSize(int32 InHandle) const { return Allocations[InHandle].Size; }
+
+	/// \brief 使用量低于容量的四分之一时值得紧凑排列
+	bool ShouldCompact() const;
+
+	/// \brief 计算紧凑排列需要的拷贝，不修改分配；之后分配不变时Compact得到相同的排列
+	/// \param OutMoves 需要拷贝的范围，相邻的分配合并为一段
+	/// \return 紧凑排列后的容量
+	int32 PlanCompact(TArray<FMove>& OutMoves) const;
+
+	/// \brief 按偏移顺序把所有分配移到缓冲区开头，容量缩小到使用量的两倍
+	/// \param OutMoves 需要拷贝的范围，相邻的分配合并为一段
+	void Compact(TArray<FMove>& OutMoves);
+
+	/// \brief 释放所有分配，容量清零
+	void Reset();
+
+	int32 GetCapacity() const { return Capacity; }
+	int32 GetNumUsedElements() const { return NumUsedElements; }
+	int32 GetNumAllocations() const { return Allocations.Num(); }
+	int32 GetNumFreeRanges() const { return FreeRanges.Num(); }
+
+	/// \brief 遍历所有分配的偏移和大小（测试用）
+	template <typename FuncType>
+	void ForEachAllocation(FuncType&& Func) const
+	{
+		for (TSparseArray<FBlock>::TConstIterator It(Allocations); It; ++It)
+		{
+			Func(It.GetIndex(), It->Offset, It->Size);
+		}
+	}
+
+	/// \brief 遍历所有空闲范围，按偏移排序（测试用）
+	template <typename FuncType>
+	void ForEachFreeRange(FuncType&& Func) const
+	{
+		for (const FBlock& Block : FreeRanges)
+		{
+			Func(Block.Offset, Block.Size);
+		}
+	}
+
+private:
+	struct FBlock
+	{
+		int32 Offset;
+		int32 Size;
+	};
+
+	/// \brief 所有分配的句柄，按偏移排序
+	void GetHandlesByOffset(TArray<int32>& OutHandles) const;
+
+	/// \brief 插入空闲范围并与相邻的空闲范围合并
+	void AddFreeRange(int32 InOffset, int32 InSize);
+
+	/// \brief 扩大容量，保证存在至少InNumElements个连续的空闲元素
+	void Grow(int32 InNumElements);
+
+	TSparseArray<FBlock> Allocations;
+	TArray<FBlock> FreeRanges;		///< 按偏移排序，互不相邻
+	int32 Capacity = 0;
+	int32 NumUsedElements = 0;
+};
+
+/**
+ * @brief 多个代理共用的结构化缓冲区
+ *
+ * 每种数据只有一个池化缓冲区，代理通过FSurfaceRangeAllocator分配其中的一段并保存分配句柄，
+ * 渲染时用分配的偏移访问自己的数据。相比每个代理各自创建缓冲区，减少了池化缓冲区、SRV和RegisterExternalBuffer的数量，
+ * 多个代理也可以直接用同一组缓冲区合并绘制。
+ *
+ * 容量增长时在下一次GetBuffer创建更大的缓冲区并在GPU上拷贝原有的分配；
+ * Defragment在每帧剩余的上传预算内把分配逐步拷贝到较小的新缓冲区，全部拷贝完成后才切换缓冲区和偏移，
+ * 期间分配或上传发生变化时放弃本次整理。只应在没有上传进行中时调用Defragment。仅渲染线程访问。
+ */
+class UTILITYRENDERER_API FSurfaceBufferArena
+{
+public:
+	FSurfaceBufferArena(const TCHAR* InName, uint32 InBytesPerElement);
+	~FSurfaceBufferArena();
+
+	FSurfaceBufferArena(const FSurfaceBufferArena&) = delete;
+	FSurfaceBufferArena& operator=(const FSurfaceBufferArena&) = delete;
+
+	/// \brief 分配InNumElements个元素（至少一个），内容未初始化
+	/// \return 分配句柄
+	int32 Allocate(int32 InNumElements);
+
+	/// \brief 释放分配并把句柄置为INDEX_NONE
+	void Free(int32& InOutAllocation);
+
+	/// \brief 分配在缓冲区中的元素偏移
+	int32 GetOffset(int32 InAllocation) const { return Allocator.GetOffset(InAllocation); }
+	int32 GetSize(int32 InAllocation) const { return Allocator.GetSize(InAllocation); }
+
+	/// \brief 本帧的缓冲区，容量增长后创建更大的缓冲区并在GPU上拷贝已分配的范围，拷贝量计入本帧的上传量
+	FRDGBufferRef GetBuffer(FRDGBuilder& GraphBuilder);
+
+	/// \brief 本帧缓冲区的SRV，同一次渲染中缓冲区没有扩容或整理时复用，所有Pass共用
+	FRDGBufferSRVRef GetSRV(FRDGBuilder& GraphBuilder);
+
+	/// \brief 丢弃上一次渲染创建的SRV，每次渲染开始时调用
+	void ResetSRV();
+
+	/// \brief 上传数据到分配中从InElementOffset开始的范围，计入本帧的上传量
+	void Upload(FRDGBuilder& GraphBuilder, int32 InAllocation, int32 InElementOffset, const void* InData, int32 InNumElements);
+
+	/// \brief 只上传源数据中被修改的范围
+	///
+	/// 源数据超出分配大小时按两倍重新分配，原有的前InNumValidElements个元素在GPU上拷贝到新的分配，再写入修改的范围。
+	/// \param InOutAllocation 已有的分配，重新分配时替换为新的句柄
+	/// \param InNumValidElements 分配中原有的有效元素数量
+	void UploadDirtyRanges(FRDGBuilder& GraphBuilder, int32& InOutAllocation, const void* InData, int32 InNumElements, int32 InNumValidElements, const FSurfaceDirtyRanges& InDirtyRanges);
+
+	/// \brief 空闲空间较多时开始整理，在本帧剩余的上传预算内继续拷贝到新的缓冲区，没有分配时释放缓冲区
+	/// \return 本帧整理完成、分配的偏移已变化时返回true
+	bool Defragment(FRDGBuilder& GraphBuilder);
+
+	/// \brief 是否有尚未完成的整理
+	bool IsDefragmenting() const { return DefragPooledBuffer.IsValid(); }
+
+	/// \brief 释放缓冲区和所有分配
+	void Release();
+
+	uint32 GetBytesPerElement() const { return BytesPerElement; }
+	const FSurfaceRangeAllocator& GetAllocator() const { return Allocator; }
+
+	/// \brief 所有共享缓冲区的容量和已分配的字节数
+	static int64 GetTotalCapacityBytes() { return TotalCapacityBytes.load(std::memory_order_relaxed); }
+	static int64 GetTotalUsedBytes() { return TotalUsedBytes.load(std::memory_order_relaxed); }
+
+	/// \brief 所有共享缓冲区紧凑排列的累计次数
+	static uint32 GetNumDefragments() { return NumDefragments.load(std::memory_order_relaxed); }
+
+private:
+	/// \brief 分配器的容量或使用量变化后更新全局统计
+	void UpdateStats();
+
+	/// \brief 放弃尚未完成的整理，旧缓冲区和偏移保持不变
+	void CancelDefragment();
+
+	const TCHAR* Name;
+	uint32 BytesPerElement;
+	FSurfaceRangeAllocator Allocator;
+	TRefCountPtr<FRDGPooledBuffer> PooledBuffer;
+
+	// 本次渲染的SRV及其对应的缓冲区，只在一次渲染内有效
+	FRDGBufferRef SRVBuffer = nullptr;
+	FRDGBufferSRVRef SRV = nullptr;
+
+	// 分帧整理：目标缓冲区、拷贝列表以及已完成的拷贝，完成前继续使用PooledBuffer和原来的偏移
+	TRefCountPtr<FRDGPooledBuffer> DefragPooledBuffer;
+	TArray<FSurfaceRangeAllocator::FMove> DefragMoves;
+	int32 DefragMoveIndex = 0;			///< 正在拷贝的范围
+	int32 DefragMovedElements = 0;		///< 正在拷贝的范围已拷贝的元素数量
+
+	int64 StatCapacityBytes = 0;		///< 已计入全局统计的容量
+	int64 StatUsedBytes = 0;			///< 已计入全局统计的使用量
+
+	static std::atomic<int64> TotalCapacityBytes;
+	static std::atomic<int64> TotalUsedBytes;
+	static std::atomic<uint32> NumDefragments;
+};
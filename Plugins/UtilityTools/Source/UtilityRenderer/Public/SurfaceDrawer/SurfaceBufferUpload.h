@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+
+#include <atomic>
+
+
+class FRDGBuilder;
+class FSurfaceBufferArena;
+
+/// \brief 分帧上传的一段源数据，数据和目标分配由调用方持有
+struct FSurfaceBufferUploadSource
+{
+	FSurfaceBufferArena* Arena = nullptr;	///< 目标共享缓冲区
+	int32 Allocation = INDEX_NONE;			///< 目标共享缓冲区中的分配，大小不小于NumElements
+	const void* Data = nullptr;				///< 源数据
+	int32 NumElements = 0;					///< 元素数量
+};
+
+/**
+ * @brief 分帧上传一组几何数据
+ *
+ * 几何数据变化时，代理不在同一帧内上传全部数据，而是在共享缓冲区中分配一组新的范围，
+ * 每帧在r.SurfaceDrawer.UploadBudgetKB的预算内按块写入（所有代理共用每帧的预算）：
+ * 每块先上传到临时缓冲区，再拷贝到共享缓冲区的对应范围。
+ * 全部写入后由调用方一次性替换旧的分配和旧数据，完成前旧的分配继续用于渲染，画面不会出现部分更新的数据。
+ *
+ * 源数据和目标分配在上传完成或Reset之前必须保持有效。仅渲染线程访问。
+ */
+class UTILITYRENDERER_API FSurfaceBufferUpload
+{
+public:
+	/// \brief 开始上传一组数据，丢弃尚未完成的上一次上传
+	void Begin(TConstArrayView<FSurfaceBufferUploadSource> InSources);
+
+	/// \brief 在本帧剩余的预算内继续上传
+	/// \return 所有数据都已写入时返回true
+	bool Advance(FRDGBuilder& GraphBuilder);
+
+	/// \brief 是否有尚未完成的上传
+	bool IsActive() const { return Sources.Num() > 0; }
+
+	/// \brief 丢弃尚未完成的上传
+	void Reset();
+
+	/// \brief 上传一段数据到目标缓冲区的指定范围：先上传到临时缓冲区，再在GPU上拷贝，计入本帧的上传量
+	/// \param InDestOffset 目标缓冲区中的字节偏移
+	static void AddRangeUpload(FRDGBuilder& GraphBuilder, FRDGBufferRef InDestBuffer, uint64 InDestOffset, const void* InData, uint32 InBytesPerElement, int32 InNumElements);
+
+	/// \brief 每帧的上传预算（字节），r.SurfaceDrawer.UploadBudgetKB为0时不限制
+	static uint64 GetBudgetBytes();
+
+	/// \brief 本帧剩余的上传预算（字节），r.SurfaceDrawer.UploadBudgetKB为0时不限制
+	/// \param InMinBytes 本帧尚未上传任何数据时至少允许的字节数，保证预算小于单个元素时每帧仍有进展
+	static uint64 GetFrameBudget(uint64 InMinBytes);
+
+	/// \brief 记录本帧上传的字节数
+	static void CommitFrameUpload(uint64 InNumBytes);
+
+	/// \brief 最近一个有上传的帧（不含当前帧）中所有代理上传的字节数
+	static uint64 GetLastFrameUploadBytes() { return LastFrameUploadBytes.load(std::memory_order_relaxed); }
+
+	/// \brief 最近一次完成的上传从开始到完成的耗时（秒）和跨越的帧数
+	static double GetLastUploadSeconds() { return LastUploadSeconds.load(std::memory_order_relaxed); }
+	static uint32 GetLastUploadFrames() { return LastUploadFrames.load(std::memory_order_relaxed); }
+
+private:
+	TArray<FSurfaceBufferUploadSource> Sources;
+	int32 SourceIndex = 0;			///< 正在上传的源数据
+	int32 UploadedElements = 0;		///< 正在上传的源数据已写入的元素数量
+	double StartTime = 0.0;
+	uint32 StartFrameNumber = 0;
+
+	static std::atomic<uint64> LastFrameUploadBytes;
+	static std::atomic<double> LastUploadSeconds;
+	static std::atomic<uint32> LastUploadFrames;
+};
@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+
+/// \brief 等值线输入网格，高度按行优先排列（X变化最快），可以是地形高度图或任意标量场
+struct FContourGridDesc
+{
+	TConstArrayView<float> Heights;	///< 网格点数值，数量为SizeX * SizeY
+	int32 SizeX;					///< X方向网格点数量
+	int32 SizeY;					///< Y方向网格点数量
+	FVector2D Origin;				///< 网格点(0, 0)的世界坐标
+	FVector2D CellSize;				///< 相邻网格点的世界间距
+
+	FContourGridDesc()
+		: SizeX(0), SizeY(0), Origin(FVector2D::ZeroVector), CellSize(FVector2D::UnitVector)
+	{
+	}
+
+	FContourGridDesc(TConstArrayView<float> InHeights, int32 InSizeX, int32 InSizeY, const FVector2D& InOrigin, const FVector2D& InCellSize)
+		: Heights(InHeights), SizeX(InSizeX), SizeY(InSizeY), Origin(InOrigin), CellSize(InCellSize)
+	{
+	}
+};
+
+/// \brief 等值线折线集合，所有折线的顶点连续存放，可直接交给线BVH构建
+struct FContourPolylineSet
+{
+	TArray<FVector2f> Vertices;		///< 折线顶点（世界XY坐标），闭合折线首尾顶点相同
+	TArray<int32> PolylineOffsets;	///< 每条折线首顶点在Vertices中的偏移，末尾额外一项为顶点总数
+	TArray<int32> PolylineLevels;	///< 每条折线对应的等值线索引
+
+	/// \brief 折线数量
+	int32 Num() const { return PolylineLevels.Num(); }
+
+	void Reset()
+	{
+		Vertices.Reset();
+		PolylineOffsets.Reset();
+		PolylineLevels.Reset();
+	}
+};
+
+/// \brief 等值线生成统计信息
+struct FContourBuildStats
+{
+	int32 NumTiles;				///< 分块数量
+	int32 NumSegments;			///< 行进方格生成的线段数量
+	int32 NumPolylines;			///< 拼接后的折线数量
+	double BuildTimeMs;			///< 耗时（毫秒）
+
+	FContourBuildStats()
+		: NumTiles(0), NumSegments(0), NumPolylines(0), BuildTimeMs(0.0)
+	{
+	}
+};
+
+/**
+ * @brief 等值线生成器，使用行进方格（Marching Squares）从网格生成等值线
+ *
+ * 网格按分块并行处理：每个分块对每个等值依次生成线段，并借助分块内的稠密边索引拼接为折线段，
+ * 折线段端点以所在网格边为键，之后按等值并行地把跨分块的折线段首尾相连。
+ * 交点只由网格边两端的数值决定，相邻分块在公共边上得到完全相同的顶点。
+ * 鞍点方格使用方格中心均值消除歧义。
+ */
+class UTILITYRENDERER_API FSurfaceContourBuilder
+{
+public:
+	/// \brief 生成等值线
+	/// \param InIsoLevels 等值列表，输出折线按等值索引排列
+	/// \param InTileSize 分块边长（方格数），0表示使用默认值
+	/// \return 生成至少一条折线时返回true
+	static bool Build(
+		const FContourGridDesc& InGrid,
+		TConstArrayView<float> InIsoLevels,
+		FContourPolylineSet& OutPolylines,
+		int32 InTileSize = 0,
+		FContourBuildStats* OutStats = nullptr);
+};
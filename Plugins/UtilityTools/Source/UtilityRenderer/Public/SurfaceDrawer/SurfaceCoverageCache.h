@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+#include "ShaderParameterMacros.h"
+
+#include <atomic>
+
+
+class FRDGBuilder;
+class FSceneView;
+
+/// \brief 覆盖缓存着色器参数，对应SurfaceCoverageCache.ush
+BEGIN_SHADER_PARAMETER_STRUCT(FSurfaceCoverageCacheParameters, UTILITYRENDERER_API)
+	SHADER_PARAMETER_RDG_TEXTURE(Texture2D<uint4>, CoverageHistoryTexture)			// 上一帧的覆盖结果
+	SHADER_PARAMETER_RDG_TEXTURE_UAV(RWTexture2D<uint4>, CoverageOutputTexture)	// 本帧的覆盖结果
+	SHADER_PARAMETER(FIntPoint, CoverageOrigin)										// 覆盖纹理左上角对应的屏幕像素（ScissorRect.Min）
+	SHADER_PARAMETER(float, CoverageDepthTolerance)									// 复用覆盖结果时设备深度允许的相对差
+	SHADER_PARAMETER(uint32, bCoverageHistoryValid)									// 上一帧的覆盖结果是否可用
+END_SHADER_PARAMETER_STRUCT()
+
+/// \brief 覆盖结果的缓存键，任一字段变化时整个缓存失效
+struct FSurfaceCoverageCacheKey
+{
+	FMatrix ViewProjMatrix;			///< 不含TAA/TSR抖动的视图投影矩阵
+	FIntRect ViewportRect;			///< 视口矩形
+	FIntRect ScissorRect;			///< 代理的屏幕范围
+	FIntPoint TextureExtent;		///< 场景纹理尺寸
+	uint32 GeometryGeneration;		///< 几何缓冲区版本
+	uint32 AttributeGeneration;		///< 样式/图层缓冲区版本
+	uint32 Parameters;				///< 影响覆盖结果的其他参数（线宽单位、可见图层等）
+
+	FSurfaceCoverageCacheKey()
+		: ViewProjMatrix(FMatrix::Identity)
+		, ViewportRect(0, 0, 0, 0)
+		, ScissorRect(0, 0, 0, 0)
+		, TextureExtent(0, 0)
+		, GeometryGeneration(0)
+		, AttributeGeneration(0)
+		, Parameters(0)
+	{
+	}
+
+	bool operator==(const FSurfaceCoverageCacheKey& Other) const
+	{
+		return ViewProjMatrix.Equals(Other.ViewProjMatrix, 0.0)
+			&& ViewportRect == Other.ViewportRect
+			&& ScissorRect == Other.ScissorRect
+			&& TextureExtent == Other.TextureExtent
+			&& GeometryGeneration == Other.GeometryGeneration
+			&& AttributeGeneration == Other.AttributeGeneration
+			&& Parameters == Other.Parameters;
+	}
+};
+
+/**
+ * @brief 代理覆盖结果的时间缓存
+ *
+ * 全屏Pass额外输出一张覆盖纹理（设备深度、距离、纹理坐标和多边形索引），保留到下一帧。
+ * 覆盖纹理只覆盖代理的屏幕范围（ScissorRect），由像素着色器通过UAV写入，显存随代理在屏幕上的大小变化。
+ * 下一帧的缓存键与上一帧一致时，着色器逐像素比较设备深度，深度相近的像素直接读取上一帧的覆盖结果，
+ * 只重新合成颜色（场景颜色、样式和模板值每帧重新读取），深度变化的像素（如移动的物体）重新遍历BVH。
+ * 缓存键使用不含抖动的视图投影矩阵，深度比较允许r.SurfaceDrawer.CoverageCacheDepthTolerance的相对差，
+ * 因此开启TAA/TSR时静止视图也能命中；复用的覆盖结果不随抖动变化，叠加层的边缘不参与时间抗锯齿。
+ *
+ * 只在主视图中使用，每个代理一份缓存（渲染线程访问）。
+ */
+class UTILITYRENDERER_API FSurfaceCoverageCache
+{
+public:
+	static constexpr EPixelFormat CoverageTextureFormat = PF_R32G32B32A32_UINT;
+
+	/// \brief 是否开启覆盖缓存（r.SurfaceDrawer.CoverageCache）
+	static bool IsEnabled();
+
+	/// \brief 不含TAA/TSR抖动的视图投影矩阵，作为缓存键
+	static FMatrix GetUnjitteredViewProjection(const FSceneView& InView);
+
+	/// \brief 创建本帧的覆盖纹理（InKey.ScissorRect大小）并填写着色器参数，覆盖纹理在图执行后保留为下一帧的历史
+	/// \param InKey 本帧的缓存键，与上一帧一致时计为命中并绑定上一帧的覆盖纹理
+	/// \param OutParameters 着色器参数
+	void AddCoverageTexture(FRDGBuilder& GraphBuilder, const FSurfaceCoverageCacheKey& InKey, FSurfaceCoverageCacheParameters& OutParameters);
+
+	/// \brief 释放历史纹理（渲染线程）
+	void Release_RenderThread();
+
+	/// \brief 所有代理累计的缓存命中次数（每个代理每帧计一次）
+	static uint64 GetNumHits() { return NumHits.load(std::memory_order_relaxed); }
+
+	/// \brief 所有代理累计的缓存失效次数
+	static uint64 GetNumMisses() { return NumMisses.load(std::memory_order_relaxed); }
+
+	/// \brief 清零命中和失效计数
+	static void ResetCounters();
+
+private:
+	FSurfaceCoverageCacheKey Key;
+	TRefCountPtr<IPooledRenderTarget> HistoryTexture;
+
+	static std::atomic<uint64> NumHits;
+	static std::atomic<uint64> NumMisses;
+};
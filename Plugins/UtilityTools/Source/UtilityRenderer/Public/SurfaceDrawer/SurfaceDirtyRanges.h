@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * @brief 数组中被修改的元素范围
+ *
+ * 局部修改GPU数据时记录被修改的元素，上传时只写入这些范围。Add可以按任意顺序追加，
+ * Normalize按起点排序并合并重叠、相邻以及间隔较小的范围，减少拷贝Pass的数量。
+ */
+struct UTILITYRENDERER_API FSurfaceDirtyRanges
+{
+	/// \brief 一段连续的元素
+	struct FRange
+	{
+		int32 Start;	///< 起始元素
+		int32 Num;		///< 元素数量
+	};
+
+	/// \brief 追加一段被修改的元素
+	void Add(int32 InStart, int32 InNum);
+
+	/// \brief 追加另一组范围
+	void Append(const FSurfaceDirtyRanges& InOther) { Ranges.Append(InOther.Ranges); }
+
+	/// \brief 按起点排序，合并重叠或间隔不超过InMaxGap个元素的范围
+	void Normalize(int32 InMaxGap);
+
+	/// \brief 所有范围的元素总数，Normalize之后不含重复的元素
+	int32 GetNumElements() const;
+
+	bool IsEmpty() const { return Ranges.Num() == 0; }
+	TConstArrayView<FRange> GetRanges() const { return Ranges; }
+	void Reset() { Ranges.Reset(); }
+
+private:
+	TArray<FRange> Ranges;
+};
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+
+#include "SurfaceLineBuilder.h"
+#include "SurfacePolygonBuilder.h"
+
+
+class FRDGBuilder;
+struct FSurfaceViewFootprint;
+
+/**
+ * @brief 按视图在地面上的覆盖范围剔除BVH的前几层，得到遍历的起始子树
+ *
+ * 着色器只比较反投影世界坐标的XY，因此每个节点的XY范围直接与视图覆盖范围（FSurfaceViewFootprint）求交，
+ * 与地表高度无关；覆盖范围外的子树不可能包含可见像素。
+ * 剔除到第NumLevels层（或更早遇到的叶子节点）为止，剩余子树的根节点按着色器遍历的出栈顺序输出，
+ * 着色器把它们逆序压栈后遍历，访问叶子节点的顺序与从根节点开始遍历时相同，首个命中的结果不变。
+ */
+class UTILITYRENDERER_API FSurfaceFrustumCulling
+{
+public:
+	static constexpr int32 MaxSeedLevels = 4;					///< 最多剔除的层数
+	static constexpr int32 MaxSeedNodes = 1 << MaxSeedLevels;	///< 起始子树不超过16个，只占着色器64项遍历栈的四分之一，其余留给子树内的遍历
+
+	/// \brief 剔除线BVH（出栈顺序：右子节点先于左子节点）
+	/// \param InWorldPadding 包围盒XY外扩量（世界单位线宽的一半）
+	/// \param OutSeedNodes 起始子树的根节点索引；全部剔除时为空
+	static void CullLineSubtrees(TConstArrayView<FGPULineBVHNode> InNodes, const FSurfaceViewFootprint& InFootprint, float InWorldPadding, int32 InNumLevels, TArray<uint32>& OutSeedNodes);
+
+	/// \brief 剔除多边形BVH（出栈顺序：左子节点先于右子节点），同时剔除不含可见图层的子树
+	static void CullPolygonSubtrees(TConstArrayView<FGPUPolygonBVHNode> InNodes, TConstArrayView<uint32> InNodeLayerMasks, uint32 InVisibleLayers, const FSurfaceViewFootprint& InFootprint,
+		int32 InNumLevels, TArray<uint32>& OutSeedNodes);
+
+	/// \brief 计算代理的起始子树：r.SurfaceDrawer.SeedCullLevels不大于0时只返回根节点
+	/// \param InPixelPadding 视锥侧面外扩的像素数（像素单位线宽的一半）
+	static void CalculateLineSeedNodes(const FGPULineData& InData, const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, float InWorldPadding, float InPixelPadding, TArray<uint32>& OutSeedNodes);
+
+	/// \brief 计算多边形代理的起始子树，规则同CalculateLineSeedNodes
+	static void CalculatePolygonSeedNodes(const FGPUPolygonData& InData, TConstArrayView<uint32> InNodeLayerMasks, uint32 InVisibleLayers, const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, TArray<uint32>& OutSeedNodes);
+
+	/// \brief 上传遍历的起始子树（每帧每个代理几十字节），为空时上传一个占位元素
+	static FRDGBufferSRVRef CreateSeedNodesSRV(FRDGBuilder& GraphBuilder, const TCHAR* InName, TConstArrayView<uint32> InSeedNodes);
+};
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfaceLineBuilder.h"
+
+
+/// \brief 经纬度到本地平面坐标的投影
+///
+/// 以原点为中心的局部等距投影：X指向东，Y指向南（与UE左手坐标系俯视时的地图方向一致），
+/// 先以双精度减去原点再转为单精度，远离原点时不损失精度。适用于城市到省级范围的数据，
+/// 范围更大时距离误差随纬度跨度增大。已经是投影坐标（米）的数据只做平移和缩放。
+struct FGeoJsonProjection
+{
+	FVector2D Origin;			///< 原点（经度、纬度，或投影坐标系中的X、Y）
+	double UnitsPerMeter;		///< 每米对应的世界单位，默认厘米
+	bool bProjectedMeters;		///< 输入坐标已经是以米为单位的投影坐标
+
+	FGeoJsonProjection()
+		: Origin(FVector2D::ZeroVector), UnitsPerMeter(100.0), bProjectedMeters(false)
+	{
+	}
+
+	FGeoJsonProjection(const FVector2D& InOrigin, double InUnitsPerMeter = 100.0, bool bInProjectedMeters = false)
+		: Origin(InOrigin), UnitsPerMeter(InUnitsPerMeter), bProjectedMeters(bInProjectedMeters)
+	{
+	}
+};
+
+/// \brief GeoJSON导入选项
+struct FGeoJsonImportOptions
+{
+	FGeoJsonProjection Projection;	///< 坐标投影
+	bool bImportLines;				///< 输出LineString/MultiLineString折线
+	bool bImportPolygonOutlines;	///< 把Polygon/MultiPolygon的每个环输出为折线
+	bool bImportPolygonRings;		///< 输出用于填充的多边形环
+	int32 FeaturesPerBatch;			///< 每批要素数量，0表示使用默认值
+
+	FGeoJsonImportOptions()
+		: bImportLines(true), bImportPolygonOutlines(true), bImportPolygonRings(true), FeaturesPerBatch(0)
+	{
+	}
+};
+
+/// \brief 一批解析完成的要素，按要素在文件中的顺序排列
+struct FGeoJsonFeatureBatch
+{
+	int32 FirstFeatureIndex = 0;			///< 本批第一个要素在文件中的索引
+	int32 NumFeatures = 0;					///< 本批要素数量（包含跳过的要素）
+	int32 NumSkippedFeatures = 0;			///< 几何类型不支持或解析失败而跳过的要素数量
+
+	FSurfacePolygonSoup Polylines;			///< 折线（线要素以及多边形轮廓），闭合环首尾顶点相同
+	TArray<int32> PolylineFeatureIndices;	///< 每条折线所属的要素索引
+
+	FSurfacePolygonSoup Rings;				///< 多边形环，外环已统一为逆时针、内环为顺时针
+	TArray<int32> RingFeatureIndices;		///< 每个环所属的要素索引，同一要素的环共同构成一个多边形
+
+	void Reset()
+	{
+		FirstFeatureIndex = 0;
+		NumFeatures = 0;
+		NumSkippedFeatures = 0;
+		Polylines.Reset();
+		PolylineFeatureIndices.Reset();
+		Rings.Reset();
+		RingFeatureIndices.Reset();
+	}
+
+	/// \brief 把另一批追加到末尾（调整顶点偏移）
+	void Append(const FGeoJsonFeatureBatch& InOther);
+};
+
+/// \brief GeoJSON导入统计信息
+struct FGeoJsonImportStats
+{
+	int64 NumBytes;				///< 文件大小
+	int32 NumFeatures;			///< 要素数量
+	int32 NumSkippedFeatures;	///< 跳过的要素数量
+	int32 NumPolylines;			///< 输出折线数量
+	int32 NumRings;				///< 输出多边形环数量
+	int64 NumVertices;			///< 输出顶点总数（折线与环）
+	int32 NumBatches;			///< 批次数量
+	bool bMemoryMapped;			///< 是否使用了内存映射
+	double ScanTimeMs;			///< 查找要素边界的耗时（毫秒）
+	double ParseTimeMs;			///< 并行解析的耗时（毫秒）
+	double TotalTimeMs;			///< 总耗时（毫秒，包含批次回调）
+
+	FGeoJsonImportStats()
+		: NumBytes(0), NumFeatures(0), NumSkippedFeatures(0), NumPolylines(0), NumRings(0), NumVertices(0), NumBatches(0)
+		, bMemoryMapped(false), ScanTimeMs(0.0), ParseTimeMs(0.0), TotalTimeMs(0.0)
+	{
+	}
+};
+
+/**
+ * @brief GeoJSON流式导入器，把线和多边形要素直接转换为扁平的折线/环数据
+ *
+ * 文件以内存映射方式读取（失败时整体读入内存），按顺序扫描一遍字符找出FeatureCollection中每个要素的字节范围，
+ * 只跟踪括号深度和字符串边界，不建立任何JSON对象。要素按批分组，每攒够一轮批次就并行解析：
+ * 解析器直接在映射内存上工作，键和字符串只以视图比较，数字由手写的解析函数转换，投影后的顶点直接写入批次数组。
+ * 批次按文件顺序交给回调，回调返回前不会继续扫描，内存占用与文件大小无关。
+ *
+ * 支持LineString、MultiLineString、Polygon、MultiPolygon以及其中的GeometryCollection，
+ * 也支持单个Feature/Geometry以及每行一个要素的GeoJSON序列。Point/MultiPoint计入跳过的要素。
+ */
+class UTILITYRENDERER_API FSurfaceGeoJsonImporter
+{
+public:
+	/// \brief 导入文件，按文件顺序逐批回调
+	/// \return 文件读取成功且至少输出一条折线或一个环时返回true
+	static bool ImportFile(
+		const FString& InFilePath,
+		const FGeoJsonImportOptions& InOptions,
+		TFunctionRef<void(FGeoJsonFeatureBatch& InBatch)> InOnBatch,
+		FGeoJsonImportStats* OutStats = nullptr);
+
+	/// \brief 导入文件，所有批次合并到一起
+	static bool ImportFile(
+		const FString& InFilePath,
+		const FGeoJsonImportOptions& InOptions,
+		FGeoJsonFeatureBatch& OutResult,
+		FGeoJsonImportStats* OutStats = nullptr);
+
+	/// \brief 导入内存中的GeoJSON文本
+	static bool ImportBuffer(
+		TConstArrayView64<uint8> InData,
+		const FGeoJsonImportOptions& InOptions,
+		TFunctionRef<void(FGeoJsonFeatureBatch& InBatch)> InOnBatch,
+		FGeoJsonImportStats* OutStats = nullptr);
+};
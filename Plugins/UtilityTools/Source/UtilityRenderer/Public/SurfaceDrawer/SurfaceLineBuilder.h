@@ -3,6 +3,7 @@
 #include "CoreMinimal.h"
 #include "Math/Bounds.h"
 #include "BVHConfig.h"
+#include "SurfaceDirtyRanges.h"
 
 struct FSegmentCluster;
 
@@ -23,13 +24,75 @@ struct FLineBVHNode
 	FLineBVHNode& operator=(const FLineBVHNode&) = delete;
 };
 
+/// \brief 扁平多边形数据：所有多边形的顶点连续存放，避免每个多边形单独分配
+///
+/// 构建完成后可通过移动或TSharedRef<const FSurfacePolygonSoup>交给组件，后台线程直接读取，不再复制。
+struct FSurfacePolygonSoup
+{
+	TArray<FVector2f> Vertices;			///< 所有多边形的顶点（XY）
+	TArray<int32> PolygonOffsets;		///< 每个多边形首顶点在Vertices中的偏移，末尾额外一项为顶点总数
+	TArray<int32> PolygonStyleIndices;	///< 可选：每个多边形的样式索引，为空时保留组件当前的多边形样式
+
+	/// \brief 多边形数量
+	int32 Num() const { return FMath::Max(PolygonOffsets.Num() - 1, 0); }
+
+	/// \brief 获取多边形的顶点
+	TConstArrayView<FVector2f> GetPolygon(int32 PolygonIndex) const
+	{
+		return MakeArrayView(Vertices.GetData() + PolygonOffsets[PolygonIndex], PolygonOffsets[PolygonIndex + 1] - PolygonOffsets[PolygonIndex]);
+	}
+
+	void Reserve(int32 InNumPolygons, int32 InNumVertices)
+	{
+		Vertices.Reserve(InNumVertices);
+		PolygonOffsets.Reserve(InNumPolygons + 1);
+	}
+
+	/// \brief 追加一个多边形，返回多边形索引
+	int32 AddPolygon(TConstArrayView<FVector2f> InVertices)
+	{
+		if (PolygonOffsets.Num() == 0)
+		{
+			PolygonOffsets.Add(0);
+		}
+		Vertices.Append(InVertices.GetData(), InVertices.Num());
+		PolygonOffsets.Add(Vertices.Num());
+		return PolygonOffsets.Num() - 2;
+	}
+
+	void Reset()
+	{
+		Vertices.Reset();
+		PolygonOffsets.Reset();
+		PolygonStyleIndices.Reset();
+	}
+};
+
 /// \brief BVH树构建器类，负责从多边形数据提取线段数据并构建BVH树
 class UTILITYRENDERER_API FLineBVHBuilder
 {
 public:
 	FLineBVHBuilder(const TArray<FPolygon>& InPolygons, const FBVHBuildConfig& InBuildConfig);
+
+	/// \brief 从连续存放的折线顶点构建，不需要FPolygon中转
+	/// \param InPolylineOffsets 每条折线首顶点的偏移，末尾额外一项为顶点总数，折线索引即多边形索引
+	FLineBVHBuilder(TConstArrayView<FVector2f> InVertices, TConstArrayView<int32> InPolylineOffsets, const FBVHBuildConfig& InBuildConfig);
+
+	/// \brief 创建空构建器，之后通过AppendPolylines分批追加折线
+	explicit FLineBVHBuilder(const FBVHBuildConfig& InBuildConfig);
+
+	/// \brief 从扁平多边形数据构建，直接读取其顶点数组
+	FLineBVHBuilder(const FSurfacePolygonSoup& InPolygonSoup, const FBVHBuildConfig& InBuildConfig)
+		: FLineBVHBuilder(InPolygonSoup.Vertices, InPolygonSoup.PolygonOffsets, InBuildConfig)
+	{
+	}
 	~FLineBVHBuilder();
 
+	/// \brief 追加一批折线，折线索引接着已追加的折线继续编号
+	/// \param InPolylineOffsets 每条折线首顶点的偏移（相对本批顶点），末尾额外一项为本批顶点总数
+	/// \note 只复制线段簇需要的数据，调用方可在返回后释放本批顶点
+	void AppendPolylines(TConstArrayView<FVector2f> InVertices, TConstArrayView<int32> InPolylineOffsets);
+
 	/// \brief 构建BVH树
 	void Build();
 
@@ -40,6 +103,10 @@ public:
 	void GetStats(FBVHStats& OutStats) const;
 
 private:
+	/// \brief 为一条折线创建线段簇
+	template <typename VertexAccessorType>
+	void AddPolylineClusters(int32 PolyIndex, int32 NumVertices, const VertexAccessorType& GetVertex);
+
 	/// \brief 递归构建BVH树
 	FLineBVHNode* BuildRecursive_Middle(const TArray<FSegmentCluster*>& InClusters, int32 Depth);
 	FLineBVHNode* BuildRecursive_SAH(const TArray<FSegmentCluster*>& InClusters, int32 Depth);
@@ -59,6 +126,7 @@ private:
 	// --------------------------------------------------------------------
 	double BuildTimeMs;						///< 构建耗时（毫秒）
 	int32 TotalSegments;					///< 从多边形提取的线段总数
+	int32 NumPolylines;						///< 已追加的折线数，即下一条折线的全局索引
 };
 
 // =====================================================================
@@ -94,7 +162,8 @@ struct FGPUSegmentCluster
 	int32 PolygonIndex;			///< 所属多边形索引		(4字节)
 
 	int32 AllSegmentNum;		///< 总线段数量			(4字节)
-	float Padding[3];			///< 填充				(4 * 3字节)
+	int32 PolylineClusterIndex;	///< 在所属折线中的序号（按顶点顺序）	(4字节)
+	float Padding[2];			///< 填充				(4 * 2字节)
 
 	int32 SegmentNumPerLOD[8];	///< 每个LOD的线段数量	(4 * 8字节)
 };
@@ -136,6 +205,180 @@ struct FGPULineData
 	}
 };
 
+/// \brief 线GPU数据中被局部修改的元素，上传时只写入这些范围
+struct FGPULineDirtyRanges
+{
+	FSurfaceDirtyRanges Nodes;		///< 重新计算包围盒的节点
+	FSurfaceDirtyRanges Clusters;	///< 修改的Cluster
+	FSurfaceDirtyRanges Segments;	///< 修改或新增的线段
+
+	void Append(const FGPULineDirtyRanges& InOther)
+	{
+		Nodes.Append(InOther.Nodes);
+		Clusters.Append(InOther.Clusters);
+		Segments.Append(InOther.Segments);
+	}
+
+	bool IsEmpty() const
+	{
+		return Nodes.IsEmpty() && Clusters.IsEmpty() && Segments.IsEmpty();
+	}
+
+	void Reset()
+	{
+		Nodes.Reset();
+		Clusters.Reset();
+		Segments.Reset();
+	}
+};
+
+/// \brief 线GPU数据的局部修改（FLineDataConverter::RefitPolyline的结果）
+///
+/// 只保存修改后的节点、Cluster和线段，生成时只读基础数据，不复制整个数据：
+/// 游戏线程和渲染线程各自持有一份完整数据，分别Apply后只上传DirtyRanges中的范围。
+struct UTILITYRENDERER_API FGPULineDataPatch
+{
+	/// \brief 一段连续写入的线段
+	struct FSegmentRange
+	{
+		int32 Start;					///< 起始线段
+		TArray<FGPUSegment> Segments;	///< 新的线段
+	};
+
+	TMap<int32, FGPULineBVHNode> Nodes;			///< 修改后的节点
+	TMap<int32, FGPUSegmentCluster> Clusters;	///< 修改后的Cluster
+	TArray<FSegmentRange> SegmentRanges;		///< 修改或新增的线段，按写入顺序排列
+	int32 BaseNumSegments;						///< 基础数据的线段数量，INDEX_NONE表示尚未修改
+	int32 NumSegments;							///< 修补后的线段数量（新增的线段追加在末尾）
+	FGPULineDirtyRanges DirtyRanges;			///< 修改的范围
+
+	FGPULineDataPatch() : BaseNumSegments(INDEX_NONE), NumSegments(INDEX_NONE) {}
+
+	/// \brief 修补后的节点，未修改时返回基础数据中的节点
+	const FGPULineBVHNode& GetNode(const FGPULineData& InBaseData, int32 NodeIndex) const
+	{
+		const FGPULineBVHNode* Node = Nodes.Find(NodeIndex);
+		return Node ? *Node : InBaseData.Nodes[NodeIndex];
+	}
+
+	/// \brief 修补后的Cluster，未修改时返回基础数据中的Cluster
+	const FGPUSegmentCluster& GetCluster(const FGPULineData& InBaseData, int32 ClusterIndex) const
+	{
+		const FGPUSegmentCluster* Cluster = Clusters.Find(ClusterIndex);
+		return Cluster ? *Cluster : InBaseData.Clusters[ClusterIndex];
+	}
+
+	/// \brief 追加之后的修改（基于本修改修补后的数据生成），相同元素以之后的修改为准
+	/// \return 之后的修改不是基于本修改修补后的数据生成时返回false，不修改任何数据
+	bool Append(const FGPULineDataPatch& InOther);
+
+	/// \brief 把修改写入InOutData
+	/// \return 数据与生成修改时的基础数据不对应时返回false，不修改任何数据
+	bool Apply(FGPULineData& InOutData) const;
+
+	bool IsEmpty() const
+	{
+		return DirtyRanges.IsEmpty();
+	}
+
+	void Reset()
+	{
+		*this = FGPULineDataPatch();
+	}
+};
+
+/// \brief 局部修改（FLineDataConverter::RefitPolyline）使用的索引，只在CPU上使用，不上传
+///
+/// 只依赖BVH拓扑和Cluster的划分，由GPU数据在第一次局部修改时生成，之后的局部修改不改变这些索引。
+struct UTILITYRENDERER_API FLineRefitIndices
+{
+	TArray<int32> NodeParents;				///< 每个节点的父节点索引（根节点为-1）
+	TArray<int32> ClusterNodes;				///< 每个Cluster对应的叶子节点索引
+	TArray<int32> PolygonClusterOffsets;	///< 每个多边形在PolygonClusters中的偏移，末尾额外一项为总数
+	TArray<int32> PolygonClusters;			///< 按多边形和顶点顺序排列的Cluster索引
+
+	/// \brief 由ConvertToGPUData生成的数据建立索引
+	/// \return 数据无效或Cluster的折线序号不连续时返回false，索引为空
+	bool Build(const FGPULineData& InGPUData);
+
+	/// \brief 多边形存在且新的顶点数划分为相同数量的Cluster（不检查LOD数据）
+	bool CanRefitPolyline(int32 InPolygonIndex, int32 InNumVertices) const;
+
+	/// \brief 索引是否对应该数据的节点和Cluster
+	bool IsValidFor(const FGPULineData& InGPUData) const
+	{
+		return NodeParents.Num() == InGPUData.Nodes.Num() && ClusterNodes.Num() == InGPUData.Clusters.Num() && PolygonClusterOffsets.Num() > 0;
+	}
+
+	void Reset()
+	{
+		NodeParents.Empty();
+		ClusterNodes.Empty();
+		PolygonClusterOffsets.Empty();
+		PolygonClusters.Empty();
+	}
+};
+
+/// \brief GPU线样式
+struct FGPULineStyle
+{
+	FVector4f Color;	///< 线颜色								(16字节)
+
+	float Width;		///< 线宽								(4字节)
+	float Opacity;		///< 不透明度							(4字节)
+	int32 AtlasSlot;	///< 自定义纹理图集槽位（-1表示使用颜色）	(4字节)
+	float Padding;		///< 填充								(4字节)
+
+	FGPULineStyle()
+		: Color(FVector4f::Zero()), Width(0.0f), Opacity(0.0f), AtlasSlot(-1), Padding(0.0f)
+	{
+	}
+
+	explicit FGPULineStyle(const FSurfaceLineStyle& InStyle)
+		: Color(FVector4f(InStyle.LineColor)), Width(InStyle.LineWidth), Opacity(InStyle.LineOpacity), AtlasSlot(InStyle.AtlasSlot), Padding(0.0f)
+	{
+	}
+
+	bool operator==(const FGPULineStyle& Other) const
+	{
+		return Color == Other.Color && Width == Other.Width && Opacity == Other.Opacity && AtlasSlot == Other.AtlasSlot;
+	}
+};
+
+/// \brief 线样式表：样式数组，以及按多边形索引查找的样式索引
+///
+/// 一个组件的所有样式在同一个Pass中渲染，着色器通过线段的PolygonIndex查找样式，
+/// BVH遍历按最大线宽剪枝。
+struct UTILITYRENDERER_API FLineStyleTable
+{
+	TArray<FGPULineStyle> Styles;			///< 样式数组，至少包含一个样式
+	TArray<uint32> PolygonStyleIndices;		///< 每个多边形的样式索引，未指定的多边形使用样式0
+	float MaxLineWidth;						///< 所有样式中的最大线宽
+
+	FLineStyleTable() : MaxLineWidth(0.0f) {}
+
+	/// \brief 构建样式表，超出样式数量的样式索引回退到样式0
+	void Build(TConstArrayView<FGPULineStyle> InStyles, TConstArrayView<int32> InPolygonStyleIndices);
+
+	/// \brief 获取多边形的样式
+	const FGPULineStyle& GetPolygonStyle(int32 PolygonIndex) const
+	{
+		return Styles[PolygonStyleIndices.IsValidIndex(PolygonIndex) ? PolygonStyleIndices[PolygonIndex] : 0];
+	}
+
+	void Reset()
+	{
+		Styles.Empty();
+		PolygonStyleIndices.Empty();
+		MaxLineWidth = 0.0f;
+	}
+
+	bool IsValid() const
+	{
+		return Styles.Num() > 0 && PolygonStyleIndices.Num() > 0;
+	}
+};
+
 /// \brief 提供BVH数据到GPU格式的转换器
 class UTILITYRENDERER_API FLineDataConverter
 {
@@ -143,6 +386,17 @@ public:
 	/// \brief 转换为GPU数据格式
 	static bool ConvertToGPUData(const FLineBVHBuilder& Builder, FGPULineData& OutGPUData);
 
+	/// \brief 用新的顶点替换一条折线，只修改其线段、Cluster以及向上到根节点的包围盒，不重建BVH
+	///
+	/// 新的顶点数必须划分为相同数量的Cluster（每个Cluster最多128条线段）；线段变多的Cluster
+	/// 改用Segments末尾新追加的位置，原位置不再被引用，直到下次完整构建。
+	/// InGPUData只读，修改写入InOutPatch，可在后台线程基于其他线程正在读取的数据生成；
+	/// 同一个InOutPatch中的多次修改依次叠加（后一次读取前一次修补后的节点和Cluster）。
+	/// \param InRefitIndices 由InGPUData（或其局部修改前的数据）生成的索引
+	/// \param InOutPatch 追加被修改的节点、Cluster和线段，必须基于InGPUData生成
+	/// \return 索引与数据不对应、多边形不存在、Cluster数量变化或包含LOD数据时返回false，InOutPatch保持不变
+	static bool RefitPolyline(const FGPULineData& InGPUData, const FLineRefitIndices& InRefitIndices, int32 InPolygonIndex, TConstArrayView<FVector2f> InVertices, FGPULineDataPatch& InOutPatch);
+
 private:
 	/// \brief 收集节点数据
 	static int32 CollectNodesRecursive(const FLineBVHNode* Node, FGPULineData& OutData);
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfaceLineBuilder.h"
+
+
+/**
+ * @brief 线BVH的CPU查询
+ *
+ * 直接在FGPULineData（与GPU相同的数据）上进行遍历，只使用LOD0线段。
+ * 叶子簇内的线段每4条组成一批，使用VectorRegister同时计算点到线段距离或射线交点，
+ * 供Gameplay进行拾取、距离判断，替代物理射线检测和暴力遍历。
+ */
+class UTILITYRENDERER_API FLineBVHQuery
+{
+public:
+	/// \brief 查询XY平面上距离点最近的线段
+	/// \param InMaxDistance 最大搜索距离，超过该距离的线段忽略
+	/// \return 找到线段时返回true
+	static bool QueryNearestSegment(const FGPULineData& InGPUData, const FVector2f& InPoint, float InMaxDistance, FSurfaceLineHit& OutHit);
+
+	/// \brief 查询XY平面上与点距离不超过半径的全部线段
+	/// \return 找到的线段数量
+	static int32 QuerySegmentsInRadius(const FGPULineData& InGPUData, const FVector2f& InPoint, float InRadius, TArray<FSurfaceLineHit>& OutHits);
+
+	/// \brief 查询XY平面上射线首先命中的线段
+	/// \param InDirection 射线方向，内部会归一化
+	/// \return 命中线段时返回true，OutHit.Distance为沿射线的距离
+	static bool RaycastSegment(const FGPULineData& InGPUData, const FVector2f& InOrigin, const FVector2f& InDirection, float InMaxDistance, FSurfaceLineHit& OutHit);
+};
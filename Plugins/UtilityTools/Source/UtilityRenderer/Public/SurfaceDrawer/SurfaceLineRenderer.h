@@ -3,10 +3,84 @@
 #include "CoreMinimal.h"
 #include "RenderGraphResources.h"
 
+#include "SurfaceBufferArena.h"
+#include "SurfaceBufferUpload.h"
+#include "SurfaceCoverageCache.h"
 #include "SurfaceLineBuilder.h"
+#include "SurfacePolygonIdPicker.h"
 
 
 class FSurfaceLineRenderManager;
+
+/// \brief GPU 代理参数：代理数据在共享缓冲区和合并样式缓冲区中的偏移及其渲染参数（合并模式）
+struct FGPULineProxyParams
+{
+	int32 NodeOffset;			///< 节点偏移			(4字节)
+	int32 ClusterOffset;		///< 簇偏移				(4字节)
+	int32 SegmentOffset;		///< 线段偏移			(4字节)
+	int32 StyleOffset;			///< 线样式偏移			(4字节)
+
+	int32 PolygonStyleOffset;	///< 多边形样式索引偏移	(4字节)
+	uint32 NumPolygonStyles;	///< 多边形样式索引数量	(4字节)
+	float MaxLineWidth;			///< 最大线宽			(4字节)
+	uint32 bUsePixelUnit;		///< 是否使用像素单位	(4字节)
+
+	FGPULineProxyParams()
+		: NodeOffset(0), ClusterOffset(0), SegmentOffset(0), StyleOffset(0)
+		, PolygonStyleOffset(0), NumPolygonStyles(0), MaxLineWidth(0.0f), bUsePixelUnit(0)
+	{
+	}
+};
+
+/// \brief 代理几何数据在共享缓冲区中的分配句柄
+struct FSurfaceLineAllocations
+{
+	int32 Nodes = INDEX_NONE;
+	int32 Clusters = INDEX_NONE;
+	int32 Segments = INDEX_NONE;
+};
+
+/// \brief 所有SurfaceLine代理共用的几何缓冲区（仅渲染线程访问）
+struct FSurfaceLineArenas
+{
+	FSurfaceBufferArena Nodes;
+	FSurfaceBufferArena Clusters;
+	FSurfaceBufferArena Segments;
+
+	FSurfaceLineArenas();
+
+	/// \brief 按数据大小为节点、簇和线段分配范围
+	void Allocate(const FGPULineData& InData, FSurfaceLineAllocations& OutAllocations);
+
+	/// \brief 释放分配，句柄置为INDEX_NONE
+	void Free(FSurfaceLineAllocations& InOutAllocations);
+
+	/// \brief 紧凑排列三个缓冲区
+	void Defragment(FRDGBuilder& GraphBuilder);
+
+	/// \brief 丢弃上一次渲染创建的SRV
+	void ResetSRVs();
+
+	/// \brief 释放三个缓冲区和所有分配
+	void Release();
+};
+
+/**
+ * @brief 代理顶层BVH，以每个代理的根节点包围盒为叶子
+ *
+ * 代理数量很少，渲染线程每帧按包围盒中心中位数划分重建。节点布局与FGPULineBVHNode相同，
+ * 根节点索引为0，叶子节点的ClusterIndex为代理序号。
+ */
+struct UTILITYRENDERER_API FLineProxyTopLevelBVH
+{
+	/// \brief 合并Pass最多包含的代理数量，与着色器中单个像素的候选代理数组大小一致
+	static constexpr int32 MaxMergedProxies = 16;
+
+	/// \brief 构建顶层BVH
+	/// \param InProxyBounds 每个代理的XY包围盒，序号即叶子节点的ClusterIndex
+	static void Build(TConstArrayView<FBox2f> InProxyBounds, TArray<FGPULineBVHNode>& OutNodes);
+};
+
 /**
  * @brief SurfaceLine场景代理
  *
@@ -20,91 +94,173 @@ public:
 	FSurfaceLineSceneProxy() 
 		: GPULineData(nullptr)
 		, CustomTexture(nullptr)
-		, LineWidth(0.0f)
-		, LineOpacity(0.0f)
+		, NumAtlasSlots(1)
 		, bUseCustomTexture(false)
 		, bUsePixelUnit(false)
 		, ProxyId(0)
 		, bBuffersInitialized(false)
+		, BufferGeneration(0)
+		, bUploadPending(false)
+		, bStyleBuffersInitialized(false)
+		, StyleBufferGeneration(0)
 	{
 	}
 	
 	FSurfaceLineSceneProxy(
 		const TSharedPtr<FGPULineData>& InGPULineData,
 		UTexture2D* InCustomTexture,
-		float InLineWidth, 
-		float InLineOpacity,
-		FLinearColor InLineColor,
 		bool InbUseCustomTexture,
 		bool InbUsePixelUnit
 	)
 		: GPULineData(InGPULineData)
 		, CustomTexture(InCustomTexture)
-		, LineWidth(InLineWidth)
-		, LineOpacity(InLineOpacity)
-		, LineColor(InLineColor)
+		, NumAtlasSlots(1)
 		, bUseCustomTexture(InbUseCustomTexture)
 		, bUsePixelUnit(InbUsePixelUnit)
+		, ProxyId(0)
 		, bBuffersInitialized(false)
+		, BufferGeneration(0)
+		, bUploadPending(false)
+		, bStyleBuffersInitialized(false)
+		, StyleBufferGeneration(0)
 	{
 	}
 	
 	/// \brief 更新参数
+	/// \param InGPULineData InbBuffersInitialized为false时是新数据，归代理所有（之后由局部修改原地修补），分帧上传完成前继续使用当前数据和缓冲区渲染
+	/// \param InPatch InbBuffersInitialized为true时的局部修改，修补当前数据后只上传修改的范围
 	void UpdateParameters_RenderThread(
 		const TSharedPtr<FGPULineData>& InGPULineData,
 		UTexture2D* InCustomTexture,
-		float InLineWidth, 
-		float InLineOpacity, 
-		const FLinearColor& InLineColor,
 		bool InbUseCustomTexture,
 		bool InbUsePixelUnit,
-		bool InbBuffersInitialized)
+		bool InbBuffersInitialized,
+		const TSharedPtr<const FGPULineDataPatch>& InPatch)
 	{
 		check(IsInRenderingThread());
 	
-		GPULineData = InGPULineData;
+		if (!InbBuffersInitialized)
+		{
+			PendingGPULineData = InGPULineData;
+			bUploadPending = true;
+			PendingUpload.Reset();
+			PendingPatch.Reset();
+		}
+		else if (InPatch.IsValid() && !InPatch->IsEmpty())
+		{
+			// 完整上传进行中时修补正在上传的数据并重新上传，否则累积修改，下次渲染时修补当前数据并上传修改的范围
+			if (bUploadPending)
+			{
+				if (PendingGPULineData.IsValid() && ensure(InPatch->Apply(*PendingGPULineData)))
+				{
+					PendingUpload.Reset();
+				}
+			}
+			else
+			{
+				ensure(PendingPatch.Append(*InPatch));
+			}
+		}
 		CustomTexture = InCustomTexture;
-		LineWidth = InLineWidth;
-		LineOpacity = InLineOpacity;
-		LineColor = InLineColor;
 		bUseCustomTexture = InbUseCustomTexture;
 		bUsePixelUnit = InbUsePixelUnit;
-		bBuffersInitialized = InbBuffersInitialized;
+	}
+
+	/// \brief 更新线样式表
+	void UpdateStyleParameters_RenderThread(
+		const TSharedPtr<const FLineStyleTable>& InStyleTable,
+		int32 InNumAtlasSlots,
+		bool InbStyleBuffersInitialized)
+	{
+		check(IsInRenderingThread());
+
+		StyleTable = InStyleTable;
+		NumAtlasSlots = FMath::Max(InNumAtlasSlots, 1);
+		bStyleBuffersInitialized = InbStyleBuffersInitialized;
+	}
+
+	/// \brief 更新多边形ID拾取器，为空时不输出ID纹理
+	void UpdatePickingParameters_RenderThread(const TSharedPtr<FSurfacePolygonIdPicker>& InPolygonIdPicker)
+	{
+		check(IsInRenderingThread());
+
+		if (PolygonIdPicker.IsValid() && PolygonIdPicker != InPolygonIdPicker)
+		{
+			PolygonIdPicker->Release_RenderThread();
+		}
+		PolygonIdPicker = InPolygonIdPicker;
 	}
 	
 	/// \brief 重置参数，释放资源引用
 	void Reset()
 	{
 		GPULineData.Reset();
+		PendingGPULineData.Reset();
+		PendingPatch.Reset();
 		CustomTexture = nullptr;
-		LineWidth = 0.0f;
-		LineOpacity = 0.0f;
-		LineColor = FLinearColor::Black;
+		StyleTable.Reset();
+		NumAtlasSlots = 1;
 		bUseCustomTexture = false;
 		bUsePixelUnit = false;
+		PolygonIdPicker.Reset();
 	}
 
 	/// \brief 获取代理ID
 	uint32 GetProxyId() const { return ProxyId; }
 
+	/// \brief 是否可以与其他代理在同一个Pass中渲染（合并模式不支持自定义纹理和拾取）
+	bool CanMerge() const { return !bUseCustomTexture && !PolygonIdPicker.IsValid(); }
+
+	/// \brief 计算代理在视口中的屏幕范围：BVH根节点范围按最大线宽外扩后投影到屏幕
+	/// \return 代理完全在视口外时返回false
+	bool CalculateScissorRect(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, FIntRect& OutScissorRect) const;
+
+	/// \brief 按视锥剔除BVH的前几层，得到着色器遍历的起始子树
+	void CalculateSeedNodes(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, TArray<uint32>& OutSeedNodes) const;
+
 private:
-	TSharedPtr<FGPULineData> GPULineData;
+	TSharedPtr<FGPULineData> GPULineData; ///< 归代理所有，只在渲染线程修补
 	UTexture2D* CustomTexture;
-	float LineWidth;
-	float LineOpacity;
-	FLinearColor LineColor;
+	TSharedPtr<const FLineStyleTable> StyleTable; ///< 线样式表，所有样式在同一个Pass中渲染
+	int32 NumAtlasSlots; ///< 自定义纹理横向划分的图集槽位数量
 	bool bUseCustomTexture;
 	bool bUsePixelUnit;
 
 	uint32 ProxyId; ///< 唯一标识符
+
+	// 多边形ID拾取，开启时额外输出ID纹理并回读光标附近区域
+	TSharedPtr<FSurfacePolygonIdPicker> PolygonIdPicker;
+
+	// 主视图的覆盖结果缓存（r.SurfaceDrawer.CoverageCache）
+	FSurfaceCoverageCache CoverageCache;
 	
-	// 池化缓冲区管理
-	bool bBuffersInitialized;
-	TRefCountPtr<FRDGPooledBuffer> BVHNodesPooledBuffer;
-	TRefCountPtr<FRDGPooledBuffer> ClustersPooledBuffer;
-	TRefCountPtr<FRDGPooledBuffer> SegmentsPooledBuffer;
-	void InitializePooledBuffers(FRDGBuilder& GraphBuilder);
-	void ReleasePooledBuffers();
+	// 几何数据在共享缓冲区（FSurfaceLineArenas）中的分配
+	bool bBuffersInitialized; ///< 分配中的数据是否与GPULineData一致
+	uint32 BufferGeneration; ///< 每次替换几何数据后递增，覆盖结果缓存据此判断是否过期
+	FSurfaceLineAllocations Allocations;
+
+	// 正在分帧上传的新数据及其分配，全部上传后与GPULineData及其分配一起替换
+	bool bUploadPending;
+	TSharedPtr<FGPULineData> PendingGPULineData;
+	FSurfaceLineAllocations PendingAllocations;
+	FSurfaceBufferUpload PendingUpload;
+
+	// 累积的局部修改，本帧剩余的上传预算足够时修补GPULineData并一次写入现有分配
+	FGPULineDataPatch PendingPatch;
+
+	/// \brief 在本帧的上传预算内推进新数据的上传，完成时替换数据和分配
+	void InitializePooledBuffers(FRDGBuilder& GraphBuilder, FSurfaceLineArenas& Arenas);
+
+	/// \brief 修补数据并把修改的范围写入现有分配，没有可用的分配或超过每帧的上传预算时在副本上修补后改为完整上传
+	void UploadDirtyRanges(FRDGBuilder& GraphBuilder, FSurfaceLineArenas& Arenas);
+
+	// 样式缓冲区，修改样式时只重新上传这两个缓冲区
+	bool bStyleBuffersInitialized;
+	uint32 StyleBufferGeneration;
+	TRefCountPtr<FRDGPooledBuffer> LineStylesPooledBuffer;
+	TRefCountPtr<FRDGPooledBuffer> PolygonStylesPooledBuffer;
+	void InitializeStyleBuffers(FRDGBuilder& GraphBuilder);
+	void ReleasePooledBuffers(FSurfaceLineArenas& Arenas);
 
 	friend FSurfaceLineRenderManager;
 };
@@ -133,7 +289,7 @@ public:
 	void RegisterSceneProxy(const TSharedPtr<FSurfaceLineSceneProxy>& InSceneProxy);
 	void UnregisterSceneProxy(uint32 ProxyId);
 
-	/// \brief 获取当前注册的代理数量
+	/// \brief 获取当前注册的代理数量（游戏线程）
 	int32 GetNumSceneProxies();
 	
 private:
@@ -154,6 +310,32 @@ private:
 	/// \brief 渲染线程执行函数
 	void Execute_RenderThread(FPostOpaqueRenderParameters& Parameters);
 
+	/// \brief 在渲染线程添加代理
+	void AddSceneProxy_RenderThread(const TSharedPtr<FSurfaceLineSceneProxy>& InSceneProxy);
+
+	/// \brief 在渲染线程移除代理并释放其GPU资源
+	void RemoveSceneProxy_RenderThread(uint32 ProxyId);
+
+	/// \brief 为单个代理添加全屏Pass，只渲染代理的屏幕范围ScissorRect
+	void AddProxyPass_RenderThread(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, const FSceneView* SceneView, FSurfaceLineSceneProxy& SceneProxy, const FIntRect& ScissorRect);
+
+	/// \brief 为单个代理添加分块计算Pass，只分派覆盖ScissorRect的分块
+	/// \return 场景颜色不支持UAV读写时返回false，由调用方退回全屏Pass
+	bool AddTiledComputePass_RenderThread(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfaceLineSceneProxy& SceneProxy, const FIntRect& ScissorRect);
+
+	/// \brief 在一个全屏Pass中渲染所有可合并的代理，ScissorRect为各代理屏幕范围的并集
+	void AddMergedPass_RenderThread(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, TConstArrayView<FSurfaceLineSceneProxy*> SceneProxies, const FIntRect& ScissorRect);
+
+	/// \brief 合并样式缓冲区与代理样式缓冲区不一致时，在GPU上重新拷贝
+	void UpdateMergedBuffers_RenderThread(FRDGBuilder& GraphBuilder, TConstArrayView<FSurfaceLineSceneProxy*> SceneProxies);
+
+	/// \brief 释放合并样式缓冲区
+	void ReleaseMergedBuffers_RenderThread();
+
+	/// \brief 把代理的几何缓冲区和偏移写入单代理Pass的参数
+	template <typename ParametersType>
+	void SetGeometryParameters(FRDGBuilder& GraphBuilder, const FSurfaceLineSceneProxy& SceneProxy, ParametersType* PassParameters);
+
 private:
 	/// \brief 单例实例
 	static FSurfaceLineRenderManager* Instance;
@@ -161,9 +343,32 @@ private:
 	/// \brief 渲染委托句柄
 	FDelegateHandle OnOverlayRenderHandle;
 
-	/// \brief 场景代理映射表（ProxyId -> SceneProxy）
-	TMap<uint32, TSharedPtr<FSurfaceLineSceneProxy>> SceneProxyMap;
+	/// \brief 场景代理列表，按ProxyId（注册顺序）排列；仅渲染线程访问，注册和注销通过渲染命令修改
+	TArray<TSharedPtr<FSurfaceLineSceneProxy>> SceneProxies;
+
+	/// \brief 已注册的代理ID，仅游戏线程访问，决定渲染委托的挂接和移除
+	TSet<uint32> RegisteredProxyIds;
 	uint32 NextProxyId = 0; ///< 可以反映已经注册过的代理总数（包括已经注销的）
 
-	FCriticalSection RenderThreadLock;
+	/// \brief 所有代理共用的节点、簇和线段缓冲区（仅渲染线程访问）
+	FSurfaceLineArenas Arenas;
+
+	/// \brief 合并模式中一个代理的样式缓冲区版本及其样式在合并样式缓冲区中的偏移（仅渲染线程访问）
+	struct FMergedProxySlot
+	{
+		uint32 ProxyId;
+		uint32 StyleBufferGeneration;
+		int32 StyleOffset;
+		int32 PolygonStyleOffset;
+
+		bool operator==(const FMergedProxySlot& Other) const
+		{
+			return ProxyId == Other.ProxyId && StyleBufferGeneration == Other.StyleBufferGeneration;
+		}
+	};
+
+	// 合并模式的样式缓冲区：所有代理的样式依次拼接，代理集合或任一代理的样式变化时重建；几何数据直接使用共享缓冲区
+	TArray<FMergedProxySlot> MergedProxySlots;
+	TRefCountPtr<FRDGPooledBuffer> MergedLineStylesPooledBuffer;
+	TRefCountPtr<FRDGPooledBuffer> MergedPolygonStylesPooledBuffer;
 };
\ No newline at end of file
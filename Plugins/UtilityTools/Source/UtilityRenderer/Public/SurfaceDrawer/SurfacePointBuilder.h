@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "BVHConfig.h"
+
+
+/// \brief GPU点数据
+struct FGPUSurfacePoint
+{
+	FVector2f Position;	///< 点位置（XY）							(8字节)
+	float Radius;		///< 半径									(4字节)
+	int32 IconSlot;		///< 图标图集槽位（-1表示纯色圆）			(4字节)
+
+	FVector4f Color;	///< 颜色									(16字节)
+};
+
+/// \brief 点空间网格，点按所在单元排序，GPU与CPU查询共用
+struct FGPUPointData
+{
+	TArray<FGPUSurfacePoint> Points;	///< 按单元排序的点
+	TArray<uint32> CellOffsets;			///< 每个单元首个点在Points中的偏移，末尾额外一项为点总数
+	TArray<int32> SourceIndices;		///< 排序后每个点在输入点数组中的索引
+	FVector2f GridOrigin;				///< 网格原点（单元(0, 0)的最小角）
+	float CellSize;						///< 单元边长
+	FIntPoint GridSize;					///< 单元数量
+	float MaxRadius;					///< 所有点中的最大半径
+
+	FGPUPointData()
+		: GridOrigin(FVector2f::ZeroVector), CellSize(1.0f), GridSize(0, 0), MaxRadius(0.0f)
+	{
+	}
+
+	void Reset()
+	{
+		Points.Empty();
+		CellOffsets.Empty();
+		SourceIndices.Empty();
+		GridOrigin = FVector2f::ZeroVector;
+		CellSize = 1.0f;
+		GridSize = FIntPoint(0, 0);
+		MaxRadius = 0.0f;
+	}
+
+	bool IsValid() const
+	{
+		return Points.Num() > 0 && CellOffsets.Num() == GridSize.X * GridSize.Y + 1;
+	}
+
+	/// \brief 位置所在单元坐标（可能在网格之外）
+	FIntPoint GetCellCoord(const FVector2f& InPosition) const
+	{
+		return FIntPoint(
+			FMath::FloorToInt32((InPosition.X - GridOrigin.X) / CellSize),
+			FMath::FloorToInt32((InPosition.Y - GridOrigin.Y) / CellSize));
+	}
+};
+
+/// \brief 点网格统计信息
+struct FPointGridStats
+{
+	int32 NumPoints;			///< 点数量
+	int32 NumCells;				///< 单元数量
+	int32 NumOccupiedCells;		///< 非空单元数量
+	int32 MaxPointsPerCell;		///< 单元内最大点数
+	double BuildTimeMs;			///< 耗时（毫秒）
+
+	FPointGridStats()
+		: NumPoints(0), NumCells(0), NumOccupiedCells(0), MaxPointsPerCell(0), BuildTimeMs(0.0)
+	{
+	}
+};
+
+/**
+ * @brief 点空间网格构建器
+ *
+ * 以均匀网格作为空间哈希：并行计算每个点所在单元并计数，前缀和得到单元偏移后并行散射，
+ * 单元内按输入索引排序，结果与线程调度无关。
+ * 单元边长默认由点密度决定；点半径为世界单位时单元边长（包括指定的边长）不小于最大半径，着色器只需查找3x3个相邻单元。
+ */
+class UTILITYRENDERER_API FSurfacePointGridBuilder
+{
+public:
+	/// \brief 构建点网格
+	/// \param bInRadiusInWorldUnits 点半径是否为世界单位（像素单位下半径与视距相关，只按密度选择单元边长）
+	/// \param InCellSize 指定单元边长，<=0时自动选择
+	/// \return 至少有一个点时返回true
+	static bool Build(
+		TConstArrayView<FSurfacePoint> InPoints,
+		FGPUPointData& OutData,
+		bool bInRadiusInWorldUnits = true,
+		float InCellSize = 0.0f,
+		FPointGridStats* OutStats = nullptr);
+};
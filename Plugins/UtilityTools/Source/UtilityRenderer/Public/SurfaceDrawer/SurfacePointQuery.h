@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfacePointBuilder.h"
+
+
+/**
+ * @brief 点网格的CPU查询
+ *
+ * 直接在FGPUPointData（与GPU相同的数据）上查询，只访问查询范围覆盖的单元，
+ * 供Gameplay进行范围检测、拾取，替代逐个Actor的距离判断。
+ */
+class UTILITYRENDERER_API FSurfacePointQuery
+{
+public:
+	/// \brief 查询XY平面上与位置距离不超过半径的全部点，结果按距离升序排列
+	/// \param bInIncludePointRadius 为true时计入点自身半径（查询圆与点的圆相交即命中），Distance仍为到点中心的距离
+	/// \return 找到的点数量
+	static int32 QueryPointsInRadius(const FGPUPointData& InData, const FVector2f& InLocation, float InRadius, TArray<FSurfacePointHit>& OutHits, bool bInIncludePointRadius = false);
+
+	/// \brief 查询XY平面上距离位置最近的点
+	/// \param InMaxDistance 最大搜索距离，超过该距离的点忽略
+	/// \return 找到点时返回true
+	static bool QueryNearestPoint(const FGPUPointData& InData, const FVector2f& InLocation, float InMaxDistance, FSurfacePointHit& OutHit);
+};
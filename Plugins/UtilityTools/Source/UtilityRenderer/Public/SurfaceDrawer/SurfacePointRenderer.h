@@ -0,0 +1,159 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+
+#include "SurfacePointBuilder.h"
+
+
+class FSurfacePointRenderManager;
+/**
+ * @brief SurfacePoint场景代理
+ *
+ * 作为USurfacePointComponent的渲染代理，保存其渲染相关的参数
+ */
+class FSurfacePointSceneProxy
+{
+public:
+	FSurfacePointSceneProxy()
+		: GPUPointData(nullptr)
+		, IconTexture(nullptr)
+		, NumIconSlots(1)
+		, Opacity(1.0f)
+		, bUsePixelUnit(false)
+		, ProxyId(0)
+		, bBuffersInitialized(false)
+	{
+	}
+
+	FSurfacePointSceneProxy(
+		const TSharedPtr<const FGPUPointData>& InGPUPointData,
+		UTexture2D* InIconTexture,
+		bool InbUsePixelUnit
+	)
+		: GPUPointData(InGPUPointData)
+		, IconTexture(InIconTexture)
+		, NumIconSlots(1)
+		, Opacity(1.0f)
+		, bUsePixelUnit(InbUsePixelUnit)
+		, ProxyId(0)
+		, bBuffersInitialized(false)
+	{
+	}
+
+	/// \brief 更新参数
+	void UpdateParameters_RenderThread(
+		const TSharedPtr<const FGPUPointData>& InGPUPointData,
+		UTexture2D* InIconTexture,
+		int32 InNumIconSlots,
+		float InOpacity,
+		bool InbUsePixelUnit,
+		bool InbBuffersInitialized)
+	{
+		check(IsInRenderingThread());
+
+		GPUPointData = InGPUPointData;
+		IconTexture = InIconTexture;
+		NumIconSlots = FMath::Max(InNumIconSlots, 1);
+		Opacity = InOpacity;
+		bUsePixelUnit = InbUsePixelUnit;
+		bBuffersInitialized = InbBuffersInitialized;
+	}
+
+	/// \brief 重置参数，释放资源引用
+	void Reset()
+	{
+		GPUPointData.Reset();
+		IconTexture = nullptr;
+		NumIconSlots = 1;
+		Opacity = 1.0f;
+		bUsePixelUnit = false;
+	}
+
+	/// \brief 获取代理ID
+	uint32 GetProxyId() const { return ProxyId; }
+
+private:
+	TSharedPtr<const FGPUPointData> GPUPointData;
+	UTexture2D* IconTexture;
+	int32 NumIconSlots; ///< 图标纹理横向划分的图集槽位数量
+	float Opacity;
+	bool bUsePixelUnit;
+
+	uint32 ProxyId; ///< 唯一标识符
+
+	// 池化缓冲区管理
+	bool bBuffersInitialized;
+	TRefCountPtr<FRDGPooledBuffer> PointsPooledBuffer;
+	TRefCountPtr<FRDGPooledBuffer> CellOffsetsPooledBuffer;
+	void InitializePooledBuffers(FRDGBuilder& GraphBuilder);
+	void ReleasePooledBuffers();
+
+	friend FSurfacePointRenderManager;
+};
+
+/**
+	* @brief SurfacePoint渲染管理器 - 单例
+	*
+	* 负责：
+	* 1. 注册/注销场景代理
+	* 2. 管理渲染委托的挂接和移除
+	* 3. 添加渲染Pass
+	*/
+class UTILITYRENDERER_API FSurfacePointRenderManager
+{
+public:
+	static FSurfacePointRenderManager* Get()
+	{
+		if (!Instance)
+		{
+			Instance = new FSurfacePointRenderManager();
+		}
+		return Instance;
+	};
+
+	// 注册/注销组件
+	void RegisterSceneProxy(const TSharedPtr<FSurfacePointSceneProxy>& InSceneProxy);
+	void UnregisterSceneProxy(uint32 ProxyId);
+
+	/// \brief 获取当前注册的代理数量（游戏线程）
+	int32 GetNumSceneProxies();
+
+private:
+	/// \brief 私有构造
+	FSurfacePointRenderManager() = default;
+	~FSurfacePointRenderManager();
+
+	/// \brief 禁止拷贝
+	FSurfacePointRenderManager(const FSurfacePointRenderManager&) = delete;
+	FSurfacePointRenderManager& operator=(const FSurfacePointRenderManager&) = delete;
+
+	/// \brief 将 Execute_RenderThread 挂接到渲染器。
+	void BeginRendering();
+
+	/// \brief 从渲染器移除 Execute_RenderThread
+	void EndRendering();
+
+	/// \brief 渲染线程执行函数
+	void Execute_RenderThread(FPostOpaqueRenderParameters& Parameters);
+
+	/// \brief 在渲染线程添加代理
+	void AddSceneProxy_RenderThread(const TSharedPtr<FSurfacePointSceneProxy>& InSceneProxy);
+
+	/// \brief 在渲染线程移除代理并释放其GPU资源
+	void RemoveSceneProxy_RenderThread(uint32 ProxyId);
+
+private:
+	/// \brief 单例实例
+	static FSurfacePointRenderManager* Instance;
+
+	/// \brief 渲染委托句柄
+	FDelegateHandle OnPostOpaqueRenderHandle;
+
+	/// \brief 场景代理列表，按ProxyId（注册顺序）排列；仅渲染线程访问，注册和注销通过渲染命令修改
+	TArray<TSharedPtr<FSurfacePointSceneProxy>> SceneProxies;
+
+	/// \brief 已注册的代理ID，仅游戏线程访问，决定渲染委托的挂接和移除
+	TSet<uint32> RegisteredProxyIds;
+	uint32 NextProxyId = 0; ///< 可以反映已经注册过的代理总数（包括已经注销的）
+};
@@ -3,23 +3,64 @@
 #include "CoreMinimal.h"
 #include "Math/Bounds.h"
 #include "BVHConfig.h"
+#include "SurfaceDirtyRanges.h"
 
 
+/// \brief 索引三角网格，多边形面的紧凑输入格式
+///
+/// 共享顶点只保存一次（单精度），每3个索引构成一个三角形，每个三角形对应一个多边形ID。
+/// 通过TSharedRef<const FPolygonMeshData>在组件、异步任务和构建器之间传递，不再复制。
+struct UTILITYRENDERER_API FPolygonMeshData
+{
+	TArray<FVector3f> Vertices;	///< 顶点数组
+	TArray<uint32> Indices;		///< 三角形索引数组（长度为三角形数量的3倍）
+	TArray<int32> PolygonIds;	///< 每个三角形所属的多边形索引
+
+	FPolygonMeshData() = default;
+
+	FPolygonMeshData(TArray<FVector3f>&& InVertices, TArray<uint32>&& InIndices, TArray<int32>&& InPolygonIds)
+		: Vertices(MoveTemp(InVertices))
+		, Indices(MoveTemp(InIndices))
+		, PolygonIds(MoveTemp(InPolygonIds))
+	{
+	}
+
+	/// \brief 三角形数量
+	int32 NumTriangles() const { return Indices.Num() / 3; }
+
+	/// \brief 检查数据是否有效
+	bool IsValid() const;
+
+	/// \brief 追加FTriangle数组（每个三角形3个独立顶点）
+	void AppendTriangles(const TArray<FTriangle>& InTriangles);
+
+	/// \brief 追加另一份索引网格，索引按已有顶点数偏移
+	void AppendMesh(const FPolygonMeshData& InMeshData);
+};
+
+/// \brief 叶子节点三角形包的容量，与SIMD宽度（4）一致
+static constexpr int32 TRIANGLE_PACKET_SIZE = 4;
+
 /// \brief 多边形BVH节点
 struct FPolygonBVHNode
 {
 	FBox BoundingBox;				///< 节点的包围盒
 	bool bIsLeaf;					///< 是否为叶子节点
 
-	FTriangle Triangle;				///< 存储的三角形（仅叶子节点有效）
+	TArray<int32, TInlineAllocator<TRIANGLE_PACKET_SIZE>> TriangleIndices;	///< 存储的三角形索引（仅叶子节点有效，最多TRIANGLE_PACKET_SIZE个）
 
 	FPolygonBVHNode* LeftChild;		///< 左子节点
 	FPolygonBVHNode* RightChild;	///< 右子节点
 
+	int32 NumSubtreeNodes;			///< 以该节点为根的子树节点数（含自身）
+	int32 NumSubtreeLeaves;			///< 以该节点为根的子树叶子数（即三角形包数）
+
 	FPolygonBVHNode()
 		: bIsLeaf(false)
 		, LeftChild(nullptr)
 		, RightChild(nullptr)
+		, NumSubtreeNodes(1)
+		, NumSubtreeLeaves(0)
 	{
 	}
 
@@ -39,7 +80,7 @@ struct FPolygonBVHNode
 
 	FBox GetBoundingBox() const 
 	{
-		return bIsLeaf ? Triangle.GetBoundingBox() : BoundingBox;
+		return BoundingBox;
 	}
 
 	// 禁止拷贝构造和赋值
@@ -47,11 +88,23 @@ struct FPolygonBVHNode
 	FPolygonBVHNode& operator=(const FPolygonBVHNode&) = delete;
 };
 
-/// \brief BVH树构建器类，负责从三角形数据构建BVH树
+/// \brief BVH树构建器类，负责从索引三角网格构建BVH树
 class UTILITYRENDERER_API FPolygonBVHBuilder
 {
 public:
+	/// \brief 从共享的索引网格构建，构建器持有网格引用，不复制数据
+	FPolygonBVHBuilder(const TSharedRef<const FPolygonMeshData>& InMeshData, const FBVHBuildConfig& InBuildConfig);
+
+	/// \brief 从外部数组视图构建，调用方需保证数组在构建器生命周期内有效
+	FPolygonBVHBuilder(
+		TConstArrayView<FVector3f> InVertices,
+		TConstArrayView<uint32> InIndices,
+		TConstArrayView<int32> InPolygonIds,
+		const FBVHBuildConfig& InBuildConfig);
+
+	/// \brief 从FTriangle数组构建（内部转换为索引网格）
 	FPolygonBVHBuilder(const TArray<FTriangle>& InTriangles, const FBVHBuildConfig& InBuildConfig);
+
 	~FPolygonBVHBuilder();
 
 	/// \brief 构建BVH树
@@ -63,9 +116,25 @@ public:
 	/// \brief 获取统计信息
 	void GetStats(FBVHStats& OutStats) const;
 
+	/// \brief 获取三角形数量
+	int32 GetNumTriangles() const { return Indices.Num() / 3; }
+
+	/// \brief 获取三角形的三个顶点
+	void GetTriangleVertices(int32 TriangleIndex, FVector3f& OutV1, FVector3f& OutV2, FVector3f& OutV3) const;
+
 private:
-	/// \brief 递归构建BVH树
-	FPolygonBVHNode* BuildRecursive_Middle(const TArray<FTriangle>& InTriangles, int32 Depth);
+	/// \brief 将FTriangle数组转换为索引网格
+	static TSharedRef<const FPolygonMeshData> MakeTriangleMeshData(const TArray<FTriangle>& InTriangles);
+
+	/// \brief 递归构建BVH树，[Begin, End)为TriangleOrder中的范围
+	FPolygonBVHNode* BuildRecursive_Middle(int32 Begin, int32 End, int32 Depth);
+	FPolygonBVHNode* BuildRecursive_SAH(int32 Begin, int32 End, int32 Depth);
+
+	/// \brief 创建叶子节点（三角形数量不超过TRIANGLE_PACKET_SIZE）
+	FPolygonBVHNode* CreateLeaf(int32 Begin, int32 End, const FBox& InBoundingBox) const;
+
+	/// \brief 计算范围内三角形的联合包围盒
+	FBox ComputeRangeBounds(int32 Begin, int32 End) const;
 
 	/// \brief 递归统计BVH树信息
 	void GetStatsRecursive(const FPolygonBVHNode* Node, int32 CurrentDepth, FBVHStats& OutStats) const;
@@ -73,14 +142,24 @@ private:
 private:
 	friend class FPolygonGPUConverter;
 
-	FPolygonBVHNode* Root;			///< BVH树的根节点
-	TArray<FTriangle> AllTriangles;	///< 所有三角形
-	FBVHBuildConfig BuildConfig;	///< BVH构建配置
+	FPolygonBVHNode* Root;							///< BVH树的根节点
+	TSharedPtr<const FPolygonMeshData> MeshData;	///< 持有的索引网格（使用数组视图构建时为空）
+	TConstArrayView<FVector3f> Vertices;			///< 顶点
+	TConstArrayView<uint32> Indices;				///< 三角形索引
+	TConstArrayView<int32> PolygonIds;				///< 三角形所属多边形索引
+	FBVHBuildConfig BuildConfig;					///< BVH构建配置
+
+	// --------------------------------------------------------------------
+	// 构建过程中的临时数据
+	// --------------------------------------------------------------------
+	TArray<int32> TriangleOrder;					///< 原地划分的三角形索引
+	TArray<FBox3f> TriangleBounds;					///< 每个三角形的包围盒
+	TArray<FVector3f> TriangleCenters;				///< 每个三角形包围盒的中心
 
 	// --------------------------------------------------------------------
 	// 用于调试的参数
 	// --------------------------------------------------------------------
-	double BuildTimeMs;				///< 构建耗时（毫秒）
+	double BuildTimeMs;								///< 构建耗时（毫秒）
 };
 
 // =====================================================================
@@ -88,43 +167,78 @@ private:
 // =====================================================================
 
 /// \brief GPU BVH节点
+///
+/// 节点按深度优先顺序线性存储：内部节点的左子节点固定位于下一个位置（i + 1），
+/// 只需保存右子节点的偏移；叶子节点以负数保存其三角形包索引。
 struct FGPUPolygonBVHNode
 {
-	FVector3f MinExtent;	///< 包围盒最小值						(12字节)
-	int32 LeftChild;		///< 左子节点索引（-1表示无效）			(4字节)
-
-	FVector3f MaxExtent;	///< 包围盒最大值						(12字节)
-	int32 RightChild;		///< 右子节点索引（-1表示无效）			(4字节)
+	FVector3f MinExtent;		///< 包围盒最小值											(12字节)
+	int32 RightOffsetOrPacket;	///< 内部节点：右子节点偏移(>0)；叶子节点：-(三角形包索引 + 1)	(4字节)
 
-	int32 TriangleIndex;	///< 三角形起始索引（仅叶子节点有效）	(4字节)
-	float IsLeaf;			///< 是否为叶子节点						(4字节)
-	float Padding1;			///< 填充1								(4字节)
-	float Padding2;			///< 填充2								(4字节)
+	FVector3f MaxExtent;		///< 包围盒最大值											(12字节)
+	uint32 Padding;				///< 填充													(4字节)
 
 	FGPUPolygonBVHNode()
-		: LeftChild(-1), RightChild(-1), TriangleIndex(-1)
+		: RightOffsetOrPacket(0), Padding(0)
 	{
 	}
+
+	/// \brief 是否为叶子节点
+	bool IsLeaf() const { return RightOffsetOrPacket < 0; }
+
+	/// \brief 叶子节点的三角形包索引
+	int32 GetPacketIndex() const { return -RightOffsetOrPacket - 1; }
+
+	/// \brief 内部节点的右子节点索引
+	int32 GetRightChild(int32 NodeIndex) const { return NodeIndex + RightOffsetOrPacket; }
+
+	/// \brief 内部节点的左子节点索引
+	static int32 GetLeftChild(int32 NodeIndex) { return NodeIndex + 1; }
 };
 
-/// \brief GPU 三角形
-struct FGPUTriangle
+/// \brief GPU 三角形包
+///
+/// 以SoA布局保存最多TRIANGLE_PACKET_SIZE个三角形的XY坐标，
+/// 使CPU（VectorRegister）和GPU（float4）都能一次测试4个三角形。
+struct alignas(16) FGPUTrianglePacket
 {
-	FVector3f Vertex1;		///< 顶点1			(12字节)
-	float Padding1;			///< 填充1			(4字节)
-
-	FVector3f Vertex2;		///< 顶点2			(12字节)
-	float Padding2;			///< 填充2			(4字节)
+	float V1X[TRIANGLE_PACKET_SIZE];					///< 顶点1 X			(16字节)
+	float V1Y[TRIANGLE_PACKET_SIZE];					///< 顶点1 Y			(16字节)
+	float V2X[TRIANGLE_PACKET_SIZE];					///< 顶点2 X			(16字节)
+	float V2Y[TRIANGLE_PACKET_SIZE];					///< 顶点2 Y			(16字节)
+	float V3X[TRIANGLE_PACKET_SIZE];					///< 顶点3 X			(16字节)
+	float V3Y[TRIANGLE_PACKET_SIZE];					///< 顶点3 Y			(16字节)
+	int32 PolygonIndex[TRIANGLE_PACKET_SIZE];			///< 所属多边形索引		(16字节)
+
+	int32 NumTriangles;			///< 有效三角形数量		(4字节)
+	uint32 BoundaryEdgeMask;	///< 多边形边界边标记，第Lane * 3 + i位对应第Lane个三角形的第i条边（V1V2、V2V3、V3V1）	(4字节)
+	float Padding[2];			///< 填充				(4 * 2字节)
+
+	FGPUTrianglePacket()
+	{
+		FMemory::Memzero(*this);
+	}
 
-	FVector3f Vertex3;		///< 顶点3			(12字节)
-	int32 PolygonIndex;		///< 所属多边形索引	(4字节)
+	/// \brief 写入第Lane个三角形
+	void SetTriangle(int32 Lane, const FVector3f& InV1, const FVector3f& InV2, const FVector3f& InV3, int32 InPolygonIndex)
+	{
+		check(Lane >= 0 && Lane < TRIANGLE_PACKET_SIZE);
+
+		V1X[Lane] = InV1.X;
+		V1Y[Lane] = InV1.Y;
+		V2X[Lane] = InV2.X;
+		V2Y[Lane] = InV2.Y;
+		V3X[Lane] = InV3.X;
+		V3Y[Lane] = InV3.Y;
+		PolygonIndex[Lane] = InPolygonIndex;
+	}
 };
 
 /// \brief 多边形 GPU数据
 struct FGPUPolygonData
 {
 	TArray<FGPUPolygonBVHNode> Nodes;			///< BVH节点数组
-	TArray<FGPUTriangle> Triangles;				///< 三角形数据
+	TArray<FGPUTrianglePacket> Packets;			///< 三角形包数据
 	int32 RootNodeIndex;						///< 根节点索引
 
 	FGPUPolygonData() : RootNodeIndex(-1) {}
@@ -133,7 +247,7 @@ struct FGPUPolygonData
 	void Reset()
 	{
 		Nodes.Empty();
-		Triangles.Empty();
+		Packets.Empty();
 		RootNodeIndex = -1;
 	}
 
@@ -144,6 +258,103 @@ struct FGPUPolygonData
 	}
 };
 
+/// \brief 未指定图层的多边形所使用的默认图层掩码（图层0）
+static constexpr uint32 DEFAULT_POLYGON_LAYER_MASK = 1u;
+
+/// \brief 局部修改图层掩码时值发生变化的多边形和节点，上传时只写入这些范围
+struct FPolygonLayerMaskDirtyRanges
+{
+	FSurfaceDirtyRanges Polygons;	///< 修改的多边形图层掩码
+	FSurfaceDirtyRanges Nodes;		///< 子树掩码随之变化的节点
+
+	void Append(const FPolygonLayerMaskDirtyRanges& InOther)
+	{
+		Polygons.Append(InOther.Polygons);
+		Nodes.Append(InOther.Nodes);
+	}
+
+	bool IsEmpty() const
+	{
+		return Polygons.IsEmpty() && Nodes.IsEmpty();
+	}
+
+	void Reset()
+	{
+		Polygons.Reset();
+		Nodes.Reset();
+	}
+};
+
+/// \brief 多边形图层掩码
+///
+/// 每个多边形对应一个32位图层掩码（按PolygonIndex索引），BVH的每个节点对应其子树内全部多边形图层掩码的并集。
+/// 遍历时与可见图层无交集的子树整体剔除；修改图层只需重新计算这两个小数组，无需重建BVH。
+struct UTILITYRENDERER_API FPolygonLayerMasks
+{
+	TArray<uint32> PolygonLayerMasks;	///< 每个多边形的图层掩码
+	TArray<uint32> NodeLayerMasks;		///< 每个BVH节点子树的图层掩码并集（与FGPUPolygonData::Nodes一一对应）
+
+	/// \brief 根据用户指定的多边形图层掩码计算，未指定的多边形使用DEFAULT_POLYGON_LAYER_MASK
+	void Build(const FGPUPolygonData& InGPUData, TConstArrayView<uint32> InPolygonLayerMasks);
+
+	/// \brief 部分多边形的图层掩码修改后重新合并节点掩码，只记录值发生变化的多边形和节点
+	/// \param InPolygonLayerMasks 用户指定的全部多边形图层掩码
+	/// \param InChangedPolygons 修改过的多边形索引
+	/// \return 修改的多边形超出当前范围时返回false，不修改任何数据，需要重新Build
+	bool Update(const FGPUPolygonData& InGPUData, TConstArrayView<uint32> InPolygonLayerMasks, TConstArrayView<int32> InChangedPolygons, FPolygonLayerMaskDirtyRanges& OutDirtyRanges);
+
+	/// \brief 获取多边形的图层掩码
+	uint32 GetPolygonLayerMask(int32 PolygonIndex) const
+	{
+		return PolygonLayerMasks.IsValidIndex(PolygonIndex) ? PolygonLayerMasks[PolygonIndex] : DEFAULT_POLYGON_LAYER_MASK;
+	}
+
+	/// \brief 获取节点子树的图层掩码，超出范围时不剔除
+	uint32 GetNodeLayerMask(int32 NodeIndex) const
+	{
+		return NodeLayerMasks.IsValidIndex(NodeIndex) ? NodeLayerMasks[NodeIndex] : ~0u;
+	}
+
+	void Reset()
+	{
+		PolygonLayerMasks.Empty();
+		NodeLayerMasks.Empty();
+	}
+
+	bool IsValid() const
+	{
+		return PolygonLayerMasks.Num() > 0 && NodeLayerMasks.Num() > 0;
+	}
+
+private:
+	/// \brief 自底向上重新合并节点掩码
+	/// \param OutDirtyNodes 不为空时记录值发生变化的节点
+	void MergeNodeLayerMasks(const FGPUPolygonData& InGPUData, FSurfaceDirtyRanges* OutDirtyNodes);
+};
+
+/// \brief 局部修改图层掩码的暂存数据
+///
+/// 游戏线程在自己的掩码上Update后只暂存修改范围及范围内的新值（按范围顺序连续存放），
+/// 渲染线程持有另一份完整掩码，据此修补后只上传这些范围，两边都不需要复制整个掩码。
+struct UTILITYRENDERER_API FPolygonLayerMaskPatch
+{
+	FPolygonLayerMaskDirtyRanges DirtyRanges;	///< 修改范围
+	TArray<uint32> PolygonValues;				///< DirtyRanges.Polygons范围内的新值
+	TArray<uint32> NodeValues;					///< DirtyRanges.Nodes范围内的新值
+
+	/// \brief 从更新后的掩码中暂存InDirtyRanges范围内的值，多次暂存时后暂存的值覆盖先暂存的值
+	void Stage(const FPolygonLayerMasks& InLayerMasks, const FPolygonLayerMaskDirtyRanges& InDirtyRanges);
+
+	/// \brief 把暂存的值写入InOutLayerMasks
+	/// \return 范围超出掩码大小（掩码与暂存数据不对应）时返回false，不修改任何数据
+	bool Apply(FPolygonLayerMasks& InOutLayerMasks) const;
+
+	bool IsEmpty() const
+	{
+		return DirtyRanges.IsEmpty();
+	}
+};
+
 /// \brief 提供BVH数据到GPU格式的转换器
 class UTILITYRENDERER_API FPolygonGPUConverter
 {
@@ -152,12 +363,20 @@ public:
 	static bool ConvertToGPUData(const FPolygonBVHBuilder& Builder, FGPUPolygonData& OutGPUData);
 
 private:
-	/// \brief 递归构建GPU节点
-	static int32 CollectNodesRecursive(const FPolygonBVHNode* BVHNodes, FGPUPolygonData& OutGPUData);
+	/// \brief 待输出的子树，偏移量由子树节点数/叶子数的前缀和得到
+	struct FSubtreeTask
+	{
+		const FPolygonBVHNode* Node;	///< 子树根节点
+		int32 NodeOffset;				///< 子树根节点在Nodes中的位置
+		int32 PacketOffset;				///< 子树第一个三角形包在Packets中的位置
+	};
+
+	/// \brief 计算每个三角形的边界边标记（3位）：同一多边形内没有另一个三角形共用（按XY坐标比较）的边为边界边
+	static void ComputeBoundaryEdgeMasks(const FPolygonBVHBuilder& Builder, TArray<uint8>& OutBoundaryEdgeMasks);
 
-	/// \brief 收集顶点数据
-	static void CollectTrianglesRecursive(const FPolygonBVHNode* BVHNode, FGPUPolygonData& OutGPUData);
+	/// \brief 输出单个节点（叶子节点同时输出三角形包）
+	static void EmitNode(const FPolygonBVHBuilder& Builder, TConstArrayView<uint8> InBoundaryEdgeMasks, const FSubtreeTask& Task, FGPUPolygonData& OutGPUData);
 
-	/// \brief 分配索引
-	static void AssignTriangleIndices(FGPUPolygonData& OutGPUData);
+	/// \brief 深度优先输出整棵子树
+	static void EmitSubtreeRecursive(const FPolygonBVHBuilder& Builder, TConstArrayView<uint8> InBoundaryEdgeMasks, const FSubtreeTask& Task, FGPUPolygonData& OutGPUData);
 };
\ No newline at end of file
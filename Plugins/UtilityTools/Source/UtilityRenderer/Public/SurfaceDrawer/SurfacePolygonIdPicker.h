@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+
+#include <atomic>
+
+
+class FRHIGPUTextureReadback;
+class FRDGBuilder;
+class UWorld;
+
+/**
+ * @brief 多边形ID拾取器
+ *
+ * 线段/多边形全屏Pass在开启拾取时额外输出一张R32整数多边形ID纹理（多边形索引 + 1，0表示未命中），
+ * 每帧只把光标附近的一小块区域拷贝到回读环中。回读环有多个槽位，GPU结果就绪后才读取，
+ * 未就绪时跳过本帧的回读而不是等待，因此结果会滞后若干帧，但不会造成渲染线程阻塞。
+ *
+ * 光标位置由游戏线程写入，拾取结果可在任意线程读取。
+ */
+class UTILITYRENDERER_API FSurfacePolygonIdPicker
+{
+public:
+	static constexpr int32 NumReadbacks = 4;				///< 回读环槽位数量
+	static constexpr int32 PickRadius = 2;					///< 拾取半径（像素），回读区域为(2R+1)^2
+	static constexpr int32 RegionSize = PickRadius * 2 + 1;	///< 回读区域边长（像素）
+	static constexpr EPixelFormat IdTextureFormat = PF_R32_UINT;	///< 整数格式，多边形索引超过2^24时不丢失精度
+
+	FSurfacePolygonIdPicker();
+	~FSurfacePolygonIdPicker();
+
+	/// \brief 设置光标位置（游戏线程）
+	/// \param InNormalizedPosition 相对视口的归一化坐标[0, 1]，任一分量为负时停止拾取
+	void SetCursorPosition(const FVector2f& InNormalizedPosition);
+
+	/// \brief 获取光标下的多边形索引，没有命中时返回INDEX_NONE
+	int32 GetPolygonUnderCursor() const { return PolygonUnderCursor.load(std::memory_order_relaxed); }
+
+	/// \brief 以世界中第一个玩家控制器的鼠标位置更新光标，并返回当前的拾取结果（游戏线程）
+	int32 PickPolygonUnderCursor(const UWorld* InWorld);
+
+	/// \brief 获取被跳过的回读次数（回读环已满，GPU尚未完成之前的拷贝）
+	uint32 GetNumSkippedReadbacks() const { return NumSkippedReadbacks.load(std::memory_order_relaxed); }
+
+	/// \brief 创建本帧的多边形ID纹理，清空为0
+	static FRDGTextureRef CreateIdTexture(FRDGBuilder& GraphBuilder, FIntPoint InExtent);
+
+	/// \brief 处理已就绪的回读，并将光标附近区域拷贝到下一个回读槽位（渲染线程）
+	/// \param InViewRect 光标归一化坐标对应的视口矩形
+	void AddReadbackPasses(FRDGBuilder& GraphBuilder, FRDGTextureRef InIdTexture, const FIntRect& InViewRect);
+
+	/// \brief 释放回读资源（渲染线程）
+	void Release_RenderThread();
+
+private:
+	/// \brief 读取所有已就绪的回读槽位，更新拾取结果
+	void ProcessReadbacks_RenderThread();
+
+	/// \brief 在回读区域中查找距离光标最近的有效多边形ID
+	static int32 FindNearestPolygon(const uint32* InData, int32 InRowPitchInPixels, const FIntPoint& InCursorInRegion);
+
+	struct FReadbackSlot
+	{
+		TUniquePtr<FRHIGPUTextureReadback> Readback;
+		FIntPoint CursorInRegion = FIntPoint::ZeroValue; ///< 光标在回读区域内的像素位置
+	};
+
+	// 渲染线程数据
+	TArray<FReadbackSlot> ReadbackSlots;
+	int32 WriteIndex;	///< 下一个写入的槽位
+	int32 NumPending;	///< 已提交但尚未读取的槽位数量
+
+	// 游戏线程写入的光标位置
+	FVector2f CursorPosition;
+	mutable FCriticalSection CursorLock;
+
+	std::atomic<int32> PolygonUnderCursor;
+	std::atomic<uint32> NumSkippedReadbacks;
+};
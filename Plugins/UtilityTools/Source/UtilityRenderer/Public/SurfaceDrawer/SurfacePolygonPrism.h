@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfacePolygonBuilder.h"
+
+
+/// \brief 棱柱顶点
+struct FPolygonPrismVertex
+{
+	FVector3f Position;		///< 顶点位置			(12字节)
+	int32 PolygonIndex;		///< 所属多边形索引		(4字节)
+
+	FPolygonPrismVertex()
+		: Position(FVector3f::ZeroVector), PolygonIndex(-1)
+	{
+	}
+
+	FPolygonPrismVertex(const FVector3f& InPosition, int32 InPolygonIndex)
+		: Position(InPosition), PolygonIndex(InPolygonIndex)
+	{
+	}
+};
+
+/// \brief 多边形拉伸得到的竖直棱柱网格（模板阴影体）
+///
+/// 每个多边形的三角形在[MinZ, MaxZ]之间拉伸为封闭体：顶面、底面，以及多边形边界上的侧面。
+/// 同一多边形内相邻三角形的公共边方向相反，侧面相互抵消，不会输出。
+struct UTILITYRENDERER_API FPolygonPrismMesh
+{
+	TArray<FPolygonPrismVertex> Vertices;	///< 顶点数组
+	TArray<uint32> Indices;					///< 三角形索引数组，所有三角形朝外
+	FBox3f Bounds;							///< 包围盒
+
+	FPolygonPrismMesh() : Bounds(ForceInit) {}
+
+	/// \brief 三角形数量
+	int32 NumTriangles() const { return Indices.Num() / 3; }
+
+	void Reset()
+	{
+		Vertices.Empty();
+		Indices.Empty();
+		Bounds.Init();
+	}
+
+	bool IsValid() const
+	{
+		return Vertices.Num() > 0 && Indices.Num() > 0;
+	}
+};
+
+/// \brief 棱柱网格生成器，纯CPU实现，不依赖渲染线程
+class UTILITYRENDERER_API FPolygonPrismBuilder
+{
+public:
+	/// \brief 将索引三角网格沿Z轴拉伸为棱柱网格
+	/// \param InMinZ 棱柱底面高度，应低于地形最低点
+	/// \param InMaxZ 棱柱顶面高度，应高于地形最高点
+	/// \return 生成了至少一个棱柱时返回true
+	static bool BuildPrismMesh(const FPolygonMeshData& InMeshData, float InMinZ, float InMaxZ, FPolygonPrismMesh& OutPrismMesh);
+};
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfacePolygonBuilder.h"
+
+
+/**
+ * @brief 多边形BVH的CPU查询
+ *
+ * 直接在FGPUPolygonData（与GPU相同的线性布局）上进行遍历，
+ * 叶子节点的三角形包使用VectorRegister一次测试4个三角形，供Gameplay进行包含查询。
+ */
+class UTILITYRENDERER_API FPolygonBVHQuery
+{
+public:
+	/// \brief 查询XY平面上包含点的多边形
+	/// \return 找到包含点的三角形时返回true，OutPolygonIndex为其所属多边形索引
+	static bool QueryPoint(const FGPUPolygonData& InGPUData, const FVector2f& InPoint, int32& OutPolygonIndex);
+
+	/// \brief 查询XY平面上包含点的可见多边形，跳过与InVisibleLayers无交集的子树和多边形
+	static bool QueryPoint(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks& InLayerMasks, uint32 InVisibleLayers, const FVector2f& InPoint, int32& OutPolygonIndex);
+
+	/// \brief 批量查询：按Morton顺序排序以提高遍历的缓存一致性，再分批并行查询
+	/// \param OutPolygonIndices 与InPoints一一对应，不在任何多边形内时为INDEX_NONE
+	static void QueryPoints(const FGPUPolygonData& InGPUData, TConstArrayView<FVector2f> InPoints, TArray<int32>& OutPolygonIndices);
+
+	/// \brief 批量查询可见多边形
+	static void QueryPoints(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks& InLayerMasks, uint32 InVisibleLayers, TConstArrayView<FVector2f> InPoints, TArray<int32>& OutPolygonIndices);
+
+	/// \brief 查询点到最近三角形边的XY距离（上限为InMaxDistance）
+	///
+	/// 三角形内部边也参与计算，结果是到多边形边界距离的保守下界：
+	/// 点在该距离内移动时，包含它的三角形集合不会改变。
+	static float QueryDistanceToEdges(const FGPUPolygonData& InGPUData, const FVector2f& InPoint, float InMaxDistance);
+
+	/// \brief 暴力遍历全部三角形包，返回包含点的全部多边形索引（不去重），用于校验BVH查询结果
+	static void QueryPointBruteForce(const FGPUPolygonData& InGPUData, const FVector2f& InPoint, TArray<int32>& OutPolygonIndices);
+
+	/// \brief SIMD测试三角形包内的全部三角形
+	/// \param InLaneMask 参与测试的通道掩码（第i位对应包内第i个三角形）
+	/// \return 包含点的第一个三角形在包内的序号，不在任何三角形内时返回INDEX_NONE
+	static int32 PointInsidePacket(const FGPUTrianglePacket& InPacket, const FVector2f& InPoint, uint32 InLaneMask = 0xF);
+
+private:
+	static void QueryPointsInternal(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks* InLayerMasks, uint32 InVisibleLayers, TConstArrayView<FVector2f> InPoints, TArray<int32>& OutPolygonIndices);
+
+	static bool QueryPointInternal(const FGPUPolygonData& InGPUData, const FPolygonLayerMasks* InLayerMasks, uint32 InVisibleLayers, const FVector2f& InPoint, int32& OutPolygonIndex);
+};
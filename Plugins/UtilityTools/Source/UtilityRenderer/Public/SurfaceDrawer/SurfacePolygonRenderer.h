@@ -3,9 +3,45 @@
 #include "CoreMinimal.h"
 #include "RenderGraphResources.h"
 
+#include "SurfaceBufferArena.h"
+#include "SurfaceBufferUpload.h"
+#include "SurfaceCoverageCache.h"
 #include "SurfacePolygonBuilder.h"
+#include "SurfacePolygonPrism.h"
+#include "SurfacePolygonIdPicker.h"
 
 
+/// \brief 代理几何数据在共享缓冲区中的分配句柄
+struct FSurfacePolygonAllocations
+{
+	int32 Nodes = INDEX_NONE;
+	int32 Packets = INDEX_NONE;
+};
+
+/// \brief 所有SurfacePolygon代理共用的几何缓冲区（仅渲染线程访问）
+struct FSurfacePolygonArenas
+{
+	FSurfaceBufferArena Nodes;
+	FSurfaceBufferArena Packets;
+
+	FSurfacePolygonArenas();
+
+	/// \brief 按数据大小为节点和三角形包分配范围
+	void Allocate(const FGPUPolygonData& InData, FSurfacePolygonAllocations& OutAllocations);
+
+	/// \brief 释放分配，句柄置为INDEX_NONE
+	void Free(FSurfacePolygonAllocations& InOutAllocations);
+
+	/// \brief 紧凑排列两个缓冲区
+	void Defragment(FRDGBuilder& GraphBuilder);
+
+	/// \brief 丢弃上一次渲染创建的SRV
+	void ResetSRVs();
+
+	/// \brief 释放两个缓冲区和所有分配
+	void Release();
+};
+
 /**
  * @brief SurfacePolygon场景代理
  * 
@@ -19,7 +55,14 @@ public:
 		, Opacity(0.0f)
 		, Color(FLinearColor::Black)
 		, ProxyId(0)
+		, VisibleLayers(~0u)
+		, RenderMode(ESurfacePolygonRenderMode::FullscreenBVH)
 		, bBuffersInitialized(false)
+		, BufferGeneration(0)
+		, bUploadPending(false)
+		, bLayerBuffersInitialized(false)
+		, LayerBufferGeneration(0)
+		, bPrismBuffersInitialized(false)
 	{
 	}
 
@@ -31,29 +74,118 @@ public:
 		: GPUPolygonData(InGPUPolygonData)
 		, Opacity(InOpacity)
 		, Color(InColor)
+		, ProxyId(0)
+		, VisibleLayers(~0u)
+		, RenderMode(ESurfacePolygonRenderMode::FullscreenBVH)
 		, bBuffersInitialized(false)
+		, BufferGeneration(0)
+		, bUploadPending(false)
+		, bLayerBuffersInitialized(false)
+		, LayerBufferGeneration(0)
+		, bPrismBuffersInitialized(false)
 	{
 	}
 
 	/// \brief 更新参数
+	/// \param InbBuffersInitialized 为false时InGPUPolygonData是新数据，分帧上传完成前继续使用当前数据和缓冲区渲染
+	/// \param InLayerMasks InbLayerBuffersInitialized为false时是重新计算的图层掩码，归代理所有，之后由局部修改原地修补
+	/// \param InLayerMaskPatch InbLayerBuffersInitialized为true时的局部修改，修补当前掩码后只上传这些范围
 	void UpdateParameters_RenderThread(
 		const TSharedPtr<FGPUPolygonData>& InGPUPolygonData,
 		float InOpacity,
 		const FLinearColor& InColor,
-		bool InbBuffersInitialized)
+		bool InbBuffersInitialized,
+		const TSharedPtr<FPolygonLayerMasks>& InLayerMasks,
+		uint32 InVisibleLayers,
+		bool InbLayerBuffersInitialized,
+		const TSharedPtr<const FPolygonLayerMaskPatch>& InLayerMaskPatch)
 	{
 		check(IsInRenderingThread());
 
-		GPUPolygonData = InGPUPolygonData;
 		Opacity = InOpacity;
 		Color = InColor;
-		bBuffersInitialized = InbBuffersInitialized;
+		VisibleLayers = InVisibleLayers;
+		if (!InbBuffersInitialized)
+		{
+			PendingGPUPolygonData = InGPUPolygonData;
+			bUploadPending = true;
+			PendingUpload.Reset();
+		}
+
+		// 图层掩码按多边形和节点索引，新几何数据上传期间暂存，与几何数据一起替换（替换后整体上传）
+		TSharedPtr<FPolygonLayerMasks>& TargetLayerMasks = bUploadPending ? PendingLayerMasks : LayerMasks;
+		bool bPatched = false;
+		if (!InbLayerBuffersInitialized)
+		{
+			TargetLayerMasks = InLayerMasks;
+		}
+		else if (InLayerMaskPatch.IsValid() && !InLayerMaskPatch->IsEmpty())
+		{
+			// 局部修改总是基于最近一次传入的完整掩码，与之不对应时说明丢失了完整掩码，保持原样直到下次重新计算
+			bPatched = ensure(TargetLayerMasks.IsValid() && InLayerMaskPatch->Apply(*TargetLayerMasks));
+		}
+
+		if (!bUploadPending)
+		{
+			bLayerBuffersInitialized = bLayerBuffersInitialized && InbLayerBuffersInitialized;
+			if (!bLayerBuffersInitialized)
+			{
+				PendingLayerDirtyRanges.Reset();
+			}
+			else if (bPatched)
+			{
+				PendingLayerDirtyRanges.Append(InLayerMaskPatch->DirtyRanges);
+			}
+		}
+	}
+
+	/// \brief 更新模板阴影体模式参数
+	void UpdatePrismParameters_RenderThread(
+		const TSharedPtr<const FPolygonPrismMesh>& InPrismMesh,
+		ESurfacePolygonRenderMode InRenderMode,
+		bool InbPrismBuffersInitialized)
+	{
+		check(IsInRenderingThread());
+
+		PrismMesh = InPrismMesh;
+		RenderMode = InRenderMode;
+		bPrismBuffersInitialized = InbPrismBuffersInitialized;
+	}
+
+	/// \brief 更新多边形ID拾取器，为空时不输出ID纹理
+	void UpdatePickingParameters_RenderThread(const TSharedPtr<FSurfacePolygonIdPicker>& InPolygonIdPicker)
+	{
+		check(IsInRenderingThread());
+
+		if (PolygonIdPicker.IsValid() && PolygonIdPicker != InPolygonIdPicker)
+		{
+			PolygonIdPicker->Release_RenderThread();
+		}
+		PolygonIdPicker = InPolygonIdPicker;
+	}
+
+	/// \brief 是否使用模板阴影体模式渲染
+	bool UseStencilVolume() const
+	{
+		return RenderMode == ESurfacePolygonRenderMode::StencilVolume && PrismMesh.IsValid() && PrismMesh->IsValid();
+	}
+
+	/// \brief 是否使用分块计算模式渲染
+	bool UseTiledCompute() const
+	{
+		return RenderMode == ESurfacePolygonRenderMode::TiledCompute;
 	}
 
 	/// \brief 重置参数，释放资源引用
 	void Reset()
 	{
 		GPUPolygonData.Reset();
+		PendingGPUPolygonData.Reset();
+		LayerMasks.Reset();
+		PendingLayerMasks.Reset();
+		PendingLayerDirtyRanges.Reset();
+		PrismMesh.Reset();
+		PolygonIdPicker.Reset();
 		Opacity = 0.0f;
 		Color = FLinearColor::Black;
 	}
@@ -61,6 +193,13 @@ public:
 	/// \brief 获取代理ID
 	uint32 GetProxyId() const { return ProxyId; }
 
+	/// \brief 计算代理在视口中的屏幕范围：BVH根节点范围投影到屏幕
+	/// \return 代理完全在视口外时返回false
+	bool CalculateScissorRect(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, FIntRect& OutScissorRect) const;
+
+	/// \brief 按视锥和可见图层剔除BVH的前几层，得到着色器遍历的起始子树
+	void CalculateSeedNodes(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, TArray<uint32>& OutSeedNodes) const;
+
 private:
 	TSharedPtr<FGPUPolygonData> GPUPolygonData;
 	float Opacity;
@@ -68,12 +207,49 @@ private:
 
 	uint32 ProxyId; ///< 唯一标识符
 
-	// 池化缓冲区管理
-	bool bBuffersInitialized;
-	TRefCountPtr<FRDGPooledBuffer> BVHNodesPooledBuffer;
-	TRefCountPtr<FRDGPooledBuffer> TrianglesPooledBuffer;
-	void InitializePooledBuffers(FRDGBuilder& GraphBuilder);
-	void ReleasePooledBuffers();
+	// 图层可见性，掩码归代理所有，只在渲染线程修补
+	TSharedPtr<FPolygonLayerMasks> LayerMasks;
+	uint32 VisibleLayers; ///< 可见图层掩码，切换图层仅修改该常量，不需要上传
+
+	// 模板阴影体模式
+	TSharedPtr<const FPolygonPrismMesh> PrismMesh;
+	ESurfacePolygonRenderMode RenderMode;
+
+	// 多边形ID拾取，开启时额外输出ID纹理并回读光标附近区域
+	TSharedPtr<FSurfacePolygonIdPicker> PolygonIdPicker;
+
+	// 主视图的覆盖结果缓存（r.SurfaceDrawer.CoverageCache）
+	FSurfaceCoverageCache CoverageCache;
+
+	// 几何数据在共享缓冲区（FSurfacePolygonArenas）中的分配
+	bool bBuffersInitialized; ///< 分配中的数据是否与GPUPolygonData一致
+	uint32 BufferGeneration; ///< 每次替换几何数据后递增，覆盖缓存据此判断是否失效
+	FSurfacePolygonAllocations Allocations;
+
+	// 正在分帧上传的新数据及其分配，全部上传后与GPUPolygonData及其分配、图层掩码一起替换
+	bool bUploadPending;
+	TSharedPtr<FGPUPolygonData> PendingGPUPolygonData;
+	TSharedPtr<FPolygonLayerMasks> PendingLayerMasks;
+	FSurfacePolygonAllocations PendingAllocations;
+	FSurfaceBufferUpload PendingUpload;
+
+	/// \brief 在本帧的上传预算内推进新数据的上传，完成时替换数据和分配
+	void InitializePooledBuffers(FRDGBuilder& GraphBuilder, FSurfacePolygonArenas& Arenas);
+
+	// 图层掩码缓冲区，修改少量多边形的图层时只上传变化的多边形和节点
+	bool bLayerBuffersInitialized;
+	uint32 LayerBufferGeneration;
+	TRefCountPtr<FRDGPooledBuffer> PolygonLayerMasksPooledBuffer;
+	TRefCountPtr<FRDGPooledBuffer> NodeLayerMasksPooledBuffer;
+	FPolygonLayerMaskDirtyRanges PendingLayerDirtyRanges;
+	void InitializeLayerBuffers(FRDGBuilder& GraphBuilder);
+
+	// 棱柱网格缓冲区
+	bool bPrismBuffersInitialized;
+	TRefCountPtr<FRDGPooledBuffer> PrismVerticesPooledBuffer;
+	TRefCountPtr<FRDGPooledBuffer> PrismIndicesPooledBuffer;
+	void InitializePrismBuffers(FRDGBuilder& GraphBuilder);
+	void ReleasePooledBuffers(FSurfacePolygonArenas& Arenas);
 
 	friend class FSurfacePolygonRenderManager;
 };
@@ -102,7 +278,7 @@ public:
 	void RegisterSceneProxy(const TSharedPtr<FSurfacePolygonSceneProxy>& InSceneProxy);
 	void UnregisterSceneProxy(uint32 ProxyId);
 
-	/// \brief 获取当前注册的代理数量
+	/// \brief 获取当前注册的代理数量（游戏线程）
 	int32 GetNumSceneProxies();
 
 private:
@@ -123,6 +299,25 @@ private:
 	/// \brief 渲染线程执行函数
 	void Execute_RenderThread(FPostOpaqueRenderParameters& Parameters);
 
+	/// \brief 在渲染线程添加代理
+	void AddSceneProxy_RenderThread(const TSharedPtr<FSurfacePolygonSceneProxy>& InSceneProxy);
+
+	/// \brief 在渲染线程移除代理并释放其GPU资源
+	void RemoveSceneProxy_RenderThread(uint32 ProxyId);
+
+	/// \brief 模板阴影体模式：标记棱柱覆盖的像素，然后只着色被标记的像素
+	/// \param InOutPrismDepthTexture 同一帧所有代理共用的深度模板缓冲区，首次使用时创建
+	/// \param InPolygonIdTexture 多边形ID纹理，为空时不输出ID
+	void AddStencilVolumePasses(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfacePolygonSceneProxy& SceneProxy, FRDGTextureRef& InOutPrismDepthTexture, FRDGTextureRef InPolygonIdTexture);
+
+	/// \brief 分块计算模式：每个16×16分块剔除一次BVH，像素只测试分块的候选三角形包，只分派覆盖ScissorRect的分块
+	/// \return 缓冲区未就绪或场景颜色不支持UAV读写时返回false，由调用方退回全屏Pass
+	bool AddTiledComputePass(FRDGBuilder& GraphBuilder, const FPostOpaqueRenderParameters& Parameters, FSurfacePolygonSceneProxy& SceneProxy, const FIntRect& ScissorRect);
+
+	/// \brief 把代理的几何缓冲区和偏移写入Pass参数
+	template <typename ParametersType>
+	void SetGeometryParameters(FRDGBuilder& GraphBuilder, const FSurfacePolygonSceneProxy& SceneProxy, ParametersType* PassParameters);
+
 private:
 	/// \brief 单例实例
 	static FSurfacePolygonRenderManager* Instance;
@@ -130,9 +325,13 @@ private:
 	/// \brief 渲染委托句柄
 	FDelegateHandle OnOverlayRenderHandle;
 
-	/// \brief 场景代理映射表（ProxyId -> SceneProxy）
-	TMap<uint32, TSharedPtr<FSurfacePolygonSceneProxy>> SceneProxyMap;
+	/// \brief 场景代理列表，按ProxyId（注册顺序）排列；仅渲染线程访问，注册和注销通过渲染命令修改
+	TArray<TSharedPtr<FSurfacePolygonSceneProxy>> SceneProxies;
+
+	/// \brief 已注册的代理ID，仅游戏线程访问，决定渲染委托的挂接和移除
+	TSet<uint32> RegisteredProxyIds;
 	uint32 NextProxyId = 0; ///< 可以反映已经注册过的代理总数（包括已经注销的）
 
-	FCriticalSection RenderThreadLock;
+	/// \brief 所有代理共用的节点和三角形包缓冲区（仅渲染线程访问）
+	FSurfacePolygonArenas Arenas;
 };
\ No newline at end of file
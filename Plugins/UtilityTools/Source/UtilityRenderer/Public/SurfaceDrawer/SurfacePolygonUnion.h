@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfacePolygonBuilder.h"
+
+
+/// \brief 多边形并集统计信息
+struct FPolygonUnionStats
+{
+	int32 NumInputTriangles;	///< 输入三角形数量
+	int32 NumOutputTriangles;	///< 输出三角形数量
+	int32 NumGroups;			///< 分组数量（每组单独求并集）
+	int32 NumTiles;				///< 空间分块数量
+	double BuildTimeMs;			///< 耗时（毫秒）
+
+	FPolygonUnionStats()
+		: NumInputTriangles(0), NumOutputTriangles(0), NumGroups(0), NumTiles(0), BuildTimeMs(0.0)
+	{
+	}
+};
+
+/**
+ * @brief 多边形并集预处理，在BVH构建之前消除同组多边形之间的重叠
+ *
+ * 对同一分组（例如同一图层掩码）的三角形按X方向扫描线求并集：以顶点和边交点为事件把平面切分为竖直条带，
+ * 条带内边互不相交，按Y排序后用非零环绕规则得到被覆盖的区间，输出互不重叠的梯形（每个梯形两个三角形）。
+ * 相邻条带中由同一对边界边围成的梯形会被合并，输出规模与边界复杂度相关，与重叠层数无关。
+ *
+ * 计算使用双精度。空间沿X方向划分为互不相关的分块，分块与分组并行处理。
+ * 输出三角形的多边形索引为所在分组中最小的多边形索引。
+ */
+class UTILITYRENDERER_API FPolygonUnionBuilder
+{
+public:
+	/// \brief 计算每个分组的并集
+	/// \param InPolygonGroupKeys 按多边形索引排列的分组键，越界的多边形使用InDefaultGroupKey
+	/// \param InNumTiles 空间分块数量，0表示按三角形数量自动选择
+	/// \return 输出至少一个三角形时返回true
+	static bool BuildUnion(
+		const FPolygonMeshData& InMeshData,
+		TConstArrayView<uint32> InPolygonGroupKeys,
+		uint32 InDefaultGroupKey,
+		FPolygonMeshData& OutMeshData,
+		int32 InNumTiles = 0,
+		FPolygonUnionStats* OutStats = nullptr);
+
+	/// \brief 把多边形环（可带洞）直接转换为互不重叠的三角形，使用与求并集相同的扫描
+	///
+	/// 同一多边形索引的所有环一起按非零环绕规则扫描，外环应为逆时针、内环为顺时针（如GeoJSON导入器的输出）。
+	/// 统计信息中的输入三角形数量为0
+	/// \param InRingOffsets 每个环首顶点的偏移，末尾额外一项为顶点总数，环可以首尾重复也可以不闭合
+	/// \param InRingPolygonIds 每个环所属的多边形索引，即输出三角形的多边形索引
+	/// \param InZ 输出顶点的Z坐标
+	/// \return 输出至少一个三角形时返回true
+	static bool TriangulateRings(
+		TConstArrayView<FVector2f> InVertices,
+		TConstArrayView<int32> InRingOffsets,
+		TConstArrayView<int32> InRingPolygonIds,
+		float InZ,
+		FPolygonMeshData& OutMeshData,
+		FPolygonUnionStats* OutStats = nullptr);
+};
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "GlobalShader.h"
+#include "RenderGraphResources.h"
+#include "ShaderParameterMacros.h"
+#include "ShaderParameterStruct.h"
+
+
+class FRDGBuilder;
+
+/// \brief 降分辨率模式着色器参数，对应SurfaceReducedResolution.ush
+BEGIN_SHADER_PARAMETER_STRUCT(FSurfaceReducedResolutionParameters, UTILITYRENDERER_API)
+	SHADER_PARAMETER_RDG_TEXTURE(Texture2D<uint2>, ReducedCoverageTexture)	// 低分辨率分类结果
+	SHADER_PARAMETER(FIntRect, ReducedRect)									// 低分辨率纹理中已写入的范围
+	SHADER_PARAMETER(uint32, ReductionFactor)								// 降采样倍数
+END_SHADER_PARAMETER_STRUCT()
+
+/**
+ * @brief 降分辨率覆盖评估
+ *
+ * 先以1/N分辨率在每个N×N像素块的中心采样，把采样点分为三类：附近没有图元（空白）、
+ * 深入某个多边形的线/面内部（内部）以及其他（边缘）。全分辨率Pass读取像素周围2×2个采样点，
+ * 分类一致、都不是边缘且设备深度相近时直接着色，否则逐像素遍历BVH，因此只有边缘和深度不连续处按全分辨率查询。
+ *
+ * 采样点周围保守半径（相邻采样点世界间距的1.5倍，覆盖该采样点参与分类的所有像素）内的判断：
+ * 线按采样点到线段的距离判断空白和内部；多边形检查半径内是否有可见多边形的边界边，
+ * 没有边界边时半径内的像素与采样点位于同一多边形内（或都在外部），小于采样间距的多边形和洞都会按边缘处理。
+ *
+ * 只实现固定比例的降分辨率，不实现棋盘格采样：棋盘格的缺失像素同样需要按相邻像素的分类和深度重建，
+ * 边缘处仍要逐像素查询，节省的查询次数与2倍降采样相当，却需要额外的时间重建才能避免闪烁。
+ */
+class UTILITYRENDERER_API FSurfaceReducedResolution
+{
+public:
+	static constexpr EPixelFormat CoverageTextureFormat = PF_R32G32_UINT;
+
+	/// \brief 降采样倍数（r.SurfaceDrawer.ReducedResolution），1表示不降分辨率
+	static int32 GetReductionFactor();
+
+	/// \brief 全分辨率矩形对应的低分辨率矩形：覆盖中心采样点位于矩形内的所有像素块，并向外多取一块供2×2采样
+	static FIntRect GetReducedRect(const FIntRect& InScissorRect, const FIntRect& InViewportRect, int32 InReductionFactor);
+
+	/// \brief 添加低分辨率分类Pass所需的纹理并填写全分辨率Pass的参数
+	/// \param InExtent 全分辨率场景纹理尺寸
+	/// \return 低分辨率分类纹理，作为分类Pass的渲染目标
+	static FRDGTextureRef CreateCoverageTexture(FRDGBuilder& GraphBuilder, FIntPoint InExtent, const FIntRect& InReducedRect, int32 InReductionFactor, FSurfaceReducedResolutionParameters& OutParameters);
+};
+
+/**
+ * @brief 降分辨率分类像素着色器：每个N×N像素块的中心采样一次，输出空白/内部/边缘分类
+ *
+ * 与全分辨率像素着色器共用参数结构和着色器文件，入口函数为MainReducedPixelShader。
+ * \tparam RenderShaderType 全分辨率像素着色器
+ */
+template <typename RenderShaderType>
+class TSurfaceReducedPS : public FGlobalShader
+{
+public:
+	DECLARE_GLOBAL_SHADER(TSurfaceReducedPS);
+
+	using FParameters = typename RenderShaderType::FParameters;
+	SHADER_USE_PARAMETER_STRUCT(TSurfaceReducedPS, FGlobalShader);
+
+public:
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return true;
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("REDUCED_RESOLUTION"), 1);
+	}
+};
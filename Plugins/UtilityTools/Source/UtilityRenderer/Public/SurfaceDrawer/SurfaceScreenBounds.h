@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * @brief 视图在地面（XY平面）上的覆盖范围
+ *
+ * 视锥的4条角射线从近平面截断到r.SurfaceDrawer.MaxViewDistance，8个角点投影到XY平面取凸包。
+ * 截断距离内的地表不论高度，被看到时其XY一定位于凸包内，因此地表数据只需比较XY，与地表高度无关。
+ */
+struct UTILITYRENDERER_API FSurfaceViewFootprint
+{
+	TArray<FVector2D, TInlineAllocator<8>> Hull;	///< XY凸包顶点（逆时针）
+	FBox2D Bounds;									///< 凸包的包围盒
+	double MinZ;									///< 截断后视锥的最低点
+	double MaxZ;									///< 截断后视锥的最高点
+
+	FSurfaceViewFootprint()
+		: Bounds(ForceInit)
+		, MinZ(0.0)
+		, MaxZ(0.0)
+	{
+	}
+
+	/// \brief 由视图投影矩阵（反向Z）构造覆盖范围
+	/// \param InViewportSize 视口尺寸（像素）
+	/// \param InPixelPadding 视锥侧面向外扩展的像素数，用于像素单位线宽
+	static FSurfaceViewFootprint FromViewProjection(const FMatrix& InViewProjMatrix, const FIntPoint& InViewportSize, float InPixelPadding);
+
+	/// \brief XY矩形是否与覆盖范围相交（分离轴测试）
+	bool IntersectsBox(const FBox2D& InBox) const;
+};
+
+/**
+ * @brief 代理屏幕范围计算
+ *
+ * 地表数据只有XY范围有意义（着色器由场景深度反投影得到世界坐标后只比较XY），
+ * 因此把BVH根节点的XY范围沿Z延伸到整个截断视锥的高度范围得到包围盒，投影到视口得到保守的像素矩形，
+ * 渲染管理器以该矩形作为全屏Pass的视口，矩形外的像素不执行BVH查询；XY范围在视图覆盖范围之外时跳过整个Pass。
+ */
+class UTILITYRENDERER_API FSurfaceScreenBounds
+{
+public:
+	/// \brief 投影世界空间包围盒，得到覆盖其全部投影像素的矩形
+	///
+	/// 包围盒的6个面先在裁剪空间中用近平面和（按InPixelPadding外扩的）四个侧面裁剪，
+	/// 只统计视锥内的部分，避免相机后方的顶点投影后翻转，也避免很高的包围盒把矩形扩大到整个视口。
+	/// \param InViewProjMatrix 视图投影矩阵
+	/// \param InViewportRect 视口矩形
+	/// \param InWorldBox 世界空间包围盒
+	/// \param InPixelPadding 矩形向四周额外扩大的像素数
+	/// \param OutScreenRect 裁剪到视口内的矩形
+	/// \return 包围盒完全在视口外时返回false
+	static bool ProjectBox(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, const FBox& InWorldBox, float InPixelPadding, FIntRect& OutScreenRect);
+
+	/// \brief 由BVH根节点范围构造与地表高度无关的包围盒：XY按世界单位扩大后限制在覆盖范围的包围盒内，Z取截断视锥的高度范围
+	static FBox MakeSurfaceBox(const FVector3f& InMinExtent, const FVector3f& InMaxExtent, float InWorldPadding, const FSurfaceViewFootprint& InFootprint);
+
+	/// \brief 计算代理的全屏Pass视口
+	///
+	/// r.SurfaceDrawer.Scissor为0时不裁剪，返回整个视口。
+	/// \param InMinExtent BVH根节点最小值
+	/// \param InMaxExtent BVH根节点最大值
+	/// \param InWorldPadding 世界单位的外扩量（世界单位线宽的一半）
+	/// \param InPixelPadding 像素单位的外扩量（像素单位线宽的一半）
+	/// \return 代理完全在视口外时返回false
+	static bool CalculateScissorRect(const FMatrix& InViewProjMatrix, const FIntRect& InViewportRect, const FVector3f& InMinExtent, const FVector3f& InMaxExtent,
+		float InWorldPadding, float InPixelPadding, FIntRect& OutScissorRect);
+};
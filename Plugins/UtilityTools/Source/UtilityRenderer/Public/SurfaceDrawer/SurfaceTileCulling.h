@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SurfaceLineBuilder.h"
+#include "SurfacePolygonBuilder.h"
+
+
+/// \brief 分块剔除使用的视图参数，与着色器常量一致
+struct FSurfaceTileView
+{
+	FMatrix44f ScreenToWorld;	///< 屏幕坐标到世界坐标变换矩阵
+	FMatrix44f InvViewMatrix;	///< 视图逆矩阵
+	FIntRect ViewportRect;		///< 视口矩形
+	float TanHalfFOV;			///< 垂直半视场角的正切，由投影矩阵得到
+
+	FSurfaceTileView()
+		: ScreenToWorld(FMatrix44f::Identity)
+		, InvViewMatrix(FMatrix44f::Identity)
+		, ViewportRect(0, 0, 0, 0)
+		, TanHalfFOV(1.0f)
+	{
+	}
+};
+
+/// \brief 全部分块的候选叶子节点
+struct UTILITYRENDERER_API FSurfaceTileCandidates
+{
+	int32 NumTilesX = 0;		///< 横向分块数量
+	int32 NumTilesY = 0;		///< 纵向分块数量
+	TArray<int32> TileOffsets;	///< 每个分块的候选在Candidates中的偏移，末尾额外一项为候选总数
+	TArray<int32> Candidates;	///< 候选叶子节点索引，顺序与逐像素BVH遍历的顺序一致
+	TArray<bool> TileOverflow;	///< 候选超过容量或遍历超过循环上限的分块，着色器对其逐像素遍历BVH
+	int32 NumEmptyTiles = 0;	///< 没有候选（包括没有有效深度）的分块数量
+
+	/// \brief 获取分块的候选叶子节点
+	TConstArrayView<int32> GetTileCandidates(int32 InTileX, int32 InTileY) const
+	{
+		const int32 TileIndex = InTileY * NumTilesX + InTileX;
+		return TConstArrayView<int32>(Candidates.GetData() + TileOffsets[TileIndex], TileOffsets[TileIndex + 1] - TileOffsets[TileIndex]);
+	}
+
+	/// \brief 分块数量、空分块比例、溢出分块数量和非空分块的平均候选数量，用于测试日志
+	FString DescribeStats() const;
+};
+
+/// \brief 分块候选与逐像素遍历的对照结果
+struct FSurfaceTileCullingCheck
+{
+	int32 NumMismatches = 0;		///< 逐像素访问的叶子节点未按顺序出现在分块候选中的像素数量（应为0）
+	int64 NumPixelLeafNodes = 0;	///< 所有像素逐像素遍历访问的叶子节点总数
+	int32 NumPixels = 0;			///< 视口像素总数
+
+	/// \brief 每个像素平均访问的叶子节点数量
+	double GetAveragePixelLeafNodes() const
+	{
+		return NumPixels > 0 ? static_cast<double>(NumPixelLeafNodes) / NumPixels : 0.0;
+	}
+};
+
+/**
+ * @brief 分块计算着色器剔除步骤的CPU实现
+ *
+ * 与SurfaceLine/SurfacePolygon着色器的MainTiledComputeShader逐步对应：
+ * 由分块内的深度范围求出世界空间XY覆盖范围，再用该范围剔除一次BVH得到候选叶子节点。
+ * 用于在没有GPU的环境下测试剔除的保守性和效果。
+ */
+class UTILITYRENDERER_API FSurfaceTileCulling
+{
+public:
+	static constexpr int32 TileSize = 16;				///< 分块边长（像素），与着色器的线程组大小一致
+	static constexpr int32 MaxTileCandidates = 256;		///< 每个分块最多保存的候选叶子节点数量
+	static constexpr int32 MaxTileLoops = 1024;			///< 分块遍历BVH的最大循环次数
+
+	/// \brief 屏幕范围的最小值向下对齐到视口的分块网格，使裁剪后的分块划分与整个视口相同
+	static FIntRect AlignScissorRect(const FIntRect& InViewportRect, const FIntRect& InScissorRect);
+
+	/// \brief 由视图矩阵和投影矩阵构造视图参数，与渲染管理器设置着色器参数的方式一致
+	static FSurfaceTileView MakeView(const FMatrix& InViewMatrix, const FMatrix& InProjMatrix, const FIntRect& InViewportRect);
+
+	/// \brief 构造从-X方向斜向俯视目标点的方形视口视图（90度视场角），用于无GPU环境的测试
+	/// \param InDistance 相机到目标点的距离
+	/// \param InPitch 俯仰角（度，负值向下）
+	static FSurfaceTileView MakeObliqueView(const FVector& InTarget, double InDistance, float InPitch, int32 InViewportSize);
+
+	/// \brief 生成水平面（Z = InPlaneZ）的逐像素设备深度，看不到平面的像素深度为0，用于无GPU环境的测试
+	static void BuildPlaneDepth(const FSurfaceTileView& InView, float InPlaneZ, TArray<float>& OutDeviceDepth);
+
+	/// \brief 屏幕坐标（像素中心为 x + 0.5）和设备深度转换为世界坐标
+	static FVector3f ScreenToWorldPosition(const FSurfaceTileView& InView, const FVector2f& InScreenPosition, float InDeviceDepth);
+
+	/// \brief 像素在世界空间中的大小，与着色器的CalculatePixelWorldSize一致
+	static float CalculatePixelWorldSize(const FSurfaceTileView& InView, const FVector3f& InWorldPosition, const FVector2f& InScreenPosition);
+
+	/// \brief 分块的世界空间XY覆盖范围：分块四角分别在最小和最大深度处反投影，取8个点的包围盒
+	/// \param InTileRect 分块的像素范围（相对视口左上角，Max不包含）
+	static FBox2f ComputeTileFootprint(const FSurfaceTileView& InView, const FIntRect& InTileRect, float InMinDepth, float InMaxDepth);
+
+	/// \brief 剔除线BVH，按逐像素遍历的顺序收集包围盒与覆盖范围（按半线宽扩大）相交的叶子节点
+	/// \return 候选数量超过MaxTileCandidates或循环超过MaxTileLoops时返回false
+	static bool CullLineBVH(TConstArrayView<FGPULineBVHNode> InNodes, const FBox2f& InFootprint, float InHalfWidth, TArray<int32>& OutLeafNodes);
+
+	/// \brief 剔除多边形BVH，跳过子树内没有可见图层的节点
+	/// \return 候选数量超过MaxTileCandidates或循环超过MaxTileLoops时返回false
+	static bool CullPolygonBVH(TConstArrayView<FGPUPolygonBVHNode> InNodes, TConstArrayView<uint32> InNodeLayerMasks, uint32 InVisibleLayers, const FBox2f& InFootprint, TArray<int32>& OutLeafNodes);
+
+	/// \brief 对整个视口分块剔除线BVH
+	/// \param InDeviceDepth 视口内逐像素的设备深度（反向Z，0表示无穷远），行优先，宽高与视口一致
+	/// \param InMaxLineWidth 最大线宽，像素单位时乘以分块内最大的像素世界大小
+	static void CullLineTiles(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, const FGPULineData& InData, float InMaxLineWidth, bool bInUsePixelUnit, FSurfaceTileCandidates& OutCandidates);
+
+	/// \brief 对整个视口分块剔除多边形BVH
+	static void CullPolygonTiles(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, const FGPUPolygonData& InData, const FPolygonLayerMasks& InLayerMasks, uint32 InVisibleLayers, FSurfaceTileCandidates& OutCandidates);
+
+	/// \brief 逐像素遍历函数：输入像素的世界坐标和屏幕坐标，按遍历顺序输出访问的叶子节点，遍历失败时返回false
+	using FCullPixelFunction = TFunctionRef<bool(const FVector3f&, const FVector2f&, TArray<int32>&)>;
+
+	/// \brief 以逐像素遍历为参照校验分块候选：每个像素访问的叶子节点序列必须是其分块候选的子序列，
+	/// 没有有效深度的像素和溢出分块不参与校验
+	static FSurfaceTileCullingCheck CheckTileCandidates(const FSurfaceTileView& InView, TConstArrayView<float> InDeviceDepth, const FSurfaceTileCandidates& InCandidates, FCullPixelFunction InCullPixel);
+};
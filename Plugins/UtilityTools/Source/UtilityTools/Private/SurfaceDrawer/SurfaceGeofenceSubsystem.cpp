@@ -0,0 +1,195 @@
+﻿#include "SurfaceDrawer/SurfaceGeofenceSubsystem.h"
+
+#include "SurfaceDrawer/SurfacePolygonComponent.h"
+#include "SurfaceDrawer/SurfacePolygonBuilder.h"
+#include "SurfaceDrawer/SurfacePolygonQuery.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfaceGeofence, Log, All);
+
+namespace SurfaceGeofence
+{
+	/// \brief 每个并行任务处理的Actor数量
+	static constexpr int32 ActorsPerBatch = 64;
+}
+
+USurfaceGeofenceSubsystem* USurfaceGeofenceSubsystem::Get(const UObject* WorldContextObject)
+{
+	if (GEngine)
+	{
+		UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+		return World ? World->GetSubsystem<USurfaceGeofenceSubsystem>() : nullptr;
+	}
+
+	return nullptr;
+}
+
+bool USurfaceGeofenceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	// 仅在Game和PIE中跟踪
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId USurfaceGeofenceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USurfaceGeofenceSubsystem, STATGROUP_Tickables);
+}
+
+void USurfaceGeofenceSubsystem::RegisterActor(AActor* InActor, USurfacePolygonComponent* InFence)
+{
+	if (!InActor || !InFence)
+	{
+		return;
+	}
+
+	for (FTrackedActor& Tracked : TrackedActors)
+	{
+		if (Tracked.Actor.Get() == InActor)
+		{
+			// 更换围栏时强制重新查询
+			Tracked.Fence = InFence;
+			Tracked.QueriedData.Reset();
+			return;
+		}
+	}
+
+	FTrackedActor& NewTracked = TrackedActors.AddDefaulted_GetRef();
+	NewTracked.Actor = InActor;
+	NewTracked.Fence = InFence;
+	NewTracked.QueriedLocation = FVector2f::ZeroVector;
+	NewTracked.SafeRadius = 0.0f;
+	NewTracked.CurrentPolygon = INDEX_NONE;
+	NewTracked.Location = FVector2f::ZeroVector;
+	NewTracked.NewPolygon = INDEX_NONE;
+}
+
+void USurfaceGeofenceSubsystem::UnregisterActor(AActor* InActor)
+{
+	TrackedActors.RemoveAllSwap([InActor](const FTrackedActor& Tracked) { return Tracked.Actor.Get() == InActor; });
+}
+
+int32 USurfaceGeofenceSubsystem::GetCurrentPolygon(AActor* InActor) const
+{
+	for (const FTrackedActor& Tracked : TrackedActors)
+	{
+		if (Tracked.Actor.Get() == InActor)
+		{
+			return Tracked.CurrentPolygon;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+float USurfaceGeofenceSubsystem::GetSafeRadius(AActor* InActor) const
+{
+	for (const FTrackedActor& Tracked : TrackedActors)
+	{
+		if (Tracked.Actor.Get() == InActor)
+		{
+			return Tracked.SafeRadius;
+		}
+	}
+
+	return 0.0f;
+}
+
+void USurfaceGeofenceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// 移除已销毁的Actor
+	TrackedActors.RemoveAllSwap([](const FTrackedActor& Tracked) { return !Tracked.Actor.IsValid() || !Tracked.Fence.IsValid(); });
+
+	// 游戏线程收集位置，只保留移出安全半径或数据已重建的Actor
+	TArray<int32> RequeryIndices;
+	for (int32 Index = 0; Index < TrackedActors.Num(); ++Index)
+	{
+		FTrackedActor& Tracked = TrackedActors[Index];
+
+		const FVector ActorLocation = Tracked.Actor->GetActorLocation();
+		Tracked.Location = FVector2f(ActorLocation.X, ActorLocation.Y);
+
+		// 上次查询的数据只弱引用，围栏重建后旧数据即可释放；没有数据时只需保证当前不在任何多边形内
+		const TSharedPtr<const FGPUPolygonData> FenceData = Tracked.Fence->GetGPUPolygonData();
+		const bool bDataChanged = Tracked.QueriedData.Pin() != FenceData || (!FenceData.IsValid() && Tracked.CurrentPolygon != INDEX_NONE);
+		const bool bLeftSafeRadius = FVector2f::DistSquared(Tracked.Location, Tracked.QueriedLocation) > FMath::Square(Tracked.SafeRadius);
+		if (bDataChanged || bLeftSafeRadius)
+		{
+			// 构建结果在游戏线程发布，只有重新查询的Actor持有共享指针，后台查询期间保持不变
+			Tracked.Data = FenceData;
+			RequeryIndices.Add(Index);
+		}
+	}
+
+	LastNumRequeried = RequeryIndices.Num();
+	if (RequeryIndices.IsEmpty())
+	{
+		return;
+	}
+
+	// 分批并行查询所在多边形和新的安全半径
+	const float LocalMaxSafeRadius = MaxSafeRadius;
+	const int32 NumBatches = FMath::DivideAndRoundUp(RequeryIndices.Num(), SurfaceGeofence::ActorsPerBatch);
+	ParallelFor(NumBatches,
+		[this, &RequeryIndices, LocalMaxSafeRadius](int32 BatchIndex)
+		{
+			const int32 Begin = BatchIndex * SurfaceGeofence::ActorsPerBatch;
+			const int32 End = FMath::Min(Begin + SurfaceGeofence::ActorsPerBatch, RequeryIndices.Num());
+			for (int32 Index = Begin; Index < End; ++Index)
+			{
+				FTrackedActor& Tracked = TrackedActors[RequeryIndices[Index]];
+
+				Tracked.NewPolygon = INDEX_NONE;
+				Tracked.SafeRadius = 0.0f;
+				if (Tracked.Data.IsValid() && Tracked.Data->IsValid())
+				{
+					FPolygonBVHQuery::QueryPoint(*Tracked.Data, Tracked.Location, Tracked.NewPolygon);
+					Tracked.SafeRadius = FPolygonBVHQuery::QueryDistanceToEdges(*Tracked.Data, Tracked.Location, LocalMaxSafeRadius);
+				}
+
+				Tracked.QueriedLocation = Tracked.Location;
+				Tracked.QueriedData = Tracked.Data;
+			}
+		},
+		RequeryIndices.Num() <= SurfaceGeofence::ActorsPerBatch ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// 先更新状态再广播，回调中注册/注销Actor不会影响本次遍历
+	struct FPendingEvent
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<USurfacePolygonComponent> Fence;
+		int32 OldPolygon;
+		int32 NewPolygon;
+	};
+	TArray<FPendingEvent> PendingEvents;
+
+	for (int32 Index : RequeryIndices)
+	{
+		FTrackedActor& Tracked = TrackedActors[Index];
+		Tracked.Data.Reset();
+
+		if (Tracked.NewPolygon != Tracked.CurrentPolygon)
+		{
+			PendingEvents.Add({ Tracked.Actor, Tracked.Fence, Tracked.CurrentPolygon, Tracked.NewPolygon });
+			Tracked.CurrentPolygon = Tracked.NewPolygon;
+		}
+	}
+
+	// 游戏线程广播事件：先离开旧多边形，再进入新多边形
+	for (const FPendingEvent& Event : PendingEvents)
+	{
+		if (Event.OldPolygon != INDEX_NONE)
+		{
+			OnExitPolygon.Broadcast(Event.Actor.Get(), Event.Fence.Get(), Event.OldPolygon);
+		}
+		if (Event.NewPolygon != INDEX_NONE)
+		{
+			OnEnterPolygon.Broadcast(Event.Actor.Get(), Event.Fence.Get(), Event.NewPolygon);
+		}
+	}
+}
@@ -1,10 +1,20 @@
 ﻿#include "SurfaceDrawer/SurfaceLineComponent.h"
 
+#include "SurfaceDrawer/SurfaceContourBuilder.h"
+#include "SurfaceDrawer/SurfaceGeoJsonImporter.h"
 #include "SurfaceDrawer/SurfaceLineBuilder.h"
+#include "SurfaceDrawer/SurfacePolygonIdPicker.h"
+#include "SurfaceDrawer/SurfaceLineQuery.h"
 #include "SurfaceDrawer/SurfaceLineRenderer.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogSurfaceLineComponent, Log, All);
+
+namespace SurfaceLineComponent
+{
+	// 线段数据尚未构建完成时允许指定样式的最大多边形数量，避免误传的大索引分配大量内存
+	static constexpr int32 MaxPolygonsWithoutData = 1 << 24;
+}
 	
 USurfaceLineComponent::USurfaceLineComponent()
 {
@@ -19,6 +29,13 @@ USurfaceLineComponent::USurfaceLineComponent()
 	bUseCustomTexture = false;
 	bUsePixelUnit = false;
 	bBuffersInitialized = false;
+	bEnablePolygonPicking = false;
+	bPolygonEditInFlight = false;
+	NumPolygons = 0;
+
+	NumAtlasSlots = 1;
+	bPolygonStylesDirty = true;
+	bStyleBuffersInitialized = false;
 }
 
 void USurfaceLineComponent::SetPolygons(const TArray<FPolygon>& InPolygons)
@@ -26,6 +43,83 @@ void USurfaceLineComponent::SetPolygons(const TArray<FPolygon>& InPolygons)
 	AsyncBuildBVHData(InPolygons);
 }
 
+void USurfaceLineComponent::SetContourGrid(const TArray<float>& InHeights, int32 InSizeX, int32 InSizeY, const FVector2D& InOrigin, const FVector2D& InCellSize, const TArray<float>& InIsoLevels)
+{
+	if (InSizeX < 2 || InSizeY < 2 || InHeights.Num() != InSizeX * InSizeY || InIsoLevels.Num() == 0)
+	{
+		UE_LOG(LogSurfaceLineComponent, Warning, TEXT("等值线网格无效: %d x %d, 数值数量=%d, 等值数=%d，跳过构建"),
+			InSizeX, InSizeY, InHeights.Num(), InIsoLevels.Num());
+		return;
+	}
+
+	// 等值线直接以连续顶点交给构建器，不经过FPolygon
+	LaunchAsyncBuild(
+		[Heights = InHeights, InSizeX, InSizeY, InOrigin, InCellSize, IsoLevels = InIsoLevels](const FBVHBuildConfig& InBuildConfig) -> TSharedPtr<FLineBVHBuilder>
+		{
+			FContourPolylineSet Polylines;
+			const FContourGridDesc Grid(Heights, InSizeX, InSizeY, InOrigin, InCellSize);
+			if (!FSurfaceContourBuilder::Build(Grid, IsoLevels, Polylines))
+			{
+				// 没有等值线是有效结果，返回空构建器以清空旧线段
+				return MakeShared<FLineBVHBuilder>(InBuildConfig);
+			}
+
+			return MakeShared<FLineBVHBuilder>(Polylines.Vertices, Polylines.PolylineOffsets, InBuildConfig);
+		});
+}
+
+void USurfaceLineComponent::SetPolygonSoup(FSurfacePolygonSoup&& InPolygonSoup)
+{
+	SetPolygonSoup(MakeShared<FSurfacePolygonSoup>(MoveTemp(InPolygonSoup)));
+}
+
+void USurfaceLineComponent::SetPolygonSoup(const TSharedRef<const FSurfacePolygonSoup>& InPolygonSoup)
+{
+	if (InPolygonSoup->Num() == 0)
+	{
+		ClearPolygons();
+		return;
+	}
+
+	// 可选的多边形样式索引随几何数据一起更新
+	if (InPolygonSoup->PolygonStyleIndices.Num() > 0)
+	{
+		SetPolygonStyles(InPolygonSoup->PolygonStyleIndices);
+	}
+
+	// 只捕获共享引用，后台线程直接读取顶点数组
+	LaunchAsyncBuild(
+		[PolygonSoup = InPolygonSoup](const FBVHBuildConfig& InBuildConfig) -> TSharedPtr<FLineBVHBuilder>
+		{
+			return MakeShared<FLineBVHBuilder>(*PolygonSoup, InBuildConfig);
+		});
+}
+
+void USurfaceLineComponent::LoadGeoJson(const FString& InFilePath, const FVector2D& InOrigin, bool bInProjectedMeters, float InUnitsPerMeter)
+{
+	FGeoJsonImportOptions Options;
+	Options.Projection = FGeoJsonProjection(InOrigin, InUnitsPerMeter, bInProjectedMeters);
+	Options.bImportPolygonRings = false;
+
+	// 逐批追加到构建器，每批顶点在构建器复制线段后即释放，不在内存中汇总整个文件
+	LaunchAsyncBuild(
+		[FilePath = InFilePath, Options](const FBVHBuildConfig& InBuildConfig) -> TSharedPtr<FLineBVHBuilder>
+		{
+			TSharedRef<FLineBVHBuilder> NewBuilder = MakeShared<FLineBVHBuilder>(InBuildConfig);
+			const bool bImported = FSurfaceGeoJsonImporter::ImportFile(FilePath, Options,
+				[&NewBuilder](FGeoJsonFeatureBatch& InBatch)
+				{
+					NewBuilder->AppendPolylines(InBatch.Polylines.Vertices, InBatch.Polylines.PolygonOffsets);
+				});
+			if (!bImported)
+			{
+				return nullptr;
+			}
+
+			return NewBuilder;
+		});
+}
+
 void USurfaceLineComponent::SetProperties(float InLineWidth, float InLineOpacity, const FLinearColor& InLineColor)
 {
 	LineWidth = InLineWidth;
@@ -56,6 +150,41 @@ void USurfaceLineComponent::SetLineWidth(float InLineWidth)
 	MarkRenderStateDirty();
 }
 
+void USurfaceLineComponent::SetLineStyles(const TArray<FSurfaceLineStyle>& InLineStyles)
+{
+	LineStyles = InLineStyles;
+
+	MarkRenderStateDirty();
+}
+
+void USurfaceLineComponent::SetPolygonStyles(const TArray<int32>& InPolygonStyleIndices)
+{
+	PolygonStyleIndices = InPolygonStyleIndices;
+
+	MarkPolygonStylesDirty();
+	MarkRenderStateDirty();
+}
+
+void USurfaceLineComponent::SetPolygonStyle(int32 InPolygonIndex, int32 InStyleIndex)
+{
+	// 索引来自蓝图，按当前数据的多边形数量校验；构建完成前数据可能还会变化，只限制上限
+	const int32 MaxPolygons = (NumPolygons > 0 && !IsAsyncBuilding.load()) ? NumPolygons : SurfaceLineComponent::MaxPolygonsWithoutData;
+	if (InPolygonIndex < 0 || InPolygonIndex >= MaxPolygons)
+	{
+		UE_LOG(LogSurfaceLineComponent, Warning, TEXT("多边形索引 %d 超出范围[0, %d)，忽略样式设置"), InPolygonIndex, MaxPolygons);
+		return;
+	}
+
+	if (InPolygonIndex >= PolygonStyleIndices.Num())
+	{
+		PolygonStyleIndices.SetNumZeroed(InPolygonIndex + 1);
+	}
+	PolygonStyleIndices[InPolygonIndex] = InStyleIndex;
+
+	MarkPolygonStylesDirty();
+	MarkRenderStateDirty();
+}
+
 void USurfaceLineComponent::ClearPolygons()
 {
 	AsyncBuildBVHData(TArray<FPolygon>());
@@ -63,6 +192,174 @@ void USurfaceLineComponent::ClearPolygons()
 	MarkGeometryDataDirty();
 }
 
+bool USurfaceLineComponent::UpdatePolygon(int32 InPolygonIndex, const TArray<FVector>& InVertices)
+{
+	if (IsAsyncBuilding.load())
+	{
+		UE_LOG(LogSurfaceLineComponent, Warning, TEXT("正在进行AsyncBuildBVHData请求，跳过多边形 %d 的更新"), InPolygonIndex);
+		return false;
+	}
+
+	if (!GPULineData.IsValid() || InPolygonIndex < 0)
+	{
+		return false;
+	}
+
+	// 索引已生成时直接检查线段簇数量，否则在后台线程生成索引后检查
+	if (RefitIndices.IsValid() && !RefitIndices->CanRefitPolyline(InPolygonIndex, InVertices.Num()))
+	{
+		UE_LOG(LogSurfaceLineComponent, Warning, TEXT("多边形 %d 不存在或线段簇数量发生变化，无法局部更新"), InPolygonIndex);
+		return false;
+	}
+
+	TArray<FVector2f> Vertices;
+	Vertices.Reserve(InVertices.Num());
+	for (const FVector& Vertex : InVertices)
+	{
+		Vertices.Add(FVector2f(FVector2D(Vertex)));
+	}
+	PendingPolygonEdits.Emplace(InPolygonIndex, MoveTemp(Vertices));
+
+	// 正在应用的修改完成后再一起应用之后提交的修改
+	if (!bPolygonEditInFlight)
+	{
+		LaunchPolygonEdits();
+	}
+	return true;
+}
+
+void USurfaceLineComponent::LaunchPolygonEdits()
+{
+	check(IsInGameThread());
+
+	bPolygonEditInFlight = true;
+
+	TWeakObjectPtr<USurfaceLineComponent> WeakThis(this);
+
+	// 后台线程只读当前数据（修改在游戏线程应用，同时只有一批修改在进行），生成只含修改元素的补丁
+	AsyncTask(ENamedThreads::AnyThread,
+		[WeakThis, BaseGPULineData = GPULineData, BaseRefitIndices = RefitIndices, Edits = MoveTemp(PendingPolygonEdits)]()
+		{
+			TSharedPtr<const FLineRefitIndices> NewRefitIndices = BaseRefitIndices;
+			if (!NewRefitIndices.IsValid())
+			{
+				TSharedPtr<FLineRefitIndices> BuiltRefitIndices = MakeShared<FLineRefitIndices>();
+				if (BuiltRefitIndices->Build(*BaseGPULineData))
+				{
+					NewRefitIndices = BuiltRefitIndices;
+				}
+			}
+
+			TSharedPtr<FGPULineDataPatch> NewPatch = MakeShared<FGPULineDataPatch>();
+			for (const TPair<int32, TArray<FVector2f>>& Edit : Edits)
+			{
+				if (!NewRefitIndices.IsValid() || !FLineDataConverter::RefitPolyline(*BaseGPULineData, *NewRefitIndices, Edit.Key, Edit.Value, *NewPatch))
+				{
+					UE_LOG(LogSurfaceLineComponent, Warning, TEXT("多边形 %d 不存在或线段簇数量发生变化，无法局部更新"), Edit.Key);
+				}
+			}
+
+			AsyncTask(ENamedThreads::GameThread,
+				[WeakThis, BaseGPULineData, NewRefitIndices, NewPatch]()
+				{
+					if (!WeakThis.IsValid())
+					{
+						return;
+					}
+
+					USurfaceLineComponent* This = WeakThis.Get();
+					This->bPolygonEditInFlight = false;
+
+					// 期间数据已被重新构建替换，修改作废
+					if (This->GPULineData != BaseGPULineData)
+					{
+						This->PendingPolygonEdits.Reset();
+						return;
+					}
+
+					This->RefitIndices = NewRefitIndices;
+					if (!NewPatch->IsEmpty())
+					{
+						// 游戏线程只写入修改的元素，尚未移交的渲染线程副本一起修补，已移交的副本由渲染线程修补
+						ensure(NewPatch->Apply(*This->GPULineData));
+						if (This->RenderGPULineData.IsValid())
+						{
+							ensure(NewPatch->Apply(*This->RenderGPULineData));
+						}
+
+						if (This->GeometryPatch.IsValid())
+						{
+							ensure(This->GeometryPatch->Append(*NewPatch));
+						}
+						else
+						{
+							This->GeometryPatch = NewPatch;
+						}
+						This->MarkRenderStateDirty();
+					}
+
+					if (This->PendingPolygonEdits.Num() > 0)
+					{
+						This->LaunchPolygonEdits();
+					}
+				});
+		});
+}
+
+bool USurfaceLineComponent::QueryNearestSegment(const FVector& InLocation, float InMaxDistance, FSurfaceLineHit& OutHit) const
+{
+	// 持有一份引用，避免查询期间被异步构建替换
+	TSharedPtr<FGPULineData> LocalGPULineData = GPULineData;
+	if (!LocalGPULineData.IsValid())
+	{
+		OutHit = FSurfaceLineHit();
+		return false;
+	}
+
+	return FLineBVHQuery::QueryNearestSegment(*LocalGPULineData, FVector2f(InLocation.X, InLocation.Y), InMaxDistance, OutHit);
+}
+
+int32 USurfaceLineComponent::QuerySegmentsInRadius(const FVector& InLocation, float InRadius, TArray<FSurfaceLineHit>& OutHits) const
+{
+	TSharedPtr<FGPULineData> LocalGPULineData = GPULineData;
+	if (!LocalGPULineData.IsValid())
+	{
+		OutHits.Reset();
+		return 0;
+	}
+
+	return FLineBVHQuery::QuerySegmentsInRadius(*LocalGPULineData, FVector2f(InLocation.X, InLocation.Y), InRadius, OutHits);
+}
+
+bool USurfaceLineComponent::RaycastSegment(const FVector& InOrigin, const FVector& InDirection, float InMaxDistance, FSurfaceLineHit& OutHit) const
+{
+	TSharedPtr<FGPULineData> LocalGPULineData = GPULineData;
+	if (!LocalGPULineData.IsValid())
+	{
+		OutHit = FSurfaceLineHit();
+		return false;
+	}
+
+	return FLineBVHQuery::RaycastSegment(*LocalGPULineData, FVector2f(InOrigin.X, InOrigin.Y), FVector2f(InDirection.X, InDirection.Y), InMaxDistance, OutHit);
+}
+
+void USurfaceLineComponent::SetPolygonPickingEnabled(bool bEnabled)
+{
+	if (bEnablePolygonPicking == bEnabled)
+	{
+		return;
+	}
+
+	bEnablePolygonPicking = bEnabled;
+
+	MarkRenderStateDirty();
+}
+
+int32 USurfaceLineComponent::GetPolygonUnderCursor()
+{
+	return PolygonIdPicker.IsValid() ? PolygonIdPicker->PickPolygonUnderCursor(GetWorld()) : INDEX_NONE;
+}
+
 void USurfaceLineComponent::OnRegister()
 {
 	Super::OnRegister();
@@ -113,6 +410,10 @@ void USurfaceLineComponent::AsyncBuildBVHData(const TArray<FPolygon>& InPolygons
 	{
 		UE_LOG(LogSurfaceLineComponent, Warning, TEXT("Polygons为空，跳过构建"));
 		GPULineData.Reset();
+		RenderGPULineData.Reset();
+		RefitIndices.Reset();
+		PendingPolygonEdits.Reset();
+		NumPolygons = 0;
 
 		MarkGeometryDataDirty();
 		return;
@@ -124,15 +425,34 @@ void USurfaceLineComponent::AsyncBuildBVHData(const TArray<FPolygon>& InPolygons
 		return;
 	}
 	
+	LaunchAsyncBuild(
+		[InPolygons](const FBVHBuildConfig& InBuildConfig) -> TSharedPtr<FLineBVHBuilder>
+		{
+			return MakeShared<FLineBVHBuilder>(InPolygons, InBuildConfig);
+		});
+}
+
+void USurfaceLineComponent::LaunchAsyncBuild(TUniqueFunction<TSharedPtr<FLineBVHBuilder>(const FBVHBuildConfig&)>&& InMakeBuilder)
+{
+	if (IsAsyncBuilding.load())
+	{
+		UE_LOG(LogSurfaceLineComponent, Warning, TEXT("正在进行上一次的AsyncBuildBVHData请求，跳过构建"));
+		return;
+	}
+	
 	IsAsyncBuilding.store(true);
 	
 	TWeakObjectPtr<USurfaceLineComponent> WeakThis(this);
 	
 	AsyncTask(ENamedThreads::AnyThread,
-		[WeakThis, InPolygons]()
+		[WeakThis, MakeBuilder = MoveTemp(InMakeBuilder), BuildConfig = BVHBuildConfig]()
 		{
-			TSharedPtr<FLineBVHBuilder> NewLineBVHBuilder = MakeShared<FLineBVHBuilder>(InPolygons, WeakThis->BVHBuildConfig);
-			NewLineBVHBuilder->Build();
+			TSharedPtr<FLineBVHBuilder> NewLineBVHBuilder = MakeBuilder(BuildConfig);
+			const bool bHasBuilder = NewLineBVHBuilder.IsValid();
+			if (bHasBuilder)
+			{
+				NewLineBVHBuilder->Build();
+			}
 	
 			if (!WeakThis.IsValid())
 			{
@@ -140,16 +460,60 @@ void USurfaceLineComponent::AsyncBuildBVHData(const TArray<FPolygon>& InPolygons
 				return;
 			}
 	
-			NewLineBVHBuilder->GetStats(WeakThis->BVHStats);
-
 			// 转换为GPU数据
-			TSharedPtr<FGPULineData> NewGPULineData = MakeShared<FGPULineData>();
-			FLineDataConverter::ConvertToGPUData(*NewLineBVHBuilder, *NewGPULineData);
-			WeakThis->GPULineData = NewGPULineData;
-			WeakThis->MarkRenderStateDirty();
-			WeakThis->MarkGeometryDataDirty();
+			TSharedPtr<FGPULineData> NewGPULineData;
+			TSharedPtr<FGPULineData> NewRenderGPULineData;
+			TOptional<FBVHStats> NewBVHStats;
+			int32 NewNumPolygons = 0;
+			if (NewLineBVHBuilder.IsValid() && NewLineBVHBuilder->IsBuilt())
+			{
+				NewLineBVHBuilder->GetStats(NewBVHStats.Emplace());
 
-			WeakThis->IsAsyncBuilding.store(false);
+				NewGPULineData = MakeShared<FGPULineData>();
+				FLineDataConverter::ConvertToGPUData(*NewLineBVHBuilder, *NewGPULineData);
+
+				// 多边形数量（最大多边形索引加一），游戏线程据此校验SetPolygonStyle的索引
+				for (const FGPUSegmentCluster& Cluster : NewGPULineData->Clusters)
+				{
+					NewNumPolygons = FMath::Max(NewNumPolygons, Cluster.PolygonIndex + 1);
+				}
+
+				// 游戏线程和渲染线程各自修补自己的数据，渲染线程的副本在这里复制，不占用游戏线程
+				NewRenderGPULineData = MakeShared<FGPULineData>(*NewGPULineData);
+			}
+
+			// 查询和场景代理更新都在游戏线程读取，构建结果回到游戏线程再替换
+			AsyncTask(ENamedThreads::GameThread,
+				[WeakThis, bHasBuilder, NewGPULineData, NewRenderGPULineData, NewBVHStats, NewNumPolygons]()
+				{
+					if (!WeakThis.IsValid())
+					{
+						UE_LOG(LogSurfaceLineComponent, Warning, TEXT("组件已销毁，取消AsyncBuildBVHData"));
+						return;
+					}
+
+					// 数据源读取失败时保留现有线段
+					if (!bHasBuilder)
+					{
+						UE_LOG(LogSurfaceLineComponent, Warning, TEXT("线段数据读取失败，保留现有线段"));
+						WeakThis->IsAsyncBuilding.store(false);
+						return;
+					}
+
+					if (NewBVHStats.IsSet())
+					{
+						WeakThis->BVHStats = NewBVHStats.GetValue();
+					}
+					WeakThis->GPULineData = NewGPULineData;
+					WeakThis->RenderGPULineData = NewRenderGPULineData;
+					WeakThis->NumPolygons = NewNumPolygons;
+					WeakThis->RefitIndices.Reset();
+					WeakThis->PendingPolygonEdits.Reset();
+					WeakThis->MarkRenderStateDirty();
+					WeakThis->MarkGeometryDataDirty();
+
+					WeakThis->IsAsyncBuilding.store(false);
+				});
 		}
 	);
 }
@@ -158,46 +522,85 @@ void USurfaceLineComponent::CreateSceneProxy()
 {
 	check(IsInGameThread());
 
+	// 代理持有自己的数据副本，下次更新时完整传入
 	SceneProxy = MakeShared<FSurfaceLineSceneProxy>(
-		GPULineData,
+		nullptr,
 		CustomTexture,
-		LineWidth,
-		LineOpacity,
-		LineColor,
 		bUseCustomTexture,
 		bUsePixelUnit);
+	bBuffersInitialized = false;
 }
 	
 void USurfaceLineComponent::UpdateSceneProxy()
 {
 	if (SceneProxy.IsValid())
 	{
+		// 拾取器随开关创建/释放，关闭时渲染线程不再输出ID纹理
+		if (bEnablePolygonPicking && !PolygonIdPicker.IsValid())
+		{
+			PolygonIdPicker = MakeShared<FSurfacePolygonIdPicker>();
+		}
+		else if (!bEnablePolygonPicking)
+		{
+			PolygonIdPicker.Reset();
+		}
+
+		// 样式或多边形样式索引变化时重新生成样式表，只重新上传样式缓冲区
+		TArray<FGPULineStyle> CurrentStyles;
+		GatherLineStyles(CurrentStyles);
+		if (bPolygonStylesDirty || !StyleTable.IsValid() || StyleTable->Styles != CurrentStyles)
+		{
+			TSharedPtr<FLineStyleTable> NewStyleTable = MakeShared<FLineStyleTable>();
+			NewStyleTable->Build(CurrentStyles, PolygonStyleIndices);
+			StyleTable = NewStyleTable;
+			bPolygonStylesDirty = false;
+			bStyleBuffersInitialized = false;
+		}
+
+		// 需要完整上传时移交渲染线程的副本（没有时在这里复制），之后两边各自修补
+		TSharedPtr<FGPULineData> RenderLineData;
+		if (!bBuffersInitialized)
+		{
+			RenderLineData = MoveTemp(RenderGPULineData);
+			if (!RenderLineData.IsValid() && GPULineData.IsValid())
+			{
+				RenderLineData = MakeShared<FGPULineData>(*GPULineData);
+			}
+		}
+
 		// 渲染线程更新参数
 		ENQUEUE_RENDER_COMMAND(UpdateSceneProxyCommand)(
 			[SceneProxyCopy = SceneProxy,
-			GPULineDataCopy = GPULineData,
+			GPULineDataCopy = MoveTemp(RenderLineData),
 			CustomTextureCopy = CustomTexture,
-			LineWidthCopy = LineWidth,
-			LineOpacityCopy = LineOpacity,
-			LineColorCopy = LineColor,
 			bUseCustomTextureCopy = bUseCustomTexture,
 			bUsePixelUnitCopy = bUsePixelUnit,
-			bBuffersInitializedCopy = bBuffersInitialized](FRHICommandList& RHICmdList)
+			bBuffersInitializedCopy = bBuffersInitialized,
+			GeometryPatchCopy = TSharedPtr<const FGPULineDataPatch>(MoveTemp(GeometryPatch)),
+			StyleTableCopy = StyleTable,
+			NumAtlasSlotsCopy = NumAtlasSlots,
+			bStyleBuffersInitializedCopy = bStyleBuffersInitialized,
+			PolygonIdPickerCopy = PolygonIdPicker](FRHICommandList& RHICmdList)
 			{
 				if (SceneProxyCopy.IsValid())
 				{
 					SceneProxyCopy->UpdateParameters_RenderThread(
 						GPULineDataCopy,
 						CustomTextureCopy,
-						LineWidthCopy,
-						LineOpacityCopy,
-						LineColorCopy,
 						bUseCustomTextureCopy,
 						bUsePixelUnitCopy,
-						bBuffersInitializedCopy);
+						bBuffersInitializedCopy,
+						GeometryPatchCopy);
+					SceneProxyCopy->UpdateStyleParameters_RenderThread(
+						StyleTableCopy,
+						NumAtlasSlotsCopy,
+						bStyleBuffersInitializedCopy);
+					SceneProxyCopy->UpdatePickingParameters_RenderThread(PolygonIdPickerCopy);
 				}
 			});
 		bBuffersInitialized = true;
+		bStyleBuffersInitialized = true;
+		GeometryPatch.Reset();
 	}
 }
 	
@@ -213,3 +616,30 @@ void USurfaceLineComponent::MarkGeometryDataDirty()
 {
 	bBuffersInitialized = false;
 }
+
+void USurfaceLineComponent::MarkPolygonStylesDirty()
+{
+	bPolygonStylesDirty = true;
+}
+
+void USurfaceLineComponent::GatherLineStyles(TArray<FGPULineStyle>& OutStyles) const
+{
+	OutStyles.Reset();
+
+	if (LineStyles.Num() == 0)
+	{
+		FSurfaceLineStyle DefaultStyle;
+		DefaultStyle.LineWidth = LineWidth;
+		DefaultStyle.LineOpacity = LineOpacity;
+		DefaultStyle.LineColor = LineColor;
+		DefaultStyle.AtlasSlot = bUseCustomTexture ? 0 : -1;
+		OutStyles.Emplace(DefaultStyle);
+		return;
+	}
+
+	OutStyles.Reserve(LineStyles.Num());
+	for (const FSurfaceLineStyle& Style : LineStyles)
+	{
+		OutStyles.Emplace(Style);
+	}
+}
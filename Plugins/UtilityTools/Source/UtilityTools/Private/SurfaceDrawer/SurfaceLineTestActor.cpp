@@ -1,14 +1,153 @@
 ﻿#include "SurfaceDrawer/SurfaceLineTestActor.h"
 
 #include "SurfaceDrawer/BVHConfig.h"
+#include "SurfaceDrawer/SurfaceBufferArena.h"
+#include "SurfaceDrawer/SurfaceBufferUpload.h"
+#include "SurfaceDrawer/SurfaceContourBuilder.h"
+#include "SurfaceDrawer/SurfaceCoverageCache.h"
+#include "SurfaceDrawer/SurfaceFrustumCulling.h"
+#include "SurfaceDrawer/SurfaceGeoJsonImporter.h"
+#include "SurfaceDrawer/SurfaceLineBuilder.h"
+#include "SurfaceDrawer/SurfaceScreenBounds.h"
+#include "SurfaceDrawer/SurfaceTileCulling.h"
+
+#include "Algo/Count.h"
+#include "Async/ParallelFor.h"
 
 #include "Components/InputComponent.h"
 #include "GameFramework/PlayerController.h"
 #include "GameFramework/PlayerInput.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/StringBuilder.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderingThread.h"
+#include "RHIGPUReadback.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogSurfaceLineTestActor, Log, All);
 
+namespace SurfaceLineTestActor
+{
+	/// \brief 在中心点周围的方形区域内随机生成闭合的圆形多边形
+	static void BuildRandomCircles(const FVector2D& InCenter, double InHalfExtent, int32 InNumPolygons, int32 InRandomSeed, FSurfacePolygonSoup& OutPolygonSoup)
+	{
+		FRandomStream RandomStream(InRandomSeed);
+		TArray<FVector2f> SoupVertices;
+		for (int32 PolygonIndex = 0; PolygonIndex < InNumPolygons; ++PolygonIndex)
+		{
+			const FVector2D PolygonCenter = InCenter + FVector2D(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f)) * InHalfExtent;
+			const float Radius = RandomStream.FRandRange(200.f, 2000.f);
+			SoupVertices.Reset();
+			for (int32 Index = 0; Index < 32; ++Index)
+			{
+				const float Angle = UE_TWO_PI * Index / 31;
+				SoupVertices.Add(FVector2f(PolygonCenter + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius));
+			}
+			OutPolygonSoup.AddPolygon(SoupVertices);
+		}
+	}
+
+	/// \brief 执行InGraphBuilder并回读共享缓冲区的全部内容，阻塞直到GPU完成（仅渲染线程）
+	static void ReadbackArena(FRHICommandListImmediate& RHICmdList, FRDGBuilder& InGraphBuilder, FSurfaceBufferArena& InArena, TArray<uint8>& OutBytes)
+	{
+		FRDGBufferRef Buffer = InArena.GetBuffer(InGraphBuilder);
+		const uint32 NumBytes = static_cast<uint32>(Buffer->Desc.GetSize());
+		FRHIGPUBufferReadback Readback(TEXT("SurfaceArenaTestReadback"));
+		AddEnqueueCopyPass(InGraphBuilder, &Readback, Buffer, NumBytes);
+		InGraphBuilder.Execute();
+		RHICmdList.BlockUntilGPUIdle();
+
+		OutBytes.SetNumUninitialized(NumBytes);
+		FMemory::Memcpy(OutBytes.GetData(), Readback.Lock(NumBytes), NumBytes);
+		Readback.Unlock();
+	}
+
+	/// \brief 执行InGraphBuilder并回读共享缓冲区，逐个分配与InContents中的数据比较（仅渲染线程）
+	/// \return 内容不一致的分配数量
+	static int32 VerifyArenaContents(FRHICommandListImmediate& RHICmdList, FRDGBuilder& InGraphBuilder, FSurfaceBufferArena& InArena, const TMap<int32, TArray<uint32>>& InContents)
+	{
+		TArray<uint8> Bytes;
+		ReadbackArena(RHICmdList, InGraphBuilder, InArena, Bytes);
+
+		int32 NumMismatches = 0;
+		for (const TPair<int32, TArray<uint32>>& Pair : InContents)
+		{
+			const int64 ByteOffset = static_cast<int64>(InArena.GetOffset(Pair.Key)) * sizeof(uint32);
+			const int64 NumBytes = static_cast<int64>(Pair.Value.Num()) * sizeof(uint32);
+			if (InArena.GetSize(Pair.Key) < Pair.Value.Num() || ByteOffset + NumBytes > Bytes.Num()
+				|| FMemory::Memcmp(Bytes.GetData() + ByteOffset, Pair.Value.GetData(), NumBytes) != 0)
+			{
+				++NumMismatches;
+			}
+		}
+		return NumMismatches;
+	}
+
+	/// \brief 以控制台变量当前的设置优先级修改其值
+	/// \return 修改前的值
+	static int32 OverrideConsoleVariable(const TCHAR* InName, int32 InValue)
+	{
+		IConsoleVariable* Variable = IConsoleManager::Get().FindConsoleVariable(InName);
+		if (!Variable)
+		{
+			return InValue;
+		}
+
+		const int32 OldValue = Variable->GetInt();
+		Variable->Set(InValue, static_cast<EConsoleVariableFlags>(Variable->GetFlags() & ECVF_SetByMask));
+		return OldValue;
+	}
+
+	/// \brief 原始数据完整上传到共享缓冲区后只写入修改的范围，回读分配的内容并与修改后的数据逐字节比较
+	///
+	/// 修改后的数据比原始数据多时经临时缓冲区重新分配；其后的另一个分配写入固定内容，检查修改没有写出分配的范围。
+	/// \return 不一致的元素数量
+	template <typename ElementType>
+	static int32 VerifyDirtyRangeUpload(FRHICommandListImmediate& RHICmdList, TConstArrayView<ElementType> InOriginal, TConstArrayView<ElementType> InEdited, FSurfaceDirtyRanges InDirtyRanges)
+	{
+		constexpr int32 NumGuardElements = 64;
+		constexpr uint8 GuardByte = 0xCD;
+		FSurfaceBufferArena Arena(TEXT("SurfaceRefitTestArena"), sizeof(ElementType));
+
+		TArray<uint8> GuardData;
+		GuardData.Init(GuardByte, NumGuardElements * sizeof(ElementType));
+
+		FRDGBuilder GraphBuilder(RHICmdList);
+		int32 Allocation = Arena.Allocate(InOriginal.Num());
+		const int32 GuardAllocation = Arena.Allocate(NumGuardElements);
+		Arena.Upload(GraphBuilder, Allocation, 0, InOriginal.GetData(), InOriginal.Num());
+		Arena.Upload(GraphBuilder, GuardAllocation, 0, GuardData.GetData(), NumGuardElements);
+
+		// 与渲染器相同，间隔很小的范围合并为一次拷贝
+		InDirtyRanges.Normalize(16);
+		Arena.UploadDirtyRanges(GraphBuilder, Allocation, InEdited.GetData(), InEdited.Num(), InOriginal.Num(), InDirtyRanges);
+
+		TArray<uint8> Bytes;
+		ReadbackArena(RHICmdList, GraphBuilder, Arena, Bytes);
+
+		int32 NumMismatches = 0;
+		const uint8* AllocationBytes = Bytes.GetData() + static_cast<int64>(Arena.GetOffset(Allocation)) * sizeof(ElementType);
+		for (int32 Index = 0; Index < InEdited.Num(); ++Index)
+		{
+			if (FMemory::Memcmp(AllocationBytes + static_cast<int64>(Index) * sizeof(ElementType), &InEdited[Index], sizeof(ElementType)) != 0)
+			{
+				++NumMismatches;
+			}
+		}
+		const uint8* GuardBytes = Bytes.GetData() + static_cast<int64>(Arena.GetOffset(GuardAllocation)) * sizeof(ElementType);
+		if (FMemory::Memcmp(GuardBytes, GuardData.GetData(), GuardData.Num()) != 0)
+		{
+			++NumMismatches;
+		}
+
+		Arena.Release();
+		return NumMismatches;
+	}
+}
+
 ASurfaceLineTestActor::ASurfaceLineTestActor()
 {
 	PrimaryActorTick.bCanEverTick = true;
@@ -52,6 +191,386 @@ void ASurfaceLineTestActor::SetCustomPolygons(const TArray<FPolygon>& Polygons)
 	SurfaceLineComponent->SetPolygons(Polygons);
 }
 
+float ASurfaceLineTestActor::RunContourBenchmark(int32 InGridSize, int32 InNumLevels, float InCellSize)
+{
+	if (InGridSize < 2 || InNumLevels <= 0)
+	{
+		return 0.f;
+	}
+
+	// 多个频率叠加的起伏地形，高度范围约[-1, 1]
+	TArray<float> Heights;
+	Heights.SetNumUninitialized(InGridSize * InGridSize);
+	for (int32 Y = 0; Y < InGridSize; ++Y)
+	{
+		for (int32 X = 0; X < InGridSize; ++X)
+		{
+			const float U = float(X) / InGridSize * UE_TWO_PI;
+			const float V = float(Y) / InGridSize * UE_TWO_PI;
+			Heights[Y * InGridSize + X] =
+				0.5f * FMath::Sin(U * 3.f) * FMath::Cos(V * 2.f) +
+				0.3f * FMath::Sin(U * 7.f + V * 5.f) +
+				0.2f * FMath::Cos(U * 17.f - V * 13.f);
+		}
+	}
+
+	TArray<float> IsoLevels;
+	for (int32 Level = 0; Level < InNumLevels; ++Level)
+	{
+		IsoLevels.Add(-1.f + 2.f * (Level + 0.5f) / InNumLevels);
+	}
+
+	const FVector Location = GetActorLocation();
+	const FVector2D Origin(Location.X, Location.Y);
+	const FVector2D CellSize(InCellSize, InCellSize);
+
+	FContourPolylineSet Polylines;
+	FContourBuildStats Stats;
+	FSurfaceContourBuilder::Build(FContourGridDesc(Heights, InGridSize, InGridSize, Origin, CellSize), IsoLevels, Polylines, 0, &Stats);
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("等值线基准测试: 网格 %d x %d, %d 个等值, %d 个分块, 线段 %d 条, 折线 %d 条, 顶点 %d 个, 耗时 %.3f ms"),
+		InGridSize, InGridSize, InNumLevels, Stats.NumTiles, Stats.NumSegments, Stats.NumPolylines, Polylines.Vertices.Num(), Stats.BuildTimeMs);
+
+	if (SurfaceLineComponent)
+	{
+		SurfaceLineComponent->SetContourGrid(Heights, InGridSize, InGridSize, Origin, CellSize, IsoLevels);
+	}
+
+	return Stats.BuildTimeMs;
+}
+
+float ASurfaceLineTestActor::RunPolygonSoupBenchmark(int32 InNumPolygons, int32 InVerticesPerPolygon, int32 InRandomSeed)
+{
+	if (InNumPolygons <= 0 || InVerticesPerPolygon < 2)
+	{
+		return 0.f;
+	}
+
+	// 以Actor位置为中心随机分布的闭合多边形，两种格式数据相同
+	const FVector Center = GetActorLocation();
+	FRandomStream RandomStream(InRandomSeed);
+	TArray<FPolygon> Polygons;
+	Polygons.SetNum(InNumPolygons);
+	FSurfacePolygonSoup PolygonSoup;
+	PolygonSoup.Reserve(InNumPolygons, InNumPolygons * InVerticesPerPolygon);
+	TArray<FVector2f> SoupVertices;
+	for (FPolygon& Polygon : Polygons)
+	{
+		const FVector PolygonCenter = Center + FVector(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f), 0.f) * 1000000.f;
+		const float Radius = RandomStream.FRandRange(500.f, 5000.f);
+		Polygon.Vertices.SetNum(InVerticesPerPolygon);
+		SoupVertices.Reset();
+		for (int32 Index = 0; Index < InVerticesPerPolygon; ++Index)
+		{
+			const float Angle = UE_TWO_PI * Index / (InVerticesPerPolygon - 1);
+			Polygon.Vertices[Index] = PolygonCenter + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * Radius;
+			SoupVertices.Add(FVector2f(Polygon.Vertices[Index].X, Polygon.Vertices[Index].Y));
+		}
+		PolygonSoup.AddPolygon(SoupVertices);
+	}
+
+	FBVHBuildConfig BuildConfig;
+
+	// TArray<FPolygon>：SetPolygons传入异步任务时整体复制一次，再由构建器提取线段
+	uint32 StartCycles = FPlatformTime::Cycles();
+	{
+		const TArray<FPolygon> CapturedPolygons = Polygons;
+		FLineBVHBuilder Builder(CapturedPolygons, BuildConfig);
+		Builder.Build();
+	}
+	const double PolygonsMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	// 扁平多边形：共享只读数据，构建器直接读取
+	const TSharedRef<const FSurfacePolygonSoup> SharedPolygonSoup = MakeShared<FSurfacePolygonSoup>(MoveTemp(PolygonSoup));
+	StartCycles = FPlatformTime::Cycles();
+	{
+		FLineBVHBuilder Builder(*SharedPolygonSoup, BuildConfig);
+		Builder.Build();
+	}
+	const double SoupMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("扁平多边形基准测试: %d 个多边形, %d 个顶点, TArray<FPolygon> %.3f ms, FSurfacePolygonSoup %.3f ms"),
+		InNumPolygons, InNumPolygons * InVerticesPerPolygon, PolygonsMs, SoupMs);
+
+	if (SurfaceLineComponent)
+	{
+		SurfaceLineComponent->SetPolygonSoup(SharedPolygonSoup);
+	}
+
+	return SoupMs;
+}
+
+float ASurfaceLineTestActor::RunGeoJsonBenchmark(int32 InNumFeatures, int32 InVerticesPerFeature, int32 InRandomSeed)
+{
+	if (InNumFeatures <= 0 || InVerticesPerFeature < 4)
+	{
+		return 0.f;
+	}
+
+	// 坐标取1e-7度的整数倍，文本与期望值完全一致；偶数要素为折线，奇数要素为带一个洞的多边形
+	const FVector2D Origin(116.4, 39.9);
+	FRandomStream RandomStream(InRandomSeed);
+	TArray<FVector2D> ExpectedFirstVertices;
+	ExpectedFirstVertices.Reserve(InNumFeatures * 2);
+	TAnsiStringBuilder<1024> Builder;
+	Builder << "{\"type\":\"FeatureCollection\",\"features\":[\n";
+
+	auto AppendRing = [&Builder, &ExpectedFirstVertices, InVerticesPerFeature](const FIntPoint& Center, int32 Radius, bool bClosed)
+		{
+			Builder << '[';
+			const int32 NumPositions = bClosed ? InVerticesPerFeature : InVerticesPerFeature - 1;
+			for (int32 Index = 0; Index < NumPositions; ++Index)
+			{
+				const double Angle = UE_DOUBLE_TWO_PI * (Index % (InVerticesPerFeature - 1)) / (InVerticesPerFeature - 1);
+				const int64 Lon = Center.X + FMath::RoundToInt64(FMath::Cos(Angle) * Radius);
+				const int64 Lat = Center.Y + FMath::RoundToInt64(FMath::Sin(Angle) * Radius);
+				if (Index == 0)
+				{
+					ExpectedFirstVertices.Add(FVector2D(Lon * 1e-7, Lat * 1e-7));
+				}
+				Builder.Appendf("%s[%lld.%07lld,%lld.%07lld]", Index > 0 ? "," : "", Lon / 10000000, Lon % 10000000, Lat / 10000000, Lat % 10000000);
+			}
+			Builder << ']';
+		};
+
+	for (int32 FeatureIndex = 0; FeatureIndex < InNumFeatures; ++FeatureIndex)
+	{
+		// 原点附近±0.5度，坐标始终为正，便于按整数格式输出
+		const FIntPoint Center(
+			1164000000 + RandomStream.RandRange(-5000000, 5000000),
+			399000000 + RandomStream.RandRange(-5000000, 5000000));
+		const int32 Radius = RandomStream.RandRange(500, 5000);
+
+		Builder.Appendf("%s{\"type\":\"Feature\",\"properties\":{\"id\":%d,\"name\":\"f\\\"%d\"},\"geometry\":", FeatureIndex > 0 ? ",\n" : "", FeatureIndex, FeatureIndex);
+		if (FeatureIndex % 2 == 0)
+		{
+			Builder << "{\"type\":\"LineString\",\"coordinates\":";
+			AppendRing(Center, Radius, false);
+		}
+		else
+		{
+			// 坐标在type之前，覆盖延迟解析的路径
+			Builder << "{\"coordinates\":[";
+			AppendRing(Center, Radius, true);
+			Builder << ',';
+			AppendRing(Center, Radius / 2, true);
+			Builder << "],\"type\":\"Polygon\"";
+		}
+		Builder << "}}";
+	}
+	Builder << "\n]}\n";
+
+	const FString FilePath = FPaths::ProjectSavedDir() / TEXT("SurfaceDrawer") / TEXT("GeoJsonBenchmark.geojson");
+	if (!FFileHelper::SaveArrayToFile(TArrayView<const uint8>(reinterpret_cast<const uint8*>(Builder.GetData()), Builder.Len()), *FilePath))
+	{
+		UE_LOG(LogSurfaceLineTestActor, Warning, TEXT("GeoJSON基准测试: 无法写入 %s"), *FilePath);
+		return 0.f;
+	}
+
+	FGeoJsonImportOptions Options;
+	Options.Projection = FGeoJsonProjection(Origin);
+	Options.bImportPolygonRings = false;
+
+	FGeoJsonFeatureBatch Result;
+	FGeoJsonImportStats Stats;
+	FSurfaceGeoJsonImporter::ImportFile(FilePath, Options, Result, &Stats);
+
+	// 与导入器相同的局部等距投影
+	const double MetersPerDegree = 6378137.0 * FMath::DegreesToRadians(1.0);
+	const double ScaleX = MetersPerDegree * FMath::Cos(FMath::DegreesToRadians(Origin.Y)) * 100.0;
+	const double ScaleY = -MetersPerDegree * 100.0;
+	int32 NumMismatches = Result.Polylines.Num() == ExpectedFirstVertices.Num() ? 0 : 1;
+	for (int32 PolylineIndex = 0; PolylineIndex < FMath::Min(Result.Polylines.Num(), ExpectedFirstVertices.Num()); ++PolylineIndex)
+	{
+		const FVector2f& Actual = Result.Polylines.GetPolygon(PolylineIndex)[0];
+		const FVector2D Expected((ExpectedFirstVertices[PolylineIndex].X - Origin.X) * ScaleX, (ExpectedFirstVertices[PolylineIndex].Y - Origin.Y) * ScaleY);
+		if (!FVector2D(Actual).Equals(Expected, 1.0))
+		{
+			++NumMismatches;
+		}
+	}
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("GeoJSON基准测试: %d 个要素, %.1f MB, 折线 %d (期望 %d), 顶点 %lld, 扫描 %.2f ms, 解析 %.2f ms, 总计 %.2f ms, 不一致 %d"),
+		Stats.NumFeatures, Stats.NumBytes / (1024.0 * 1024.0), Result.Polylines.Num(), ExpectedFirstVertices.Num(), Stats.NumVertices,
+		Stats.ScanTimeMs, Stats.ParseTimeMs, Stats.TotalTimeMs, NumMismatches);
+
+	if (SurfaceLineComponent)
+	{
+		SurfaceLineComponent->SetPolygonSoup(MoveTemp(Result.Polylines));
+	}
+
+	return Stats.TotalTimeMs;
+}
+
+int32 ASurfaceLineTestActor::RunTileCullingTest(int32 InNumPolygons, int32 InViewportSize, int32 InRandomSeed)
+{
+	if (InNumPolygons <= 0 || InViewportSize < FSurfaceTileCulling::TileSize)
+	{
+		return 0;
+	}
+
+	// 以Actor位置为中心随机分布的闭合多边形
+	const FVector Center = GetActorLocation();
+	const double HalfExtent = 200000.0;
+	FSurfacePolygonSoup PolygonSoup;
+	SurfaceLineTestActor::BuildRandomCircles(FVector2D(Center), HalfExtent, InNumPolygons, InRandomSeed, PolygonSoup);
+
+	FLineBVHBuilder Builder(PolygonSoup, FBVHBuildConfig());
+	Builder.Build();
+	FGPULineData GPUData;
+	if (!FLineDataConverter::ConvertToGPUData(Builder, GPUData))
+	{
+		return 0;
+	}
+
+	// 斜向俯视，画面上部为天空（深度为0）
+	const FSurfaceTileView View = FSurfaceTileCulling::MakeObliqueView(Center, HalfExtent, -35.f, InViewportSize);
+	TArray<float> DeviceDepth;
+	FSurfaceTileCulling::BuildPlaneDepth(View, Center.Z, DeviceDepth);
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	FSurfaceTileCandidates TileCandidates;
+	FSurfaceTileCulling::CullLineTiles(View, DeviceDepth, GPUData, Width, bUsePixelUnit, TileCandidates);
+	const double CullMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	// 逐像素遍历与着色器的QueryBVH一致，像素单位线宽按像素的世界大小换算
+	const FSurfaceTileCullingCheck Check = FSurfaceTileCulling::CheckTileCandidates(View, DeviceDepth, TileCandidates,
+		[this, &View, &GPUData](const FVector3f& InWorldPosition, const FVector2f& InScreenPosition, TArray<int32>& OutLeafNodes)
+		{
+			const float HalfWidth = 0.5f * Width * (bUsePixelUnit ? FSurfaceTileCulling::CalculatePixelWorldSize(View, InWorldPosition, InScreenPosition) : 1.f);
+			const FVector2f PixelPosition(InWorldPosition.X, InWorldPosition.Y);
+			return FSurfaceTileCulling::CullLineBVH(GPUData.Nodes, FBox2f(PixelPosition, PixelPosition), HalfWidth, OutLeafNodes);
+		});
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("分块剔除测试: %d 个叶子节点, %s, 像素平均访问叶子 %.2f 个, 剔除耗时 %.3f ms, 候选缺失 %d 个像素"),
+		GPUData.Clusters.Num(), *TileCandidates.DescribeStats(), Check.GetAveragePixelLeafNodes(), CullMs, Check.NumMismatches);
+
+	if (SurfaceLineComponent)
+	{
+		SurfaceLineComponent->SetPolygonSoup(MakeShared<FSurfacePolygonSoup>(MoveTemp(PolygonSoup)));
+	}
+
+	return Check.NumMismatches;
+}
+
+int32 ASurfaceLineTestActor::RunScreenBoundsTest(int32 InNumBoxes, int32 InViewportSize, int32 InRandomSeed)
+{
+	if (InNumBoxes <= 0 || InViewportSize <= 0)
+	{
+		return 0;
+	}
+
+	const FIntRect ViewportRect(0, 0, InViewportSize, InViewportSize);
+	const FMatrix ProjMatrix = FReversedZPerspectiveMatrix(UE_PI * 0.25f, InViewportSize, InViewportSize, 10.0f);
+	const int32 NumSamplesPerAxis = 9;
+
+	// 采样点投影到视口内时输出像素坐标；近平面（W = 10）之前的点被GPU裁剪
+	auto ProjectSample = [InViewportSize](const FMatrix& InViewProjMatrix, const FVector& InPosition, FIntPoint& OutPixel)
+		{
+			const FVector4 ClipPosition = InViewProjMatrix.TransformFVector4(FVector4(InPosition, 1.0));
+			if (ClipPosition.W < 10.0)
+			{
+				return false;
+			}
+
+			const FVector2D NDCPosition(ClipPosition.X / ClipPosition.W, ClipPosition.Y / ClipPosition.W);
+			if (FMath::Abs(NDCPosition.X) > 1.0 || FMath::Abs(NDCPosition.Y) > 1.0)
+			{
+				return false;
+			}
+
+			OutPixel = FIntPoint(
+				FMath::Clamp(FMath::FloorToInt32((NDCPosition.X * 0.5 + 0.5) * InViewportSize), 0, InViewportSize - 1),
+				FMath::Clamp(FMath::FloorToInt32((0.5 - NDCPosition.Y * 0.5) * InViewportSize), 0, InViewportSize - 1));
+			return true;
+		};
+
+	FRandomStream RandomStream(InRandomSeed);
+	int32 NumMisses = 0;
+	int32 NumCulledBoxes = 0;
+	int32 NumVisibleSamples = 0;
+	int32 NumSurfaceMisses = 0;
+	int32 NumVisibleSurfaceSamples = 0;
+	double ScissorArea = 0.0;
+	for (int32 BoxIndex = 0; BoxIndex < InNumBoxes; ++BoxIndex)
+	{
+		// 相机位于原点附近，朝向任意方向；部分包围盒包含相机
+		const FVector ViewLocation = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, 5000.f);
+		const FRotator ViewRotation(RandomStream.FRandRange(-89.f, 89.f), RandomStream.FRandRange(-180.f, 180.f), 0.f);
+		const FMatrix ViewMatrix = FTranslationMatrix(-ViewLocation) * FInverseRotationMatrix(ViewRotation) * FMatrix(
+			FPlane(0, 0, 1, 0),
+			FPlane(1, 0, 0, 0),
+			FPlane(0, 1, 0, 0),
+			FPlane(0, 0, 0, 1));
+		const FMatrix ViewProjMatrix = ViewMatrix * ProjMatrix;
+
+		const FVector BoxCenter = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, 100000.f);
+		const FVector BoxExtent(RandomStream.FRandRange(10.f, 50000.f), RandomStream.FRandRange(10.f, 50000.f), RandomStream.FRandRange(10.f, 50000.f));
+		const FBox WorldBox(BoxCenter - BoxExtent, BoxCenter + BoxExtent);
+		const float PixelPadding = RandomStream.FRandRange(0.f, 8.f);
+
+		FIntRect ScissorRect;
+		const bool bVisible = FSurfaceScreenBounds::ProjectBox(ViewProjMatrix, ViewportRect, WorldBox, PixelPadding, ScissorRect);
+		if (bVisible)
+		{
+			ScissorArea += ScissorRect.Area();
+		}
+		else
+		{
+			++NumCulledBoxes;
+		}
+
+		for (int32 SampleIndex = 0; SampleIndex < NumSamplesPerAxis * NumSamplesPerAxis * NumSamplesPerAxis; ++SampleIndex)
+		{
+			const FVector Alpha(
+				static_cast<double>(SampleIndex % NumSamplesPerAxis) / (NumSamplesPerAxis - 1),
+				static_cast<double>(SampleIndex / NumSamplesPerAxis % NumSamplesPerAxis) / (NumSamplesPerAxis - 1),
+				static_cast<double>(SampleIndex / (NumSamplesPerAxis * NumSamplesPerAxis)) / (NumSamplesPerAxis - 1));
+			FIntPoint Pixel;
+			if (!ProjectSample(ViewProjMatrix, WorldBox.Min + WorldBox.GetSize() * Alpha, Pixel))
+			{
+				continue;
+			}
+			++NumVisibleSamples;
+
+			if (!bVisible || !ScissorRect.Contains(Pixel))
+			{
+				++NumMisses;
+			}
+		}
+
+		// 地表数据只有XY范围：代理矩形必须覆盖该XY范围内任意高度（远超旧的±1千米高度范围）的可见点
+		FIntRect SurfaceScissorRect;
+		const bool bSurfaceVisible = FSurfaceScreenBounds::CalculateScissorRect(ViewProjMatrix, ViewportRect,
+			FVector3f(WorldBox.Min.X, WorldBox.Min.Y, BoxCenter.Z), FVector3f(WorldBox.Max.X, WorldBox.Max.Y, BoxCenter.Z), 0.f, PixelPadding, SurfaceScissorRect);
+		for (int32 SampleIndex = 0; SampleIndex < NumSamplesPerAxis * NumSamplesPerAxis; ++SampleIndex)
+		{
+			const FVector2D Alpha(
+				static_cast<double>(SampleIndex % NumSamplesPerAxis) / (NumSamplesPerAxis - 1),
+				static_cast<double>(SampleIndex / NumSamplesPerAxis) / (NumSamplesPerAxis - 1));
+			const FVector2D SurfacePosition = FVector2D(WorldBox.Min) + FVector2D(WorldBox.GetSize()) * Alpha;
+
+			FIntPoint Pixel;
+			if (!ProjectSample(ViewProjMatrix, FVector(SurfacePosition, RandomStream.FRandRange(-1000000.f, 1000000.f)), Pixel))
+			{
+				continue;
+			}
+			++NumVisibleSurfaceSamples;
+
+			if (!bSurfaceVisible || !SurfaceScissorRect.Contains(Pixel))
+			{
+				++NumSurfaceMisses;
+			}
+		}
+	}
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("屏幕范围测试: %d 个包围盒, 屏幕外 %d 个, 可见矩形平均占视口 %.1f%%, 可见采样点 %d 个, 落在矩形外 %d 个; 任意高度地表可见采样点 %d 个, 落在代理矩形外 %d 个"),
+		InNumBoxes, NumCulledBoxes, 100.0 * ScissorArea / FMath::Max(InNumBoxes - NumCulledBoxes, 1) / ViewportRect.Area(), NumVisibleSamples, NumMisses,
+		NumVisibleSurfaceSamples, NumSurfaceMisses);
+
+	return NumMisses + NumSurfaceMisses;
+}
+
 void ASurfaceLineTestActor::OnLeftMouseButtonPressed()
 {
 	APlayerController* PC = GetWorld()->GetFirstPlayerController();
@@ -81,3 +600,599 @@ void ASurfaceLineTestActor::OnMiddleMouseButtonPressed()
 	SurfaceLineComponent->MarkRenderStateDirty();
 }
 
+int32 ASurfaceLineTestActor::RunSeedCullingTest(int32 InNumPolygons, int32 InViewportSize, int32 InRandomSeed)
+{
+	if (InNumPolygons <= 0 || InViewportSize <= 0)
+	{
+		return 0;
+	}
+
+	const FVector Center = GetActorLocation();
+	const double HalfExtent = 200000.0;
+	FSurfacePolygonSoup PolygonSoup;
+	SurfaceLineTestActor::BuildRandomCircles(FVector2D(Center), HalfExtent, InNumPolygons, InRandomSeed, PolygonSoup);
+
+	FLineBVHBuilder Builder(PolygonSoup, FBVHBuildConfig());
+	Builder.Build();
+	FGPULineData GPUData;
+	if (!FLineDataConverter::ConvertToGPUData(Builder, GPUData))
+	{
+		return 0;
+	}
+
+	// 近距离斜向俯视数据范围内的随机位置，大部分子树位于视锥外
+	FRandomStream RandomStream(InRandomSeed);
+	const FVector Target = Center + FVector(RandomStream.FRandRange(-1.f, 1.f) * HalfExtent, RandomStream.FRandRange(-1.f, 1.f) * HalfExtent, 0.0);
+	const FRotator ViewRotation(RandomStream.FRandRange(-60.f, -20.f), RandomStream.FRandRange(-180.f, 180.f), 0.f);
+	const FVector ViewLocation = Target - ViewRotation.Vector() * HalfExtent * 0.1;
+	const FMatrix ViewMatrix = FTranslationMatrix(-ViewLocation) * FInverseRotationMatrix(ViewRotation) * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+	const FMatrix ProjMatrix = FReversedZPerspectiveMatrix(UE_PI * 0.25f, InViewportSize, InViewportSize, 10.0f);
+	const FIntRect ViewportRect(0, 0, InViewportSize, InViewportSize);
+	const FSurfaceTileView View = FSurfaceTileCulling::MakeView(ViewMatrix, ProjMatrix, ViewportRect);
+
+	const float WorldPadding = bUsePixelUnit ? 0.f : 0.5f * Width;
+	const float PixelPadding = bUsePixelUnit ? 0.5f * Width + 1.f : 1.f;
+	const FSurfaceViewFootprint Footprint = FSurfaceViewFootprint::FromViewProjection(ViewMatrix * ProjMatrix, ViewportRect.Size(), PixelPadding);
+	TArray<uint32> SeedNodes;
+	FSurfaceFrustumCulling::CullLineSubtrees(GPUData.Nodes, Footprint, WorldPadding, FSurfaceFrustumCulling::MaxSeedLevels, SeedNodes);
+
+	// 起始子树数量超过上限时着色器的遍历栈可能溢出
+	int32 NumMismatches = 0;
+	if (SeedNodes.Num() > FSurfaceFrustumCulling::MaxSeedNodes)
+	{
+		UE_LOG(LogSurfaceLineTestActor, Warning, TEXT("起始子树剔除测试: 起始子树数量 %d 超过上限 %d"), SeedNodes.Num(), FSurfaceFrustumCulling::MaxSeedNodes);
+		++NumMismatches;
+	}
+
+	// 每个节点所属的起始子树序号，-1表示被剔除
+	TArray<int32> NodeSeedIndices;
+	NodeSeedIndices.Init(INDEX_NONE, GPUData.Nodes.Num());
+	TArray<int32> NodeStack;
+	for (int32 SeedIndex = 0; SeedIndex < SeedNodes.Num(); ++SeedIndex)
+	{
+		NodeStack.Add(SeedNodes[SeedIndex]);
+		while (!NodeStack.IsEmpty())
+		{
+			const int32 NodeIndex = NodeStack.Pop(EAllowShrinking::No);
+			NodeSeedIndices[NodeIndex] = SeedIndex;
+			const FGPULineBVHNode& Node = GPUData.Nodes[NodeIndex];
+			if (Node.IsLeaf == 0)
+			{
+				if (Node.LeftChild != -1)
+				{
+					NodeStack.Add(Node.LeftChild);
+				}
+				if (Node.RightChild != -1)
+				{
+					NodeStack.Add(Node.RightChild);
+				}
+			}
+		}
+	}
+
+	// 从根节点逐像素遍历访问的叶子节点必须都属于某个起始子树，且所属子树序号不减（即访问顺序不变）；
+	// 剔除与地表高度无关，地表位于数据所在高度和远低于数据的高度时结果都必须一致
+	const double SurfaceHeights[] = { Center.Z, Center.Z - 500000.0 };
+	TArray<float> DeviceDepth;
+	TArray<int32> RowMismatches;
+	for (const double SurfaceHeight : SurfaceHeights)
+	{
+		FSurfaceTileCulling::BuildPlaneDepth(View, SurfaceHeight, DeviceDepth);
+		RowMismatches.SetNumZeroed(InViewportSize);
+		ParallelFor(InViewportSize, [&](int32 Y)
+			{
+				TArray<int32> PixelLeafNodes;
+				for (int32 X = 0; X < InViewportSize; ++X)
+				{
+					const float PixelDepth = DeviceDepth[Y * InViewportSize + X];
+					if (PixelDepth <= 0.f)
+					{
+						continue;
+					}
+
+					const FVector2f ScreenPosition(X + 0.5f, Y + 0.5f);
+					const FVector3f WorldPosition = FSurfaceTileCulling::ScreenToWorldPosition(View, ScreenPosition, PixelDepth);
+					const float HalfWidth = 0.5f * Width * (bUsePixelUnit ? FSurfaceTileCulling::CalculatePixelWorldSize(View, WorldPosition, ScreenPosition) : 1.f);
+					const FVector2f PixelPosition(WorldPosition.X, WorldPosition.Y);
+					if (!FSurfaceTileCulling::CullLineBVH(GPUData.Nodes, FBox2f(PixelPosition, PixelPosition), HalfWidth, PixelLeafNodes))
+					{
+						continue;
+					}
+
+					int32 LastSeedIndex = 0;
+					for (const int32 LeafNode : PixelLeafNodes)
+					{
+						const int32 SeedIndex = NodeSeedIndices[LeafNode];
+						if (SeedIndex < LastSeedIndex)
+						{
+							++RowMismatches[Y];
+							break;
+						}
+						LastSeedIndex = SeedIndex;
+					}
+				}
+			});
+
+		for (const int32 RowMismatch : RowMismatches)
+		{
+			NumMismatches += RowMismatch;
+		}
+		RowMismatches.Reset();
+	}
+
+	const int32 NumCulledNodes = Algo::Count(NodeSeedIndices, INDEX_NONE);
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("起始子树剔除测试: %d 个节点, %d 个起始子树, 剔除节点 %.1f%%, 遍历结果不一致 %d 个像素"),
+		GPUData.Nodes.Num(), SeedNodes.Num(), 100.0 * NumCulledNodes / FMath::Max(GPUData.Nodes.Num(), 1), NumMismatches);
+
+	return NumMismatches;
+}
+
+int32 ASurfaceLineTestActor::RunRefitTest(int32 InNumPolygons, int32 InNumEdits, int32 InRandomSeed)
+{
+	if (InNumPolygons <= 0 || InNumEdits <= 0)
+	{
+		return 0;
+	}
+
+	const FVector Center = GetActorLocation();
+	const double HalfExtent = 200000.0;
+	FSurfacePolygonSoup PolygonSoup;
+	SurfaceLineTestActor::BuildRandomCircles(FVector2D(Center), HalfExtent, InNumPolygons, InRandomSeed, PolygonSoup);
+
+	FLineBVHBuilder Builder(PolygonSoup, FBVHBuildConfig());
+	Builder.Build();
+	FGPULineData GPUData;
+	FLineRefitIndices RefitIndices;
+	if (!FLineDataConverter::ConvertToGPUData(Builder, GPUData) || !RefitIndices.Build(GPUData))
+	{
+		return 0;
+	}
+	const FGPULineData OriginalGPUData = GPUData;
+	FGPULineDirtyRanges TotalDirtyRanges;
+	FGPULineDataPatch TotalPatch;
+
+	TArray<TArray<FVector2f>> ExpectedPolygons;
+	ExpectedPolygons.SetNum(PolygonSoup.Num());
+	for (int32 PolygonIndex = 0; PolygonIndex < PolygonSoup.Num(); ++PolygonIndex)
+	{
+		const TConstArrayView<FVector2f> Polygon = PolygonSoup.GetPolygon(PolygonIndex);
+		ExpectedPolygons[PolygonIndex].Append(Polygon.GetData(), Polygon.Num());
+	}
+
+	// 每次修改单独统计修改范围，相当于每帧编辑一个多边形；顶点数在2~129之间变化，始终为一个线段簇
+	FRandomStream RandomStream(InRandomSeed + 1);
+	TArray<FVector2f> Vertices;
+	int64 DirtyBytes = 0;
+	int32 NumRejected = 0;
+	int32 NumPatchMismatches = 0;
+	double RefitMs = 0.0;
+	for (int32 EditIndex = 0; EditIndex < InNumEdits; ++EditIndex)
+	{
+		const int32 PolygonIndex = RandomStream.RandHelper(PolygonSoup.Num());
+		const int32 NumVertices = RandomStream.RandRange(2, 129);
+		const FVector2D PolygonCenter = FVector2D(Center) + FVector2D(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f)) * HalfExtent;
+		const float Radius = RandomStream.FRandRange(200.f, 2000.f);
+		Vertices.Reset();
+		for (int32 Index = 0; Index < NumVertices; ++Index)
+		{
+			const float Angle = UE_TWO_PI * Index / (NumVertices - 1);
+			Vertices.Add(FVector2f(PolygonCenter + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius));
+		}
+
+		// 与组件相同：基于只读数据生成补丁后写入，渲染线程累积的补丁在下面整体校验
+		FGPULineDataPatch Patch;
+		const uint32 StartCycles = FPlatformTime::Cycles();
+		const bool bRefit = FLineDataConverter::RefitPolyline(GPUData, RefitIndices, PolygonIndex, Vertices, Patch) && Patch.Apply(GPUData);
+		RefitMs += FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+		if (!bRefit)
+		{
+			++NumRejected;
+			continue;
+		}
+
+		const FGPULineDirtyRanges& DirtyRanges = Patch.DirtyRanges;
+		ExpectedPolygons[PolygonIndex] = Vertices;
+		TotalDirtyRanges.Append(DirtyRanges);
+		if (!TotalPatch.Append(Patch))
+		{
+			++NumPatchMismatches;
+		}
+		DirtyBytes += static_cast<int64>(DirtyRanges.Nodes.GetNumElements()) * sizeof(FGPULineBVHNode)
+			+ static_cast<int64>(DirtyRanges.Clusters.GetNumElements()) * sizeof(FGPUSegmentCluster)
+			+ static_cast<int64>(DirtyRanges.Segments.GetNumElements()) * sizeof(FGPUSegment);
+	}
+
+	// 线段与最新的顶点一致，Cluster的包围盒为其线段的包围盒
+	int32 NumMismatches = 0;
+	for (int32 PolygonIndex = 0; PolygonIndex < ExpectedPolygons.Num(); ++PolygonIndex)
+	{
+		const TArray<FVector2f>& Expected = ExpectedPolygons[PolygonIndex];
+		int32 FirstVertex = 0;
+		for (int32 Offset = RefitIndices.PolygonClusterOffsets[PolygonIndex]; Offset < RefitIndices.PolygonClusterOffsets[PolygonIndex + 1]; ++Offset)
+		{
+			const FGPUSegmentCluster& Cluster = GPUData.Clusters[RefitIndices.PolygonClusters[Offset]];
+			FBox3f SegmentBox(ForceInit);
+			for (int32 SegmentIndex = 0; SegmentIndex < Cluster.AllSegmentNum; ++SegmentIndex)
+			{
+				const FGPUSegment& Segment = GPUData.Segments[Cluster.SegmentStartIndex + SegmentIndex];
+				const int32 VertexIndex = FirstVertex + SegmentIndex;
+				if (!Expected.IsValidIndex(VertexIndex + 1) || Segment.PolygonIndex != PolygonIndex
+					|| FVector2f(Segment.Start) != Expected[VertexIndex] || FVector2f(Segment.End) != Expected[VertexIndex + 1])
+				{
+					++NumMismatches;
+				}
+				SegmentBox += Segment.Start;
+				SegmentBox += Segment.End;
+			}
+			if (SegmentBox.Min != Cluster.MinExtent || SegmentBox.Max != Cluster.MaxExtent)
+			{
+				++NumMismatches;
+			}
+			FirstVertex += Cluster.AllSegmentNum;
+		}
+		if (FirstVertex != Expected.Num() - 1)
+		{
+			++NumMismatches;
+		}
+	}
+
+	// 叶子节点的包围盒为其Cluster的包围盒，内部节点为子节点包围盒的并集
+	for (const FGPULineBVHNode& Node : GPUData.Nodes)
+	{
+		FBox3f ExpectedBox(ForceInit);
+		if (Node.IsLeaf == 1)
+		{
+			const FGPUSegmentCluster& Cluster = GPUData.Clusters[Node.ClusterIndex];
+			ExpectedBox = FBox3f(Cluster.MinExtent, Cluster.MaxExtent);
+		}
+		else
+		{
+			for (const int32 ChildIndex : { Node.LeftChild, Node.RightChild })
+			{
+				if (GPUData.Nodes.IsValidIndex(ChildIndex))
+				{
+					ExpectedBox += FBox3f(GPUData.Nodes[ChildIndex].MinExtent, GPUData.Nodes[ChildIndex].MaxExtent);
+				}
+			}
+		}
+		if (ExpectedBox.Min != Node.MinExtent || ExpectedBox.Max != Node.MaxExtent)
+		{
+			++NumMismatches;
+		}
+	}
+
+	// 原始数据一次写入累积的补丁（渲染线程合并多帧修改的方式），结果与逐次修补的数据一致
+	FGPULineData PatchedGPUData = OriginalGPUData;
+	if (!TotalPatch.Apply(PatchedGPUData)
+		|| PatchedGPUData.Nodes.Num() != GPUData.Nodes.Num() || PatchedGPUData.Clusters.Num() != GPUData.Clusters.Num() || PatchedGPUData.Segments.Num() != GPUData.Segments.Num()
+		|| FMemory::Memcmp(PatchedGPUData.Nodes.GetData(), GPUData.Nodes.GetData(), GPUData.Nodes.Num() * sizeof(FGPULineBVHNode)) != 0
+		|| FMemory::Memcmp(PatchedGPUData.Clusters.GetData(), GPUData.Clusters.GetData(), GPUData.Clusters.Num() * sizeof(FGPUSegmentCluster)) != 0
+		|| FMemory::Memcmp(PatchedGPUData.Segments.GetData(), GPUData.Segments.GetData(), GPUData.Segments.Num() * sizeof(FGPUSegment)) != 0)
+	{
+		++NumPatchMismatches;
+	}
+	NumMismatches += NumPatchMismatches;
+
+	// 由修改后的数据重新生成的索引与原来的一致
+	FLineRefitIndices RebuiltRefitIndices;
+	if (!RebuiltRefitIndices.Build(GPUData) || RebuiltRefitIndices.NodeParents != RefitIndices.NodeParents || RebuiltRefitIndices.ClusterNodes != RefitIndices.ClusterNodes
+		|| RebuiltRefitIndices.PolygonClusterOffsets != RefitIndices.PolygonClusterOffsets || RebuiltRefitIndices.PolygonClusters != RefitIndices.PolygonClusters)
+	{
+		++NumMismatches;
+	}
+
+	// GPU路径：原始数据上传到共享缓冲区后写入所有修改的范围，回读结果与CPU上修改后的数据一致
+	int32 NumGPUMismatches = 0;
+	ENQUEUE_RENDER_COMMAND(SurfaceLineRefitUploadTest)(
+		[&OriginalGPUData, &GPUData, &TotalDirtyRanges, &NumGPUMismatches](FRHICommandListImmediate& RHICmdList)
+		{
+			NumGPUMismatches += SurfaceLineTestActor::VerifyDirtyRangeUpload<FGPULineBVHNode>(RHICmdList, OriginalGPUData.Nodes, GPUData.Nodes, TotalDirtyRanges.Nodes);
+			NumGPUMismatches += SurfaceLineTestActor::VerifyDirtyRangeUpload<FGPUSegmentCluster>(RHICmdList, OriginalGPUData.Clusters, GPUData.Clusters, TotalDirtyRanges.Clusters);
+			NumGPUMismatches += SurfaceLineTestActor::VerifyDirtyRangeUpload<FGPUSegment>(RHICmdList, OriginalGPUData.Segments, GPUData.Segments, TotalDirtyRanges.Segments);
+		});
+	FlushRenderingCommands();
+	NumMismatches += NumGPUMismatches;
+
+	const int64 TotalBytes = static_cast<int64>(GPUData.Nodes.Num()) * sizeof(FGPULineBVHNode)
+		+ static_cast<int64>(GPUData.Clusters.Num()) * sizeof(FGPUSegmentCluster)
+		+ static_cast<int64>(GPUData.Segments.Num()) * sizeof(FGPUSegment);
+	const int32 NumRefits = FMath::Max(InNumEdits - NumRejected, 1);
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("局部修改测试: %d 个多边形, 修改 %d 次 (拒绝 %d 次), 每次平均上传 %.2f KB, 完整数据 %.2f MB, 每次平均耗时 %.3f ms, 不一致 %d (其中累积补丁 %d, GPU回读 %d)"),
+		InNumPolygons, InNumEdits, NumRejected, DirtyBytes / 1024.0 / NumRefits, TotalBytes / (1024.0 * 1024.0), RefitMs / InNumEdits, NumMismatches, NumPatchMismatches, NumGPUMismatches);
+
+	if (SurfaceLineComponent)
+	{
+		FSurfacePolygonSoup EditedSoup;
+		for (const TArray<FVector2f>& Polygon : ExpectedPolygons)
+		{
+			EditedSoup.AddPolygon(Polygon);
+		}
+		SurfaceLineComponent->SetPolygonSoup(MoveTemp(EditedSoup));
+	}
+
+	return NumMismatches;
+}
+
+int32 ASurfaceLineTestActor::RunArenaAllocatorTest(int32 InNumOperations, int32 InRandomSeed)
+{
+	if (InNumOperations <= 0)
+	{
+		return 0;
+	}
+
+	// 分配和空闲范围按偏移排序后应首尾相接地覆盖[0, Capacity)，空闲范围之间至少隔着一个分配
+	auto ValidateLayout = [](const FSurfaceRangeAllocator& Allocator)
+	{
+		int32 NumErrors = 0;
+		int32 NumUsedElements = 0;
+		TArray<TPair<int32, int32>> Ranges;
+		Allocator.ForEachAllocation([&Ranges, &NumUsedElements](int32 Handle, int32 Offset, int32 Size)
+			{
+				Ranges.Add({ Offset, Size });
+				NumUsedElements += Size;
+			});
+
+		int32 PrevFreeEnd = -1;
+		Allocator.ForEachFreeRange([&Ranges, &NumErrors, &PrevFreeEnd](int32 Offset, int32 Size)
+			{
+				if (Size <= 0 || Offset <= PrevFreeEnd)
+				{
+					++NumErrors;
+				}
+				PrevFreeEnd = Offset + Size;
+				Ranges.Add({ Offset, Size });
+			});
+
+		Ranges.Sort([](const TPair<int32, int32>& A, const TPair<int32, int32>& B) { return A.Key < B.Key; });
+		int32 End = 0;
+		for (const TPair<int32, int32>& Range : Ranges)
+		{
+			if (Range.Key != End)
+			{
+				++NumErrors;
+			}
+			End = Range.Key + Range.Value;
+		}
+
+		if (End != Allocator.GetCapacity() || NumUsedElements != Allocator.GetNumUsedElements())
+		{
+			++NumErrors;
+		}
+		return NumErrors;
+	};
+
+	FRandomStream RandomStream(InRandomSeed);
+	FSurfaceRangeAllocator Allocator;
+	TArray<int32> Handles;
+	int32 NumErrors = 0;
+	int32 NumCompactions = 0;
+	int32 NumMovedElements = 0;
+	int32 MaxFreeRanges = 0;
+	for (int32 Operation = 0; Operation < InNumOperations; ++Operation)
+	{
+		const float Choice = RandomStream.FRand();
+		if (Handles.Num() == 0 || Choice < 0.55f)
+		{
+			// 大小跨越几个数量级，模拟小组件和大组件混合
+			const int32 NumElements = 1 + RandomStream.RandHelper(1 << RandomStream.RandRange(2, 12));
+			Handles.Add(Allocator.Allocate(NumElements));
+		}
+		else if (Choice < 0.99f || !Allocator.ShouldCompact())
+		{
+			const int32 Index = RandomStream.RandHelper(Handles.Num());
+			Allocator.Free(Handles[Index]);
+			Handles.RemoveAtSwap(Index);
+		}
+		else
+		{
+			// 每个元素写入所属分配的句柄，按拷贝列表搬到新缓冲区后应仍位于同一分配内
+			TArray<int32> OldElements;
+			OldElements.Init(INDEX_NONE, Allocator.GetCapacity());
+			Allocator.ForEachAllocation([&OldElements](int32 Handle, int32 Offset, int32 Size)
+				{
+					for (int32 Index = 0; Index < Size; ++Index)
+					{
+						OldElements[Offset + Index] = Handle;
+					}
+				});
+
+			TArray<FSurfaceRangeAllocator::FMove> Moves;
+			Allocator.Compact(Moves);
+
+			TArray<int32> NewElements;
+			NewElements.Init(INDEX_NONE, Allocator.GetCapacity());
+			for (const FSurfaceRangeAllocator::FMove& Move : Moves)
+			{
+				for (int32 Index = 0; Index < Move.Num; ++Index)
+				{
+					NewElements[Move.DestOffset + Index] = OldElements[Move.SrcOffset + Index];
+				}
+				NumMovedElements += Move.Num;
+			}
+
+			Allocator.ForEachAllocation([&NewElements, &NumErrors](int32 Handle, int32 Offset, int32 Size)
+				{
+					for (int32 Index = 0; Index < Size; ++Index)
+					{
+						if (NewElements[Offset + Index] != Handle)
+						{
+							++NumErrors;
+							break;
+						}
+					}
+				});
+
+			// 紧凑排列后最多只剩末尾一个空闲范围
+			if (Allocator.GetNumFreeRanges() > 1)
+			{
+				++NumErrors;
+			}
+			++NumCompactions;
+		}
+
+		MaxFreeRanges = FMath::Max(MaxFreeRanges, Allocator.GetNumFreeRanges());
+		if (Operation % 100 == 0 || Operation == InNumOperations - 1)
+		{
+			NumErrors += ValidateLayout(Allocator);
+		}
+	}
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("共享缓冲区分配器测试: %d 次操作, 剩余 %d 个分配, 容量 %d 个元素 (使用率 %.1f%%), 最多 %d 个空闲范围, 紧凑排列 %d 次 (拷贝 %d 个元素), 校验失败 %d 次"),
+		InNumOperations, Allocator.GetNumAllocations(), Allocator.GetCapacity(),
+		100.0 * Allocator.GetNumUsedElements() / FMath::Max(Allocator.GetCapacity(), 1), MaxFreeRanges, NumCompactions, NumMovedElements, NumErrors);
+
+	return NumErrors;
+}
+
+int32 ASurfaceLineTestActor::RunArenaBufferTest(int32 InNumAllocations, int32 InRandomSeed)
+{
+	if (InNumAllocations <= 0)
+	{
+		return 0;
+	}
+
+	// 测试期间不限制上传预算并开启整理，整理在一次调用内完成
+	const int32 OldBudgetKB = SurfaceLineTestActor::OverrideConsoleVariable(TEXT("r.SurfaceDrawer.UploadBudgetKB"), 0);
+	const int32 OldDefragment = SurfaceLineTestActor::OverrideConsoleVariable(TEXT("r.SurfaceDrawer.ArenaDefragment"), 1);
+
+	int32 NumErrors = 0;
+	int32 NumGrowths = 0;
+	int32 CapacityBeforeDefrag = 0;
+	int32 CapacityAfterDefrag = 0;
+	ENQUEUE_RENDER_COMMAND(SurfaceLineArenaBufferTest)(
+		[InNumAllocations, InRandomSeed, &NumErrors, &NumGrowths, &CapacityBeforeDefrag, &CapacityAfterDefrag](FRHICommandListImmediate& RHICmdList)
+		{
+			FRandomStream RandomStream(InRandomSeed);
+			FSurfaceBufferArena Arena(TEXT("SurfaceArenaBufferTest"), sizeof(uint32));
+
+			// 每个元素写入不重复的值，分配的内容按句柄记录
+			TMap<int32, TArray<uint32>> Contents;
+			uint32 NextValue = 1;
+			auto MakeContent = [&NextValue](TArray<uint32>& OutData, int32 InNum)
+			{
+				OutData.SetNumUninitialized(InNum);
+				for (uint32& Value : OutData)
+				{
+					Value = NextValue++;
+				}
+			};
+			auto FreeRandomAllocation = [&RandomStream, &Contents, &Arena]()
+			{
+				TArray<int32> Handles;
+				Contents.GenerateKeyArray(Handles);
+				int32 Handle = Handles[RandomStream.RandHelper(Handles.Num())];
+				Contents.Remove(Handle);
+				Arena.Free(Handle);
+			};
+
+			// 1. 随机分配并上传，期间释放一部分留下空洞；容量多次翻倍，扩容只拷贝仍然有效的分配
+			{
+				FRDGBuilder GraphBuilder(RHICmdList);
+				for (int32 Index = 0; Index < InNumAllocations; ++Index)
+				{
+					const int32 PrevCapacity = Arena.GetAllocator().GetCapacity();
+					const int32 NumElements = 1 + RandomStream.RandHelper(1 << RandomStream.RandRange(2, 10));
+					const int32 Handle = Arena.Allocate(NumElements);
+					TArray<uint32>& Data = Contents.Add(Handle);
+					MakeContent(Data, NumElements);
+					Arena.Upload(GraphBuilder, Handle, 0, Data.GetData(), NumElements);
+					NumGrowths += Arena.GetAllocator().GetCapacity() != PrevCapacity ? 1 : 0;
+
+					if (Contents.Num() > 1 && RandomStream.FRand() < 0.4f)
+					{
+						FreeRandomAllocation();
+					}
+				}
+
+				// 一部分分配经UploadDirtyRanges扩大一倍：原有元素经临时缓冲区搬到新的分配，只写入第一个元素和新增的元素
+				TArray<int32> Handles;
+				Contents.GenerateKeyArray(Handles);
+				for (int32 Index = 0; Index < FMath::Min(Handles.Num(), 8); ++Index)
+				{
+					int32 Handle = Handles[Index];
+					TArray<uint32> Data = Contents.FindAndRemoveChecked(Handle);
+					const int32 NumOldElements = Data.Num();
+					TArray<uint32> Appended;
+					MakeContent(Appended, NumOldElements);
+					Data.Append(Appended);
+					Data[0] = NextValue++;
+
+					FSurfaceDirtyRanges DirtyRanges;
+					DirtyRanges.Add(0, 1);
+					DirtyRanges.Add(NumOldElements, NumOldElements);
+					Arena.UploadDirtyRanges(GraphBuilder, Handle, Data.GetData(), Data.Num(), NumOldElements, DirtyRanges);
+					Contents.Add(Handle, MoveTemp(Data));
+				}
+
+				NumErrors += SurfaceLineTestActor::VerifyArenaContents(RHICmdList, GraphBuilder, Arena, Contents);
+			}
+
+			// 2. 释放大部分分配直到值得整理，整理后偏移变化，回读内容应与整理前一致
+			while (Contents.Num() > 1 && !Arena.GetAllocator().ShouldCompact())
+			{
+				FreeRandomAllocation();
+			}
+			CapacityBeforeDefrag = Arena.GetAllocator().GetCapacity();
+			{
+				FRDGBuilder GraphBuilder(RHICmdList);
+				if (!Arena.Defragment(GraphBuilder) || Arena.IsDefragmenting() || Arena.GetAllocator().GetNumFreeRanges() > 1)
+				{
+					++NumErrors;
+				}
+				NumErrors += SurfaceLineTestActor::VerifyArenaContents(RHICmdList, GraphBuilder, Arena, Contents);
+			}
+			CapacityAfterDefrag = Arena.GetAllocator().GetCapacity();
+
+			// 3. 整理后分配并释放同样多的元素，不应扩容，也不应再次触发整理
+			const int32 NumFreeElements = CapacityAfterDefrag - Arena.GetAllocator().GetNumUsedElements();
+			int32 Handle = Arena.Allocate(NumFreeElements);
+			if (Arena.GetAllocator().GetCapacity() != CapacityAfterDefrag)
+			{
+				++NumErrors;
+			}
+			Arena.Free(Handle);
+			if (Arena.GetAllocator().ShouldCompact())
+			{
+				++NumErrors;
+			}
+
+			Arena.Release();
+		});
+	FlushRenderingCommands();
+
+	SurfaceLineTestActor::OverrideConsoleVariable(TEXT("r.SurfaceDrawer.UploadBudgetKB"), OldBudgetKB);
+	SurfaceLineTestActor::OverrideConsoleVariable(TEXT("r.SurfaceDrawer.ArenaDefragment"), OldDefragment);
+
+	UE_LOG(LogSurfaceLineTestActor, Log, TEXT("共享缓冲区回读测试: %d 次分配, 扩容 %d 次, 整理前容量 %d 个元素, 整理后 %d 个元素, 校验失败 %d 次"),
+		InNumAllocations, NumGrowths, CapacityBeforeDefrag, CapacityAfterDefrag, NumErrors);
+
+	return NumErrors;
+}
+
+void ASurfaceLineTestActor::GetCoverageCacheCounters(int64& OutNumHits, int64& OutNumMisses, bool bInReset)
+{
+	OutNumHits = static_cast<int64>(FSurfaceCoverageCache::GetNumHits());
+	OutNumMisses = static_cast<int64>(FSurfaceCoverageCache::GetNumMisses());
+	if (bInReset)
+	{
+		FSurfaceCoverageCache::ResetCounters();
+	}
+}
+
+void ASurfaceLineTestActor::GetUploadStats(float& OutLastUploadMs, int32& OutLastUploadFrames, int64& OutLastFrameUploadBytes)
+{
+	OutLastUploadMs = static_cast<float>(FSurfaceBufferUpload::GetLastUploadSeconds() * 1000.0);
+	OutLastUploadFrames = static_cast<int32>(FSurfaceBufferUpload::GetLastUploadFrames());
+	OutLastFrameUploadBytes = static_cast<int64>(FSurfaceBufferUpload::GetLastFrameUploadBytes());
+}
+
+void ASurfaceLineTestActor::GetArenaStats(int64& OutCapacityBytes, int64& OutUsedBytes, int32& OutNumDefragments)
+{
+	OutCapacityBytes = FSurfaceBufferArena::GetTotalCapacityBytes();
+	OutUsedBytes = FSurfaceBufferArena::GetTotalUsedBytes();
+	OutNumDefragments = static_cast<int32>(FSurfaceBufferArena::GetNumDefragments());
+}
@@ -0,0 +1,258 @@
+﻿#include "SurfaceDrawer/SurfacePointComponent.h"
+
+#include "SurfaceDrawer/SurfacePointBuilder.h"
+#include "SurfaceDrawer/SurfacePointQuery.h"
+#include "SurfaceDrawer/SurfacePointRenderer.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfacePointComponent, Log, All);
+
+USurfacePointComponent::USurfacePointComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	IsAsyncBuilding.store(false);
+
+	// 初始化点渲染默认参数
+	Opacity = 1.0f;
+	bUsePixelUnit = false;
+	NumIconSlots = 1;
+	GridCellSize = 0.0f;
+	bBuffersInitialized = false;
+}
+
+void USurfacePointComponent::SetPoints(const TArray<FSurfacePoint>& InPoints)
+{
+	AsyncBuildGridData(InPoints);
+}
+
+void USurfacePointComponent::ClearPoints()
+{
+	AsyncBuildGridData(TArray<FSurfacePoint>());
+}
+
+void USurfacePointComponent::SetOpacity(float InOpacity)
+{
+	Opacity = InOpacity;
+
+	MarkRenderStateDirty();
+}
+
+void USurfacePointComponent::SetIconTexture(UTexture2D* InIconTexture, int32 InNumIconSlots)
+{
+	IconTexture = InIconTexture;
+	NumIconSlots = FMath::Max(InNumIconSlots, 1);
+
+	MarkRenderStateDirty();
+}
+
+void USurfacePointComponent::SetUsePixelUnit(bool bInUsePixelUnit)
+{
+	if (bUsePixelUnit == bInUsePixelUnit)
+	{
+		return;
+	}
+
+	bUsePixelUnit = bInUsePixelUnit;
+	MarkRenderStateDirty();
+
+	// 世界单位下单元边长不小于最大半径，切换后必须重建网格；网格数据保存了全部点，按输入顺序还原即可
+	TSharedPtr<const FGPUPointData> LocalGPUPointData = GPUPointData;
+	if (!LocalGPUPointData.IsValid())
+	{
+		return;
+	}
+
+	LaunchAsyncBuild(
+		[LocalGPUPointData](TArray<FSurfacePoint>& OutPoints)
+		{
+			OutPoints.SetNum(LocalGPUPointData->Points.Num());
+			for (int32 Slot = 0; Slot < LocalGPUPointData->Points.Num(); ++Slot)
+			{
+				const FGPUSurfacePoint& GPUPoint = LocalGPUPointData->Points[Slot];
+				FSurfacePoint& Point = OutPoints[LocalGPUPointData->SourceIndices[Slot]];
+				Point.Location = FVector(GPUPoint.Position.X, GPUPoint.Position.Y, 0.0);
+				Point.Radius = GPUPoint.Radius;
+				Point.Color = FLinearColor(GPUPoint.Color.X, GPUPoint.Color.Y, GPUPoint.Color.Z, GPUPoint.Color.W);
+				Point.IconSlot = GPUPoint.IconSlot;
+			}
+		});
+}
+
+int32 USurfacePointComponent::QueryPointsInRadius(const FVector& InLocation, float InRadius, TArray<FSurfacePointHit>& OutHits, bool bIncludePointRadius) const
+{
+	// 持有一份引用，避免查询期间被异步构建替换
+	TSharedPtr<const FGPUPointData> LocalGPUPointData = GPUPointData;
+	if (!LocalGPUPointData.IsValid())
+	{
+		OutHits.Reset();
+		return 0;
+	}
+
+	return FSurfacePointQuery::QueryPointsInRadius(*LocalGPUPointData, FVector2f(InLocation.X, InLocation.Y), InRadius, OutHits, bIncludePointRadius);
+}
+
+bool USurfacePointComponent::QueryNearestPoint(const FVector& InLocation, float InMaxDistance, FSurfacePointHit& OutHit) const
+{
+	TSharedPtr<const FGPUPointData> LocalGPUPointData = GPUPointData;
+	if (!LocalGPUPointData.IsValid())
+	{
+		OutHit = FSurfacePointHit();
+		return false;
+	}
+
+	return FSurfacePointQuery::QueryNearestPoint(*LocalGPUPointData, FVector2f(InLocation.X, InLocation.Y), InMaxDistance, OutHit);
+}
+
+void USurfacePointComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	CreateSceneProxy();
+
+	// Game 或者 PIE模式下注册代理
+	UWorld* World = GetWorld();
+	if (World && (World->WorldType == EWorldType::Game || World->WorldType == EWorldType::PIE))
+	{
+		FSurfacePointRenderManager::Get()->RegisterSceneProxy(SceneProxy);
+	}
+}
+
+void USurfacePointComponent::OnUnregister()
+{
+	FSurfacePointRenderManager::Get()->UnregisterSceneProxy(SceneProxy->GetProxyId());
+	DestroySceneProxy();
+
+	Super::OnUnregister();
+}
+
+void USurfacePointComponent::CreateRenderState_Concurrent(FRegisterComponentContext* Context)
+{
+	Super::CreateRenderState_Concurrent(Context);
+
+	if (SceneProxy.IsValid())
+	{
+		UpdateSceneProxy();
+	}
+}
+
+void USurfacePointComponent::DestroyRenderState_Concurrent()
+{
+	Super::DestroyRenderState_Concurrent();
+}
+
+bool USurfacePointComponent::ShouldCreateRenderState() const
+{
+	return true;
+}
+
+void USurfacePointComponent::AsyncBuildGridData(const TArray<FSurfacePoint>& InPoints)
+{
+	if (InPoints.Num() == 0)
+	{
+		GPUPointData.Reset();
+
+		MarkGeometryDataDirty();
+		MarkRenderStateDirty();
+		return;
+	}
+
+	LaunchAsyncBuild(
+		[Points = InPoints](TArray<FSurfacePoint>& OutPoints) mutable
+		{
+			OutPoints = MoveTemp(Points);
+		});
+}
+
+void USurfacePointComponent::LaunchAsyncBuild(TUniqueFunction<void(TArray<FSurfacePoint>&)>&& InGatherPoints)
+{
+	if (IsAsyncBuilding.load())
+	{
+		UE_LOG(LogSurfacePointComponent, Warning, TEXT("正在进行上一次的AsyncBuildGridData请求，跳过构建"));
+		return;
+	}
+
+	IsAsyncBuilding.store(true);
+
+	TWeakObjectPtr<USurfacePointComponent> WeakThis(this);
+
+	AsyncTask(ENamedThreads::AnyThread,
+		[WeakThis, GatherPoints = MoveTemp(InGatherPoints), bRadiusInWorldUnits = !bUsePixelUnit, CellSize = GridCellSize]() mutable
+		{
+			TArray<FSurfacePoint> Points;
+			GatherPoints(Points);
+
+			TSharedPtr<FGPUPointData> NewGPUPointData = MakeShared<FGPUPointData>();
+			FSurfacePointGridBuilder::Build(Points, *NewGPUPointData, bRadiusInWorldUnits, CellSize);
+
+			// 查询和场景代理更新都在游戏线程读取，构建结果回到游戏线程再替换
+			AsyncTask(ENamedThreads::GameThread,
+				[WeakThis, NewGPUPointData]()
+				{
+					if (!WeakThis.IsValid())
+					{
+						UE_LOG(LogSurfacePointComponent, Warning, TEXT("组件已销毁，取消AsyncBuildGridData"));
+						return;
+					}
+
+					WeakThis->GPUPointData = NewGPUPointData;
+					WeakThis->MarkRenderStateDirty();
+					WeakThis->MarkGeometryDataDirty();
+
+					WeakThis->IsAsyncBuilding.store(false);
+				});
+		}
+	);
+}
+
+void USurfacePointComponent::CreateSceneProxy()
+{
+	check(IsInGameThread());
+
+	SceneProxy = MakeShared<FSurfacePointSceneProxy>(
+		GPUPointData,
+		IconTexture,
+		bUsePixelUnit);
+}
+
+void USurfacePointComponent::UpdateSceneProxy()
+{
+	if (SceneProxy.IsValid())
+	{
+		// 渲染线程更新参数
+		ENQUEUE_RENDER_COMMAND(UpdateSurfacePointSceneProxyCommand)(
+			[SceneProxyCopy = SceneProxy,
+			GPUPointDataCopy = GPUPointData,
+			IconTextureCopy = IconTexture,
+			NumIconSlotsCopy = NumIconSlots,
+			OpacityCopy = Opacity,
+			bUsePixelUnitCopy = bUsePixelUnit,
+			bBuffersInitializedCopy = bBuffersInitialized](FRHICommandList& RHICmdList)
+			{
+				if (SceneProxyCopy.IsValid())
+				{
+					SceneProxyCopy->UpdateParameters_RenderThread(
+						GPUPointDataCopy,
+						IconTextureCopy,
+						NumIconSlotsCopy,
+						OpacityCopy,
+						bUsePixelUnitCopy,
+						bBuffersInitializedCopy);
+				}
+			});
+		bBuffersInitialized = true;
+	}
+}
+
+void USurfacePointComponent::DestroySceneProxy()
+{
+	if (SceneProxy.IsValid())
+	{
+		SceneProxy.Reset();
+	}
+}
+
+void USurfacePointComponent::MarkGeometryDataDirty()
+{
+	bBuffersInitialized = false;
+}
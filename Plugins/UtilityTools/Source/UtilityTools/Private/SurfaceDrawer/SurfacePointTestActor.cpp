@@ -0,0 +1,112 @@
+﻿#include "SurfaceDrawer/SurfacePointTestActor.h"
+
+#include "SurfaceDrawer/SurfacePointBuilder.h"
+#include "SurfaceDrawer/SurfacePointQuery.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogSurfacePointTestActor, Log, All);
+
+ASurfacePointTestActor::ASurfacePointTestActor()
+	: RadiusRange(500.0, 2000.0)
+	, NumIconSlots(0)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// 创建根组件
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
+
+	// 创建SurfacePoint组件
+	SurfacePointComponent = CreateDefaultSubobject<USurfacePointComponent>(TEXT("SurfacePointComponent"));
+}
+
+void ASurfacePointTestActor::SpawnRandomPoints(int32 InNumPoints, float InExtent, int32 InRandomSeed)
+{
+	if (!SurfacePointComponent || InNumPoints <= 0)
+	{
+		return;
+	}
+
+	const FVector Center = GetActorLocation();
+	FRandomStream RandomStream(InRandomSeed);
+
+	Points.SetNum(InNumPoints);
+	for (FSurfacePoint& Point : Points)
+	{
+		Point.Location = Center + FVector(RandomStream.FRandRange(-0.5f, 0.5f) * InExtent, RandomStream.FRandRange(-0.5f, 0.5f) * InExtent, 0.0);
+		Point.Radius = RandomStream.FRandRange(RadiusRange.X, RadiusRange.Y);
+		Point.Color = FLinearColor::MakeRandomSeededColor(RandomStream.RandHelper(MAX_int32));
+		Point.IconSlot = NumIconSlots > 0 ? RandomStream.RandHelper(NumIconSlots) : -1;
+	}
+
+	SurfacePointComponent->SetPoints(Points);
+}
+
+int32 ASurfacePointTestActor::RunRadiusQueryBenchmark(int32 InNumQueries, float InRadius, int32 InRandomSeed)
+{
+	TSharedPtr<const FGPUPointData> GPUData = SurfacePointComponent ? SurfacePointComponent->GetGPUPointData() : nullptr;
+	if (!GPUData.IsValid() || !GPUData->IsValid() || GPUData->Points.Num() != Points.Num() || InNumQueries <= 0)
+	{
+		UE_LOG(LogSurfacePointTestActor, Warning, TEXT("点网格未构建或与生成的点不一致，跳过半径查询基准测试"));
+		return 0;
+	}
+
+	// 在网格范围内生成随机查询位置
+	const FVector2f Min = GPUData->GridOrigin;
+	const FVector2f Size = FVector2f(GPUData->GridSize) * GPUData->CellSize;
+	FRandomStream RandomStream(InRandomSeed);
+	TArray<FVector2f> Locations;
+	Locations.SetNumUninitialized(InNumQueries);
+	for (FVector2f& Location : Locations)
+	{
+		Location = Min + FVector2f(RandomStream.FRand() * Size.X, RandomStream.FRand() * Size.Y);
+	}
+
+	// 暴力遍历
+	TArray<TArray<int32>> BruteForceResults;
+	BruteForceResults.SetNum(InNumQueries);
+	uint32 StartCycles = FPlatformTime::Cycles();
+	for (int32 QueryIndex = 0; QueryIndex < InNumQueries; ++QueryIndex)
+	{
+		for (int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex)
+		{
+			const FVector2f Position(Points[PointIndex].Location.X, Points[PointIndex].Location.Y);
+			if (FVector2f::DistSquared(Position, Locations[QueryIndex]) <= InRadius * InRadius)
+			{
+				BruteForceResults[QueryIndex].Add(PointIndex);
+			}
+		}
+	}
+	const double BruteForceMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	// 网格查询
+	TArray<TArray<int32>> GridResults;
+	GridResults.SetNum(InNumQueries);
+	TArray<FSurfacePointHit> Hits;
+	int32 NumHits = 0;
+	StartCycles = FPlatformTime::Cycles();
+	for (int32 QueryIndex = 0; QueryIndex < InNumQueries; ++QueryIndex)
+	{
+		FSurfacePointQuery::QueryPointsInRadius(*GPUData, Locations[QueryIndex], InRadius, Hits);
+		for (const FSurfacePointHit& Hit : Hits)
+		{
+			GridResults[QueryIndex].Add(Hit.PointIndex);
+		}
+		NumHits += Hits.Num();
+	}
+	const double GridMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	int32 NumMismatches = 0;
+	for (int32 QueryIndex = 0; QueryIndex < InNumQueries; ++QueryIndex)
+	{
+		GridResults[QueryIndex].Sort();
+		if (GridResults[QueryIndex] != BruteForceResults[QueryIndex])
+		{
+			++NumMismatches;
+		}
+	}
+
+	UE_LOG(LogSurfacePointTestActor, Log, TEXT("半径查询基准测试: %d 个点, %d 次查询, 半径 %.1f, 平均命中 %.1f 个, 暴力遍历 %.3f ms, 网格查询 %.3f ms, 不一致 %d 次"),
+		Points.Num(), InNumQueries, InRadius, float(NumHits) / InNumQueries, BruteForceMs, GridMs, NumMismatches);
+
+	return NumMismatches;
+}
@@ -1,11 +1,22 @@
 ﻿#include "SurfaceDrawer/SurfacePolygonComponent.h"
 
+#include "SurfaceDrawer/SurfaceGeoJsonImporter.h"
 #include "SurfaceDrawer/SurfacePolygonBuilder.h"
+#include "SurfaceDrawer/SurfacePolygonIdPicker.h"
+#include "SurfaceDrawer/SurfacePolygonPrism.h"
+#include "SurfaceDrawer/SurfacePolygonQuery.h"
 #include "SurfaceDrawer/SurfacePolygonRenderer.h"
+#include "SurfaceDrawer/SurfacePolygonUnion.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogSurfacePolygonComponent, Log, All);
 
+namespace SurfacePolygonComponent
+{
+	// 网格尚未构建完成时允许指定图层的最大多边形数量，避免误传的大索引分配大量内存
+	static constexpr int32 MaxPolygonsWithoutMesh = 1 << 24;
+}
+
 USurfacePolygonComponent::USurfacePolygonComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
@@ -16,11 +27,89 @@ USurfacePolygonComponent::USurfacePolygonComponent()
 	Opacity = 0.5f;
 	Color = FLinearColor::Green;
 	bBuffersInitialized = false;
+
+	VisibleLayers = ~0u;
+	bLayerMasksDirty = true;
+	bLayerBuffersInitialized = false;
+
+	RenderMode = ESurfacePolygonRenderMode::FullscreenBVH;
+	PrismHeightRange = FVector2D(-100000.0, 100000.0);
+	bPrismBuffersInitialized = false;
+
+	bEnablePolygonPicking = false;
+	bUnionOverlappingPolygons = false;
+	NumInputPolygons = 0;
 }
 
 void USurfacePolygonComponent::SetTriangles(const TArray<FTriangle>& InTriangles)
 {
-	AsyncBuildBVHData(InTriangles);
+	TSharedRef<FPolygonMeshData> NewMeshData = MakeShared<FPolygonMeshData>();
+	NewMeshData->AppendTriangles(InTriangles);
+
+	AsyncBuildBVHData(NewMeshData);
+}
+
+void USurfacePolygonComponent::SetIndexedMesh(TArray<FVector3f>&& InVertices, TArray<uint32>&& InIndices, TArray<int32>&& InPolygonIds)
+{
+	AsyncBuildBVHData(MakeShared<FPolygonMeshData>(MoveTemp(InVertices), MoveTemp(InIndices), MoveTemp(InPolygonIds)));
+}
+
+void USurfacePolygonComponent::SetIndexedMesh(TConstArrayView<FVector3f> InVertices, TConstArrayView<uint32> InIndices, TConstArrayView<int32> InPolygonIds)
+{
+	TSharedRef<FPolygonMeshData> NewMeshData = MakeShared<FPolygonMeshData>();
+	NewMeshData->Vertices = InVertices;
+	NewMeshData->Indices = InIndices;
+	NewMeshData->PolygonIds = InPolygonIds;
+
+	AsyncBuildBVHData(NewMeshData);
+}
+
+void USurfacePolygonComponent::SetIndexedMesh(const TSharedRef<const FPolygonMeshData>& InMeshData)
+{
+	AsyncBuildBVHData(InMeshData);
+}
+
+void USurfacePolygonComponent::LoadGeoJson(const FString& InFilePath, const FVector2D& InOrigin, bool bInProjectedMeters, float InUnitsPerMeter)
+{
+	FGeoJsonImportOptions Options;
+	Options.Projection = FGeoJsonProjection(InOrigin, InUnitsPerMeter, bInProjectedMeters);
+	Options.bImportLines = false;
+	Options.bImportPolygonOutlines = false;
+
+	TWeakObjectPtr<USurfacePolygonComponent> WeakThis(this);
+
+	AsyncTask(ENamedThreads::AnyThread,
+		[WeakThis, FilePath = InFilePath, Options]()
+		{
+			// 逐批三角化后追加，要素不会跨批次，每批的环在三角化后即释放
+			TSharedRef<FPolygonMeshData> NewMeshData = MakeShared<FPolygonMeshData>();
+			FPolygonMeshData BatchMeshData;
+			const bool bImported = FSurfaceGeoJsonImporter::ImportFile(FilePath, Options,
+				[&NewMeshData, &BatchMeshData](FGeoJsonFeatureBatch& InBatch)
+				{
+					FPolygonUnionBuilder::TriangulateRings(InBatch.Rings.Vertices, InBatch.Rings.PolygonOffsets, InBatch.RingFeatureIndices, 0.f, BatchMeshData);
+					NewMeshData->AppendMesh(BatchMeshData);
+				});
+
+			// 构建参数在游戏线程读取
+			AsyncTask(ENamedThreads::GameThread,
+				[WeakThis, FilePath, bImported, NewMeshData]()
+				{
+					if (!WeakThis.IsValid())
+					{
+						return;
+					}
+
+					// 读取失败或没有可三角化的面时保留现有网格
+					if (!bImported || NewMeshData->NumTriangles() == 0)
+					{
+						UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("GeoJSON导入失败或没有有效多边形，保留现有网格: %s"), *FilePath);
+						return;
+					}
+
+					WeakThis->SetIndexedMesh(NewMeshData);
+				});
+		});
 }
 
 void USurfacePolygonComponent::SetProperties(float InOpacity, const FLinearColor& InColor)
@@ -45,13 +134,185 @@ void USurfacePolygonComponent::SetColor(const FLinearColor& InColor)
 	MarkRenderStateDirty();
 }
 
+void USurfacePolygonComponent::SetRenderMode(ESurfacePolygonRenderMode InRenderMode)
+{
+	if (RenderMode == InRenderMode)
+	{
+		return;
+	}
+
+	RenderMode = InRenderMode;
+
+	if (RenderMode == ESurfacePolygonRenderMode::StencilVolume && !PrismMesh.IsValid())
+	{
+		AsyncBuildPrismMesh();
+	}
+
+	MarkRenderStateDirty();
+}
+
+void USurfacePolygonComponent::SetPrismHeightRange(const FVector2D& InPrismHeightRange)
+{
+	PrismHeightRange = InPrismHeightRange;
+
+	// 非模板阴影体模式下只清除旧棱柱，切换模式时再生成
+	PrismMesh.Reset();
+	MarkPrismDataDirty();
+
+	if (RenderMode == ESurfacePolygonRenderMode::StencilVolume)
+	{
+		AsyncBuildPrismMesh();
+	}
+
+	MarkRenderStateDirty();
+}
+
 void USurfacePolygonComponent::ClearTriangles()
 {
-	AsyncBuildBVHData(TArray<FTriangle>());
+	AsyncBuildBVHData(nullptr);
 
 	MarkGeometryDataDirty();
 }
 
+void USurfacePolygonComponent::SetUnionOverlappingPolygons(bool bInUnionOverlappingPolygons)
+{
+	if (bUnionOverlappingPolygons == bInUnionOverlappingPolygons)
+	{
+		return;
+	}
+
+	bUnionOverlappingPolygons = bInUnionOverlappingPolygons;
+
+	// MeshData始终是用户输入，关闭并集时即可恢复原始网格；正在构建时由构建完成后按当前开关重新构建
+	if (MeshData.IsValid() && !IsAsyncBuilding.load())
+	{
+		AsyncBuildBVHData(MeshData);
+	}
+}
+
+int32 USurfacePolygonComponent::GetNumInputTriangles() const
+{
+	return MeshData.IsValid() ? MeshData->NumTriangles() : 0;
+}
+
+void USurfacePolygonComponent::SetPolygonLayerMask(int32 InPolygonIndex, int32 InLayerMask)
+{
+	// 索引来自蓝图，按输入网格的多边形数量校验；构建完成前输入网格可能还会变化，只限制上限
+	const int32 MaxPolygons = (NumInputPolygons > 0 && !IsAsyncBuilding.load()) ? NumInputPolygons : SurfacePolygonComponent::MaxPolygonsWithoutMesh;
+	if (InPolygonIndex < 0 || InPolygonIndex >= MaxPolygons)
+	{
+		UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("多边形索引 %d 超出范围[0, %d)，忽略图层设置"), InPolygonIndex, MaxPolygons);
+		return;
+	}
+
+	if (!PolygonLayerMasks.IsValidIndex(InPolygonIndex))
+	{
+		const int32 OldNum = PolygonLayerMasks.Num();
+		PolygonLayerMasks.SetNumUninitialized(InPolygonIndex + 1);
+		for (int32 Index = OldNum; Index < PolygonLayerMasks.Num(); ++Index)
+		{
+			PolygonLayerMasks[Index] = DEFAULT_POLYGON_LAYER_MASK;
+		}
+	}
+
+	if (PolygonLayerMasks[InPolygonIndex] == static_cast<uint32>(InLayerMask))
+	{
+		return;
+	}
+
+	PolygonLayerMasks[InPolygonIndex] = static_cast<uint32>(InLayerMask);
+
+	// 延迟到UpdateSceneProxy统一计算，同一帧内的多次修改只计算和上传一次
+	ChangedLayerPolygons.Add(InPolygonIndex);
+	MarkRenderStateDirty();
+}
+
+void USurfacePolygonComponent::SetVisibleLayers(int32 InVisibleLayers)
+{
+	VisibleLayers = static_cast<uint32>(InVisibleLayers);
+
+	MarkRenderStateDirty();
+}
+
+void USurfacePolygonComponent::SetLayerVisible(int32 InLayer, bool bVisible)
+{
+	if (InLayer < 0 || InLayer >= 32)
+	{
+		UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("图层序号 %d 超出范围[0, 31]"), InLayer);
+		return;
+	}
+
+	const uint32 LayerBit = 1u << InLayer;
+	SetVisibleLayers(static_cast<int32>(bVisible ? (VisibleLayers | LayerBit) : (VisibleLayers & ~LayerBit)));
+}
+
+void USurfacePolygonComponent::SetPolygonPickingEnabled(bool bEnabled)
+{
+	if (bEnablePolygonPicking == bEnabled)
+	{
+		return;
+	}
+
+	bEnablePolygonPicking = bEnabled;
+
+	MarkRenderStateDirty();
+}
+
+int32 USurfacePolygonComponent::GetPolygonUnderCursor()
+{
+	return PolygonIdPicker.IsValid() ? PolygonIdPicker->PickPolygonUnderCursor(GetWorld()) : INDEX_NONE;
+}
+
+int32 USurfacePolygonComponent::QueryPolygonAtLocation(const FVector& InLocation) const
+{
+	// GPU数据只在游戏线程替换，与后台构建没有竞争
+	TSharedPtr<FGPUPolygonData> LocalGPUPolygonData = GPUPolygonData;
+	if (!LocalGPUPolygonData.IsValid())
+	{
+		return INDEX_NONE;
+	}
+
+	int32 PolygonIndex = INDEX_NONE;
+	TSharedPtr<const FPolygonLayerMasks> LocalLayerMasks = LayerMasks;
+	if (LocalLayerMasks.IsValid())
+	{
+		FPolygonBVHQuery::QueryPoint(*LocalGPUPolygonData, *LocalLayerMasks, VisibleLayers, FVector2f(InLocation.X, InLocation.Y), PolygonIndex);
+	}
+	else
+	{
+		FPolygonBVHQuery::QueryPoint(*LocalGPUPolygonData, FVector2f(InLocation.X, InLocation.Y), PolygonIndex);
+	}
+
+	return PolygonIndex;
+}
+
+void USurfacePolygonComponent::QueryPolygonsAtLocations(const TArray<FVector>& InLocations, TArray<int32>& OutPolygonIndices) const
+{
+	TSharedPtr<FGPUPolygonData> LocalGPUPolygonData = GPUPolygonData;
+	if (!LocalGPUPolygonData.IsValid())
+	{
+		OutPolygonIndices.Init(INDEX_NONE, InLocations.Num());
+		return;
+	}
+
+	TArray<FVector2f> Points;
+	Points.SetNumUninitialized(InLocations.Num());
+	for (int32 Index = 0; Index < InLocations.Num(); ++Index)
+	{
+		Points[Index] = FVector2f(InLocations[Index].X, InLocations[Index].Y);
+	}
+
+	TSharedPtr<const FPolygonLayerMasks> LocalLayerMasks = LayerMasks;
+	if (LocalLayerMasks.IsValid())
+	{
+		FPolygonBVHQuery::QueryPoints(*LocalGPUPolygonData, *LocalLayerMasks, VisibleLayers, Points, OutPolygonIndices);
+	}
+	else
+	{
+		FPolygonBVHQuery::QueryPoints(*LocalGPUPolygonData, Points, OutPolygonIndices);
+	}
+}
+
 void USurfacePolygonComponent::OnRegister()
 {
 	Super::OnRegister();
@@ -96,12 +357,17 @@ bool USurfacePolygonComponent::ShouldCreateRenderState() const
 	return true;
 }
 
-void USurfacePolygonComponent::AsyncBuildBVHData(const TArray<FTriangle>& InTriangles)
+void USurfacePolygonComponent::AsyncBuildBVHData(const TSharedPtr<const FPolygonMeshData>& InMeshData)
 {
-	if (InTriangles.Num() == 0)
+	if (!InMeshData.IsValid() || InMeshData->NumTriangles() == 0)
 	{
 		UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("Triangles为空，跳过构建"));
+		MeshData.Reset();
+		UnionMeshData.Reset();
 		GPUPolygonData.Reset();
+		NumInputPolygons = 0;
+		PrismMesh.Reset();
+		MarkPrismDataDirty();
 
 		MarkGeometryDataDirty();
 		return;
@@ -117,28 +383,127 @@ void USurfacePolygonComponent::AsyncBuildBVHData(const TArray<FTriangle>& InTria
 
 	TWeakObjectPtr<USurfacePolygonComponent> WeakThis(this);
 
+	// 异步任务只持有网格的共享引用，不复制三角形数据
+	MeshData = InMeshData;
+	TSharedRef<const FPolygonMeshData> InputMeshData = InMeshData.ToSharedRef();
+	const FBVHBuildConfig BuildConfig = BVHBuildConfig;
+	const bool bBuildPrismMesh = RenderMode == ESurfacePolygonRenderMode::StencilVolume;
+	const FVector2D LocalPrismHeightRange = PrismHeightRange;
+	const bool bBuildUnion = bUnionOverlappingPolygons;
+	TArray<uint32> LocalPolygonLayerMasks = bBuildUnion ? PolygonLayerMasks : TArray<uint32>();
+
 	AsyncTask(ENamedThreads::AnyThread,
-		[WeakThis, InTriangles]()
+		[WeakThis, InputMeshData, BuildConfig, bBuildPrismMesh, LocalPrismHeightRange, bBuildUnion, LocalPolygonLayerMasks = MoveTemp(LocalPolygonLayerMasks)]()
 		{
-			TSharedPtr<FPolygonBVHBuilder> NewPolygonBVHBuilder = MakeShared<FPolygonBVHBuilder>(InTriangles, WeakThis->BVHBuildConfig);
+			// 按图层求并集，之后的BVH和棱柱都基于合并后的网格
+			TSharedRef<const FPolygonMeshData> LocalMeshData = InputMeshData;
+			if (bBuildUnion)
+			{
+				TSharedRef<FPolygonMeshData> UnionMeshData = MakeShared<FPolygonMeshData>();
+				if (FPolygonUnionBuilder::BuildUnion(*InputMeshData, LocalPolygonLayerMasks, DEFAULT_POLYGON_LAYER_MASK, *UnionMeshData))
+				{
+					LocalMeshData = UnionMeshData;
+				}
+				else
+				{
+					UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("多边形并集结果为空，使用原始网格"));
+				}
+			}
+
+			TSharedPtr<FPolygonBVHBuilder> NewPolygonBVHBuilder = MakeShared<FPolygonBVHBuilder>(LocalMeshData, BuildConfig);
 			NewPolygonBVHBuilder->Build();
 
-			if (!WeakThis.IsValid())
+			// 模板阴影体模式同时生成棱柱网格，否则等切换模式时再生成
+			TSharedPtr<FPolygonPrismMesh> NewPrismMesh;
+			if (bBuildPrismMesh)
 			{
-				UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("组件已销毁，取消AsyncBuildBVHData"));
-				return;
+				NewPrismMesh = MakeShared<FPolygonPrismMesh>();
+				FPolygonPrismBuilder::BuildPrismMesh(*LocalMeshData, LocalPrismHeightRange.X, LocalPrismHeightRange.Y, *NewPrismMesh);
 			}
 
-			NewPolygonBVHBuilder->GetStats(WeakThis->BVHStats);
+			FBVHStats NewBVHStats;
+			NewPolygonBVHBuilder->GetStats(NewBVHStats);
+
+			// 输入网格的多边形数量，游戏线程据此校验SetPolygonLayerMask的索引
+			int32 NewNumInputPolygons = 0;
+			for (const int32 PolygonId : InputMeshData->PolygonIds)
+			{
+				NewNumInputPolygons = FMath::Max(NewNumInputPolygons, PolygonId + 1);
+			}
 
 			// 转换为GPU数据
 			TSharedPtr<FGPUPolygonData> NewGPUPolygonData = MakeShared<FGPUPolygonData>();
 			FPolygonGPUConverter::ConvertToGPUData(*NewPolygonBVHBuilder, *NewGPUPolygonData);
-			WeakThis->GPUPolygonData = NewGPUPolygonData;
-			WeakThis->MarkGeometryDataDirty();
-			WeakThis->MarkRenderStateDirty();
 
-			WeakThis->IsAsyncBuilding.store(false);
+			// 查询和场景代理更新都在游戏线程读取，构建结果回到游戏线程再替换
+			AsyncTask(ENamedThreads::GameThread,
+				[WeakThis, InputMeshData, LocalMeshData, bBuildUnion, NewBVHStats, NewNumInputPolygons, NewGPUPolygonData, NewPrismMesh]()
+				{
+					if (!WeakThis.IsValid())
+					{
+						UE_LOG(LogSurfacePolygonComponent, Warning, TEXT("组件已销毁，取消AsyncBuildBVHData"));
+						return;
+					}
+
+					WeakThis->BVHStats = NewBVHStats;
+
+					// MeshData保留用户输入，合并后的网格单独保存，切换渲染模式时用于生成棱柱
+					WeakThis->UnionMeshData.Reset();
+					if (&LocalMeshData.Get() != &InputMeshData.Get() && WeakThis->MeshData.Get() == &InputMeshData.Get())
+					{
+						WeakThis->UnionMeshData = LocalMeshData;
+					}
+
+					WeakThis->GPUPolygonData = NewGPUPolygonData;
+					WeakThis->NumInputPolygons = NewNumInputPolygons;
+					WeakThis->PrismMesh = NewPrismMesh;
+					WeakThis->MarkGeometryDataDirty();
+					WeakThis->MarkPrismDataDirty();
+					WeakThis->MarkRenderStateDirty();
+
+					WeakThis->IsAsyncBuilding.store(false);
+
+					// 构建期间切换了并集开关，结果与开关不一致，按当前开关重新构建
+					if (WeakThis->bUnionOverlappingPolygons != bBuildUnion && WeakThis->MeshData.IsValid())
+					{
+						WeakThis->AsyncBuildBVHData(WeakThis->MeshData);
+					}
+				});
+		}
+	);
+}
+
+void USurfacePolygonComponent::AsyncBuildPrismMesh()
+{
+	TSharedPtr<const FPolygonMeshData> SourceMeshData = GetPrismSourceMeshData();
+	if (!SourceMeshData.IsValid())
+	{
+		return;
+	}
+
+	TWeakObjectPtr<USurfacePolygonComponent> WeakThis(this);
+	TSharedRef<const FPolygonMeshData> LocalMeshData = SourceMeshData.ToSharedRef();
+	const FVector2D LocalPrismHeightRange = PrismHeightRange;
+
+	AsyncTask(ENamedThreads::AnyThread,
+		[WeakThis, LocalMeshData, LocalPrismHeightRange]()
+		{
+			TSharedPtr<FPolygonPrismMesh> NewPrismMesh = MakeShared<FPolygonPrismMesh>();
+			FPolygonPrismBuilder::BuildPrismMesh(*LocalMeshData, LocalPrismHeightRange.X, LocalPrismHeightRange.Y, *NewPrismMesh);
+
+			AsyncTask(ENamedThreads::GameThread,
+				[WeakThis, LocalMeshData, NewPrismMesh]()
+				{
+					// 网格已被替换时丢弃结果
+					if (!WeakThis.IsValid() || WeakThis->GetPrismSourceMeshData().Get() != &LocalMeshData.Get())
+					{
+						return;
+					}
+
+					WeakThis->PrismMesh = NewPrismMesh;
+					WeakThis->MarkPrismDataDirty();
+					WeakThis->MarkRenderStateDirty();
+				});
 		}
 	);
 }
@@ -151,19 +516,82 @@ void USurfacePolygonComponent::CreateSceneProxy()
 		GPUPolygonData,
 		Opacity,
 		Color);
+
+	// 新代理没有图层掩码，下次更新时传入完整副本
+	bLayerBuffersInitialized = false;
 }
 
 void USurfacePolygonComponent::UpdateSceneProxy()
 {
 	if (SceneProxy.IsValid())
 	{
+		// 只修改了部分多边形的图层时原地更新游戏线程的掩码，只把值发生变化的范围暂存给渲染线程修补它自己的副本
+		if (!bLayerMasksDirty && ChangedLayerPolygons.Num() > 0)
+		{
+			FPolygonLayerMaskDirtyRanges DirtyRanges;
+			if (LayerMasks.IsValid() && GPUPolygonData.IsValid() && LayerMasks->Update(*GPUPolygonData, PolygonLayerMasks, ChangedLayerPolygons, DirtyRanges))
+			{
+				if (!DirtyRanges.IsEmpty())
+				{
+					TSharedPtr<FPolygonLayerMaskPatch> Patch = MakeShared<FPolygonLayerMaskPatch>();
+					Patch->Stage(*LayerMasks, DirtyRanges);
+					LayerMaskPatch = Patch;
+				}
+			}
+			else
+			{
+				MarkLayerMasksDirty();
+			}
+		}
+		ChangedLayerPolygons.Reset();
+
+		// 图层掩码与GPU数据一一对应，GPU数据变化或修改的多边形超出当前范围时重新计算
+		if (bLayerMasksDirty)
+		{
+			TSharedPtr<FPolygonLayerMasks> NewLayerMasks;
+			if (GPUPolygonData.IsValid())
+			{
+				NewLayerMasks = MakeShared<FPolygonLayerMasks>();
+				NewLayerMasks->Build(*GPUPolygonData, PolygonLayerMasks);
+			}
+			LayerMasks = NewLayerMasks;
+			LayerMaskPatch.Reset();
+			bLayerMasksDirty = false;
+			bLayerBuffersInitialized = false;
+		}
+
+		// 重新计算的掩码交给渲染线程一份副本，之后两边各自修补
+		TSharedPtr<FPolygonLayerMasks> RenderLayerMasks;
+		if (!bLayerBuffersInitialized && LayerMasks.IsValid())
+		{
+			RenderLayerMasks = MakeShared<FPolygonLayerMasks>(*LayerMasks);
+		}
+
+		// 拾取器随开关创建/释放，关闭时渲染线程不再输出ID纹理
+		if (bEnablePolygonPicking && !PolygonIdPicker.IsValid())
+		{
+			PolygonIdPicker = MakeShared<FSurfacePolygonIdPicker>();
+		}
+		else if (!bEnablePolygonPicking)
+		{
+			PolygonIdPicker.Reset();
+		}
+
 		// 渲染线程更新参数
 		ENQUEUE_RENDER_COMMAND(UpdateSceneProxyCommand)(
 			[SceneProxyCopy = SceneProxy,
 			GPUPolygonDataCopy = GPUPolygonData,
 			OpacityCopy = Opacity,
 			ColorCopy = Color,
-			bBuffersInitializedCopy = bBuffersInitialized](FRHICommandList& RHICmdList)
+			bBuffersInitializedCopy = bBuffersInitialized,
+			LayerMasksCopy = MoveTemp(RenderLayerMasks),
+			VisibleLayersCopy = VisibleLayers,
+			bLayerBuffersInitializedCopy = bLayerBuffersInitialized,
+			LayerMaskPatchCopy = TSharedPtr<const FPolygonLayerMaskPatch>(MoveTemp(LayerMaskPatch)),
+			PrismMeshCopy = PrismMesh,
+			RenderModeCopy = RenderMode,
+			bPrismBuffersInitializedCopy = bPrismBuffersInitialized,
+			PolygonIdPickerCopy = PolygonIdPicker](FRHICommandList& RHICmdList)
 			{
 				if (SceneProxyCopy.IsValid())
 				{
@@ -171,10 +599,22 @@ void USurfacePolygonComponent::UpdateSceneProxy()
 						GPUPolygonDataCopy,
 						OpacityCopy,
 						ColorCopy,
-						bBuffersInitializedCopy);
+						bBuffersInitializedCopy,
+						LayerMasksCopy,
+						VisibleLayersCopy,
+						bLayerBuffersInitializedCopy,
+						LayerMaskPatchCopy);
+					SceneProxyCopy->UpdatePrismParameters_RenderThread(
+						PrismMeshCopy,
+						RenderModeCopy,
+						bPrismBuffersInitializedCopy);
+					SceneProxyCopy->UpdatePickingParameters_RenderThread(PolygonIdPickerCopy);
 				}
 			});
 		bBuffersInitialized = true;
+		bLayerBuffersInitialized = true;
+		bPrismBuffersInitialized = true;
+		LayerMaskPatch.Reset();
 	}
 }
 
@@ -189,4 +629,16 @@ void USurfacePolygonComponent::DestroySceneProxy()
 void USurfacePolygonComponent::MarkGeometryDataDirty()
 {
 	bBuffersInitialized = false;
+
+	MarkLayerMasksDirty();
+}
+
+void USurfacePolygonComponent::MarkPrismDataDirty()
+{
+	bPrismBuffersInitialized = false;
+}
+
+void USurfacePolygonComponent::MarkLayerMasksDirty()
+{
+	bLayerMasksDirty = true;
 }
@@ -1,8 +1,14 @@
 ﻿#include "SurfaceDrawer/SurfacePolygonTestActor.h"
 
 #include "SurfaceDrawer/BVHConfig.h"
+#include "SurfaceDrawer/SurfaceGeofenceSubsystem.h"
+#include "SurfaceDrawer/SurfacePolygonBuilder.h"
+#include "SurfaceDrawer/SurfacePolygonPrism.h"
+#include "SurfaceDrawer/SurfacePolygonQuery.h"
+#include "SurfaceDrawer/SurfaceTileCulling.h"
 
 #include "Components/InputComponent.h"
+#include "Engine/World.h"
 #include "GameFramework/PlayerController.h"
 #include "GameFramework/PlayerInput.h"
 
@@ -25,9 +31,64 @@ private:
 
 #define TEST_TIME_LOG_SCOPE(Name) FTimeLogScope TimeLogScope_ ## Name(TEXT(#Name))
 
+namespace SurfacePolygonTestActor
+{
+	/// \brief 统计GPU数据中的有效三角形数量
+	static int32 CountGPUTriangles(const TSharedPtr<const FGPUPolygonData>& InGPUData)
+	{
+		int32 NumTriangles = 0;
+		if (InGPUData.IsValid())
+		{
+			for (const FGPUTrianglePacket& Packet : InGPUData->Packets)
+			{
+				NumTriangles += Packet.NumTriangles;
+			}
+		}
+		return NumTriangles;
+	}
+
+	/// \brief 地理围栏测试网格的每边方块数与方块边长
+	static constexpr int32 GeofenceGridSize = 8;
+	static constexpr float GeofenceCellSize = 1000.f;
+
+	/// \brief 暴力遍历全部三角形的三条边，返回点到最近边的距离（XY平面），用于校验FPolygonBVHQuery::QueryDistanceToEdges
+	static float DistanceToEdgesBruteForce(const FGPUPolygonData& InGPUData, const FVector2f& InPoint)
+	{
+		auto PointSegmentDistanceSquared = [&InPoint](float AX, float AY, float BX, float BY)
+			{
+				const FVector2f A(AX, AY);
+				const FVector2f AB = FVector2f(BX, BY) - A;
+				const float LengthSquared = AB.SizeSquared();
+				const float T = LengthSquared > 0.f ? FMath::Clamp(FVector2f::DotProduct(InPoint - A, AB) / LengthSquared, 0.f, 1.f) : 0.f;
+				return FVector2f::DistSquared(InPoint, A + AB * T);
+			};
+
+		float BestDistanceSquared = TNumericLimits<float>::Max();
+		for (const FGPUTrianglePacket& Packet : InGPUData.Packets)
+		{
+			for (int32 Lane = 0; Lane < Packet.NumTriangles; ++Lane)
+			{
+				BestDistanceSquared = FMath::Min(BestDistanceSquared, PointSegmentDistanceSquared(Packet.V1X[Lane], Packet.V1Y[Lane], Packet.V2X[Lane], Packet.V2Y[Lane]));
+				BestDistanceSquared = FMath::Min(BestDistanceSquared, PointSegmentDistanceSquared(Packet.V2X[Lane], Packet.V2Y[Lane], Packet.V3X[Lane], Packet.V3Y[Lane]));
+				BestDistanceSquared = FMath::Min(BestDistanceSquared, PointSegmentDistanceSquared(Packet.V3X[Lane], Packet.V3Y[Lane], Packet.V1X[Lane], Packet.V1Y[Lane]));
+			}
+		}
+		return FMath::Sqrt(BestDistanceSquared);
+	}
+}
+
 ASurfacePolygonTestActor::ASurfacePolygonTestActor()
 	: Opacity(1.f)
 	, Color(FLinearColor::Red)
+	, UnionToggleTestFailures(0)
+	, UnionToggleTestStep(INDEX_NONE)
+	, UnionToggleTestTriangles(0)
+	, GeofenceTestFailures(0)
+	, GeofenceTestStep(INDEX_NONE)
+	, GeofenceTestNumActors(0)
+	, GeofenceTestNumSteps(0)
+	, GeofenceTestRandomSeed(0)
+	, GeofenceTestOrderErrors(0)
 {
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -58,6 +119,16 @@ void ASurfacePolygonTestActor::Tick(float DeltaTime)
 	Super::Tick(DeltaTime);
 
 	SurfacePolygonComponent->SetProperties(Opacity, Color);
+
+	if (UnionToggleTestStep != INDEX_NONE)
+	{
+		TickUnionToggleTest();
+	}
+
+	if (GeofenceTestStep != INDEX_NONE)
+	{
+		TickGeofenceTest();
+	}
 }
 
 void ASurfacePolygonTestActor::SetCustomTriangles(const TArray<FTriangle>& InTriangles)
@@ -68,6 +139,593 @@ void ASurfacePolygonTestActor::SetCustomTriangles(const TArray<FTriangle>& InTri
 	}
 }
 
+int32 ASurfacePolygonTestActor::RunRegionLookupBenchmark(int32 InNumPoints, int32 InRandomSeed)
+{
+	TSharedPtr<const FGPUPolygonData> GPUData = SurfacePolygonComponent ? SurfacePolygonComponent->GetGPUPolygonData() : nullptr;
+	if (!GPUData.IsValid() || !GPUData->IsValid() || InNumPoints <= 0)
+	{
+		UE_LOG(LogSurfacePolygonTestActor, Warning, TEXT("多边形数据未构建，跳过区域查询基准测试"));
+		return 0;
+	}
+
+	// 在根节点包围盒内（外扩10%）生成随机点
+	const FGPUPolygonBVHNode& Root = GPUData->Nodes[GPUData->RootNodeIndex];
+	const FVector2f Min(Root.MinExtent.X, Root.MinExtent.Y);
+	const FVector2f Size = FVector2f(Root.MaxExtent.X, Root.MaxExtent.Y) - Min;
+
+	FRandomStream RandomStream(InRandomSeed);
+	TArray<FVector2f> Points;
+	Points.SetNumUninitialized(InNumPoints);
+	for (FVector2f& Point : Points)
+	{
+		Point = Min + FVector2f(RandomStream.FRandRange(-0.1f, 1.1f) * Size.X, RandomStream.FRandRange(-0.1f, 1.1f) * Size.Y);
+	}
+
+	// 暴力遍历
+	TArray<TArray<int32>> BruteForceResults;
+	BruteForceResults.SetNum(InNumPoints);
+	uint32 StartCycles = FPlatformTime::Cycles();
+	for (int32 Index = 0; Index < InNumPoints; ++Index)
+	{
+		FPolygonBVHQuery::QueryPointBruteForce(*GPUData, Points[Index], BruteForceResults[Index]);
+	}
+	const double BruteForceMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	// 逐点BVH查询（单线程、原始顺序）
+	TArray<int32> SerialResults;
+	SerialResults.SetNumUninitialized(InNumPoints);
+	StartCycles = FPlatformTime::Cycles();
+	for (int32 Index = 0; Index < InNumPoints; ++Index)
+	{
+		FPolygonBVHQuery::QueryPoint(*GPUData, Points[Index], SerialResults[Index]);
+	}
+	const double SerialMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	// 批量查询（Morton排序 + 并行）
+	TArray<int32> BatchResults;
+	StartCycles = FPlatformTime::Cycles();
+	FPolygonBVHQuery::QueryPoints(*GPUData, Points, BatchResults);
+	const double BatchMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	// 重叠区域可能返回任一包含点的多边形，只要求结果属于暴力遍历得到的集合
+	int32 NumMismatches = 0;
+	for (int32 Index = 0; Index < InNumPoints; ++Index)
+	{
+		const TArray<int32>& Expected = BruteForceResults[Index];
+		const bool bMatched = Expected.IsEmpty() ? BatchResults[Index] == INDEX_NONE : Expected.Contains(BatchResults[Index]);
+		if (!bMatched)
+		{
+			++NumMismatches;
+		}
+	}
+
+	UE_LOG(LogSurfacePolygonTestActor, Log, TEXT("区域查询基准测试: %d 个点, 暴力遍历 %.3f ms, 逐点查询 %.3f ms, 批量查询 %.3f ms (%.3f us/千次), 不一致 %d 个"),
+		InNumPoints, BruteForceMs, SerialMs, BatchMs, BatchMs * 1000.0 * 1000.0 / InNumPoints, NumMismatches);
+
+	return NumMismatches;
+}
+
+int32 ASurfacePolygonTestActor::RunTileCullingTest(int32 InViewportSize)
+{
+	TSharedPtr<const FGPUPolygonData> GPUData = SurfacePolygonComponent ? SurfacePolygonComponent->GetGPUPolygonData() : nullptr;
+	if (!GPUData.IsValid() || !GPUData->IsValid() || InViewportSize < FSurfaceTileCulling::TileSize)
+	{
+		UE_LOG(LogSurfacePolygonTestActor, Warning, TEXT("多边形数据未构建，跳过分块剔除测试"));
+		return 0;
+	}
+
+	FPolygonLayerMasks LayerMasks;
+	LayerMasks.Build(*GPUData, {});
+	const uint32 VisibleLayers = ~0u;
+
+	// 斜向俯视根节点包围盒中心，画面上部为天空（深度为0）
+	const FGPUPolygonBVHNode& Root = GPUData->Nodes[GPUData->RootNodeIndex];
+	const FVector Center = FVector((Root.MinExtent + Root.MaxExtent) * 0.5f);
+	const double Distance = FMath::Max(FVector2D(Root.MaxExtent.X - Root.MinExtent.X, Root.MaxExtent.Y - Root.MinExtent.Y).GetMax(), 1000.0);
+	const FSurfaceTileView View = FSurfaceTileCulling::MakeObliqueView(Center, Distance, -35.f, InViewportSize);
+	TArray<float> DeviceDepth;
+	FSurfaceTileCulling::BuildPlaneDepth(View, Center.Z, DeviceDepth);
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	FSurfaceTileCandidates TileCandidates;
+	FSurfaceTileCulling::CullPolygonTiles(View, DeviceDepth, *GPUData, LayerMasks, VisibleLayers, TileCandidates);
+	const double CullMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	const FSurfaceTileCullingCheck Check = FSurfaceTileCulling::CheckTileCandidates(View, DeviceDepth, TileCandidates,
+		[&GPUData, &LayerMasks, VisibleLayers](const FVector3f& InWorldPosition, const FVector2f& InScreenPosition, TArray<int32>& OutLeafNodes)
+		{
+			const FVector2f PixelPosition(InWorldPosition.X, InWorldPosition.Y);
+			return FSurfaceTileCulling::CullPolygonBVH(GPUData->Nodes, LayerMasks.NodeLayerMasks, VisibleLayers, FBox2f(PixelPosition, PixelPosition), OutLeafNodes);
+		});
+
+	UE_LOG(LogSurfacePolygonTestActor, Log, TEXT("分块剔除测试: %s, 像素平均访问叶子 %.2f 个, 剔除耗时 %.3f ms, 候选缺失 %d 个像素"),
+		*TileCandidates.DescribeStats(), Check.GetAveragePixelLeafNodes(), CullMs, Check.NumMismatches);
+
+	return Check.NumMismatches;
+}
+
+int32 ASurfacePolygonTestActor::RunPrismMeshTest(int32 InNumPolygons, int32 InRandomSeed)
+{
+	if (InNumPolygons <= 0)
+	{
+		return 0;
+	}
+
+	constexpr float MinZ = -1000.f;
+	constexpr float MaxZ = 5000.f;
+	constexpr float CellSize = 1000.f;
+
+	// 每个多边形位于独立网格单元内，顶点按多边形共享索引，扇形剖分
+	FRandomStream RandomStream(InRandomSeed);
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(InNumPolygons)));
+	FPolygonMeshData MeshData;
+	TArray<FVector2f> Centers;
+	Centers.SetNumUninitialized(InNumPolygons);
+	int32 NumExpectedVertices = 0;
+	int32 NumExpectedTriangles = 0;
+	double InputArea = 0.0;
+	for (int32 PolygonIndex = 0; PolygonIndex < InNumPolygons; ++PolygonIndex)
+	{
+		const int32 NumSides = RandomStream.RandRange(3, 8);
+		const FVector2f Center((PolygonIndex % GridSize + 0.5f) * CellSize, (PolygonIndex / GridSize + 0.5f) * CellSize);
+		const float Radius = RandomStream.FRandRange(0.2f, 0.45f) * CellSize;
+		const float StartAngle = RandomStream.FRandRange(0.f, UE_TWO_PI);
+		Centers[PolygonIndex] = Center;
+
+		const uint32 FirstVertex = MeshData.Vertices.Num();
+		for (int32 Side = 0; Side < NumSides; ++Side)
+		{
+			const float Angle = StartAngle + UE_TWO_PI * Side / NumSides;
+			MeshData.Vertices.Emplace(Center.X + Radius * FMath::Cos(Angle), Center.Y + Radius * FMath::Sin(Angle), RandomStream.FRandRange(0.f, 100.f));
+		}
+
+		for (int32 Side = 1; Side + 1 < NumSides; ++Side)
+		{
+			// 输入绕序不影响结果，生成器会统一为逆时针
+			if (RandomStream.FRand() < 0.5f)
+			{
+				MeshData.Indices.Append({ FirstVertex, FirstVertex + Side, FirstVertex + Side + 1 });
+			}
+			else
+			{
+				MeshData.Indices.Append({ FirstVertex, FirstVertex + Side + 1, FirstVertex + Side });
+			}
+			MeshData.PolygonIds.Add(PolygonIndex);
+
+			const FVector3f& V0 = MeshData.Vertices[FirstVertex];
+			const FVector3f& V1 = MeshData.Vertices[FirstVertex + Side];
+			const FVector3f& V2 = MeshData.Vertices[FirstVertex + Side + 1];
+			InputArea += 0.5 * FMath::Abs((V1.X - V0.X) * (V2.Y - V0.Y) - (V1.Y - V0.Y) * (V2.X - V0.X));
+		}
+
+		// 退化三角形应被跳过，不产生顶点和侧面
+		if (RandomStream.FRand() < 0.2f)
+		{
+			MeshData.Indices.Append({ FirstVertex, FirstVertex + 1, FirstVertex });
+			MeshData.PolygonIds.Add(PolygonIndex);
+		}
+
+		NumExpectedVertices += NumSides * 2;
+		NumExpectedTriangles += (NumSides - 2) * 2 + NumSides * 2;
+	}
+
+	FPolygonPrismMesh PrismMesh;
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	const bool bBuilt = FPolygonPrismBuilder::BuildPrismMesh(MeshData, MinZ, MaxZ, PrismMesh);
+	const double BuildMs = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+
+	int32 NumFailures = 0;
+	auto Check = [&NumFailures](bool bCondition, const TCHAR* Message)
+		{
+			if (!bCondition)
+			{
+				UE_LOG(LogSurfacePolygonTestActor, Warning, TEXT("棱柱网格测试失败: %s"), Message);
+				++NumFailures;
+			}
+		};
+
+	Check(bBuilt, TEXT("生成失败"));
+	Check(PrismMesh.Vertices.Num() == NumExpectedVertices, TEXT("顶点数量与焊接后的输入顶点数量不一致"));
+	Check(PrismMesh.NumTriangles() == NumExpectedTriangles, TEXT("三角形数量与顶面、底面和边界侧面之和不一致"));
+	Check(FMath::IsNearlyEqual(PrismMesh.Bounds.Min.Z, MinZ) && FMath::IsNearlyEqual(PrismMesh.Bounds.Max.Z, MaxZ), TEXT("包围盒高度范围错误"));
+
+	// 底面/顶面顶点成对出现，XY一致
+	int32 NumBadVertexPairs = 0;
+	for (int32 Vertex = 0; Vertex + 1 < PrismMesh.Vertices.Num(); Vertex += 2)
+	{
+		const FPolygonPrismVertex& Bottom = PrismMesh.Vertices[Vertex];
+		const FPolygonPrismVertex& Top = PrismMesh.Vertices[Vertex + 1];
+		if (Bottom.Position.X != Top.Position.X || Bottom.Position.Y != Top.Position.Y || Bottom.PolygonIndex != Top.PolygonIndex
+			|| Bottom.Position.Z != MinZ || Top.Position.Z != MaxZ)
+		{
+			++NumBadVertexPairs;
+		}
+	}
+	Check(NumBadVertexPairs == 0, TEXT("底面与顶面顶点不成对"));
+
+	// 所有三角形朝外：顶面法线朝上，底面朝下，侧面水平且背离多边形中心（凸多边形）
+	int32 NumTop = 0;
+	int32 NumBottom = 0;
+	int32 NumSide = 0;
+	int32 NumBadWinding = 0;
+	double TopArea = 0.0;
+	for (int32 Triangle = 0; Triangle < PrismMesh.NumTriangles(); ++Triangle)
+	{
+		const FPolygonPrismVertex& A = PrismMesh.Vertices[PrismMesh.Indices[Triangle * 3 + 0]];
+		const FPolygonPrismVertex& B = PrismMesh.Vertices[PrismMesh.Indices[Triangle * 3 + 1]];
+		const FPolygonPrismVertex& C = PrismMesh.Vertices[PrismMesh.Indices[Triangle * 3 + 2]];
+		if (A.PolygonIndex != B.PolygonIndex || A.PolygonIndex != C.PolygonIndex || !Centers.IsValidIndex(A.PolygonIndex))
+		{
+			++NumBadWinding;
+			continue;
+		}
+
+		const FVector3f Normal = FVector3f::CrossProduct(B.Position - A.Position, C.Position - A.Position);
+		if (A.Position.Z == MaxZ && B.Position.Z == MaxZ && C.Position.Z == MaxZ)
+		{
+			++NumTop;
+			TopArea += 0.5 * Normal.Z;
+			NumBadWinding += Normal.Z > 0.f ? 0 : 1;
+		}
+		else if (A.Position.Z == MinZ && B.Position.Z == MinZ && C.Position.Z == MinZ)
+		{
+			++NumBottom;
+			NumBadWinding += Normal.Z < 0.f ? 0 : 1;
+		}
+		else
+		{
+			++NumSide;
+			const FVector2f Outward = FVector2f((A.Position + B.Position + C.Position) / 3.f) - Centers[A.PolygonIndex];
+			const bool bHorizontal = FMath::Abs(Normal.Z) <= KINDA_SMALL_NUMBER * Normal.Size();
+			NumBadWinding += bHorizontal && FVector2f::DotProduct(FVector2f(Normal), Outward) > 0.f ? 0 : 1;
+		}
+	}
+	Check(NumTop == NumBottom && NumTop * 2 + NumSide == NumExpectedTriangles, TEXT("顶面、底面、侧面数量不匹配"));
+	Check(NumBadWinding == 0, TEXT("存在朝内的三角形"));
+	Check(FMath::IsNearlyEqual(TopArea, InputArea, InputArea * 1e-4), TEXT("顶面面积与输入网格面积不一致"));
+
+	UE_LOG(LogSurfacePolygonTestActor, Log, TEXT("棱柱网格测试: %d 个多边形, %d 个输入三角形, 生成 %d 个顶点 %d 个三角形 (顶面 %d, 侧面 %d), 朝向错误 %d 个, 耗时 %.3f ms, 失败 %d 项"),
+		InNumPolygons, MeshData.NumTriangles(), PrismMesh.Vertices.Num(), PrismMesh.NumTriangles(), NumTop, NumSide, NumBadWinding, BuildMs, NumFailures);
+
+	return NumFailures;
+}
+
+void ASurfacePolygonTestActor::StartUnionToggleTest(int32 InNumSquares, int32 InRandomSeed)
+{
+	if (!SurfacePolygonComponent || InNumSquares <= 1 || UnionToggleTestStep != INDEX_NONE || GeofenceTestStep != INDEX_NONE)
+	{
+		return;
+	}
+
+	// 方块集中在较小的范围内，保证大量重叠
+	constexpr float HalfSize = 500.f;
+	const float Extent = HalfSize * FMath::Sqrt(static_cast<float>(InNumSquares));
+	FRandomStream RandomStream(InRandomSeed);
+	TSharedRef<FPolygonMeshData> NewMeshData = MakeShared<FPolygonMeshData>();
+	for (int32 SquareIndex = 0; SquareIndex < InNumSquares; ++SquareIndex)
+	{
+		const FVector2f Center(RandomStream.FRandRange(-Extent, Extent), RandomStream.FRandRange(-Extent, Extent));
+		const uint32 FirstVertex = NewMeshData->Vertices.Num();
+		NewMeshData->Vertices.Emplace(Center.X - HalfSize, Center.Y - HalfSize, 0.f);
+		NewMeshData->Vertices.Emplace(Center.X + HalfSize, Center.Y - HalfSize, 0.f);
+		NewMeshData->Vertices.Emplace(Center.X + HalfSize, Center.Y + HalfSize, 0.f);
+		NewMeshData->Vertices.Emplace(Center.X - HalfSize, Center.Y + HalfSize, 0.f);
+		NewMeshData->Indices.Append({ FirstVertex, FirstVertex + 1, FirstVertex + 2, FirstVertex, FirstVertex + 2, FirstVertex + 3 });
+		NewMeshData->PolygonIds.Append({ SquareIndex, SquareIndex });
+	}
+
+	UnionToggleTestMesh = NewMeshData;
+	UnionToggleTestFailures = INDEX_NONE;
+	UnionToggleTestTriangles = 0;
+	UnionToggleTestStep = 0;
+}
+
+void ASurfacePolygonTestActor::TickUnionToggleTest()
+{
+	using namespace SurfacePolygonTestActor;
+
+	if (!SurfacePolygonComponent || SurfacePolygonComponent->IsBuildingBVH())
+	{
+		return;
+	}
+
+	const int32 NumInputTriangles = UnionToggleTestMesh->NumTriangles();
+	const int32 NumGPUTriangles = CountGPUTriangles(SurfacePolygonComponent->GetGPUPolygonData());
+	auto Check = [this](bool bCondition, const TCHAR* Message)
+		{
+			if (!bCondition)
+			{
+				UE_LOG(LogSurfacePolygonTestActor, Warning, TEXT("并集开关测试失败: %s"), Message);
+				++UnionToggleTestFailures;
+			}
+		};
+
+	switch (UnionToggleTestStep)
+	{
+	case 0:
+		// 先关闭并集（可能触发一次重建），再设置测试网格
+		if (SurfacePolygonComponent->bUnionOverlappingPolygons)
+		{
+			SurfacePolygonComponent->SetUnionOverlappingPolygons(false);
+			return;
+		}
+		UnionToggleTestFailures = 0;
+		SurfacePolygonComponent->SetIndexedMesh(UnionToggleTestMesh.ToSharedRef());
+		break;
+
+	case 1:
+		UnionToggleTestTriangles = NumGPUTriangles;
+		Check(NumGPUTriangles == NumInputTriangles, TEXT("未开启并集时GPU三角形数量与输入不一致"));
+		SurfacePolygonComponent->SetUnionOverlappingPolygons(true);
+		break;
+
+	case 2:
+		UE_LOG(LogSurfacePolygonTestActor, Log, TEXT("并集开关测试: 输入 %d 个三角形, 并集后 %d 个三角形"), NumInputTriangles, NumGPUTriangles);
+		Check(NumGPUTriangles > 0 && NumGPUTriangles != UnionToggleTestTriangles, TEXT("开启并集后GPU三角形数量未变化"));
+		Check(SurfacePolygonComponent->GetNumInputTriangles() == NumInputTriangles, TEXT("开启并集后输入网格被替换"));
+		SurfacePolygonComponent->SetUnionOverlappingPolygons(false);
+		break;
+
+	default:
+		Check(NumGPUTriangles == UnionToggleTestTriangles, TEXT("关闭并集后GPU三角形数量未恢复"));
+		Check(SurfacePolygonComponent->GetNumInputTriangles() == NumInputTriangles, TEXT("关闭并集后输入网格被替换"));
+		UE_LOG(LogSurfacePolygonTestActor, Log, TEXT("并集开关测试完成: 失败 %d 项"), UnionToggleTestFailures);
+		UnionToggleTestMesh.Reset();
+		UnionToggleTestStep = INDEX_NONE;
+		return;
+	}
+
+	++UnionToggleTestStep;
+}
+
+void ASurfacePolygonTestActor::StartGeofenceTest(int32 InNumActors, int32 InNumSteps, int32 InRandomSeed)
+{
+	using namespace SurfacePolygonTestActor;
+
+	if (!SurfacePolygonComponent || InNumActors <= 0 || InNumSteps <= 0 || UnionToggleTestStep != INDEX_NONE || GeofenceTestStep != INDEX_NONE)
+	{
+		return;
+	}
+
+	// 相邻方块共享边，跨越共享边时同一帧内先离开再进入
+	TSharedRef<FPolygonMeshData> NewMeshData = MakeShared<FPolygonMeshData>();
+	for (int32 Y = 0; Y < GeofenceGridSize; ++Y)
+	{
+		for (int32 X = 0; X < GeofenceGridSize; ++X)
+		{
+			const FVector2f Min(X * GeofenceCellSize, Y * GeofenceCellSize);
+			const uint32 FirstVertex = NewMeshData->Vertices.Num();
+			NewMeshData->Vertices.Emplace(Min.X, Min.Y, 0.f);
+			NewMeshData->Vertices.Emplace(Min.X + GeofenceCellSize, Min.Y, 0.f);
+			NewMeshData->Vertices.Emplace(Min.X + GeofenceCellSize, Min.Y + GeofenceCellSize, 0.f);
+			NewMeshData->Vertices.Emplace(Min.X, Min.Y + GeofenceCellSize, 0.f);
+			NewMeshData->Indices.Append({ FirstVertex, FirstVertex + 1, FirstVertex + 2, FirstVertex, FirstVertex + 2, FirstVertex + 3 });
+
+			const int32 PolygonIndex = Y * GeofenceGridSize + X;
+			NewMeshData->PolygonIds.Append({ PolygonIndex, PolygonIndex });
+		}
+	}
+
+	GeofenceTestMesh = NewMeshData;
+	GeofenceTestNumActors = InNumActors;
+	GeofenceTestNumSteps = InNumSteps;
+	GeofenceTestRandomSeed = InRandomSeed;
+	GeofenceTestFailures = INDEX_NONE;
+	GeofenceTestStep = 0;
+}
+
+void ASurfacePolygonTestActor::TickGeofenceTest()
+{
+	if (!SurfacePolygonComponent || SurfacePolygonComponent->IsBuildingBVH())
+	{
+		return;
+	}
+
+	if (GeofenceTestStep == 0)
+	{
+		// 关闭并集（可能触发一次重建），相邻方块才会保持为不同的多边形
+		if (SurfacePolygonComponent->bUnionOverlappingPolygons)
+		{
+			SurfacePolygonComponent->SetUnionOverlappingPolygons(false);
+			return;
+		}
+		SurfacePolygonComponent->SetIndexedMesh(GeofenceTestMesh.ToSharedRef());
+		++GeofenceTestStep;
+		return;
+	}
+
+	USurfaceGeofenceSubsystem* Subsystem = USurfaceGeofenceSubsystem::Get(this);
+	if (!Subsystem || Subsystem->GetNumTrackedActors() > 0)
+	{
+		UE_LOG(LogSurfacePolygonTestActor, Warning, TEXT("地理围栏子系统不可用或正在跟踪其他Actor，跳过地理围栏测试"));
+		GeofenceTestFailures = 1;
+	}
+	else
+	{
+		RunGeofenceWalk(*Subsystem);
+	}
+
+	GeofenceTestMesh.Reset();
+	GeofenceTestStep = INDEX_NONE;
+}
+
+void ASurfacePolygonTestActor::RunGeofenceWalk(USurfaceGeofenceSubsystem& InSubsystem)
+{
+	using namespace SurfacePolygonTestActor;
+
+	const TSharedPtr<const FGPUPolygonData> GPUData = SurfacePolygonComponent->GetGPUPolygonData();
+	if (!GPUData.IsValid() || !GPUData->IsValid())
+	{
+		UE_LOG(LogSurfacePolygonTestActor, Warning, TEXT("地理围栏测试失败: 测试网格未构建"));
+		GeofenceTestFailures = 1;
+		return;
+	}
+
+	// 最大安全半径小于方块边长，跳跃步移动超过该距离即必须重新查询
+	const float SavedMaxSafeRadius = InSubsystem.MaxSafeRadius;
+	const float MaxSafeRadius = GeofenceCellSize * 0.5f;
+	InSubsystem.MaxSafeRadius = MaxSafeRadius;
+	InSubsystem.OnEnterPolygon.AddDynamic(this, &ASurfacePolygonTestActor::OnGeofenceTestEnter);
+	InSubsystem.OnExitPolygon.AddDynamic(this, &ASurfacePolygonTestActor::OnGeofenceTestExit);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<AActor*> Actors;
+	for (int32 ActorIndex = 0; ActorIndex < GeofenceTestNumActors; ++ActorIndex)
+	{
+		AActor* Actor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+		if (!Actor)
+		{
+			continue;
+		}
+
+		USceneComponent* ActorRoot = NewObject<USceneComponent>(Actor, TEXT("RootComponent"));
+		Actor->SetRootComponent(ActorRoot);
+		ActorRoot->RegisterComponent();
+
+		Actors.Add(Actor);
+		GeofenceTestEventPolygons.Add(Actor, INDEX_NONE);
+		InSubsystem.RegisterActor(Actor, SurfacePolygonComponent);
+	}
+
+	GeofenceTestOrderErrors = 0;
+	int32 NumMissedRequeries = 0;
+	int32 NumUnexpectedRequeries = 0;
+	int32 NumPolygonMismatches = 0;
+	int32 NumEventMismatches = 0;
+	int32 NumRadiusErrors = 0;
+	int32 NumRequeriesSkipped = 0;
+
+	// 所在多边形与暴力遍历一致，且事件推算的多边形与子系统记录一致
+	TArray<int32> ExpectedPolygons;
+	auto VerifyPolygon = [&](AActor* Actor, const FVector2f& Location)
+		{
+			const int32 CurrentPolygon = InSubsystem.GetCurrentPolygon(Actor);
+			FPolygonBVHQuery::QueryPointBruteForce(*GPUData, Location, ExpectedPolygons);
+			if (ExpectedPolygons.IsEmpty() ? CurrentPolygon != INDEX_NONE : !ExpectedPolygons.Contains(CurrentPolygon))
+			{
+				++NumPolygonMismatches;
+			}
+			if (GeofenceTestEventPolygons.FindRef(Actor) != CurrentPolygon)
+			{
+				++NumEventMismatches;
+			}
+		};
+
+	// 在网格范围内（外扩10%）生成随机位置，网格外不在任何多边形内
+	const float GridExtent = GeofenceGridSize * GeofenceCellSize;
+	const float Z = GetActorLocation().Z;
+	FRandomStream RandomStream(GeofenceTestRandomSeed);
+	TArray<FVector2f> QueriedLocations;
+	QueriedLocations.Init(FVector2f(-GridExtent, -GridExtent), Actors.Num());
+
+	for (int32 Step = 0; Step < GeofenceTestNumSteps; ++Step)
+	{
+		// 跳跃：离开上次查询位置超过最大安全半径
+		for (int32 ActorIndex = 0; ActorIndex < Actors.Num(); ++ActorIndex)
+		{
+			FVector2f Location;
+			do
+			{
+				Location = FVector2f(RandomStream.FRandRange(-0.1f, 1.1f) * GridExtent, RandomStream.FRandRange(-0.1f, 1.1f) * GridExtent);
+			} while (FVector2f::Distance(Location, QueriedLocations[ActorIndex]) <= MaxSafeRadius);
+
+			Actors[ActorIndex]->SetActorLocation(FVector(Location.X, Location.Y, Z));
+			QueriedLocations[ActorIndex] = Location;
+		}
+
+		InSubsystem.Tick(0.f);
+		NumMissedRequeries += Actors.Num() - InSubsystem.LastNumRequeried;
+
+		for (int32 ActorIndex = 0; ActorIndex < Actors.Num(); ++ActorIndex)
+		{
+			const FVector2f& Location = QueriedLocations[ActorIndex];
+			VerifyPolygon(Actors[ActorIndex], Location);
+
+			// 安全半径不能超过到最近边的真实距离，BVH查询结果应等于真实距离（以最大安全半径为上限）
+			const float TrueDistance = DistanceToEdgesBruteForce(*GPUData, Location);
+			const float Tolerance = 1e-3f * FMath::Max(1.f, TrueDistance);
+			const float SafeRadius = InSubsystem.GetSafeRadius(Actors[ActorIndex]);
+			const float QueriedDistance = FPolygonBVHQuery::QueryDistanceToEdges(*GPUData, Location, MaxSafeRadius);
+			if (SafeRadius > TrueDistance + Tolerance || !FMath::IsNearlyEqual(QueriedDistance, FMath::Min(TrueDistance, MaxSafeRadius), Tolerance))
+			{
+				++NumRadiusErrors;
+			}
+		}
+
+		// 停留：在安全半径内移动，不应重新查询，所在多边形也不会改变
+		for (int32 ActorIndex = 0; ActorIndex < Actors.Num(); ++ActorIndex)
+		{
+			const float SafeRadius = InSubsystem.GetSafeRadius(Actors[ActorIndex]);
+			const float Angle = RandomStream.FRandRange(0.f, UE_TWO_PI);
+			const FVector2f Location = QueriedLocations[ActorIndex] + FVector2f(FMath::Cos(Angle), FMath::Sin(Angle)) * SafeRadius * RandomStream.FRandRange(0.f, 0.9f);
+			Actors[ActorIndex]->SetActorLocation(FVector(Location.X, Location.Y, Z));
+		}
+
+		InSubsystem.Tick(0.f);
+		NumUnexpectedRequeries += InSubsystem.LastNumRequeried;
+		NumRequeriesSkipped += Actors.Num() - InSubsystem.LastNumRequeried;
+
+		for (AActor* Actor : Actors)
+		{
+			const FVector ActorLocation = Actor->GetActorLocation();
+			VerifyPolygon(Actor, FVector2f(ActorLocation.X, ActorLocation.Y));
+		}
+	}
+
+	InSubsystem.OnEnterPolygon.RemoveDynamic(this, &ASurfacePolygonTestActor::OnGeofenceTestEnter);
+	InSubsystem.OnExitPolygon.RemoveDynamic(this, &ASurfacePolygonTestActor::OnGeofenceTestExit);
+	InSubsystem.MaxSafeRadius = SavedMaxSafeRadius;
+	for (AActor* Actor : Actors)
+	{
+		InSubsystem.UnregisterActor(Actor);
+		Actor->Destroy();
+	}
+	GeofenceTestEventPolygons.Reset();
+
+	GeofenceTestFailures = GeofenceTestOrderErrors + NumMissedRequeries + NumUnexpectedRequeries + NumPolygonMismatches + NumEventMismatches + NumRadiusErrors;
+	if (Actors.Num() != GeofenceTestNumActors)
+	{
+		++GeofenceTestFailures;
+	}
+
+	UE_LOG(LogSurfacePolygonTestActor, Log, TEXT("地理围栏测试: %d 个Actor, %d 步, 停留时跳过查询 %d 次; 事件顺序错误 %d, 漏查询 %d, 多余查询 %d, 多边形不一致 %d, 事件不一致 %d, 安全半径错误 %d, 失败 %d 项"),
+		Actors.Num(), GeofenceTestNumSteps, NumRequeriesSkipped, GeofenceTestOrderErrors, NumMissedRequeries, NumUnexpectedRequeries,
+		NumPolygonMismatches, NumEventMismatches, NumRadiusErrors, GeofenceTestFailures);
+}
+
+void ASurfacePolygonTestActor::OnGeofenceTestEnter(AActor* InActor, USurfacePolygonComponent* InFence, int32 InPolygonIndex)
+{
+	int32* EventPolygon = GeofenceTestEventPolygons.Find(InActor);
+	if (!EventPolygon || InFence != SurfacePolygonComponent)
+	{
+		return;
+	}
+
+	// 进入新多边形之前必须已离开旧多边形
+	if (*EventPolygon != INDEX_NONE)
+	{
+		++GeofenceTestOrderErrors;
+	}
+	*EventPolygon = InPolygonIndex;
+}
+
+void ASurfacePolygonTestActor::OnGeofenceTestExit(AActor* InActor, USurfacePolygonComponent* InFence, int32 InPolygonIndex)
+{
+	int32* EventPolygon = GeofenceTestEventPolygons.Find(InActor);
+	if (!EventPolygon || InFence != SurfacePolygonComponent)
+	{
+		return;
+	}
+
+	if (*EventPolygon != InPolygonIndex)
+	{
+		++GeofenceTestOrderErrors;
+	}
+	*EventPolygon = INDEX_NONE;
+}
+
 void ASurfacePolygonTestActor::OnLeftMouseButtonPressed()
 {
 	APlayerController* PC = GetWorld()->GetFirstPlayerController();
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SurfaceGeofenceSubsystem.generated.h"
+
+
+class USurfacePolygonComponent;
+struct FGPUPolygonData;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnSurfaceGeofenceEvent, AActor*, Actor, USurfacePolygonComponent*, Fence, int32, PolygonIndex);
+
+/**
+ * @brief 地理围栏子系统 - 跟踪已注册Actor进入/离开USurfacePolygonComponent中的多边形
+ *
+ * 负责：
+ * 1. 每个Actor缓存当前所在多边形，以及到最近三角形边的保守"安全半径"
+ * 2. Actor离开上次查询位置超过安全半径（或多边形数据重建）后才重新查询
+ * 3. 需要重新查询的Actor分批并行查询，事件在游戏线程广播
+ */
+UCLASS()
+class UTILITYTOOLS_API USurfaceGeofenceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static USurfaceGeofenceSubsystem* Get(const UObject* WorldContextObject);
+
+	//~ Begin UTickableWorldSubsystem Interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End UTickableWorldSubsystem Interface
+
+	/// \brief 注册需要跟踪的Actor及其使用的多边形围栏
+	UFUNCTION(BlueprintCallable, Category = "SurfaceGeofence")
+	void RegisterActor(AActor* InActor, USurfacePolygonComponent* InFence);
+
+	/// \brief 注销Actor，不广播离开事件
+	UFUNCTION(BlueprintCallable, Category = "SurfaceGeofence")
+	void UnregisterActor(AActor* InActor);
+
+	/// \brief 获取Actor当前所在的多边形索引，未注册或不在任何多边形内时返回-1
+	UFUNCTION(BlueprintCallable, Category = "SurfaceGeofence")
+	int32 GetCurrentPolygon(AActor* InActor) const;
+
+	/// \brief 获取Actor上次查询得到的安全半径，未注册时返回0
+	UFUNCTION(BlueprintCallable, Category = "SurfaceGeofence")
+	float GetSafeRadius(AActor* InActor) const;
+
+	/// \brief 获取已注册的Actor数量
+	UFUNCTION(BlueprintCallable, Category = "SurfaceGeofence")
+	int32 GetNumTrackedActors() const { return TrackedActors.Num(); }
+
+public:
+	/// \brief Actor进入多边形
+	UPROPERTY(BlueprintAssignable, Category = "SurfaceGeofence")
+	FOnSurfaceGeofenceEvent OnEnterPolygon;
+
+	/// \brief Actor离开多边形
+	UPROPERTY(BlueprintAssignable, Category = "SurfaceGeofence")
+	FOnSurfaceGeofenceEvent OnExitPolygon;
+
+	/// \brief 安全半径上限，限制距离查询的遍历范围
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfaceGeofence", meta = (ClampMin = "0"))
+	float MaxSafeRadius = 10000.0f;
+
+	/// \brief 上一帧重新查询的Actor数量
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SurfaceGeofence")
+	int32 LastNumRequeried = 0;
+
+private:
+	/// \brief 被跟踪的Actor
+	struct FTrackedActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<USurfacePolygonComponent> Fence;
+
+		TWeakPtr<const FGPUPolygonData> QueriedData;	///< 上次查询使用的多边形数据，重建后需重新查询（不延长旧数据的生命周期）
+		FVector2f QueriedLocation;						///< 上次查询位置（XY平面）
+		float SafeRadius;								///< 在该半径内移动不会改变所在多边形
+		int32 CurrentPolygon;							///< 当前所在多边形索引
+
+		// 本帧的临时数据，Data只在需要重新查询时设置，查询后释放
+		FVector2f Location;
+		TSharedPtr<const FGPUPolygonData> Data;
+		int32 NewPolygon;
+	};
+
+	TArray<FTrackedActor> TrackedActors;
+};
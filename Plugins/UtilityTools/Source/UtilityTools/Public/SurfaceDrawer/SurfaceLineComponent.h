@@ -7,8 +7,15 @@
 #include "SurfaceLineComponent.generated.h"
 
 	
+class FLineBVHBuilder;
 class FSurfaceLineSceneProxy;
+class FSurfacePolygonIdPicker;
 struct FGPULineData;
+struct FGPULineDataPatch;
+struct FLineRefitIndices;
+struct FSurfacePolygonSoup;
+struct FGPULineStyle;
+struct FLineStyleTable;
 
 /**
  * @brief SurfaceLine组件 - 用于多边形线段贴地绘制
@@ -18,8 +25,10 @@ struct FGPULineData;
  * 2. 管理多边形线段渲染参数配置（颜色、宽度、透明度等）
  * 3. 扩展渲染管线，进行贴地线段绘制
  *
- * 用户仅需考虑使用SetPolygons提供多边形数据，将自动构建BVH空间加速结构，
+ * 用户仅需考虑使用SetPolygons提供多边形数据（或使用SetContourGrid从网格生成等值线），将自动构建BVH空间加速结构，
+ * 大规模数据在C++中使用SetPolygonSoup传入扁平多边形数据，避免逐多边形分配和复制，GeoJSON文件使用LoadGeoJson直接导入，
  * 然后使用SetProperties设置线段渲染参数（颜色、宽度、透明度等），将自动更新场景代理，
+ * 需要多种样式时使用SetLineStyles设置样式表，并用SetPolygonStyle为每个多边形指定样式，所有样式在同一个Pass中渲染。
  */
 UCLASS(HideCategories = (Cooking, AssetUserData, Navigation, Variable, ComponentReplication, Replication, Tags, Activation),
 	ClassGroup = (SurfaceLine), BlueprintType, meta = (BlueprintSpawnableComponent))
@@ -33,6 +42,32 @@ public:
 	/// \brief 设置线段数据
 	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
 	void SetPolygons(const TArray<FPolygon>& InPolygons);
+
+	/// \brief 从网格（地形高度图或任意标量场）生成等值线作为线段数据，等值线生成与BVH构建均在后台线程完成
+	///
+	/// 折线按等值顺序排列，折线索引即多边形索引，可配合SetPolygonStyles为不同等值指定样式
+	/// \param InHeights 网格点数值，按行优先排列（X变化最快），数量为InSizeX * InSizeY
+	/// \param InOrigin 网格点(0, 0)的世界XY坐标
+	/// \param InCellSize 相邻网格点的世界间距
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	void SetContourGrid(const TArray<float>& InHeights, int32 InSizeX, int32 InSizeY, const FVector2D& InOrigin, const FVector2D& InCellSize, const TArray<float>& InIsoLevels);
+
+	/// \brief 设置扁平多边形数据（移动传入），后台线程直接读取顶点数组，不经过FPolygon
+	///
+	/// PolygonStyleIndices非空时同时替换多边形样式索引
+	void SetPolygonSoup(FSurfacePolygonSoup&& InPolygonSoup);
+
+	/// \brief 设置扁平多边形数据（共享只读），调用方可以继续持有同一份数据
+	void SetPolygonSoup(const TSharedRef<const FSurfacePolygonSoup>& InPolygonSoup);
+
+	/// \brief 导入GeoJSON文件中的线要素和多边形轮廓，文件解析与BVH构建均在后台线程完成
+	///
+	/// 每条LineString和每个多边形环为一条折线，折线索引按要素在文件中的顺序排列
+	/// \param InOrigin 投影原点（经度、纬度；bInProjectedMeters为true时为投影坐标）
+	/// \param bInProjectedMeters 文件坐标已经是以米为单位的投影坐标
+	/// \param InUnitsPerMeter 每米对应的世界单位
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	void LoadGeoJson(const FString& InFilePath, const FVector2D& InOrigin, bool bInProjectedMeters = false, float InUnitsPerMeter = 100.f);
 	
 	/// \brief 设置属性
 	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
@@ -50,9 +85,54 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
 	void SetLineColor(const FLinearColor& InLineColor);
 	
+	/// \brief 设置线样式表，非空时替代LineWidth/LineOpacity/LineColor，多边形通过样式索引引用
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	void SetLineStyles(const TArray<FSurfaceLineStyle>& InLineStyles);
+
+	/// \brief 设置每个多边形的样式索引（按多边形索引排列），未指定或越界的多边形使用样式0
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	void SetPolygonStyles(const TArray<int32>& InPolygonStyleIndices);
+
+	/// \brief 设置单个多边形的样式索引，仅更新样式缓冲区，不重建BVH
+	///
+	/// 索引不小于当前数据的多边形数量时忽略；数据尚未构建完成时只限制索引上限
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	void SetPolygonStyle(int32 InPolygonIndex, int32 InStyleIndex);
+	
 	/// \brief 清空多边形数据
 	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
 	void ClearPolygons();
+
+	/// \brief 替换单个多边形的顶点，不重建BVH：只更新其线段和向上到根节点的包围盒，渲染时只上传修改的部分
+	///
+	/// 修改在后台线程应用到数据副本，完成后回到游戏线程替换，同一时间提交的多次修改合并应用。
+	/// 新的顶点数须划分为与原来相同数量的线段簇（每簇最多128条线段），多边形不存在或正在异步构建时返回false，
+	/// 第一次修改时局部修改索引尚未生成，这类修改在后台线程被拒绝并输出警告。
+	/// 被拒绝时需要通过SetPolygons等重新构建。频繁编辑后BVH质量会下降，可在编辑结束后重新构建一次
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	bool UpdatePolygon(int32 InPolygonIndex, const TArray<FVector>& InVertices);
+
+	/// \brief 查询XY平面上距离指定位置最近的线段（最大距离InMaxDistance内）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	bool QueryNearestSegment(const FVector& InLocation, float InMaxDistance, FSurfaceLineHit& OutHit) const;
+
+	/// \brief 查询XY平面上与指定位置距离不超过InRadius的全部线段，返回线段数量
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	int32 QuerySegmentsInRadius(const FVector& InLocation, float InRadius, TArray<FSurfaceLineHit>& OutHits) const;
+
+	/// \brief 查询XY平面上射线首先命中的线段
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	bool RaycastSegment(const FVector& InOrigin, const FVector& InDirection, float InMaxDistance, FSurfaceLineHit& OutHit) const;
+
+	/// \brief 开启/关闭GPU多边形ID拾取
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	void SetPolygonPickingEnabled(bool bEnabled);
+
+	/// \brief 获取鼠标光标下的线段所属多边形索引，没有命中时返回-1
+	///
+	/// 以当前光标位置更新拾取区域，返回的是GPU回读的结果，相对光标滞后若干帧。需要先开启bEnablePolygonPicking
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineComponent")
+	int32 GetPolygonUnderCursor();
 	
 public:
 	/// \brief BVH构建配置
@@ -86,6 +166,18 @@ public:
 	/// \brief 自定义纹理
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfaceLineComponent")
 	TObjectPtr<UTexture2D> CustomTexture;
+
+	/// \brief 线样式表，为空时使用LineWidth/LineOpacity/LineColor作为唯一样式
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfaceLineComponent")
+	TArray<FSurfaceLineStyle> LineStyles;
+
+	/// \brief 自定义纹理横向划分的图集槽位数量，样式的AtlasSlot在其中选择
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfaceLineComponent", meta = (ClampMin = "1"))
+	int32 NumAtlasSlots;
+
+	/// \brief 是否输出多边形ID纹理用于光标拾取
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfaceLineComponent")
+	bool bEnablePolygonPicking;
 	
 protected:
 	//~ Begin UActorComponent Interface.
@@ -99,6 +191,12 @@ protected:
 private:
 	/// \brief 异步构建BVH数据
 	void AsyncBuildBVHData(const TArray<FPolygon>& InPolygons);
+
+	/// \brief 在后台线程创建构建器并构建BVH，构建器为空表示数据源读取失败，保留现有线段数据
+	void LaunchAsyncBuild(TUniqueFunction<TSharedPtr<FLineBVHBuilder>(const FBVHBuildConfig&)>&& InMakeBuilder);
+
+	/// \brief 在后台线程把等待中的多边形修改应用到当前数据的副本，完成后回到游戏线程替换
+	void LaunchPolygonEdits();
 	
 	// 管理渲染代理
 	void CreateSceneProxy();
@@ -106,17 +204,54 @@ private:
 	void DestroySceneProxy();
 
 	void MarkGeometryDataDirty();
+	void MarkPolygonStylesDirty();
+
+	/// \brief 收集当前生效的样式（样式表为空时由组件属性生成一个默认样式）
+	void GatherLineStyles(TArray<FGPULineStyle>& OutStyles) const;
 	
 private:
-	/// \brief BVH节点数据纹理
+	/// \brief BVH节点数据纹理，游戏线程所有（查询使用），局部修改时原地修补；渲染线程持有自己的副本
 	TSharedPtr<FGPULineData> GPULineData;
+
+	/// \brief 构建结果在后台线程复制的渲染线程副本，下次更新场景代理时移交
+	TSharedPtr<FGPULineData> RenderGPULineData;
 	
 	/// \brief 场景代理
 	TSharedPtr<FSurfaceLineSceneProxy> SceneProxy;
+
+	/// \brief 多边形ID拾取器，开启拾取时与场景代理共享
+	TSharedPtr<FSurfacePolygonIdPicker> PolygonIdPicker;
 	
 	/// \brief 异步构建状态标志
 	std::atomic<bool> IsAsyncBuilding;
 
 	/// \brief 池化缓冲区状态标志
 	bool bBuffersInitialized;
+
+	/// \brief 上次更新场景代理后UpdatePolygon的修改，渲染线程据此修补自己的副本，缓冲区需要完整上传时不使用
+	TSharedPtr<FGPULineDataPatch> GeometryPatch;
+
+	/// \brief 局部修改使用的索引，第一次修改时在后台线程生成，替换为新构建的数据后失效
+	TSharedPtr<const FLineRefitIndices> RefitIndices;
+
+	/// \brief 等待应用的多边形修改（多边形索引和新的顶点）
+	TArray<TPair<int32, TArray<FVector2f>>> PendingPolygonEdits;
+
+	/// \brief 是否有多边形修改正在后台线程应用
+	bool bPolygonEditInFlight;
+
+	/// \brief 用户指定的多边形样式索引（按PolygonIndex索引）
+	TArray<int32> PolygonStyleIndices;
+
+	/// \brief 当前数据的多边形数量（最大多边形索引加一），随构建结果更新
+	int32 NumPolygons;
+
+	/// \brief 与当前样式对应的样式表
+	TSharedPtr<const FLineStyleTable> StyleTable;
+
+	/// \brief 多边形样式索引需要重新计算
+	bool bPolygonStylesDirty;
+
+	/// \brief 样式缓冲区状态标志
+	bool bStyleBuffersInitialized;
 };
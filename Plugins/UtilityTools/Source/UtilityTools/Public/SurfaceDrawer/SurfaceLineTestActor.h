@@ -25,6 +25,76 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
 	void SetCustomPolygons(const TArray<FPolygon>& Polygons);
 
+	/// \brief 等值线基准测试：以Actor位置为原点生成起伏地形网格，统计等值线生成耗时，并把结果交给SurfaceLine组件显示
+	/// \return 等值线生成耗时（毫秒）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	float RunContourBenchmark(int32 InGridSize = 4033, int32 InNumLevels = 16, float InCellSize = 100.f);
+
+	/// \brief 扁平多边形基准测试：以相同的随机多边形比较TArray<FPolygon>（含传入异步任务时的复制）与FSurfacePolygonSoup构建BVH的耗时，
+	/// 并把扁平数据交给SurfaceLine组件显示
+	/// \return 扁平多边形的耗时（毫秒）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	float RunPolygonSoupBenchmark(int32 InNumPolygons = 20000, int32 InVerticesPerPolygon = 100, int32 InRandomSeed = 0);
+
+	/// \brief GeoJSON导入基准测试：在Saved目录生成线与带洞多边形交替的FeatureCollection，统计导入吞吐量，
+	/// 校验要素数量和每条折线首顶点的投影坐标，并把结果交给SurfaceLine组件显示
+	/// \return 导入耗时（毫秒）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	float RunGeoJsonBenchmark(int32 InNumFeatures = 20000, int32 InVerticesPerFeature = 100, int32 InRandomSeed = 0);
+
+	/// \brief 分块剔除测试：在Actor周围生成随机多边形，斜向俯视地面生成深度，用CPU模拟分块计算着色器的剔除步骤，
+	/// 校验每个像素逐像素遍历BVH访问的叶子节点都按相同顺序出现在其分块的候选中，并统计空分块比例和候选数量
+	/// \return 候选缺失的像素数量（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	int32 RunTileCullingTest(int32 InNumPolygons = 5000, int32 InViewportSize = 1024, int32 InRandomSeed = 0);
+
+	/// \brief 屏幕范围测试：随机生成相机和包围盒（包括相机位于包围盒内部的情况），
+	/// 在包围盒内均匀采样并逐点投影，校验所有落在视口内的采样点都位于FSurfaceScreenBounds计算的矩形内；
+	/// 再把包围盒的XY范围作为地表数据，校验该范围内任意高度的可见点都位于代理的全屏Pass视口内
+	/// \return 落在矩形外的采样点数量（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	int32 RunScreenBoundsTest(int32 InNumBoxes = 2000, int32 InViewportSize = 1024, int32 InRandomSeed = 0);
+
+	/// \brief 起始子树剔除测试：近距离斜向俯视随机多边形，按视图覆盖范围剔除BVH前几层，
+	/// 校验起始子树数量不超过上限，且地表位于数据高度和远低于数据高度时，
+	/// 逐像素从根节点遍历访问的叶子节点都位于起始子树内，访问顺序与起始子树的顺序一致
+	/// \return 遍历结果不一致的像素数量（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	int32 RunSeedCullingTest(int32 InNumPolygons = 5000, int32 InViewportSize = 1024, int32 InRandomSeed = 0);
+
+	/// \brief 局部修改测试：随机生成多边形并构建BVH，逐次以顶点数随机的新圆替换随机选取的多边形（FLineDataConverter::RefitPolyline），
+	/// 校验线段与最新顶点一致、每个Cluster和节点的包围盒与其线段和子节点一致，并统计每次修改需要上传的字节数；
+	/// 校验原始数据一次写入所有修改累积的补丁（FGPULineDataPatch::Append）后与逐次修改的结果一致；最后将原始数据上传到共享缓冲区、只写入所有修改的范围（FSurfaceBufferArena::UploadDirtyRanges），回读并与CPU上的结果比较
+	/// \return 不一致的线段、Cluster、节点和回读元素数量（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	int32 RunRefitTest(int32 InNumPolygons = 20000, int32 InNumEdits = 100, int32 InRandomSeed = 0);
+
+	/// \brief 共享缓冲区分配器测试：随机分配和释放大小跨越几个数量级的范围，偶尔紧凑排列，
+	/// 校验分配互不重叠、空闲范围有序且已合并、两者恰好覆盖整个容量，以及紧凑排列的拷贝使每个分配的内容保持不变
+	/// \return 校验失败的次数（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	int32 RunArenaAllocatorTest(int32 InNumOperations = 20000, int32 InRandomSeed = 0);
+
+	/// \brief 共享缓冲区回读测试：随机分配、上传和释放使容量多次扩大，部分分配经UploadDirtyRanges重新分配，回读校验每个分配的内容；
+	/// 再释放大部分分配并整理（FSurfaceBufferArena::Defragment），回读校验偏移变化后内容不变，以及整理后分配和释放同样多的元素不会再次扩容或整理。
+	/// 测试期间临时关闭上传预算（r.SurfaceDrawer.UploadBudgetKB）
+	/// \return 校验失败的次数（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	int32 RunArenaBufferTest(int32 InNumAllocations = 200, int32 InRandomSeed = 0);
+
+	/// \brief 获取覆盖缓存（r.SurfaceDrawer.CoverageCache）累计的命中和失效次数，每个组件每帧计一次
+	/// \param bInReset 读取后清零
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	void GetCoverageCacheCounters(int64& OutNumHits, int64& OutNumMisses, bool bInReset = false);
+
+	/// \brief 获取几何数据分帧上传（r.SurfaceDrawer.UploadBudgetKB）的统计：最近一次上传的耗时和帧数，以及最近一个有上传的帧的上传量
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	void GetUploadStats(float& OutLastUploadMs, int32& OutLastUploadFrames, int64& OutLastFrameUploadBytes);
+
+	/// \brief 获取SurfaceLine/SurfacePolygon共享几何缓冲区的总容量、已分配的字节数以及紧凑排列的累计次数
+	UFUNCTION(BlueprintCallable, Category = "SurfaceLineTest")
+	void GetArenaStats(int64& OutCapacityBytes, int64& OutUsedBytes, int32& OutNumDefragments);
+
 private:
 	void OnLeftMouseButtonPressed();
 	void OnMiddleMouseButtonPressed();
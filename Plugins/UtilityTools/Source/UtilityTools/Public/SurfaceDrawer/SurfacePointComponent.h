@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "SurfaceDrawer/BVHConfig.h"
+#include "SurfacePointComponent.generated.h"
+
+
+class FSurfacePointSceneProxy;
+struct FGPUPointData;
+
+/**
+ * @brief SurfacePoint组件 - 用于大量地图点（传感器、POI等）贴地绘制
+ *
+ * 负责：
+ * 1. 管理点数据及其空间网格构建
+ * 2. 管理点渲染参数配置（不透明度、图标纹理等）
+ * 3. 扩展渲染管线，进行贴地圆/图标绘制
+ *
+ * 用户仅需使用SetPoints提供点数据，将在后台线程构建空间网格，
+ * 每个点自带半径、颜色和图标槽位，所有点在同一个Pass中渲染，并可使用CPU查询进行范围检测。
+ */
+UCLASS(HideCategories = (Cooking, AssetUserData, Navigation, Variable, ComponentReplication, Replication, Tags, Activation),
+	ClassGroup = (SurfacePoint), BlueprintType, meta = (BlueprintSpawnableComponent))
+class UTILITYTOOLS_API USurfacePointComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	USurfacePointComponent();
+
+	/// \brief 设置点数据
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	void SetPoints(const TArray<FSurfacePoint>& InPoints);
+
+	/// \brief 清空点数据
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	void ClearPoints();
+
+	/// \brief 设置不透明度
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	void SetOpacity(float InOpacity);
+
+	/// \brief 设置图标纹理及其横向划分的图集槽位数量
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	void SetIconTexture(UTexture2D* InIconTexture, int32 InNumIconSlots);
+
+	/// \brief 切换像素/世界单位半径，单元边长的选择随之改变，使用当前点重新构建空间网格
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	void SetUsePixelUnit(bool bInUsePixelUnit);
+
+	/// \brief 查询XY平面上与指定位置距离不超过InRadius的全部点，结果按距离升序排列，返回点数量
+	/// \param bIncludePointRadius 为true时计入点自身半径（世界单位），查询圆与点的圆相交即命中
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	int32 QueryPointsInRadius(const FVector& InLocation, float InRadius, TArray<FSurfacePointHit>& OutHits, bool bIncludePointRadius = false) const;
+
+	/// \brief 查询XY平面上距离指定位置最近的点（最大距离InMaxDistance内）
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointComponent")
+	bool QueryNearestPoint(const FVector& InLocation, float InMaxDistance, FSurfacePointHit& OutHit) const;
+
+	/// \brief 获取当前的GPU点数据（异步构建完成前为空）
+	TSharedPtr<const FGPUPointData> GetGPUPointData() const { return GPUPointData; }
+
+public:
+	/// \brief 不透明度
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointComponent", meta = (ClampMin = "0", ClampMax = "1"))
+	float Opacity;
+
+	/// \brief 是否使用像素单位半径，运行时使用SetUsePixelUnit切换
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfacePointComponent")
+	bool bUsePixelUnit;
+
+	/// \brief 图标纹理，点的IconSlot在其中选择图标
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointComponent")
+	TObjectPtr<UTexture2D> IconTexture;
+
+	/// \brief 图标纹理横向划分的图集槽位数量
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointComponent", meta = (ClampMin = "1"))
+	int32 NumIconSlots;
+
+	/// \brief 空间网格单元边长，0表示按点密度和最大半径自动选择
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointComponent", meta = (ClampMin = "0"))
+	float GridCellSize;
+
+protected:
+	//~ Begin UActorComponent Interface.
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	virtual void CreateRenderState_Concurrent(FRegisterComponentContext* Context) override;
+	virtual void DestroyRenderState_Concurrent() override;
+	virtual bool ShouldCreateRenderState() const override;
+	//~ End UActorComponent Interface.
+
+private:
+	/// \brief 异步构建空间网格
+	void AsyncBuildGridData(const TArray<FSurfacePoint>& InPoints);
+
+	/// \brief 在后台线程获取输入点并构建空间网格，结果回到游戏线程替换
+	void LaunchAsyncBuild(TUniqueFunction<void(TArray<FSurfacePoint>&)>&& InGatherPoints);
+
+	// 管理渲染代理
+	void CreateSceneProxy();
+	void UpdateSceneProxy();
+	void DestroySceneProxy();
+
+	void MarkGeometryDataDirty();
+
+private:
+	/// \brief 点网格数据
+	TSharedPtr<const FGPUPointData> GPUPointData;
+
+	/// \brief 场景代理
+	TSharedPtr<FSurfacePointSceneProxy> SceneProxy;
+
+	/// \brief 异步构建状态标志
+	std::atomic<bool> IsAsyncBuilding;
+
+	/// \brief 池化缓冲区状态标志
+	bool bBuffersInitialized;
+};
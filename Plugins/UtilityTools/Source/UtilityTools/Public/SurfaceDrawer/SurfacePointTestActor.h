@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "SurfaceDrawer/SurfacePointComponent.h"
+#include "SurfacePointTestActor.generated.h"
+
+/**
+ * @brief SurfacePointTestActor类
+ *
+ * 该类用于测试USurfacePointComponent
+ */
+UCLASS()
+class UTILITYTOOLS_API ASurfacePointTestActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ASurfacePointTestActor();
+
+	/// \brief 以Actor位置为中心，在边长为InExtent的正方形内随机生成点
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointTest")
+	void SpawnRandomPoints(int32 InNumPoints = 1000000, float InExtent = 1000000.f, int32 InRandomSeed = 0);
+
+	/// \brief 半径查询基准测试：在点范围内随机生成查询位置，比较暴力遍历与网格查询的耗时，
+	/// 并以暴力遍历结果校验网格查询的正确性（需要在SpawnRandomPoints构建完成后调用）
+	/// \return 结果与暴力遍历不一致的查询数
+	UFUNCTION(BlueprintCallable, Category = "SurfacePointTest")
+	int32 RunRadiusQueryBenchmark(int32 InNumQueries = 1000, float InRadius = 5000.f, int32 InRandomSeed = 0);
+
+public:
+	/// \brief SurfacePoint组件
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointTest")
+	TObjectPtr<USurfacePointComponent> SurfacePointComponent;
+
+	/// \brief 随机点的半径范围
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointTest")
+	FVector2D RadiusRange;
+
+	/// \brief 随机点的图标槽位数量，0表示全部绘制为纯色圆
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePointTest", meta = (ClampMin = "0"))
+	int32 NumIconSlots;
+
+private:
+	/// \brief 最近一次生成的点，用于暴力遍历校验
+	TArray<FSurfacePoint> Points;
+};
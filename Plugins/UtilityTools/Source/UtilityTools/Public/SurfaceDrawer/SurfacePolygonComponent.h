@@ -8,6 +8,11 @@
 
 class  FSurfacePolygonSceneProxy;
 struct FGPUPolygonData;
+struct FPolygonMeshData;
+struct FPolygonLayerMasks;
+struct FPolygonLayerMaskPatch;
+struct FPolygonPrismMesh;
+class  FSurfacePolygonIdPicker;
 /**
  * @brief USurfacePolygon组件 - 用于多边形面贴地绘制
  * 
@@ -16,7 +21,7 @@ struct FGPUPolygonData;
  * 2. 管理多边形面渲染参数配置（颜色、透明度等）
  * 3. 扩展渲染管线，进行贴地面绘制
  *
- * 用户仅需考虑使用SetTriangles提供三角形数据，将自动构建BVH空间加速结构，
+ * 用户仅需考虑使用SetTriangles（或C++中使用SetIndexedMesh、LoadGeoJson）提供三角形数据，将自动构建BVH空间加速结构，
  * 然后使用SetProperties设置渲染参数（颜色、不透明度等），将自动更新场景代理，
  */
 UCLASS(HideCategories = (Cooking, AssetUserData, Navigation, Variable, ComponentReplication, Replication, Tags, Activation),
@@ -32,6 +37,24 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
 	void SetTriangles(const TArray<FTriangle>& InTriangles);
 
+	/// \brief 设置索引网格数据：单精度顶点、三角形索引、每个三角形的多边形ID（移动语义，不复制）
+	void SetIndexedMesh(TArray<FVector3f>&& InVertices, TArray<uint32>&& InIndices, TArray<int32>&& InPolygonIds);
+
+	/// \brief 设置索引网格数据（数组视图，仅复制一次到共享网格）
+	void SetIndexedMesh(TConstArrayView<FVector3f> InVertices, TConstArrayView<uint32> InIndices, TConstArrayView<int32> InPolygonIds);
+
+	/// \brief 设置共享的索引网格数据，构建过程只持有引用
+	void SetIndexedMesh(const TSharedRef<const FPolygonMeshData>& InMeshData);
+
+	/// \brief 导入GeoJSON文件中的多边形要素（含洞），文件解析与三角化在后台线程完成，之后按SetIndexedMesh构建
+	///
+	/// 多边形索引为要素在文件中的索引，同一要素的所有多边形共用一个索引
+	/// \param InOrigin 投影原点（经度、纬度；bInProjectedMeters为true时为投影坐标）
+	/// \param bInProjectedMeters 文件坐标已经是以米为单位的投影坐标
+	/// \param InUnitsPerMeter 每米对应的世界单位
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void LoadGeoJson(const FString& InFilePath, const FVector2D& InOrigin, bool bInProjectedMeters = false, float InUnitsPerMeter = 100.f);
+
 	/// \brief 设置属性
 	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
 	void SetProperties(float InOpacity, const FLinearColor& InColor);
@@ -44,10 +67,63 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
 	void SetColor(const FLinearColor& InColor);
 
+	/// \brief 设置渲染模式，切换到模板阴影体模式时按需生成棱柱网格
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetRenderMode(ESurfacePolygonRenderMode InRenderMode);
+
+	/// \brief 设置棱柱高度范围（X为底面，Y为顶面），应包住多边形范围内的地形
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetPrismHeightRange(const FVector2D& InPrismHeightRange);
+
 	/// \brief 清空三角形数据
 	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
 	void ClearTriangles();
 
+	/// \brief 开启/关闭按图层求并集，基于用户输入的原始网格重新构建BVH；正在构建时在构建完成后重新构建
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetUnionOverlappingPolygons(bool bInUnionOverlappingPolygons);
+
+	/// \brief 设置多边形所属图层（位掩码），只上传该多边形和掩码变化的节点，不重建BVH
+	///
+	/// 索引不小于输入网格的多边形数量时忽略；网格尚未构建完成时只限制索引上限
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetPolygonLayerMask(int32 InPolygonIndex, int32 InLayerMask);
+
+	/// \brief 设置可见图层（位掩码），不产生任何缓冲区上传
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetVisibleLayers(int32 InVisibleLayers);
+
+	/// \brief 显示/隐藏单个图层（0~31）
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetLayerVisible(int32 InLayer, bool bVisible);
+
+	/// \brief 查询包含指定位置（XY平面）的可见多边形索引，不在任何多边形内时返回-1
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	int32 QueryPolygonAtLocation(const FVector& InLocation) const;
+
+	/// \brief 批量查询包含各位置（XY平面）的可见多边形索引，不在任何多边形内时为-1
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void QueryPolygonsAtLocations(const TArray<FVector>& InLocations, TArray<int32>& OutPolygonIndices) const;
+
+	/// \brief 开启/关闭GPU多边形ID拾取
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	void SetPolygonPickingEnabled(bool bEnabled);
+
+	/// \brief 获取鼠标光标下的可见多边形索引，没有命中时返回-1
+	///
+	/// 以当前光标位置更新拾取区域，返回的是GPU回读的结果，相对光标滞后若干帧。需要先开启bEnablePolygonPicking
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonComponent")
+	int32 GetPolygonUnderCursor();
+
+	/// \brief 获取用户输入网格的三角形数量（不受并集影响）
+	int32 GetNumInputTriangles() const;
+
+	/// \brief 是否正在异步构建BVH
+	bool IsBuildingBVH() const { return IsAsyncBuilding.load(); }
+
+	/// \brief 获取当前的GPU多边形数据（异步构建完成前为空），只在游戏线程替换，持有返回的共享指针即可安全读取
+	TSharedPtr<const FGPUPolygonData> GetGPUPolygonData() const { return GPUPolygonData; }
+
 protected:
 	//~ Begin UActorComponent Interface.
 	virtual void OnRegister() override;
@@ -59,7 +135,13 @@ protected:
 
 private:
 	/// \brief 异步构建BVH数据
-	void AsyncBuildBVHData(const TArray<FTriangle>& InTriangles);
+	void AsyncBuildBVHData(const TSharedPtr<const FPolygonMeshData>& InMeshData);
+
+	/// \brief 异步生成棱柱网格（模板阴影体模式）
+	void AsyncBuildPrismMesh();
+
+	/// \brief 生成棱柱使用的网格：开启并集时为合并后的网格，否则为用户输入
+	TSharedPtr<const FPolygonMeshData> GetPrismSourceMeshData() const { return UnionMeshData.IsValid() ? UnionMeshData : MeshData; }
 
 	// 管理渲染代理
 	void CreateSceneProxy();
@@ -67,20 +149,54 @@ private:
 	void DestroySceneProxy();
 
 	void MarkGeometryDataDirty();
+	void MarkLayerMasksDirty();
+	void MarkPrismDataDirty();
 
 public:
 	/// \brief BVH构建配置
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePolygonComponent")
 	FBVHBuildConfig BVHBuildConfig;
 
+	/// \brief 构建BVH之前按图层求并集，消除同一图层内多边形的重叠
+	///
+	/// 适用于大量重叠且填充相同的多边形（如缓冲区）。同一图层掩码的多边形合并为一个，
+	/// 使用组内最小的多边形索引，查询和拾取得到的也是该索引。图层掩码应在设置三角形之前指定，
+	/// 运行时使用SetUnionOverlappingPolygons切换
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfacePolygonComponent")
+	bool bUnionOverlappingPolygons;
+
+	/// \brief 渲染模式
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfacePolygonComponent")
+	ESurfacePolygonRenderMode RenderMode;
+
+	/// \brief 棱柱高度范围（X为底面，Y为顶面），仅模板阴影体模式使用
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfacePolygonComponent")
+	FVector2D PrismHeightRange;
+
+	/// \brief 是否输出多边形ID纹理用于光标拾取
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "SurfacePolygonComponent")
+	bool bEnablePolygonPicking;
+
 	/// \brief BVH统计信息
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SurfacePolygonComponent")
 	FBVHStats BVHStats;
 
 private:
+	/// \brief 用户输入的网格数据，重新构建（如切换并集）时使用
+	TSharedPtr<const FPolygonMeshData> MeshData;
+
+	/// \brief 按图层求并集后的网格，未开启并集时为空；只用于生成棱柱
+	TSharedPtr<const FPolygonMeshData> UnionMeshData;
+
 	/// \brief GPU 多边形面数据
 	TSharedPtr<FGPUPolygonData> GPUPolygonData;
 
+	/// \brief 棱柱网格（模板阴影体模式）
+	TSharedPtr<const FPolygonPrismMesh> PrismMesh;
+
+	/// \brief 棱柱缓冲区状态标志
+	bool bPrismBuffersInitialized;
+
 	/// \brief 场景代理
 	TSharedPtr<FSurfacePolygonSceneProxy> SceneProxy;
 
@@ -90,6 +206,33 @@ private:
 	/// \brief 池化缓冲区状态标志
 	bool bBuffersInitialized;
 
+	/// \brief 用户指定的多边形图层掩码（按PolygonIndex索引，未指定的使用默认图层）
+	TArray<uint32> PolygonLayerMasks;
+
+	/// \brief 当前输入网格的多边形数量（最大多边形索引加一），随构建结果更新
+	int32 NumInputPolygons;
+
+	/// \brief 与当前GPU数据对应的多边形/节点图层掩码，只在游戏线程访问，局部修改时原地更新（渲染线程持有自己的副本）
+	TSharedPtr<FPolygonLayerMasks> LayerMasks;
+
+	/// \brief 可见图层掩码
+	uint32 VisibleLayers;
+
+	/// \brief 图层掩码需要重新计算
+	bool bLayerMasksDirty;
+
+	/// \brief 上次更新场景代理之后修改过图层的多边形，只重新计算并上传这些多边形及其所在子树的掩码
+	TArray<int32> ChangedLayerPolygons;
+
+	/// \brief 局部修改图层掩码后尚未传给场景代理的修改范围及新值
+	TSharedPtr<FPolygonLayerMaskPatch> LayerMaskPatch;
+
+	/// \brief 图层掩码缓冲区状态标志
+	bool bLayerBuffersInitialized;
+
+	/// \brief 多边形ID拾取器，开启拾取时与场景代理共享
+	TSharedPtr<FSurfacePolygonIdPicker> PolygonIdPicker;
+
 	/// \brief 颜色
 	FLinearColor Color;
 
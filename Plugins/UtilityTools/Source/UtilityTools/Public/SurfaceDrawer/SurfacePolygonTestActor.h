@@ -5,6 +5,8 @@
 #include "SurfaceDrawer/SurfacePolygonComponent.h"
 #include "SurfacePolygonTestActor.generated.h"
 
+class USurfaceGeofenceSubsystem;
+
 UCLASS()
 class UTILITYTOOLS_API ASurfacePolygonTestActor : public AActor
 {
@@ -20,10 +22,56 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonTest")
 	void SetCustomTriangles(const TArray<FTriangle>& InTriangles);
 
+	/// \brief 区域查询基准测试：在多边形范围内随机生成点，比较暴力遍历、逐点查询与批量查询的耗时，
+	/// 并以暴力遍历结果校验批量查询的正确性
+	/// \return 结果与暴力遍历不一致的点数
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonTest")
+	int32 RunRegionLookupBenchmark(int32 InNumPoints = 20000, int32 InRandomSeed = 0);
+
+	/// \brief 分块剔除测试：斜向俯视多边形范围生成深度，用CPU模拟分块计算着色器的剔除步骤，
+	/// 校验每个像素逐像素遍历BVH访问的叶子节点都按相同顺序出现在其分块的候选中，并统计空分块比例和候选数量
+	/// \return 候选缺失的像素数量（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonTest")
+	int32 RunTileCullingTest(int32 InViewportSize = 1024);
+
+	/// \brief 棱柱网格测试：随机生成互不重叠的凸多边形（扇形剖分，部分三角形为顺时针，并混入退化三角形），
+	/// 不依赖渲染线程直接生成棱柱网格，校验顶点与索引数量、顶面/底面/侧面朝向以及顶面面积与输入网格一致
+	/// \return 校验失败的项数（应为0）
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonTest")
+	int32 RunPrismMeshTest(int32 InNumPolygons = 200, int32 InRandomSeed = 0);
+
+	/// \brief 并集开关测试：设置相互重叠的随机方块，依次以关闭、开启、再关闭并集的方式构建，
+	/// 校验开启并集后GPU三角形数量变化、关闭后恢复为输入网格的数量，且用户输入网格始终不变。
+	/// 每一步等待异步构建完成后在Tick中推进，结束后结果写入UnionToggleTestFailures
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonTest")
+	void StartUnionToggleTest(int32 InNumSquares = 200, int32 InRandomSeed = 0);
+
+	/// \brief 地理围栏测试：设置相邻方块组成的网格，在地理围栏子系统中注册一组Actor后交替执行"跳跃"和"停留"两种移动，
+	/// 跳跃步的距离超过最大安全半径，校验每个Actor都重新查询、离开事件先于进入事件且与所在多边形一致、
+	/// 安全半径不超过暴力遍历得到的到最近三角形边的距离；停留步只在安全半径内移动，校验没有任何Actor重新查询。
+	/// 等待异步构建完成后在Tick中执行，测试期间子系统不能跟踪其他Actor，结果写入GeofenceTestFailures
+	UFUNCTION(BlueprintCallable, Category = "SurfacePolygonTest")
+	void StartGeofenceTest(int32 InNumActors = 64, int32 InNumSteps = 50, int32 InRandomSeed = 0);
+
 private:
 	void OnLeftMouseButtonPressed();
 	void OnMiddleMouseButtonPressed();
 
+	/// \brief 推进并集开关测试（上一步的异步构建完成后执行下一步）
+	void TickUnionToggleTest();
+
+	/// \brief 推进地理围栏测试（测试网格构建完成后一次执行全部移动步骤）
+	void TickGeofenceTest();
+
+	/// \brief 地理围栏测试的移动与校验
+	void RunGeofenceWalk(USurfaceGeofenceSubsystem& InSubsystem);
+
+	/// \brief 地理围栏测试的事件回调，校验同一Actor的离开/进入事件交替出现
+	UFUNCTION()
+	void OnGeofenceTestEnter(AActor* InActor, USurfacePolygonComponent* InFence, int32 InPolygonIndex);
+	UFUNCTION()
+	void OnGeofenceTestExit(AActor* InActor, USurfacePolygonComponent* InFence, int32 InPolygonIndex);
+
 public:
 	/// \brief SurfacePolygon组件
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePolygonTest")
@@ -37,7 +85,41 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "SurfacePolygonTest")
 	FLinearColor Color;
 
+	/// \brief 并集开关测试的失败项数（应为0），测试进行中为-1
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SurfacePolygonTest")
+	int32 UnionToggleTestFailures;
+
+	/// \brief 地理围栏测试的失败项数（应为0），测试进行中为-1
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "SurfacePolygonTest")
+	int32 GeofenceTestFailures;
+
 private:
 	/// \brief 点击位置集合
 	TArray<FVector> Positions;
+
+	/// \brief 并集开关测试的当前步骤，INDEX_NONE表示未进行
+	int32 UnionToggleTestStep;
+
+	/// \brief 并集开关测试的输入网格
+	TSharedPtr<const FPolygonMeshData> UnionToggleTestMesh;
+
+	/// \brief 并集关闭时GPU数据的三角形数量
+	int32 UnionToggleTestTriangles;
+
+	/// \brief 地理围栏测试的当前步骤，INDEX_NONE表示未进行
+	int32 GeofenceTestStep;
+
+	/// \brief 地理围栏测试的输入网格
+	TSharedPtr<const FPolygonMeshData> GeofenceTestMesh;
+
+	/// \brief 地理围栏测试的参数
+	int32 GeofenceTestNumActors;
+	int32 GeofenceTestNumSteps;
+	int32 GeofenceTestRandomSeed;
+
+	/// \brief 按事件推算的每个测试Actor所在多边形
+	TMap<TWeakObjectPtr<AActor>, int32> GeofenceTestEventPolygons;
+
+	/// \brief 事件顺序错误次数（进入前未离开，或离开的不是当前多边形）
+	int32 GeofenceTestOrderErrors;
 };